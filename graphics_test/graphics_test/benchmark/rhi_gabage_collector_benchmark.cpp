@@ -0,0 +1,8 @@
+﻿
+#include "ngl/rhi/rhi_object_garbage_collect_test.h"
+
+int main()
+{
+	ngl::rhi::test::GabageCollectorTest();
+	return 0;
+}
@@ -0,0 +1,8 @@
+﻿
+#include "ngl/memory/tlsf_allocator_core_test.h"
+
+int main()
+{
+	ngl::memory::test::TlsfAllocatorCoreBenchmark();
+	return 0;
+}
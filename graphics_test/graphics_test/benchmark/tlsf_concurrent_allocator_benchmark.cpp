@@ -0,0 +1,8 @@
+﻿
+#include "ngl/memory/tlsf_concurrent_allocator_test.h"
+
+int main()
+{
+	ngl::memory::test::TlsfConcurrentAllocatorTest();
+	return 0;
+}
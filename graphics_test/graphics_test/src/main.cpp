@@ -11,6 +11,7 @@
 #include "ngl/boot/boot_application.h"
 #include "ngl/platform/window.h"
 #include "ngl/util/time/timer.h"
+#include "ngl/util/time/profiler.h"
 #include "ngl/memory/tlsf_memory_pool.h"
 #include "ngl/memory/tlsf_allocator.h"
 #include "ngl/file/file.h"
@@ -18,6 +19,7 @@
 #include "ngl/math/math.h"
 
 #include "ngl/thread/job_thread.h"
+#include "ngl/thread/parallel_for.h"
 
 // resource
 #include "ngl/resource/resource_manager.h"
@@ -34,6 +36,9 @@
 #include "ngl/gfx/render/global_render_resource.h"
 #include "ngl/gfx/raytrace_scene.h"
 #include "ngl/gfx/mesh_component.h"
+#include "ngl/gfx/render/mesh_bvh.h"
+#include "ngl/gfx/render/mesh_culling.h"
+#include "ngl/gfx/render/mesh_instance_buffer.h"
 
 #include "ngl/render/test_render_path.h"
 
@@ -60,6 +65,8 @@ static bool dbgw_enable_pass_render_parallel = true;
 static float dbgw_perf_main_thread_sleep_millisec = 0.0f;
 static bool dbgw_enable_sub_view_path = false;
 static bool dbgw_enable_raytrace_pass = false;
+static bool dbgw_enable_mesh_culling = true;
+static bool dbgw_enable_mesh_bvh = true;
 static bool dbgw_view_half_dot_gray = false;
 static bool dbgw_view_gbuffer = true;
 static bool dbgw_view_dshadow = true;
@@ -69,6 +76,16 @@ static float dbgw_dlit_angle_h = 4.1f;
 static float dbgw_stat_primary_rtg_construct = {};
 static float dbgw_stat_primary_rtg_compile = {};
 static float dbgw_stat_primary_rtg_execute = {};
+static ngl::u32 dbgw_stat_primary_mesh_shape_total = {};
+static ngl::u32 dbgw_stat_primary_mesh_shape_visible = {};
+static ngl::u32 dbgw_stat_primary_shadow_shape_visible[ngl::test::RenderFrameOut::k_stat_shadow_cascade_max] = {};
+static ngl::u32 dbgw_stat_primary_shadow_shape_covered[ngl::test::RenderFrameOut::k_stat_shadow_cascade_max] = {};
+static ngl::u32 dbgw_stat_mesh_bvh_update_instance = {};
+static ngl::u32 dbgw_stat_mesh_bvh_refit_node = {};
+static ngl::u32 dbgw_stat_mesh_bvh_rebuild_count = {};
+static bool dbgw_profile_capture_pending = false;
+static constexpr int k_dbgw_profile_capture_frame = 60;
+static constexpr char k_dbgw_profile_capture_file[] = "./profile_trace.json";
 
 
 class PlayerController
@@ -101,13 +118,19 @@ public:
 	void LaunchRender();
 	
 private:
+	// Rtgの実行結果. フレームアリーナから確保するため現在フレームのみ有効.
 	struct RtgGenerateCommandListSet
 	{
-		std::vector<ngl::rtg::RtgSubmitCommandSequenceElem> graphics{};
-		std::vector<ngl::rtg::RtgSubmitCommandSequenceElem> compute{};
+		RtgGenerateCommandListSet(ngl::memory::FrameArenaAllocator* p_frame_arena)
+			: graphics(ngl::memory::FrameArenaStlAllocator<ngl::rtg::RtgSubmitCommandSequenceElem>(p_frame_arena))
+			, compute(ngl::memory::FrameArenaStlAllocator<ngl::rtg::RtgSubmitCommandSequenceElem>(p_frame_arena))
+		{
+		}
+		ngl::rtg::RtgSubmitCommandSequence graphics;
+		ngl::rtg::RtgSubmitCommandSequence compute;
 	};
 	// RenderThreadメイン処理 (RenderThread側).
-	void RenderApp(std::vector<RtgGenerateCommandListSet>& out_rtg_command_list_set);
+	void RenderApp(ngl::memory::FrameArenaVector<RtgGenerateCommandListSet>& out_rtg_command_list_set);
 private:
 	struct RenderParam
 	{
@@ -168,6 +191,14 @@ private:
 	// Meshオブジェクト管理.
 	std::vector<std::shared_ptr<ngl::gfx::StaticMeshComponent>>	mesh_comp_array_;
 	std::vector<ngl::gfx::StaticMeshComponent*>	test_move_mesh_comp_array_;
+	// シーンのBVH. RenderThreadが前フレームの参照中に更新しないようフレーム毎に切り替える.
+	std::array<ngl::gfx::SceneMeshBvh, 2>		mesh_bvh_;
+	int											mesh_bvh_flip_ = 0;
+	// Shape単位のワールドAABB. BVHと同様にフレーム毎に切り替える.
+	std::array<ngl::gfx::SceneMeshCulling, 2>	mesh_culling_;
+	int											mesh_culling_flip_ = 0;
+	// 全インスタンスのInstanceInfo. 内部でフレーム毎に切り替える.
+	ngl::gfx::MeshInstanceBuffer				mesh_instance_buffer_;
 	
 	// RaytraceScene.
 	ngl::gfx::RtSceneManager					rt_scene_;
@@ -207,6 +238,7 @@ AppGame::~AppGame()
 	
 	// リソース参照クリア.
 	mesh_comp_array_.clear();
+	mesh_instance_buffer_.Finalize();
 
 	// Material Shader Manager.
 	ngl::gfx::MaterialShaderManager::Instance().Finalize();
@@ -230,6 +262,11 @@ bool AppGame::Initialize()
 	constexpr auto scree_h = 1080;
 	constexpr auto scree_w = scree_h * 16/9;
 
+	// プロファイラのスレッド名.
+	ngl::time::Profiler::Instance().SetThreadName("MainThread");
+	render_thread_.Begin([]{ ngl::time::Profiler::Instance().SetThreadName("RenderThread"); });
+	render_thread_.Wait();
+
 	// ウィンドウ作成
 	if (!window_.Initialize(_T("ToyRenderer"), scree_w, scree_h))
 	{
@@ -298,6 +335,9 @@ bool AppGame::Initialize()
 	// RTGマネージャ初期化.
 	{
 		rtg_manager_.Init(&device_, 4);
+
+		// RHIオブジェクトの遅延破棄をRTGのJobSystemで並列実行.
+		device_.GetGabageCollector()->SetJobSystem(rtg_manager_.GetJobSystem());
 	}
 	
 	// imgui.
@@ -553,6 +593,7 @@ void AppGame::LaunchRender()
 	// RenderThreadでJob実行.
 	render_thread_.Begin([this]
 	{
+		NGL_PROFILE_SCOPE("RenderFrame");
 		// RenderThreadシステム先頭処理.
 		{
 			// このフレーム用のシステムCommandListをRtgから取得.
@@ -566,7 +607,7 @@ void AppGame::LaunchRender()
 
 		
 		// アプリケーション側のRender処理.
-		std::vector<RtgGenerateCommandListSet> app_rtg_command_list_set{};
+		auto app_rtg_command_list_set = ngl::memory::MakeFrameArenaVector<RtgGenerateCommandListSet>(device_.GetFrameArenaAllocator());
 		RenderApp(app_rtg_command_list_set);
 		
 	
@@ -683,7 +724,16 @@ bool AppGame::Execute()
 
 		// 再スタート
 		ngl::time::Timer::Instance().StartTimer("app_frame_sec");
+
+		// 前フレームまでのプロファイル記録を集計.
+		ngl::time::Profiler::Instance().EndFrame();
+		if (dbgw_profile_capture_pending && !ngl::time::Profiler::Instance().IsCapturing())
+		{
+			ngl::time::Profiler::Instance().ExportChromeTrace(k_dbgw_profile_capture_file);
+			dbgw_profile_capture_pending = false;
+		}
 	}
+	NGL_PROFILE_SCOPE("GameFrame");
 	const float delta_sec = static_cast<float>(frame_sec_);
 
 	
@@ -719,6 +769,31 @@ bool AppGame::Execute()
 			ImGui::Text("Rtg Construct: %f [sec]", dbgw_stat_primary_rtg_construct);
 			ImGui::Text("Rtg Compile  : %f [sec]", dbgw_stat_primary_rtg_compile);
 			ImGui::Text("Rtg Execute  : %f [sec]", dbgw_stat_primary_rtg_execute);
+			
+			ImGui::Text("Mesh Shape Visible: %u / %u (Culled %u)", dbgw_stat_primary_mesh_shape_visible, dbgw_stat_primary_mesh_shape_total, dbgw_stat_primary_mesh_shape_total - dbgw_stat_primary_mesh_shape_visible);
+			for (size_t ci = 0; ci < std::size(dbgw_stat_primary_shadow_shape_visible); ++ci)
+			{
+				ImGui::Text("  Shadow Cascade%zu Visible: %u / %u (Culled %u, Covered %u)", ci, dbgw_stat_primary_shadow_shape_visible[ci], dbgw_stat_primary_mesh_shape_total, dbgw_stat_primary_mesh_shape_total - dbgw_stat_primary_shadow_shape_visible[ci], dbgw_stat_primary_shadow_shape_covered[ci]);
+			}
+			ImGui::Text("Mesh Bvh Update Instance: %u, Refit Node: %u, Rebuild: %u", dbgw_stat_mesh_bvh_update_instance, dbgw_stat_mesh_bvh_refit_node, dbgw_stat_mesh_bvh_rebuild_count);
+
+			if (ImGui::TreeNode("Cpu Profile"))
+			{
+				const auto& profiler = ngl::time::Profiler::Instance();
+				for (const auto& e : profiler.GetLastFrameStat())
+				{
+					if (0 > e.parent)
+						ImGui::Text("[%s]", profiler.GetThreadName(e.thread_index));
+					ImGui::Text("%*s%s : %.3f [ms] (%u)", static_cast<int>(e.depth + 1) * 2, "", e.name, e.total_sec * 1000.0, e.count);
+				}
+				ImGui::TreePop();
+			}
+			if (!dbgw_profile_capture_pending && ImGui::Button("Capture Cpu Trace"))
+			{
+				// 指定フレーム数の記録をChrome Trace形式で出力.
+				ngl::time::Profiler::Instance().BeginCapture(k_dbgw_profile_capture_frame);
+				dbgw_profile_capture_pending = true;
+			}
 
 			ImGui::Separator();
 			ImGui::SliderFloat("Main Thread Sleep", &dbgw_perf_main_thread_sleep_millisec, 0.0f, 100.0f);
@@ -746,6 +821,8 @@ bool AppGame::Execute()
 		{
 			ImGui::Checkbox("Enable Raytrace Pass", &dbgw_enable_raytrace_pass);
 			ImGui::Checkbox("Enable SubView Render", &dbgw_enable_sub_view_path);
+			ImGui::Checkbox("Enable Mesh Culling", &dbgw_enable_mesh_culling);
+			ImGui::Checkbox("Enable Mesh Bvh", &dbgw_enable_mesh_bvh);
 		}
 		
 		ImGui::End();
@@ -771,14 +848,42 @@ bool AppGame::Execute()
 	// 描画用シーン情報.
 	ngl::gfx::SceneRepresentation frame_scene;
 	{
+		frame_scene.mesh_instance_array_.reserve(mesh_comp_array_.size());
 		for (auto& e : mesh_comp_array_)
 		{
-			// Render更新.
-			e->UpdateRenderData();
-
 			// 登録.
 			frame_scene.mesh_instance_array_.push_back(e.get());
 		}
+
+		// Render更新. 全インスタンスのInstanceInfoを一括で書き込む.
+		{
+			ngl::time::ScopedProfileZone zone_instance("MeshInstanceBufferUpdate");
+			frame_scene.p_mesh_instance_buffer_ = mesh_instance_buffer_.Update(&device_, frame_scene.mesh_instance_array_, rtg_manager_.GetJobSystem());
+		}
+
+		// BVH更新. 切り替え先を参照していた2フレーム前の描画は前フレームのSyncRenderで完了している.
+		if (dbgw_enable_mesh_bvh)
+		{
+			ngl::time::ScopedProfileZone zone_bvh("MeshBvhUpdate");
+			mesh_bvh_flip_ = 1 - mesh_bvh_flip_;
+			auto& mesh_bvh = mesh_bvh_[mesh_bvh_flip_];
+			mesh_bvh.Update(frame_scene.mesh_instance_array_, rtg_manager_.GetJobSystem());
+			frame_scene.p_mesh_bvh_ = &mesh_bvh;
+
+			dbgw_stat_mesh_bvh_update_instance = mesh_bvh.GetStatUpdateInstance();
+			dbgw_stat_mesh_bvh_refit_node = mesh_bvh.GetStatRefitNode();
+			dbgw_stat_mesh_bvh_rebuild_count += mesh_bvh.GetStatRebuild() ? 1 : 0;
+		}
+
+		// カリング用のShapeのワールドAABB構築. transform_ を参照するためGameThreadで構築し, RenderThreadは判定のみ行う.
+		if (dbgw_enable_mesh_culling)
+		{
+			ngl::time::ScopedProfileZone zone_culling("MeshCullingBuild");
+			mesh_culling_flip_ = 1 - mesh_culling_flip_;
+			auto& mesh_culling = mesh_culling_[mesh_culling_flip_];
+			mesh_culling.Build(frame_scene.mesh_instance_array_, rtg_manager_.GetJobSystem(), frame_scene.p_mesh_bvh_);
+			frame_scene.p_mesh_culling_ = &mesh_culling;
+		}
 	}
 
 	// RenderParamのセットアップ.
@@ -812,7 +917,7 @@ bool AppGame::Execute()
 }
 
 // アプリ側のRenderThread処理.
-void AppGame::RenderApp(std::vector<RtgGenerateCommandListSet>& out_rtg_command_list_set)
+void AppGame::RenderApp(ngl::memory::FrameArenaVector<RtgGenerateCommandListSet>& out_rtg_command_list_set)
 {
 	// フレームのSwapchainインデックス.
 	const auto swapchain_index = swapchain_->GetCurrentBufferIndex();
@@ -857,11 +962,12 @@ void AppGame::RenderApp(std::vector<RtgGenerateCommandListSet>& out_rtg_command_
 
 			{
 				render_frame_desc.debug_pass_render_parallel = dbgw_enable_pass_render_parallel;
+				render_frame_desc.debug_mesh_culling = dbgw_enable_mesh_culling;
 			}
 			// SubViewは最低限の設定.
 		}
 		
-		out_rtg_command_list_set.push_back({});
+		out_rtg_command_list_set.emplace_back(device_.GetFrameArenaAllocator());
 		RtgGenerateCommandListSet& rtg_result = out_rtg_command_list_set.back();
 		// Pathの実行 (RenderTaskGraphの構築と実行).
 		TestFrameRenderingPath(render_frame_desc, subview_render_frame_out, rtg_manager_, rtg_result.graphics, rtg_result.compute);
@@ -904,6 +1010,7 @@ void AppGame::RenderApp(std::vector<RtgGenerateCommandListSet>& out_rtg_command_
 
 			{
 				render_frame_desc.debug_pass_render_parallel = dbgw_enable_pass_render_parallel;
+				render_frame_desc.debug_mesh_culling = dbgw_enable_mesh_culling;
 				
 				render_frame_desc.debugview_halfdot_gray = dbgw_view_half_dot_gray;
 				render_frame_desc.debugview_subview_result = dbgw_enable_sub_view_path;
@@ -916,7 +1023,7 @@ void AppGame::RenderApp(std::vector<RtgGenerateCommandListSet>& out_rtg_command_
 		
 		swapchain_resource_state_[swapchain_index] = swapchain_final_state;// State変更.
 		
-		out_rtg_command_list_set.push_back({});
+		out_rtg_command_list_set.emplace_back(device_.GetFrameArenaAllocator());
 		RtgGenerateCommandListSet& rtg_result = out_rtg_command_list_set.back();
 		// Pathの実行 (RenderTaskGraphの構築と実行).
 		ngl::test::RenderFrameOut render_frame_out{};
@@ -928,6 +1035,14 @@ void AppGame::RenderApp(std::vector<RtgGenerateCommandListSet>& out_rtg_command_
 			dbgw_stat_primary_rtg_construct = render_frame_out.stat_rtg_construct_sec;
 			dbgw_stat_primary_rtg_compile = render_frame_out.stat_rtg_compile_sec;
 			dbgw_stat_primary_rtg_execute = render_frame_out.stat_rtg_execute_sec;
+			
+			dbgw_stat_primary_mesh_shape_total = render_frame_out.stat_mesh_shape_total;
+			dbgw_stat_primary_mesh_shape_visible = render_frame_out.stat_mesh_shape_visible;
+			for (size_t ci = 0; ci < std::size(dbgw_stat_primary_shadow_shape_visible); ++ci)
+			{
+				dbgw_stat_primary_shadow_shape_visible[ci] = render_frame_out.stat_shadow_shape_visible[ci];
+				dbgw_stat_primary_shadow_shape_covered[ci] = render_frame_out.stat_shadow_shape_covered[ci];
+			}
 		}
 	}
 }
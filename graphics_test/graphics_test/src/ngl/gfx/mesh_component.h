@@ -12,7 +12,9 @@ namespace ngl
 {
 namespace gfx
 {
-
+	class SceneMeshBvh;
+	class SceneMeshCulling;
+	class MeshInstanceBufferFrame;
 
 	class IComponent : public NonCopyableTp<IComponent>
 	{
@@ -33,22 +35,9 @@ namespace gfx
 		bool Initialize(rhi::DeviceDep* p_device, const res::ResourceHandle<ResMeshData>& res_mesh);
 		const ResMeshData* GetMeshData() const;
 
-		void UpdateRenderData();
-		rhi::RhiRef<rhi::ConstantBufferViewDep> GetInstanceBufferView() const;
-
+		// 描画用の InstanceInfo は MeshInstanceBuffer でシーンの全インスタンスをまとめて更新する.
 		math::Mat34	transform_ = math::Mat34::Identity();
 		StandardRenderModel	model_ = {};
-		
-	private:
-		void UpdateCbInstanceInfo(int cb_index);
-		
-	private:
-		std::array<rhi::RhiRef<rhi::BufferDep>, 2>	cb_instance_;
-		std::array<rhi::RhiRef<rhi::ConstantBufferViewDep>, 2>	cbv_instance_;
-
-		math::Mat34	transform_prev_ = math::Mat34::Identity();
-
-		s8 flip_index_ = 0;
 	};
 
 
@@ -60,6 +49,12 @@ namespace gfx
 		~SceneRepresentation() {}
 
 		std::vector<gfx::StaticMeshComponent*> mesh_instance_array_ = {};
+		// mesh_instance_array_ で更新したBVH. 無い場合はnullptr.
+		const gfx::SceneMeshBvh* p_mesh_bvh_ = {};
+		// mesh_instance_array_ で構築したShapeのワールドAABB. transform_ を参照するためGameThreadで構築する. 無い場合はnullptr.
+		const gfx::SceneMeshCulling* p_mesh_culling_ = {};
+		// mesh_instance_array_ の InstanceInfo と transform_. インデックスは mesh_instance_array_ と同じ.
+		const gfx::MeshInstanceBufferFrame* p_mesh_instance_buffer_ = {};
 	};
 
 }
@@ -440,6 +440,10 @@ namespace assimp
 					data_ptr[face_i * 3 + 2] = p_face_index[2];
 				}
 			}
+
+			// カリング用の境界.
+			mesh.CalcBounds();
+			out_mesh.bounds_aabb_.Expand(mesh.bounds_aabb_);
 		}
 
 		// Create Rhi.
@@ -6,6 +6,7 @@
 #include "ngl/rhi/d3d12/resource_view.d3d12.h"
 
 #include "common_struct.h"
+#include "render/mesh_instance_buffer.h"
 
 
 namespace ngl
@@ -217,10 +218,10 @@ namespace ngl
 		// TLAS setup.
 		// index_buffer : optional.
 		// bufferの管理責任は外部.
-		bool RtTlas::Setup(rhi::DeviceDep* p_device, std::vector<RtBlas*>& blas_array,
-			const std::vector<uint32_t>& instance_geom_id_array,
-			const std::vector<math::Mat34>& instance_transform_array,
-			const std::vector<uint32_t>& instance_hitgroup_id_array
+		bool RtTlas::Setup(rhi::DeviceDep* p_device, const memory::FrameArenaVector<RtBlas*>& blas_array,
+			const memory::FrameArenaVector<uint32_t>& instance_geom_id_array,
+			const memory::FrameArenaVector<math::Mat34>& instance_transform_array,
+			const memory::FrameArenaVector<uint32_t>& instance_hitgroup_id_array
 		)
 		{
 			if (is_built_)
@@ -241,7 +242,7 @@ namespace ngl
 
 
 
-			std::vector<int> id_remap;
+			auto id_remap = memory::MakeFrameArenaVector<int>(p_device->GetFrameArenaAllocator());
 			id_remap.resize(blas_array.size());
 
 			// 有効でSetup済みのBLASのみ収集.
@@ -1752,10 +1753,16 @@ namespace ngl
 			if(!is_initialized_)
 				return;
 			
+			// 以下のフレーム毎の一時配列はフレームアリーナから確保する.
+			memory::FrameArenaAllocator* p_frame_arena = p_device->GetFrameArenaAllocator();
+
 			// 現在SceneでのMesh情報収集.
-			std::unordered_map<const ResMeshData*, int> scene_mesh_to_id;
-			std::vector<const ResMeshData*> scene_mesh_array;
-			std::vector<int> scene_inst_mesh_id_array;
+			using SceneMeshToIdMap = std::unordered_map<const ResMeshData*, int, std::hash<const ResMeshData*>, std::equal_to<const ResMeshData*>,
+				memory::FrameArenaStlAllocator<std::pair<const ResMeshData* const, int>>>;
+			auto scene_mesh_to_id = SceneMeshToIdMap(SceneMeshToIdMap::allocator_type(p_frame_arena));
+			auto scene_mesh_array = memory::MakeFrameArenaVector<const ResMeshData*>(p_frame_arena);
+			auto scene_inst_mesh_id_array = memory::MakeFrameArenaVector<int>(p_frame_arena);
+			scene_inst_mesh_id_array.reserve(scene.mesh_instance_array_.size());
 			for (auto& e : scene.mesh_instance_array_)
 			{
 				auto* p_mesh = e->GetMeshData();
@@ -1769,7 +1776,8 @@ namespace ngl
 			}
 
 			// BLASを必要に応じて構築.
-			std::vector<int> scene_mesh_blas_id_array;
+			auto scene_mesh_blas_id_array = memory::MakeFrameArenaVector<int>(p_frame_arena);
+			scene_mesh_blas_id_array.reserve(scene_mesh_array.size());
 			for (auto& e : scene_mesh_array)
 			{
 				auto* p_mesh = e;
@@ -1823,19 +1831,30 @@ namespace ngl
 
 
 			// TLAS Setup.
-			std::vector<RtBlas*> scene_blas_array;
-			std::vector<math::Mat34> scene_inst_transform_array;
-			std::vector<uint32_t> scene_inst_blas_id_array;
-			std::vector<uint32_t> scene_inst_hitgroup_id_array;
+			auto scene_blas_array = memory::MakeFrameArenaVector<RtBlas*>(p_frame_arena);
+			auto scene_inst_transform_array = memory::MakeFrameArenaVector<math::Mat34>(p_frame_arena);
+			auto scene_inst_blas_id_array = memory::MakeFrameArenaVector<uint32_t>(p_frame_arena);
+			auto scene_inst_hitgroup_id_array = memory::MakeFrameArenaVector<uint32_t>(p_frame_arena);
+			scene_blas_array.reserve(scene_mesh_blas_id_array.size());
+			scene_inst_blas_id_array.reserve(scene.mesh_instance_array_.size());
+			scene_inst_hitgroup_id_array.reserve(scene.mesh_instance_array_.size());
 			for (auto e : scene_mesh_blas_id_array)
 			{
 				scene_blas_array.push_back(dynamic_scene_blas_array_[e].get());
 			}
+			// トランスフォームはGameThreadがインスタンスバッファへ詰めたものを使用し, RenderThreadからは transform_ を参照しない.
+			scene_inst_transform_array.resize(scene.mesh_instance_array_.size());
+			if (scene.p_mesh_instance_buffer_ && scene.p_mesh_instance_buffer_->NumInstance() == scene.mesh_instance_array_.size())
+			{
+				math::UnpackMat34Soa4(scene_inst_transform_array.data(), scene.p_mesh_instance_buffer_->GetTransformSoa(), static_cast<uint32_t>(scene_inst_transform_array.size()));
+			}
+			else
+			{
+				for (auto i = 0; i < scene.mesh_instance_array_.size(); ++i)
+					scene_inst_transform_array[i] = scene.mesh_instance_array_[i]->transform_;
+			}
 			for (auto i = 0; i < scene.mesh_instance_array_.size(); ++i)
 			{
-				auto& e = scene.mesh_instance_array_[i];
-
-				scene_inst_transform_array.push_back(e->transform_);
 				scene_inst_blas_id_array.push_back(scene_inst_mesh_id_array[i]);
 
 				int hitgroup_id = 0;
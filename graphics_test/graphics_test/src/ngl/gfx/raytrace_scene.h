@@ -149,10 +149,11 @@ namespace ngl
 			// TLAS setup. 必要なBufferやViewの生成まで実行する. Buffer上にAccelerationStructureをビルドするのはBuild関数まで遅延する.
 			// index_buffer : optional.
 			// bufferの管理責任は外部.
-			bool Setup(rhi::DeviceDep* p_device, std::vector<RtBlas*>& blas_array,
-				const std::vector<uint32_t>& instance_geom_id_array,
-				const std::vector<math::Mat34>& instance_transform_array,
-				const std::vector<uint32_t>& instance_hitgroup_id_array
+			// 各配列はフレーム毎に構築する一時配列のためフレームアリーナから確保したものを受け取り, 内部にコピーする.
+			bool Setup(rhi::DeviceDep* p_device, const memory::FrameArenaVector<RtBlas*>& blas_array,
+				const memory::FrameArenaVector<uint32_t>& instance_geom_id_array,
+				const memory::FrameArenaVector<math::Mat34>& instance_transform_array,
+				const memory::FrameArenaVector<uint32_t>& instance_hitgroup_id_array
 			);
 
 			// SetupAs... の情報を元に構造構築コマンドを発行する.
@@ -0,0 +1,116 @@
+﻿
+#include "mesh_bvh.h"
+
+#include "ngl/gfx/mesh_component.h"
+#include "ngl/thread/parallel_for.h"
+
+namespace ngl
+{
+namespace gfx
+{
+	namespace
+	{
+		// 並列でAABBを計算する1チャンクのインスタンス数.
+		constexpr s64 k_aabb_chunk_size = 256;
+		// 境界が無いMeshのAABBの範囲. 常に判定を通す. SceneMeshCulling と同じ値.
+		constexpr float k_unbounded_extent = 1e30f;
+
+		math::Aabb CalcInstanceAabb(const StaticMeshComponent* p_mesh)
+		{
+			const auto* p_mesh_data = p_mesh->GetMeshData();
+			if (!p_mesh_data)
+			{
+				// Shapeが無いためカリングの対象にならない. 位置のみの境界とする.
+				const math::Vec3 pos = p_mesh->transform_.GetColumn3();
+				return math::Aabb(pos, pos);
+			}
+			// 境界の無いShapeはカリングで常に可視のため, それを含むインスタンスも常に判定を通す.
+			bool is_bounded = p_mesh_data->data_.bounds_aabb_.IsValid();
+			for (const auto& shape : p_mesh_data->data_.shape_array_)
+				is_bounded = is_bounded && shape.bounds_aabb_.IsValid();
+			if (!is_bounded)
+				return math::Aabb(math::Vec3(-k_unbounded_extent), math::Vec3(k_unbounded_extent));
+			return math::Aabb::Transform(p_mesh_data->data_.bounds_aabb_, p_mesh->transform_);
+		}
+	}
+
+	void SceneMeshBvh::Clear()
+	{
+		bvh_.Clear();
+		mesh_array_.clear();
+		transform_array_.clear();
+		aabb_array_.clear();
+		changed_flag_.clear();
+		build_sah_cost_ = 0.0f;
+	}
+
+	void SceneMeshBvh::Rebuild(thread::JobSystem* p_job_system)
+	{
+		const s64 count = static_cast<s64>(mesh_array_.size());
+		transform_array_.resize(count);
+		aabb_array_.resize(count);
+		changed_flag_.assign(count, 0);
+		thread::ParallelForRange(p_job_system, 0, count, k_aabb_chunk_size, [this](s64 begin, s64 end)
+			{
+				for (s64 i = begin; i < end; ++i)
+				{
+					transform_array_[i] = mesh_array_[i]->transform_;
+					aabb_array_[i] = CalcInstanceAabb(mesh_array_[i]);
+				}
+			});
+
+		bvh_.Build(aabb_array_.data(), static_cast<uint32_t>(count));
+		build_sah_cost_ = bvh_.CalcSahCost();
+		stat_rebuild_ = true;
+	}
+
+	void SceneMeshBvh::Update(const std::vector<StaticMeshComponent*>& mesh_array, thread::JobSystem* p_job_system)
+	{
+		stat_update_instance_ = 0;
+		stat_refit_node_ = 0;
+		stat_rebuild_ = false;
+
+		// インスタンスの追加や削除は構築し直す.
+		if (!IsSameInstanceArray(mesh_array))
+		{
+			mesh_array_ = mesh_array;
+			Rebuild(p_job_system);
+			stat_update_instance_ = NumInstance();
+			return;
+		}
+
+		// transform_ が変化したインスタンスのAABBを並列に計算し, BVHへの反映は順に行う.
+		const s64 count = static_cast<s64>(mesh_array_.size());
+		thread::ParallelForRange(p_job_system, 0, count, k_aabb_chunk_size, [this](s64 begin, s64 end)
+			{
+				for (s64 i = begin; i < end; ++i)
+				{
+					const StaticMeshComponent* p_mesh = mesh_array_[i];
+					changed_flag_[i] = (transform_array_[i] != p_mesh->transform_) ? 1 : 0;
+					if (!changed_flag_[i])
+						continue;
+					transform_array_[i] = p_mesh->transform_;
+					aabb_array_[i] = CalcInstanceAabb(p_mesh);
+				}
+			});
+		for (s64 i = 0; i < count; ++i)
+		{
+			if (!changed_flag_[i])
+				continue;
+			bvh_.UpdateItem(static_cast<uint32_t>(i), aabb_array_[i]);
+			++stat_update_instance_;
+		}
+		if (0 == stat_update_instance_)
+			return;
+
+		stat_refit_node_ = bvh_.Refit();
+		// 移動でノードの重なりが増えた場合は再構築する.
+		if (bvh_.CalcSahCost() > build_sah_cost_ * k_rebuild_sah_ratio)
+		{
+			bvh_.Rebuild();
+			build_sah_cost_ = bvh_.CalcSahCost();
+			stat_rebuild_ = true;
+		}
+	}
+}
+}
@@ -0,0 +1,76 @@
+﻿#pragma once
+
+/*
+	シーンのMeshインスタンスのBVH.
+
+	SceneMeshBvh::Update で StaticMeshComponent のワールド空間AABBから math::AabbBvh を維持する.
+		Meshの配列が前回と異なる場合は構築し, 同じ場合は transform_ が変化したインスタンスのみ更新してRefitする.
+		RefitでSAHコストが構築直後から一定以上悪化した場合は再構築する.
+	要素のIDはUpdateに渡した配列のインデックス. SceneMeshCulling::Build に渡すとインスタンス単位で先に判定する.
+
+	gfx::SceneMeshBvh mesh_bvh;
+	mesh_bvh.Update(frame_scene.mesh_instance_array_, p_job_system);
+	frame_scene.p_mesh_bvh_ = &mesh_bvh;
+*/
+
+#include <vector>
+
+#include "ngl/math/math.h"
+#include "ngl/math/math_bvh.h"
+#include "ngl/util/types.h"
+
+namespace ngl
+{
+namespace thread
+{
+	class JobSystem;
+}
+
+namespace gfx
+{
+	class StaticMeshComponent;
+
+	class SceneMeshBvh
+	{
+	public:
+		// Refit後のSAHコストが構築直後に対してこの比率を超えた場合に再構築する.
+		static constexpr float k_rebuild_sah_ratio = 1.3f;
+
+		SceneMeshBvh() {}
+		~SceneMeshBvh() {}
+
+		// mesh_arrayのインスタンスのワールドAABBでBVHを更新する.
+		void Update(const std::vector<StaticMeshComponent*>& mesh_array, thread::JobSystem* p_job_system);
+		void Clear();
+
+		const math::AabbBvh& GetBvh() const { return bvh_; }
+		u32 NumInstance() const { return static_cast<u32>(mesh_array_.size()); }
+		// Updateに渡した配列と同じインスタンス列か.
+		bool IsSameInstanceArray(const std::vector<StaticMeshComponent*>& mesh_array) const { return mesh_array_ == mesh_array; }
+
+		// 直前のUpdateで transform_ が変化したインスタンス数.
+		u32 GetStatUpdateInstance() const { return stat_update_instance_; }
+		// 直前のUpdateでRefitしたノード数.
+		u32 GetStatRefitNode() const { return stat_refit_node_; }
+		// 直前のUpdateで構築または再構築したか.
+		bool GetStatRebuild() const { return stat_rebuild_; }
+
+	private:
+		void Rebuild(thread::JobSystem* p_job_system);
+
+	private:
+		math::AabbBvh						bvh_ = {};
+		std::vector<StaticMeshComponent*>	mesh_array_ = {};
+		// 前回のUpdate時点のtransform_.
+		std::vector<math::Mat34>			transform_array_ = {};
+		std::vector<math::Aabb>				aabb_array_ = {};
+		std::vector<u8>						changed_flag_ = {};
+		// 構築直後のSAHコスト.
+		float								build_sah_cost_ = 0.0f;
+
+		u32		stat_update_instance_ = 0;
+		u32		stat_refit_node_ = 0;
+		bool	stat_rebuild_ = false;
+	};
+}
+}
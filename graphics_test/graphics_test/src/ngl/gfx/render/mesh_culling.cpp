@@ -0,0 +1,183 @@
+﻿
+#include "mesh_culling.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include "ngl/gfx/mesh_component.h"
+#include "ngl/gfx/render/mesh_bvh.h"
+#include "ngl/thread/parallel_for.h"
+
+namespace ngl
+{
+namespace gfx
+{
+	namespace
+	{
+		// 並列判定の1チャンクのShape数.
+		constexpr s64 k_cull_chunk_size = 1024;
+		// BVHの判定後に並列判定する1チャンクのインスタンス数.
+		constexpr s64 k_bvh_cull_chunk_size = 256;
+		// 並列構築の1チャンクのShape数.
+		constexpr s64 k_build_chunk_size = 256;
+		// 境界が無いShapeのextent. 常に可視とする. 平面の法線成分が0でも乗算が非数にならない有限値.
+		constexpr float k_unbounded_extent = 1e30f;
+	}
+
+	void SceneMeshCulling::Build(const std::vector<StaticMeshComponent*>& mesh_array, thread::JobSystem* p_job_system, const SceneMeshBvh* p_bvh)
+	{
+		p_bvh_ = (p_bvh && p_bvh->IsSameInstanceArray(mesh_array)) ? p_bvh : nullptr;
+
+		item_array_.clear();
+		instance_shape_begin_.resize(mesh_array.size() + 1);
+		for (size_t mesh_i = 0; mesh_i < mesh_array.size(); ++mesh_i)
+		{
+			const auto* e = mesh_array[mesh_i];
+			instance_shape_begin_[mesh_i] = static_cast<u32>(item_array_.size());
+			const auto* p_mesh_data = e->GetMeshData();
+			if (!p_mesh_data)
+				continue;
+			for (u32 shape_i = 0; shape_i < p_mesh_data->data_.shape_array_.size(); ++shape_i)
+				item_array_.push_back({ e, shape_i, static_cast<u32>(mesh_i) });
+		}
+		instance_shape_begin_[mesh_array.size()] = static_cast<u32>(item_array_.size());
+
+		const s64 count = static_cast<s64>(item_array_.size());
+		for (int i = 0; i < 3; ++i)
+		{
+			center_[i].resize(count);
+			extent_[i].resize(count);
+		}
+
+		thread::ParallelForRange(p_job_system, 0, count, k_build_chunk_size, [this](s64 begin, s64 end)
+			{
+				for (s64 i = begin; i < end; ++i)
+				{
+					const auto& item = item_array_[i];
+					const auto& shape = item.p_mesh->GetMeshData()->data_.shape_array_[item.shape_index];
+
+					math::Vec3 center = math::Vec3::Zero();
+					math::Vec3 extent = math::Vec3(k_unbounded_extent);
+					if (shape.bounds_aabb_.IsValid())
+					{
+						const math::Aabb world_aabb = math::Aabb::Transform(shape.bounds_aabb_, item.p_mesh->transform_);
+						center = world_aabb.GetCenter();
+						extent = world_aabb.GetExtent();
+					}
+					center_[0][i] = center.x;
+					center_[1][i] = center.y;
+					center_[2][i] = center.z;
+					extent_[0][i] = extent.x;
+					extent_[1][i] = extent.y;
+					extent_[2][i] = extent.z;
+				}
+			});
+	}
+
+	math::AabbSoaRef SceneMeshCulling::GetAabbSoaRef() const
+	{
+		return { { center_[0].data(), center_[1].data(), center_[2].data() }, { extent_[0].data(), extent_[1].data(), extent_[2].data() } };
+	}
+
+	void SceneMeshCulling::Cull(MeshVisibleList& out_list, const math::Frustum& frustum, thread::JobSystem* p_job_system) const
+	{
+		out_list.item_array_.clear();
+		out_list.num_total_ = NumShape();
+		out_list.num_covered_ = 0;
+		if (0 >= NumShape())
+			return;
+
+		const math::AabbSoaRef aabb = GetAabbSoaRef();
+		std::vector<u32> visible_index;
+		CullIndex(visible_index, frustum, [&](u32* out_index, u32 begin, u32 end)
+			{
+				return math::CullFrustumAabb(out_index, frustum, aabb, begin, end);
+			}, p_job_system);
+
+		out_list.item_array_.resize(visible_index.size());
+		for (size_t i = 0; i < visible_index.size(); ++i)
+			out_list.item_array_[i] = item_array_[visible_index[i]];
+	}
+
+	void SceneMeshCulling::CullShadowCascade(MeshVisibleList& out_list, const math::ShadowCascadeCullVolume& volume, thread::JobSystem* p_job_system) const
+	{
+		out_list.item_array_.clear();
+		out_list.num_total_ = NumShape();
+		out_list.num_covered_ = 0;
+		if (0 >= NumShape())
+			return;
+
+		const math::AabbSoaRef aabb = GetAabbSoaRef();
+		std::atomic<u32> covered_count = 0;
+		std::vector<u32> visible_index;
+		CullIndex(visible_index, volume.frustum, [&](u32* out_index, u32 begin, u32 end)
+			{
+				u32 range_covered_count = 0;
+				const u32 count = math::CullShadowCascadeAabb(out_index, range_covered_count, volume, aabb, begin, end);
+				if (0 < range_covered_count)
+					covered_count.fetch_add(range_covered_count, std::memory_order_relaxed);
+				return count;
+			}, p_job_system);
+
+		out_list.num_covered_ = covered_count.load();
+		out_list.item_array_.resize(visible_index.size());
+		for (size_t i = 0; i < visible_index.size(); ++i)
+			out_list.item_array_[i] = item_array_[visible_index[i]];
+	}
+
+	template<typename KERNEL>
+	void SceneMeshCulling::CullIndex(std::vector<u32>& out_index, const math::Frustum& query_frustum, const KERNEL& kernel, thread::JobSystem* p_job_system) const
+	{
+		out_index.clear();
+		if (!p_bvh_)
+		{
+			// チャンク毎に可視インデックスをチャンクの先頭から詰める.
+			const s64 count = static_cast<s64>(item_array_.size());
+			const s64 chunk_count = (count + k_cull_chunk_size - 1) / k_cull_chunk_size;
+			std::vector<u32> visible_index(count);
+			std::vector<u32> chunk_visible_count(chunk_count);
+			thread::ParallelFor(p_job_system, 0, chunk_count, 1, [&](s64 chunk)
+				{
+					const s64 begin = chunk * k_cull_chunk_size;
+					const s64 end = std::min(begin + k_cull_chunk_size, count);
+					chunk_visible_count[chunk] = kernel(&visible_index[begin], static_cast<u32>(begin), static_cast<u32>(end));
+				});
+
+			for (s64 chunk = 0; chunk < chunk_count; ++chunk)
+			{
+				const u32* p_index = &visible_index[chunk * k_cull_chunk_size];
+				out_index.insert(out_index.end(), p_index, p_index + chunk_visible_count[chunk]);
+			}
+			return;
+		}
+
+		// Frustumと交差するインスタンス. Buildの順序で出力するため整列する.
+		std::vector<uint32_t> candidate;
+		p_bvh_->GetBvh().QueryFrustum(candidate, query_frustum);
+		std::sort(candidate.begin(), candidate.end());
+
+		// インスタンスのShapeの可視インデックスを, そのShapeの範囲の先頭から詰める.
+		const s64 candidate_count = static_cast<s64>(candidate.size());
+		const s64 chunk_count = (candidate_count + k_bvh_cull_chunk_size - 1) / k_bvh_cull_chunk_size;
+		std::vector<u32> visible_index(item_array_.size());
+		std::vector<u32> candidate_visible_count(candidate_count);
+		thread::ParallelFor(p_job_system, 0, chunk_count, 1, [&](s64 chunk)
+			{
+				const s64 begin = chunk * k_bvh_cull_chunk_size;
+				const s64 end = std::min(begin + k_bvh_cull_chunk_size, candidate_count);
+				for (s64 ci = begin; ci < end; ++ci)
+				{
+					const u32 shape_begin = instance_shape_begin_[candidate[ci]];
+					const u32 shape_end = instance_shape_begin_[candidate[ci] + 1];
+					candidate_visible_count[ci] = kernel(visible_index.data() + shape_begin, shape_begin, shape_end);
+				}
+			});
+
+		for (s64 ci = 0; ci < candidate_count; ++ci)
+		{
+			const u32* p_index = visible_index.data() + instance_shape_begin_[candidate[ci]];
+			out_index.insert(out_index.end(), p_index, p_index + candidate_visible_count[ci]);
+		}
+	}
+}
+}
@@ -0,0 +1,104 @@
+﻿#pragma once
+
+/*
+	Mesh Shape単位のFrustumカリング.
+
+	SceneMeshCulling::Build でシーンの全Shapeのワールド空間AABBをSoAで構築し, View毎やCascade毎に Cull で可視リストを生成する.
+		AABBは MeshShapePart のロード時に計算したローカル空間の境界を StaticMeshComponent::transform_ で変換したもの.
+		Buildは transform_ を更新するGameThreadで呼び出し, SceneRepresentation::p_mesh_culling_ でRenderThreadへ渡す.
+		RenderThreadは構築済みのAABBでCullのみ行い, transform_ を参照しない.
+		判定は math::CullFrustumAabb で4個単位のSIMD. 一定数毎のチャンクに分けてJobSystemで並列に判定し, 元の順序で可視リストに詰める.
+		Buildに SceneMeshBvh を渡した場合は, BVHでFrustumと交差するインスタンスを求めてから, そのShapeのみを判定する.
+		DirectionalShadowのCascadeは CullShadowCascade で math::CullShadowCascadeAabb により判定し, 手前のCascadeでカバーされるCasterを除く.
+
+	// GameThread.
+	mesh_culling.Build(frame_scene.mesh_instance_array_, p_job_system, frame_scene.p_mesh_bvh_);
+	frame_scene.p_mesh_culling_ = &mesh_culling;
+
+	// RenderThread.
+	math::Frustum frustum;
+	math::CreateFrustum(frustum, proj_mtx * view_mtx);
+	gfx::MeshVisibleList visible_list;
+	p_scene->p_mesh_culling_->Cull(visible_list, frustum, p_job_system);
+
+	gfx::RenderMeshWithMaterial(command_list, pass_name, visible_list, render_mesh_resource);
+*/
+
+#include <vector>
+
+#include "ngl/math/math.h"
+#include "ngl/math/math_frustum_culling.h"
+#include "ngl/util/types.h"
+
+namespace ngl
+{
+namespace thread
+{
+	class JobSystem;
+}
+
+namespace gfx
+{
+	class StaticMeshComponent;
+	class SceneMeshBvh;
+
+	// 描画するMeshとそのShape.
+	struct MeshShapeDrawItem
+	{
+		const StaticMeshComponent*	p_mesh = {};
+		u32							shape_index = 0;
+		// Buildに渡した配列でのインスタンスのインデックス. MeshInstanceBufferFrame::GetInstanceView で参照する.
+		u32							instance_index = 0;
+	};
+
+	// カリング結果の可視リスト.
+	struct MeshVisibleList
+	{
+		std::vector<MeshShapeDrawItem>	item_array_ = {};
+		// 判定したShapeの総数.
+		u32								num_total_ = 0;
+		// 範囲内だが手前のCascadeでカバーされるため除いたShape数. CullShadowCascade のみ.
+		u32								num_covered_ = 0;
+
+		u32 NumVisible() const { return static_cast<u32>(item_array_.size()); }
+		u32 NumCulled() const { return num_total_ - NumVisible(); }
+	};
+
+	// シーンの全Shapeのワールド空間AABBを保持してFrustumカリングをする.
+	class SceneMeshCulling
+	{
+	public:
+		SceneMeshCulling() {}
+		~SceneMeshCulling() {}
+
+		// mesh_arrayの全ShapeのワールドAABBを構築する. transform_ を変更した場合は再度呼び出す.
+		//	transform_ を読むため, transform_ を更新するスレッドで呼び出す.
+		//	p_bvhはmesh_arrayで更新したもの. 異なる配列で更新されている場合は使用しない.
+		void Build(const std::vector<StaticMeshComponent*>& mesh_array, thread::JobSystem* p_job_system, const SceneMeshBvh* p_bvh = nullptr);
+
+		// frustumと交差するShapeをout_listへ設定する. 順序はBuildに渡したMeshとShapeの順.
+		//	複数のFrustumで並行して呼び出すことができる.
+		void Cull(MeshVisibleList& out_list, const math::Frustum& frustum, thread::JobSystem* p_job_system) const;
+		// DirectionalShadowのCascadeに描画するShapeをout_listへ設定する. 順序はCullと同じ.
+		void CullShadowCascade(MeshVisibleList& out_list, const math::ShadowCascadeCullVolume& volume, thread::JobSystem* p_job_system) const;
+
+		u32 NumShape() const { return static_cast<u32>(item_array_.size()); }
+
+	private:
+		// kernel(out_index, begin, end) で[begin, end)のShapeを判定し, 可視のShapeのインデックスをout_indexへ設定する.
+		//	BVHがある場合はquery_frustumと交差するインスタンスのShapeのみを判定する.
+		template<typename KERNEL>
+		void CullIndex(std::vector<u32>& out_index, const math::Frustum& query_frustum, const KERNEL& kernel, thread::JobSystem* p_job_system) const;
+		math::AabbSoaRef GetAabbSoaRef() const;
+
+	private:
+		const SceneMeshBvh*				p_bvh_ = {};
+		std::vector<MeshShapeDrawItem>	item_array_ = {};
+		// Buildに渡したインスタンス毎の item_array_ の先頭. 末尾に総数を持つ.
+		std::vector<u32>				instance_shape_begin_ = {};
+		// ワールド空間AABBの中心とextentの軸毎の配列.
+		std::vector<float>				center_[3] = {};
+		std::vector<float>				extent_[3] = {};
+	};
+}
+}
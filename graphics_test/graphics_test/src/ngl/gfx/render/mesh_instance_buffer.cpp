@@ -0,0 +1,133 @@
+﻿#include "mesh_instance_buffer.h"
+
+#include <algorithm>
+
+#include "ngl/gfx/common_struct.h"
+#include "ngl/gfx/mesh_component.h"
+#include "ngl/thread/parallel_for.h"
+
+namespace ngl
+{
+namespace gfx
+{
+	namespace
+	{
+		// 並列で計算する1チャンクのMat34Soa4ブロック数.
+		constexpr s64 k_block_chunk_size = 64;
+
+		static_assert(sizeof(InstanceInfo) <= MeshInstanceBuffer::k_instance_stride, "InstanceInfo exceeds k_instance_stride.");
+	}
+
+	MeshInstanceBufferFrame::~MeshInstanceBufferFrame()
+	{
+		Release();
+	}
+	void MeshInstanceBufferFrame::Release()
+	{
+		if (buffer_.IsValid())
+			buffer_->Unmap();
+		buffer_.Reset();
+		p_mapped_ = {};
+		cbv_array_.clear();
+		transform_soa_.clear();
+		num_instance_ = 0;
+	}
+
+	bool MeshInstanceBufferFrame::Reserve(rhi::DeviceDep* p_device, u32 count)
+	{
+		const u32 capacity = static_cast<u32>(cbv_array_.size());
+		if (count <= capacity)
+			return true;
+
+		// 再確保の回数を減らすため倍に拡張する.
+		const u32 new_capacity = std::max(count, capacity * 2);
+
+		rhi::RefBufferDep new_buffer(new rhi::BufferDep());
+		{
+			rhi::BufferDep::Desc desc = {};
+			desc.SetupAsConstantBuffer(MeshInstanceBuffer::k_instance_stride);
+			desc.element_count = new_capacity;
+			if (!new_buffer->Initialize(p_device, desc))
+			{
+				assert(false);
+				return false;
+			}
+		}
+		auto* p_mapped = static_cast<u8*>(new_buffer->Map());
+		if (!p_mapped)
+		{
+			assert(false);
+			return false;
+		}
+
+		std::vector<rhi::RefCbvDep> new_cbv_array(new_capacity);
+		for (u32 i = 0; i < new_capacity; ++i)
+		{
+			new_cbv_array[i] = new rhi::ConstantBufferViewDep();
+			rhi::ConstantBufferViewDep::Desc cbv_desc = {};
+			cbv_desc.byte_offset = i * MeshInstanceBuffer::k_instance_stride;
+			cbv_desc.byte_size = MeshInstanceBuffer::k_instance_stride;
+			if (!new_cbv_array[i]->Initialize(new_buffer.Get(), cbv_desc))
+			{
+				new_buffer->Unmap();
+				assert(false);
+				return false;
+			}
+		}
+
+		// 以前のバッファを参照していた描画は完了しているため, そのまま破棄する.
+		if (buffer_.IsValid())
+			buffer_->Unmap();
+		buffer_ = new_buffer;
+		p_mapped_ = p_mapped;
+		cbv_array_ = std::move(new_cbv_array);
+		return true;
+	}
+
+	const MeshInstanceBufferFrame* MeshInstanceBuffer::Update(rhi::DeviceDep* p_device, const std::vector<StaticMeshComponent*>& mesh_array, thread::JobSystem* p_job_system)
+	{
+		// 切り替え先を参照していた2フレーム前の描画は完了している.
+		flip_ = 1 - flip_;
+		auto& frame = frame_[flip_];
+
+		const u32 count = static_cast<u32>(mesh_array.size());
+		frame.num_instance_ = 0;
+		if (!frame.Reserve(p_device, count))
+			return nullptr;
+		frame.num_instance_ = count;
+		frame.transform_soa_.resize(math::Mat34Soa4::BlockCount(count));
+
+		// ブロック単位で分割し, チャンク毎に transform_ を詰めてからそのままバッファへ書き込む.
+		math::Mat34Soa4* p_soa = frame.transform_soa_.data();
+		u8* p_mapped = frame.p_mapped_;
+		thread::ParallelForRange(p_job_system, 0, static_cast<s64>(frame.transform_soa_.size()), k_block_chunk_size, [&](s64 range_begin, s64 range_end)
+			{
+				const math::Mat34* src[k_block_chunk_size * math::Mat34Soa4::k_width];
+				for (s64 block_begin = range_begin; block_begin < range_end; block_begin += k_block_chunk_size)
+				{
+					const s64 block_end = std::min(block_begin + k_block_chunk_size, range_end);
+					const u32 begin = static_cast<u32>(block_begin) * math::Mat34Soa4::k_width;
+					const u32 end = std::min(static_cast<u32>(block_end) * math::Mat34Soa4::k_width, count);
+					for (u32 i = begin; i < end; ++i)
+						src[i - begin] = &mesh_array[i]->transform_;
+					math::PackMat34Soa4(p_soa + block_begin, src, end - begin);
+
+					auto* p_info = reinterpret_cast<InstanceInfo*>(p_mapped + static_cast<size_t>(begin) * k_instance_stride);
+					math::InstanceTransformBatchOutput out = {};
+					out.world = &p_info->mtx;
+					out.world_stride = k_instance_stride;
+					out.cofactor = &p_info->mtx_cofactor;
+					out.cofactor_stride = k_instance_stride;
+					math::CalcInstanceTransformBatch(out, p_soa + block_begin, nullptr, end - begin);
+				}
+			});
+
+		return &frame;
+	}
+	void MeshInstanceBuffer::Finalize()
+	{
+		for (auto& e : frame_)
+			e.Release();
+	}
+}
+}
@@ -0,0 +1,89 @@
+﻿#pragma once
+
+/*
+	シーンのMeshインスタンスの描画用トランスフォーム.
+
+	MeshInstanceBuffer::Update で全インスタンスの InstanceInfo を1つのアップロードバッファへ一括で書き込む.
+		StaticMeshComponent::transform_ を Mat34Soa4 に詰め, math::CalcInstanceTransformBatch でワールド行列と余因子行列をMap済みのバッファへ直接書き込む.
+		バッファはインスタンス毎に k_instance_stride byteで, インスタンス毎のCBVを GetInstanceView で参照する. インデックスはUpdateに渡した配列のインデックス.
+		Mat34Soa4 は GetTransformSoa でRenderThreadから参照できる. RenderThreadは transform_ を参照しない.
+		RenderThreadが前フレームのバッファを参照中に書き換えないよう, 内部で2フレーム分を切り替える.
+
+	// GameThread.
+	const auto* p_instance_buffer = mesh_instance_buffer.Update(p_device, frame_scene.mesh_instance_array_, p_job_system);
+	frame_scene.p_mesh_instance_buffer_ = p_instance_buffer;
+
+	// RenderThread.
+	pso->SetView(&desc_set, NGL_TEXT_SYMBOL("ngl_cb_instance"), p_scene->p_mesh_instance_buffer_->GetInstanceView(instance_index));
+*/
+
+#include <array>
+#include <vector>
+
+#include "ngl/math/math.h"
+#include "ngl/math/math_transform_batch.h"
+#include "ngl/rhi/d3d12/resource.d3d12.h"
+#include "ngl/rhi/d3d12/resource_view.d3d12.h"
+#include "ngl/util/types.h"
+
+namespace ngl
+{
+namespace thread
+{
+	class JobSystem;
+}
+
+namespace gfx
+{
+	class StaticMeshComponent;
+
+	// 1フレーム分のインスタンスバッファ.
+	class MeshInstanceBufferFrame
+	{
+	public:
+		MeshInstanceBufferFrame() {}
+		~MeshInstanceBufferFrame();
+
+		u32 NumInstance() const { return num_instance_; }
+		// instance_index番目のインスタンスの InstanceInfo のCBV.
+		rhi::ConstantBufferViewDep* GetInstanceView(u32 instance_index) const { return cbv_array_[instance_index].Get(); }
+		// 全インスタンスの transform_. Mat34Soa4::BlockCount(NumInstance()) 個.
+		const math::Mat34Soa4* GetTransformSoa() const { return transform_soa_.data(); }
+
+	private:
+		friend class MeshInstanceBuffer;
+
+		bool Reserve(rhi::DeviceDep* p_device, u32 count);
+		void Release();
+
+	private:
+		rhi::RefBufferDep					buffer_ = {};
+		// Map済みのバッファ. Upload ヒープのため破棄まで Map したままにする.
+		u8*									p_mapped_ = {};
+		std::vector<rhi::RefCbvDep>			cbv_array_ = {};
+		std::vector<math::Mat34Soa4>		transform_soa_ = {};
+		u32									num_instance_ = 0;
+	};
+
+	// シーンのMeshインスタンスの InstanceInfo をフレーム毎に一括更新する.
+	class MeshInstanceBuffer
+	{
+	public:
+		// インスタンス毎のbyte数. CBVのアライメント.
+		static constexpr u32 k_instance_stride = 256;
+
+		MeshInstanceBuffer() {}
+		~MeshInstanceBuffer() {}
+
+		// mesh_arrayの全インスタンスの InstanceInfo を書き込み, そのフレームのバッファを返す.
+		//	transform_ を読むため, transform_ を更新するスレッドで呼び出す.
+		const MeshInstanceBufferFrame* Update(rhi::DeviceDep* p_device, const std::vector<StaticMeshComponent*>& mesh_array, thread::JobSystem* p_job_system);
+		// バッファを破棄する. Deviceの破棄前に呼び出す.
+		void Finalize();
+
+	private:
+		std::array<MeshInstanceBufferFrame, 2>	frame_ = {};
+		int										flip_ = 0;
+	};
+}
+}
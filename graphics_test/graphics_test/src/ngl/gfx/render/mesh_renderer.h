@@ -3,6 +3,9 @@
 
 #include "ngl/math/math.h"
 #include "ngl/gfx/mesh_component.h"
+#include "ngl/gfx/render/mesh_culling.h"
+#include "ngl/gfx/render/mesh_instance_buffer.h"
+#include "ngl/text/text_symbol.h"
 
 namespace ngl
 {
@@ -16,7 +19,7 @@ namespace gfx
     template<typename ViewType>
     struct RenderMeshTemplate
     {
-        rhi::ResourceViewName   slot_name = {};
+        text::TextSymbol        slot_name = {};
         ViewType*               p_view = {};
     };
     using RenderMeshCbv = RenderMeshTemplate<rhi::ConstantBufferViewDep>;
@@ -29,10 +32,18 @@ namespace gfx
         RenderMeshCbv cbv_sceneview = {};// SceneView定数バッファ.
         
         RenderMeshCbv cbv_d_shadowview = {};// DirectionalShadowView定数バッファ.
+
+        const MeshInstanceBufferFrame* p_instance_buffer = {};// インスタンス毎のInstanceInfo. インデックスはメッシュ配列のインデックス.
     };
     
+    // mesh_instance_arrayは render_mesh_resouce.p_instance_buffer の更新に使用した配列.
     void RenderMeshWithMaterial(
         rhi::GraphicsCommandListDep& command_list, const char* pass_name,
         const std::vector<gfx::StaticMeshComponent*>& mesh_instance_array, const RenderMeshResource& render_mesh_resouce);
+
+    // カリング結果の可視リストのShapeのみ描画.
+    void RenderMeshWithMaterial(
+        rhi::GraphicsCommandListDep& command_list, const char* pass_name,
+        const MeshVisibleList& visible_list, const RenderMeshResource& render_mesh_resouce);
 }
 }
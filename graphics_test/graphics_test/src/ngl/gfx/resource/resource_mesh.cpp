@@ -7,6 +7,24 @@ namespace ngl
 {
 namespace gfx
 {
+	void MeshShapePart::CalcBounds()
+	{
+		bounds_aabb_ = {};
+		bounds_sphere_ = {};
+		const auto* p_pos = position_.GetTypedRawDataPtr();
+		if (!p_pos || 0 >= num_vertex_)
+			return;
+
+		for (int vi = 0; vi < num_vertex_; ++vi)
+			bounds_aabb_.Expand(p_pos[vi]);
+
+		bounds_sphere_.center_ = bounds_aabb_.GetCenter();
+		float radius_sq = 0.0f;
+		for (int vi = 0; vi < num_vertex_; ++vi)
+			radius_sq = std::max(radius_sq, math::Vec3::LengthSq(p_pos[vi] - bounds_sphere_.center_));
+		bounds_sphere_.radius_ = std::sqrt(radius_sq);
+	}
+
 	void ResMeshData::OnResourceRenderUpdate(rhi::DeviceDep* p_device, rhi::GraphicsCommandListDep* p_commandlist)
 	{
 		auto* p_d3d_commandlist = p_commandlist->GetD3D12GraphicsCommandList();
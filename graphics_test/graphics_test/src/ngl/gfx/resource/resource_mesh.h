@@ -159,6 +159,12 @@ namespace ngl
 			std::array<MeshShapeVertexDataBase*, MeshVertexSemantic::SemanticSlotMaxCount()> p_vtx_attr_mapping_ = {};
 			MeshVertexSemanticSlotMask	vtx_attr_mask_ = {};
 
+			// ローカル空間の境界. ロード時にCalcBoundsで頂点位置から計算する.
+			math::Aabb				bounds_aabb_ = {};
+			math::BoundingSphere	bounds_sphere_ = {};
+
+			// 頂点位置から境界を計算する. 球の中心はAABBの中心.
+			void CalcBounds();
 		};
 
 		// Mesh Shape Data.
@@ -177,6 +183,8 @@ namespace ngl
 			// RawData以外にもRHIBufferも一纏めにする場合はここで管理してshapeのviewが参照することもできるかもしれない.
 
 			std::vector<MeshShapePart> shape_array_;
+			// 全Shapeのローカル空間の境界.
+			math::Aabb bounds_aabb_ = {};
 		};
 
 
@@ -926,7 +926,7 @@ namespace ngl
 		}
 
 		void RenderTaskGraphBuilder::Execute(
-			std::vector<RtgSubmitCommandSequenceElem>& out_graphics_commands, std::vector<RtgSubmitCommandSequenceElem>& out_compute_commands,
+			RtgSubmitCommandSequence& out_graphics_commands, RtgSubmitCommandSequence& out_compute_commands,
 			thread::JobSystem* p_job_system)
 		{
 			// Compileされていないチェック.
@@ -1010,12 +1010,16 @@ namespace ngl
 			};
 
 			
+			// 以下の一時配列はフレームアリーナから確保する.
+			memory::FrameArenaAllocator* p_frame_arena = p_compiled_manager_->p_device_->GetFrameArenaAllocator();
+
 			// Node毎に複数CommandList利用が可能なようにNode毎のCommandList配列. Node毎のMultiThread処理.
-			std::vector<std::vector<rhi::CommandListBaseDep*>> node_commandlists = {};
-			node_commandlists.resize(node_sequence_.size());
+			auto node_commandlists = memory::MakeFrameArenaVector<memory::FrameArenaVector<rhi::CommandListBaseDep*>>(p_frame_arena);
+			node_commandlists.resize(node_sequence_.size(), memory::MakeFrameArenaVector<rhi::CommandListBaseDep*>(p_frame_arena));
 			
 			// TaskのレンダリングタスクのJob実行リスト.
-			std::vector< std::function<void(void)> > render_jobs{}; 
+			auto render_jobs = memory::MakeFrameArenaVector<std::function<void(void)>>(p_frame_arena);
+			render_jobs.reserve(node_sequence_.size());
 			for (const auto& e : node_sequence_)
 			{
 				const int node_index = GetNodeSequencePosition(e);
@@ -1086,11 +1090,13 @@ namespace ngl
 			if(p_job_system)
 			{
 				// Parallel.
+				// JobSystemは他の処理と共有され得るため, WaitAllではなくこのGraphのJobのみ待機する.
+				thread::JobCounter render_job_counter;
 				for(auto& job : render_jobs)
 				{
-					p_job_system->Add([&job]{job();});
+					p_job_system->Add([&job]{job();}, &render_job_counter);
 				}
-				p_job_system->WaitAll();
+				p_job_system->Wait(render_job_counter);
 			}
 			else
 			{
@@ -1124,7 +1130,7 @@ namespace ngl
 			out_compute_commands.clear();
 			{	
 				// Task間同期に必要なFenceをセットアップ.
-				std::vector<rhi::RhiRef<rhi::FenceDep>> sync_fences;
+				auto sync_fences = memory::MakeFrameArenaVector<rhi::RhiRef<rhi::FenceDep>>(p_frame_arena);
 				{
 					sync_fences.clear();
 					for(const auto& e : compiled_.node_dependency_fence_)
@@ -1317,12 +1323,14 @@ namespace ngl
 		// RtgのExecute() で構築して生成したComandListのSequenceをGPUへSubmitするヘルパー関数.
 		void RenderTaskGraphBuilder::SubmitCommand(
 			rhi::GraphicsCommandQueueDep& graphics_queue, rhi::ComputeCommandQueueDep& compute_queue,
-			std::vector<RtgSubmitCommandSequenceElem>& graphics_commands, std::vector<RtgSubmitCommandSequenceElem>& compute_commands)
+			RtgSubmitCommandSequence& graphics_commands, RtgSubmitCommandSequence& compute_commands)
 		{
 			//	連続したCommandListをなるべく一度のExecuteにまとめ, 必要な箇所でFenceを張る.
-			auto submit_sequence = [](std::vector<ngl::rtg::RtgSubmitCommandSequenceElem>& sequence, ngl::rhi::CommandQueueBaseDep& graphics_queue)
+			auto submit_sequence = [](RtgSubmitCommandSequence& sequence, ngl::rhi::CommandQueueBaseDep& graphics_queue)
 			{
-				std::vector<ngl::rhi::CommandListBaseDep*> exec_command_list_reservoir = {};
+				// Sequenceと同じフレームアリーナから確保.
+				auto exec_command_list_reservoir = memory::MakeFrameArenaVector<ngl::rhi::CommandListBaseDep*>(sequence.get_allocator().GetArena());
+				exec_command_list_reservoir.reserve(sequence.size());
 				for(auto&& e : sequence)
 				{
 					if(ngl::rtg::ERtgSubmitCommandType::CommandList == e.type)
@@ -96,6 +96,7 @@
 
 #include "ngl/text/hash_text.h"
 
+#include "ngl/memory/frame_arena_allocator.h"
 #include "ngl/rhi/d3d12/device.d3d12.h"
 #include "ngl/rhi/d3d12/shader.d3d12.h"
 #include "ngl/rhi/d3d12/command_list.d3d12.h"
@@ -418,6 +419,8 @@ namespace ngl
 			//	Rtgがスケジュールした同期のためのSignalまたはWaitで使用するFenceValue.
 			u64							fence_value = 0;
 		};
+		// Execute結果のCommandSequence. DeviceのFrameArenaAllocatorから確保するため現在フレームのみ有効.
+		using RtgSubmitCommandSequence = memory::FrameArenaVector<RtgSubmitCommandSequenceElem>;
 
 		// レンダリングパスのシーケンスとそれらのリソース依存関係解決.
 		//	このクラスのインスタンスは　TaskNodeのRecord, Compile, Execute の一連の処理の後に使い捨てとなる. これは使いまわしのための状態リセットの実装ミスを避けるため.
@@ -489,14 +492,14 @@ namespace ngl
 			// 結果はQueueへSubmitするCommandListとFenceのSequence.
 			// 結果のSequenceは外部でQueueに直接Submitすることも可能であるが, ヘルパ関数SubmitCommand()を利用することを推奨する.
 			void Execute(
-				std::vector<RtgSubmitCommandSequenceElem>& out_graphics_commands, std::vector<RtgSubmitCommandSequenceElem>& out_compute_commands,
+				RtgSubmitCommandSequence& out_graphics_commands, RtgSubmitCommandSequence& out_compute_commands,
 				thread::JobSystem* p_job_system = nullptr
 				);
 
 			// RtgのExecute() で構築して生成したComandListのSequenceをGPUへSubmitするヘルパー関数.
 			static void SubmitCommand(
 				rhi::GraphicsCommandQueueDep& graphics_queue, rhi::ComputeCommandQueueDep& compute_queue,
-				std::vector<RtgSubmitCommandSequenceElem>& graphics_commands, std::vector<RtgSubmitCommandSequenceElem>& compute_commands);
+				RtgSubmitCommandSequence& graphics_commands, RtgSubmitCommandSequence& compute_commands);
 			
 		public:
 			// NodeのHandleに対して割り当て済みリソースを取得する.
@@ -4,6 +4,7 @@
 #include <memory>
 
 #include "math_vector.h"
+#include "math_simd.h"
 
 namespace ngl
 {
@@ -596,6 +597,24 @@ namespace ngl
 			template<bool IS_COFACTOR>
 			static constexpr Mat44 InverseOrCofactor(const Mat44& m)
 			{
+#if NGL_MATH_SIMD
+				if (!NGL_MATH_IS_CONSTANT_EVALUATED())
+					return InverseOrCofactorSimd<IS_COFACTOR>(m);
+#endif
+				return InverseOrCofactorConstexpr<IS_COFACTOR>(m);
+			}
+			// InverseOrCofactorの実行時SIMD実装.
+			template<bool IS_COFACTOR>
+			static Mat44 InverseOrCofactorSimd(const Mat44& m)
+			{
+				Mat44 r;
+				simd_detail::Mat44InverseOrCofactor<IS_COFACTOR>(r.m[0], m.m[0]);
+				return r;
+			}
+			// InverseOrCofactorの定数式用の実装.
+			template<bool IS_COFACTOR>
+			static constexpr Mat44 InverseOrCofactorConstexpr(const Mat44& m)
+			{
 				const float c00 = Mat33::Determinant(Mat33(m.r1.y, m.r1.z, m.r1.w, m.r2.y, m.r2.z, m.r2.w, m.r3.y, m.r3.z, m.r3.w));
 				const float c01 = -Mat33::Determinant(Mat33(m.r1.x, m.r1.z, m.r1.w, m.r2.x, m.r2.z, m.r2.w, m.r3.x, m.r3.z, m.r3.w));
 				const float c02 = Mat33::Determinant(Mat33(m.r1.x, m.r1.y, m.r1.w, m.r2.x, m.r2.y, m.r2.w, m.r3.x, m.r3.y, m.r3.w));
@@ -706,8 +725,15 @@ namespace ngl
 				m0.r3 - m1.r3
 			);
 		}
-		// Mat * Mat
-		inline constexpr Mat44 operator*(const Mat44& m0, const Mat44& m1)
+		// Mat * Mat の実行時SIMD実装.
+		inline Mat44 MulSimd(const Mat44& m0, const Mat44& m1)
+		{
+			Mat44 r;
+			simd_detail::Mat44Mul(r.m[0], m0.m[0], m1.m[0]);
+			return r;
+		}
+		// Mat * Mat の定数式用の実装.
+		inline constexpr Mat44 MulConstexpr(const Mat44& m0, const Mat44& m1)
 		{
 			return Mat44(
 				m0.r0.x * m1.r0 + m0.r0.y * m1.r1 + m0.r0.z * m1.r2 + m0.r0.w * m1.r3,
@@ -716,6 +742,15 @@ namespace ngl
 				m0.r3.x * m1.r0 + m0.r3.y * m1.r1 + m0.r3.z * m1.r2 + m0.r3.w * m1.r3
 			);
 		}
+		// Mat * Mat
+		inline constexpr Mat44 operator*(const Mat44& m0, const Mat44& m1)
+		{
+#if NGL_MATH_SIMD
+			if (!NGL_MATH_IS_CONSTANT_EVALUATED())
+				return MulSimd(m0, m1);
+#endif
+			return MulConstexpr(m0, m1);
+		}
 		// Mat * scalar
 		inline constexpr Mat44 operator*(const Mat44& m, float s)
 		{
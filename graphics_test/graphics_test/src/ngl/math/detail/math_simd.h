@@ -0,0 +1,423 @@
+﻿#pragma once
+
+/*
+	ngl::math のVector, Matrix演算の実行時SIMD実装.
+
+	Mat44, Vec4 の演算はconstexprのスカラー実装を持ち, 定数式評価ではそれを使う.
+	実行時はここの4要素単位の演算で計算する. 対象は行列同士の乗算, 行列とベクトルの乗算, 逆行列と余因子行列, 正規化.
+		要素型はfloat4つ(F4). x64ではSSE(128bit)で, FMAが有効なビルド(/arch:AVX2等)では積和にFMAを使う.
+		各演算は下記のF4の基本演算のみで書いているため, 別のSIMD命令セット(NEON等)は基本演算の実装を追加するだけで対応できる.
+		SIMDが使えない環境では基本演算をfloat配列で実装し, 実行時もconstexprのスカラー実装を使う.
+		Vec3, Mat33, Mat34 * Vec3 は12byte単位の読み書きのコストでスカラー実装より遅くなるため対象外.
+
+	NGL_MATH_NO_SIMD を定義するとSIMDを使わない.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if !defined(NGL_MATH_NO_SIMD) && (defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__))
+	#define NGL_MATH_SIMD_SSE 1
+	#include <xmmintrin.h>
+	#if defined(__FMA__) || defined(__AVX2__)
+		#define NGL_MATH_SIMD_FMA 1
+		#include <immintrin.h>
+	#else
+		#define NGL_MATH_SIMD_FMA 0
+	#endif
+#else
+	#define NGL_MATH_SIMD_SSE 0
+	#define NGL_MATH_SIMD_FMA 0
+#endif
+
+// 実行時にSIMD実装を使うか.
+#define NGL_MATH_SIMD (NGL_MATH_SIMD_SSE)
+
+// 定数式評価中かの判定. C++17では標準に無いためコンパイラ組み込み関数を使う.
+// 使えない場合はconstexpr関数は常にスカラー実装を使う(結果は同じ).
+#if defined(_MSC_VER) && (1925 <= _MSC_VER)
+	#define NGL_MATH_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#elif defined(__clang__)
+	#if defined(__has_builtin)
+		#if __has_builtin(__builtin_is_constant_evaluated)
+			#define NGL_MATH_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+		#endif
+	#endif
+#elif defined(__GNUC__) && (9 <= __GNUC__)
+	#define NGL_MATH_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+#if !defined(NGL_MATH_IS_CONSTANT_EVALUATED)
+	#define NGL_MATH_IS_CONSTANT_EVALUATED() true
+#endif
+
+
+namespace ngl
+{
+	namespace math
+	{
+		namespace simd_detail
+		{
+			// -----------------------------------------------------------------------------------------
+			// F4 基本演算.
+#if NGL_MATH_SIMD_SSE
+			using F4 = __m128;
+
+			inline F4 Load4(const float* p)
+			{
+				return _mm_loadu_ps(p);
+			}
+			// 要素単位で読み込む. 要素単位で書き込まれた直後の値を128bitで読み込むとストアフォワーディングが失敗するため,
+			// 演算の直前に構築されることが多いベクトル引数はこちらを使う.
+			inline F4 Load4Element(const float* p)
+			{
+				return _mm_setr_ps(p[0], p[1], p[2], p[3]);
+			}
+			inline void Store4(float* p, F4 v)
+			{
+				_mm_storeu_ps(p, v);
+			}
+			inline F4 Set(float x, float y, float z, float w)
+			{
+				return _mm_setr_ps(x, y, z, w);
+			}
+			inline F4 Set1(float v)
+			{
+				return _mm_set1_ps(v);
+			}
+			inline F4 Zero()
+			{
+				return _mm_setzero_ps();
+			}
+			inline F4 Add(F4 a, F4 b)
+			{
+				return _mm_add_ps(a, b);
+			}
+			inline F4 Sub(F4 a, F4 b)
+			{
+				return _mm_sub_ps(a, b);
+			}
+			inline F4 Mul(F4 a, F4 b)
+			{
+				return _mm_mul_ps(a, b);
+			}
+			inline F4 Div(F4 a, F4 b)
+			{
+				return _mm_div_ps(a, b);
+			}
+			// a * b + c.
+			inline F4 MulAdd(F4 a, F4 b, F4 c)
+			{
+	#if NGL_MATH_SIMD_FMA
+				return _mm_fmadd_ps(a, b, c);
+	#else
+				return _mm_add_ps(_mm_mul_ps(a, b), c);
+	#endif
+			}
+			inline F4 Sqrt(F4 a)
+			{
+				return _mm_sqrt_ps(a);
+			}
+			inline F4 Abs(F4 a)
+			{
+				return _mm_andnot_ps(_mm_set1_ps(-0.0f), a);
+			}
+			inline F4 Min(F4 a, F4 b)
+			{
+				return _mm_min_ps(a, b);
+			}
+			inline F4 Max(F4 a, F4 b)
+			{
+				return _mm_max_ps(a, b);
+			}
+			// a >= b. 真の要素は全bitが1.
+			inline F4 CmpGe(F4 a, F4 b)
+			{
+				return _mm_cmpge_ps(a, b);
+			}
+			inline F4 And(F4 a, F4 b)
+			{
+				return _mm_and_ps(a, b);
+			}
+			// 各要素の最上位bitを下位4bitに並べる. 比較結果のマスク用.
+			inline int MoveMask(F4 a)
+			{
+				return _mm_movemask_ps(a);
+			}
+			// (a[X], a[Y], b[Z], b[W]).
+			template<int X, int Y, int Z, int W>
+			inline F4 Shuffle(F4 a, F4 b)
+			{
+				return _mm_shuffle_ps(a, b, _MM_SHUFFLE(W, Z, Y, X));
+			}
+			// 行列の転置.
+			inline void Transpose(F4& r0, F4& r1, F4& r2, F4& r3)
+			{
+				_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+			}
+#else
+			struct F4
+			{
+				float v[4];
+			};
+
+			inline F4 Load4(const float* p)
+			{
+				return { p[0], p[1], p[2], p[3] };
+			}
+			inline F4 Load4Element(const float* p)
+			{
+				return Load4(p);
+			}
+			inline void Store4(float* p, F4 v)
+			{
+				for (int i = 0; i < 4; ++i)
+					p[i] = v.v[i];
+			}
+			inline F4 Set(float x, float y, float z, float w)
+			{
+				return { x, y, z, w };
+			}
+			inline F4 Set1(float v)
+			{
+				return { v, v, v, v };
+			}
+			inline F4 Zero()
+			{
+				return { 0.0f, 0.0f, 0.0f, 0.0f };
+			}
+			inline F4 Add(F4 a, F4 b)
+			{
+				return { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] };
+			}
+			inline F4 Sub(F4 a, F4 b)
+			{
+				return { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] };
+			}
+			inline F4 Mul(F4 a, F4 b)
+			{
+				return { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] };
+			}
+			inline F4 Div(F4 a, F4 b)
+			{
+				return { a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3] };
+			}
+			inline F4 MulAdd(F4 a, F4 b, F4 c)
+			{
+				return Add(Mul(a, b), c);
+			}
+			inline F4 Sqrt(F4 a)
+			{
+				return { std::sqrt(a.v[0]), std::sqrt(a.v[1]), std::sqrt(a.v[2]), std::sqrt(a.v[3]) };
+			}
+			inline F4 Abs(F4 a)
+			{
+				return { std::abs(a.v[0]), std::abs(a.v[1]), std::abs(a.v[2]), std::abs(a.v[3]) };
+			}
+			inline F4 Min(F4 a, F4 b)
+			{
+				return { std::min(a.v[0], b.v[0]), std::min(a.v[1], b.v[1]), std::min(a.v[2], b.v[2]), std::min(a.v[3], b.v[3]) };
+			}
+			inline F4 Max(F4 a, F4 b)
+			{
+				return { std::max(a.v[0], b.v[0]), std::max(a.v[1], b.v[1]), std::max(a.v[2], b.v[2]), std::max(a.v[3], b.v[3]) };
+			}
+			// 比較結果のマスクはbit表現で保持する.
+			inline F4 CmpGe(F4 a, F4 b)
+			{
+				F4 r;
+				for (int i = 0; i < 4; ++i)
+				{
+					const uint32_t mask = (a.v[i] >= b.v[i]) ? ~0u : 0u;
+					std::memcpy(&r.v[i], &mask, sizeof(mask));
+				}
+				return r;
+			}
+			inline F4 And(F4 a, F4 b)
+			{
+				F4 r;
+				for (int i = 0; i < 4; ++i)
+				{
+					uint32_t x, y;
+					std::memcpy(&x, &a.v[i], sizeof(x));
+					std::memcpy(&y, &b.v[i], sizeof(y));
+					x &= y;
+					std::memcpy(&r.v[i], &x, sizeof(x));
+				}
+				return r;
+			}
+			inline int MoveMask(F4 a)
+			{
+				int r = 0;
+				for (int i = 0; i < 4; ++i)
+				{
+					uint32_t x;
+					std::memcpy(&x, &a.v[i], sizeof(x));
+					r |= static_cast<int>(x >> 31) << i;
+				}
+				return r;
+			}
+			template<int X, int Y, int Z, int W>
+			inline F4 Shuffle(F4 a, F4 b)
+			{
+				return { a.v[X], a.v[Y], b.v[Z], b.v[W] };
+			}
+			inline void Transpose(F4& r0, F4& r1, F4& r2, F4& r3)
+			{
+				const F4 t0 = r0, t1 = r1, t2 = r2, t3 = r3;
+				r0 = { t0.v[0], t1.v[0], t2.v[0], t3.v[0] };
+				r1 = { t0.v[1], t1.v[1], t2.v[1], t3.v[1] };
+				r2 = { t0.v[2], t1.v[2], t2.v[2], t3.v[2] };
+				r3 = { t0.v[3], t1.v[3], t2.v[3], t3.v[3] };
+			}
+#endif
+
+			template<int I>
+			inline F4 Splat(F4 a)
+			{
+				return Shuffle<I, I, I, I>(a, a);
+			}
+			// 4要素の総和を全要素に.
+			inline F4 HorizontalSum(F4 a)
+			{
+				const F4 s = Add(a, Shuffle<1, 0, 3, 2>(a, a));
+				return Add(s, Shuffle<2, 3, 0, 1>(s, s));
+			}
+			// 内積を全要素に.
+			inline F4 Dot4(F4 a, F4 b)
+			{
+				return HorizontalSum(Mul(a, b));
+			}
+
+
+			// -----------------------------------------------------------------------------------------
+			// Vector.
+
+			inline void Vec4Normalize(float* out, const float* v)
+			{
+				const F4 a = Load4Element(v);
+				Store4(out, Mul(a, Div(Set1(1.0f), Sqrt(Dot4(a, a)))));
+			}
+
+
+			// -----------------------------------------------------------------------------------------
+			// Matrix. 全て行優先.
+
+			// 行ベクトル r と行列 b(4行)の積. 行の線形結合.
+			inline F4 RowMulMat4(F4 r, F4 b0, F4 b1, F4 b2, F4 b3)
+			{
+				F4 o = Mul(Splat<0>(r), b0);
+				o = MulAdd(Splat<1>(r), b1, o);
+				o = MulAdd(Splat<2>(r), b2, o);
+				return MulAdd(Splat<3>(r), b3, o);
+			}
+			// 行列(4行)と列ベクトル v の積. 転置した行列の列の線形結合.
+			//	転置は行列のみに依存するため, 同じ行列で繰り返す場合はループ外に出せる.
+			inline F4 MatMulColumn(F4 r0, F4 r1, F4 r2, F4 r3, F4 v)
+			{
+				Transpose(r0, r1, r2, r3);
+				return RowMulMat4(v, r0, r1, r2, r3);
+			}
+
+			// out = m0 * m1. Mat44.
+			inline void Mat44Mul(float* out, const float* m0, const float* m1)
+			{
+				const F4 b0 = Load4(m1 + 0), b1 = Load4(m1 + 4), b2 = Load4(m1 + 8), b3 = Load4(m1 + 12);
+				// outとm0が同じ場合のため全行を読んでから書き込む.
+				const F4 a0 = Load4(m0 + 0), a1 = Load4(m0 + 4), a2 = Load4(m0 + 8), a3 = Load4(m0 + 12);
+				Store4(out + 0, RowMulMat4(a0, b0, b1, b2, b3));
+				Store4(out + 4, RowMulMat4(a1, b0, b1, b2, b3));
+				Store4(out + 8, RowMulMat4(a2, b0, b1, b2, b3));
+				Store4(out + 12, RowMulMat4(a3, b0, b1, b2, b3));
+			}
+			// out = m * v(列ベクトル). Mat44.
+			inline void Mat44MulVec4(float* out, const float* m, const float* v)
+			{
+				Store4(out, MatMulColumn(Load4(m + 0), Load4(m + 4), Load4(m + 8), Load4(m + 12), Load4Element(v)));
+			}
+			// out = v(行ベクトル) * m. Mat44.
+			inline void Vec4MulMat44(float* out, const float* v, const float* m)
+			{
+				Store4(out, RowMulMat4(Load4Element(v), Load4(m + 0), Load4(m + 4), Load4(m + 8), Load4(m + 12)));
+			}
+
+			// 2x2行列(m00, m01, m10, m11)の演算. Mat44の逆行列用.
+			// a * b
+			inline F4 Mat22Mul(F4 a, F4 b)
+			{
+				return Add(Mul(a, Shuffle<0, 3, 0, 3>(b, b)), Mul(Shuffle<1, 0, 3, 2>(a, a), Shuffle<2, 1, 2, 1>(b, b)));
+			}
+			// adj(a) * b
+			inline F4 Mat22AdjMul(F4 a, F4 b)
+			{
+				return Sub(Mul(Shuffle<3, 3, 0, 0>(a, a), b), Mul(Shuffle<1, 1, 2, 2>(a, a), Shuffle<2, 3, 0, 1>(b, b)));
+			}
+			// a * adj(b)
+			inline F4 Mat22MulAdj(F4 a, F4 b)
+			{
+				return Sub(Mul(a, Shuffle<3, 0, 3, 0>(b, b)), Mul(Shuffle<1, 0, 3, 2>(a, a), Shuffle<2, 1, 2, 1>(b, b)));
+			}
+
+			// Mat44の逆行列 または 行列式で割らない余因子行列.
+			//	2x2のブロック行列 M = |A B| に分割し, 各ブロックの余因子行列から計算する.
+			//	                      |C D|
+			template<bool IS_COFACTOR>
+			inline void Mat44InverseOrCofactor(float* out, const float* m)
+			{
+				const F4 r0 = Load4(m + 0), r1 = Load4(m + 4), r2 = Load4(m + 8), r3 = Load4(m + 12);
+				const F4 a = Shuffle<0, 1, 0, 1>(r0, r1);
+				const F4 b = Shuffle<2, 3, 2, 3>(r0, r1);
+				const F4 c = Shuffle<0, 1, 0, 1>(r2, r3);
+				const F4 d = Shuffle<2, 3, 2, 3>(r2, r3);
+
+				// (|A|, |B|, |C|, |D|).
+				const F4 det_sub = Sub(
+					Mul(Shuffle<0, 2, 0, 2>(r0, r2), Shuffle<1, 3, 1, 3>(r1, r3)),
+					Mul(Shuffle<1, 3, 1, 3>(r0, r2), Shuffle<0, 2, 0, 2>(r1, r3)));
+				const F4 det_a = Splat<0>(det_sub);
+				const F4 det_b = Splat<1>(det_sub);
+				const F4 det_c = Splat<2>(det_sub);
+				const F4 det_d = Splat<3>(det_sub);
+
+				const F4 d_c = Mat22AdjMul(d, c);
+				const F4 a_b = Mat22AdjMul(a, b);
+				// 逆行列 * |M| = |X Y| の各ブロックの余因子行列.
+				//                |Z W|
+				F4 x = Sub(Mul(det_d, a), Mat22Mul(b, d_c));
+				F4 w = Sub(Mul(det_a, d), Mat22Mul(c, a_b));
+				F4 y = Sub(Mul(det_b, c), Mat22MulAdj(d, a_b));
+				F4 z = Sub(Mul(det_c, b), Mat22MulAdj(a, d_c));
+
+				// 余因子行列の符号.
+				F4 scale = Set(1.0f, -1.0f, -1.0f, 1.0f);
+				if constexpr (!IS_COFACTOR)
+				{
+					// |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+					const F4 tr = HorizontalSum(Mul(a_b, Shuffle<0, 2, 1, 3>(d_c, d_c)));
+					const F4 det_m = Sub(Add(Mul(det_a, det_d), Mul(det_b, det_c)), tr);
+					scale = Div(scale, det_m);
+				}
+				x = Mul(x, scale);
+				y = Mul(y, scale);
+				z = Mul(z, scale);
+				w = Mul(w, scale);
+
+				// 各ブロックを余因子行列の転置として並べる.
+				F4 o0 = Shuffle<3, 1, 3, 1>(x, y);
+				F4 o1 = Shuffle<2, 0, 2, 0>(x, y);
+				F4 o2 = Shuffle<3, 1, 3, 1>(z, w);
+				F4 o3 = Shuffle<2, 0, 2, 0>(z, w);
+				if constexpr (IS_COFACTOR)
+				{
+					// 余因子行列は転置.
+					Transpose(o0, o1, o2, o3);
+				}
+				Store4(out + 0, o0);
+				Store4(out + 4, o1);
+				Store4(out + 8, o2);
+				Store4(out + 12, o3);
+			}
+		}
+	}
+}
@@ -2,8 +2,11 @@
 
 #include <cmath>
 #include <memory>
+#include <limits>
+#include <algorithm>
 
 #include "math_vector.h"
+#include "math_matrix.h"
 
 namespace ngl
 {
@@ -41,7 +44,8 @@ namespace ngl
 			Plane planes_[EPlaneIndex::_MAX];
 		};
 				
-		// --
+		// カメラの位置と基底ベクトルからFrustumを生成. 各平面の法線はFrustumの内側向き.
+		//	view_right, view_up, view_dirはCalcViewMatrixの左手系の基底(view_right = Cross(view_up, view_dir)).
 		inline void CreateFrustum(Frustum& out_frustum,
 			math::Vec3 view_pos, math::Vec3 view_dir, math::Vec3 view_up, math::Vec3 view_right,
 			float near_z, float far_z, float fov_y, float aspect_ratio)
@@ -53,14 +57,118 @@ namespace ngl
 
 			frustum.planes_[Frustum::EPlaneIndex::NEAR_PLANE] = { view_pos + near_z * view_dir, view_dir };
 			frustum.planes_[Frustum::EPlaneIndex::FAR_PLANE] = { view_pos + front_mult_far, -view_dir };
-			frustum.planes_[Frustum::EPlaneIndex::RIGHT_PLANE] = { view_pos, math::Vec3::Cross(front_mult_far - view_right * half_h, view_up) };
-			frustum.planes_[Frustum::EPlaneIndex::LEFT_PLANE] = { view_pos, math::Vec3::Cross(view_up,front_mult_far + view_right * half_h) };
-			frustum.planes_[Frustum::EPlaneIndex::TOP_PLANE] = { view_pos, math::Vec3::Cross(view_right, front_mult_far - view_up * half_v) };
-			frustum.planes_[Frustum::EPlaneIndex::BOTTOM_PLANE] = { view_pos, math::Vec3::Cross(front_mult_far + view_up * half_v, view_right) };
+			// 側面は視点とFar面の辺を通る. 辺の方向と面内のもう一方の軸の外積で内側向きの法線とする.
+			frustum.planes_[Frustum::EPlaneIndex::RIGHT_PLANE] = { view_pos, math::Vec3::Cross(front_mult_far + view_right * half_h, view_up) };
+			frustum.planes_[Frustum::EPlaneIndex::LEFT_PLANE] = { view_pos, math::Vec3::Cross(view_up, front_mult_far - view_right * half_h) };
+			frustum.planes_[Frustum::EPlaneIndex::TOP_PLANE] = { view_pos, math::Vec3::Cross(view_right, front_mult_far + view_up * half_v) };
+			frustum.planes_[Frustum::EPlaneIndex::BOTTOM_PLANE] = { view_pos, math::Vec3::Cross(front_mult_far - view_up * half_v, view_right) };
 
 			out_frustum = frustum;
 		}
 		
+		// 変換行列(投影 * ビュー)からFrustumを生成. 各平面の法線はFrustumの内側向き.
+		//	クリップ空間で -w <= x <= w, -w <= y <= w, 0 <= z <= w の範囲. is_reverse_zの場合は z == w がNear.
+		//	無限遠Farの投影行列ではFar平面の法線はゼロとなり, 全ての点が内側と判定される.
+		inline void CreateFrustum(Frustum& out_frustum, const Mat44& view_proj, bool is_reverse_z = true)
+		{
+			const Vec4 r0 = view_proj.r0;
+			const Vec4 r1 = view_proj.r1;
+			const Vec4 r2 = view_proj.r2;
+			const Vec4 r3 = view_proj.r3;
+			// ax + by + cz + d >= 0 を内側とする平面から変換.
+			auto to_plane = [](const Vec4& v)
+			{
+				Plane plane;
+				const float len = v.XYZ().Length();
+				const float inv_len = (0.0f < len) ? (1.0f / len) : 1.0f;
+				plane.normal_ = v.XYZ() * inv_len;
+				plane.distance_ = -v.w * inv_len;
+				return plane;
+			};
+
+			out_frustum.planes_[Frustum::EPlaneIndex::LEFT_PLANE] = to_plane(r3 + r0);
+			out_frustum.planes_[Frustum::EPlaneIndex::RIGHT_PLANE] = to_plane(r3 - r0);
+			out_frustum.planes_[Frustum::EPlaneIndex::BOTTOM_PLANE] = to_plane(r3 + r1);
+			out_frustum.planes_[Frustum::EPlaneIndex::TOP_PLANE] = to_plane(r3 - r1);
+			out_frustum.planes_[(is_reverse_z) ? Frustum::EPlaneIndex::FAR_PLANE : Frustum::EPlaneIndex::NEAR_PLANE] = to_plane(r2);
+			out_frustum.planes_[(is_reverse_z) ? Frustum::EPlaneIndex::NEAR_PLANE : Frustum::EPlaneIndex::FAR_PLANE] = to_plane(r3 - r2);
+		}
+
+
+		// 軸平行境界箱. 初期状態は空.
+		struct Aabb
+		{
+			math::Vec3 min_ = math::Vec3(std::numeric_limits<float>::max());
+			math::Vec3 max_ = math::Vec3(-std::numeric_limits<float>::max());
+
+			Aabb() = default;
+			Aabb(const math::Vec3& min, const math::Vec3& max)
+				: min_(min), max_(max)
+			{
+			}
+
+			bool IsValid() const
+			{
+				return (min_.x <= max_.x) && (min_.y <= max_.y) && (min_.z <= max_.z);
+			}
+			// 点を含むように拡張.
+			void Expand(const math::Vec3& p)
+			{
+				min_ = math::Vec3(std::min(min_.x, p.x), std::min(min_.y, p.y), std::min(min_.z, p.z));
+				max_ = math::Vec3(std::max(max_.x, p.x), std::max(max_.y, p.y), std::max(max_.z, p.z));
+			}
+			void Expand(const Aabb& v)
+			{
+				if (!v.IsValid())
+					return;
+				Expand(v.min_);
+				Expand(v.max_);
+			}
+			math::Vec3 GetCenter() const
+			{
+				return (min_ + max_) * 0.5f;
+			}
+			// 中心から各面までの距離.
+			math::Vec3 GetExtent() const
+			{
+				return (max_ - min_) * 0.5f;
+			}
+
+			// 変換後の点を全て含むAABB. 回転で大きくなるため元の形状を包む最小の箱とは限らない.
+			static Aabb Transform(const Aabb& v, const Mat34& m)
+			{
+				const math::Vec4 local_center(v.GetCenter(), 1.0f);
+				const math::Vec3 center(Vec4::Dot(m.r0, local_center), Vec4::Dot(m.r1, local_center), Vec4::Dot(m.r2, local_center));
+				const math::Vec3 extent = v.GetExtent();
+				const math::Vec3 world_extent(
+					std::abs(m.r0.x) * extent.x + std::abs(m.r0.y) * extent.y + std::abs(m.r0.z) * extent.z,
+					std::abs(m.r1.x) * extent.x + std::abs(m.r1.y) * extent.y + std::abs(m.r1.z) * extent.z,
+					std::abs(m.r2.x) * extent.x + std::abs(m.r2.y) * extent.y + std::abs(m.r2.z) * extent.z);
+				return Aabb(center - world_extent, center + world_extent);
+			}
+		};
+
+		// 境界球.
+		struct BoundingSphere
+		{
+			math::Vec3 center_ = math::Vec3::Zero();
+			float radius_ = 0.0f;
+		};
+
+		// 中心と中心から各面までの距離で表したAABBとFrustumの交差判定. 全ての平面の外側にはみ出していなければ交差とする.
+		//	Frustumの角付近で交差しないAABBも交差と判定する場合がある.
+		inline bool IsIntersectFrustumAabb(const Frustum& frustum, const math::Vec3& center, const math::Vec3& extent)
+		{
+			for (const auto& plane : frustum.planes_)
+			{
+				const float dist = Vec3::Dot(plane.normal_, center) - plane.distance_;
+				const float radius = std::abs(plane.normal_.x) * extent.x + std::abs(plane.normal_.y) * extent.y + std::abs(plane.normal_.z) * extent.z;
+				if (dist + radius < 0.0f)
+					return false;
+			}
+			return true;
+		}
+
 		// 視点位置基準での奥行き方向1.0のFrustum頂点へのベクトル. 正規化されたベクトルではないことに注意(viwe_dir成分が1.0).
 		// ex) view_dir + view_up*fov_term + view_right*fov_term*aspect
 		struct ViewPositionRelativeFrustumCorners
@@ -3,6 +3,8 @@
 #include <cmath>
 #include <memory>
 
+#include "math_simd.h"
+
 namespace ngl
 {
 	namespace math
@@ -262,8 +264,24 @@ namespace ngl
 
 			static VecN Normalize(const VecN& v)
 			{
+#if NGL_MATH_SIMD
+				if constexpr (4 == DIMENSION)
+					return NormalizeSimd(v);
+#endif
+				return NormalizeScalar(v);
+			}
+			static VecN NormalizeScalar(const VecN& v)
+			{
 				return v / v.Length();
 			}
+			// 正規化のSIMD実装. Vec4のみ.
+			static VecN NormalizeSimd(const VecN& v)
+			{
+				static_assert(4 == DIMENSION);
+				VecN r;
+				simd_detail::Vec4Normalize(r.data, v.data);
+				return r;
+			}
 
 			static constexpr VecN Zero()
 			{
@@ -52,15 +52,44 @@ namespace ngl
 		}
 
 		// Mat * Vector(column)
-		inline constexpr Vec4 operator*(const Mat44& m, const Vec4& v)
+		//	MulConstexprは定数式用の実装, MulSimdは実行時のSIMD実装. 演算子は定数式評価かで切り替える.
+		inline constexpr Vec4 MulConstexpr(const Mat44& m, const Vec4& v)
 		{
 			return Vec4(Vec4::Dot(m.r0, v), Vec4::Dot(m.r1, v), Vec4::Dot(m.r2, v), Vec4::Dot(m.r3, v));
 		}
+		inline Vec4 MulSimd(const Mat44& m, const Vec4& v)
+		{
+			Vec4 r;
+			simd_detail::Mat44MulVec4(r.data, m.m[0], v.data);
+			return r;
+		}
+		inline constexpr Vec4 operator*(const Mat44& m, const Vec4& v)
+		{
+#if NGL_MATH_SIMD
+			if (!NGL_MATH_IS_CONSTANT_EVALUATED())
+				return MulSimd(m, v);
+#endif
+			return MulConstexpr(m, v);
+		}
 		// Vector(row) * Mat
-		inline constexpr Vec4 operator*(Vec4& v, const Mat44& m)
+		inline constexpr Vec4 MulConstexpr(const Vec4& v, const Mat44& m)
 		{
 			return m.r0 * v.x + m.r1 * v.y + m.r2 * v.z + m.r3 * v.w;
 		}
+		inline Vec4 MulSimd(const Vec4& v, const Mat44& m)
+		{
+			Vec4 r;
+			simd_detail::Vec4MulMat44(r.data, v.data, m.m[0]);
+			return r;
+		}
+		inline constexpr Vec4 operator*(Vec4& v, const Mat44& m)
+		{
+#if NGL_MATH_SIMD
+			if (!NGL_MATH_IS_CONSTANT_EVALUATED())
+				return MulSimd(v, m);
+#endif
+			return MulConstexpr(v, m);
+		}
 
 		// Mat * Vector(column)
 		inline constexpr Vec3 operator*(const Mat34& m, const Vec3& v)
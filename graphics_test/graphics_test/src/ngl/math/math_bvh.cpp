@@ -0,0 +1,581 @@
+﻿
+#include "math_bvh.h"
+
+#include <algorithm>
+#include <queue>
+#include <limits>
+
+#include <assert.h>
+
+namespace ngl
+{
+	namespace math
+	{
+		namespace
+		{
+			// SAHで分割する最大の深さ. これより深い場合は最長軸の中央値で分割し, 深さを抑える.
+			constexpr uint32_t k_max_sah_depth = 48;
+			// 要素数がこれより多いノードは中心の範囲が最長の軸のみビンで評価する. 上位のノードは最長軸での分割がほぼ最良のため構築時間を優先する.
+			constexpr uint32_t k_all_axis_bin_max_item = 4096;
+			// 走査スタックの最大数. 深さの上限から十分な数.
+			constexpr uint32_t k_traverse_stack_size = 128;
+
+			Vec3 Min3(const Vec3& a, const Vec3& b)
+			{
+				return Vec3(std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z));
+			}
+			Vec3 Max3(const Vec3& a, const Vec3& b)
+			{
+				return Vec3(std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z));
+			}
+
+			// 表面積. 巨大な境界でも溢れないようにdoubleで計算する.
+			double SurfaceArea(const Vec3& min, const Vec3& max)
+			{
+				const double dx = double(max.x) - double(min.x);
+				const double dy = double(max.y) - double(min.y);
+				const double dz = double(max.z) - double(min.z);
+				if (0.0 > dx || 0.0 > dy || 0.0 > dz)
+					return 0.0;
+				return 2.0 * (dx * dy + dy * dz + dz * dx);
+			}
+
+			enum class EPlaneSide
+			{
+				Outside,
+				Intersect,
+				Inside,
+			};
+			// AABBと平面の位置関係. 判定は math::IsIntersectFrustumAabb と同じ.
+			EPlaneSide ClassifyPlaneAabb(const Plane& plane, const Vec3& center, const Vec3& extent)
+			{
+				const float dist = Vec3::Dot(plane.normal_, center) - plane.distance_;
+				const float radius = std::abs(plane.normal_.x) * extent.x + std::abs(plane.normal_.y) * extent.y + std::abs(plane.normal_.z) * extent.z;
+				if (dist + radius < 0.0f)
+					return EPlaneSide::Outside;
+				if (dist - radius >= 0.0f)
+					return EPlaneSide::Inside;
+				return EPlaneSide::Intersect;
+			}
+
+			bool IsIntersectSphereAabb(const Vec3& center, float radius_sq, const Vec3& min, const Vec3& max)
+			{
+				const Vec3 closest = Min3(Max3(center, min), max);
+				return Vec3::LengthSq(closest - center) <= radius_sq;
+			}
+
+			// 線分とAABBの交差. 交差する場合は進入位置のtを返す.
+			bool IntersectRayAabb(float& out_t, const Vec3& origin, const Vec3& inv_dir, float t_max, const Vec3& min, const Vec3& max)
+			{
+				const Vec3 t0 = (min - origin) * inv_dir;
+				const Vec3 t1 = (max - origin) * inv_dir;
+				const float t_enter = std::max(std::max(std::min(t0.x, t1.x), std::min(t0.y, t1.y)), std::max(std::min(t0.z, t1.z), 0.0f));
+				const float t_exit = std::min(std::min(std::max(t0.x, t1.x), std::max(t0.y, t1.y)), std::min(std::max(t0.z, t1.z), t_max));
+				out_t = t_enter;
+				return t_enter <= t_exit;
+			}
+		}
+
+		void AabbBvh::Build(const Aabb* aabb_array, uint32_t count)
+		{
+			item_aabb_.assign(aabb_array, aabb_array + count);
+			Rebuild();
+		}
+
+		void AabbBvh::Clear()
+		{
+			node_array_.clear();
+			node_parent_.clear();
+			item_index_.clear();
+			item_aabb_.clear();
+			item_leaf_.clear();
+			dirty_node_.clear();
+			node_dirty_flag_.clear();
+			build_item_.clear();
+		}
+
+		void AabbBvh::Rebuild()
+		{
+			const uint32_t count = NumItem();
+
+			node_array_.clear();
+			node_parent_.clear();
+			dirty_node_.clear();
+			item_index_.resize(count);
+			item_leaf_.assign(count, k_invalid_index);
+
+			// 分割で並び替える要素. IDを経由したランダムアクセスを避けるためAABBと中心も並べる.
+			build_item_.resize(count);
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				const Aabb& aabb = item_aabb_[i];
+				const Vec3 centroid = aabb.GetCenter();
+				build_item_[i] = { { aabb.min_.x, aabb.min_.y, aabb.min_.z }, { aabb.max_.x, aabb.max_.y, aabb.max_.z }, { centroid.x, centroid.y, centroid.z }, i };
+			}
+
+			if (0 < count)
+			{
+				// 葉が半分以上埋まる場合のノード数.
+				node_array_.reserve(count);
+				node_parent_.reserve(count);
+				BuildNode(0, count, k_invalid_index, 0);
+			}
+			node_dirty_flag_.assign(node_array_.size(), 0);
+
+			// 作業用のメモリは解放する.
+			std::vector<BuildItem>().swap(build_item_);
+		}
+
+		uint32_t AabbBvh::BuildNode(uint32_t begin, uint32_t end, uint32_t parent, uint32_t depth)
+		{
+			const uint32_t node_index = static_cast<uint32_t>(node_array_.size());
+			node_array_.push_back({});
+			node_parent_.push_back(parent);
+
+			const uint32_t count = end - begin;
+			if (k_max_leaf_item >= count)
+			{
+				BvhNode& node = node_array_[node_index];
+				node.first_ = begin;
+				node.count_ = count;
+				Aabb bounds = {};
+				for (uint32_t i = begin; i < end; ++i)
+				{
+					const BuildItem& item = build_item_[i];
+					item_index_[i] = item.id;
+					item_leaf_[item.id] = node_index;
+					bounds.Expand(Aabb(Vec3(item.min[0], item.min[1], item.min[2]), Vec3(item.max[0], item.max[1], item.max[2])));
+				}
+				node.min_ = bounds.min_;
+				node.max_ = bounds.max_;
+				return node_index;
+			}
+
+			// 要素の中心の範囲.
+			Vec3 centroid_min(std::numeric_limits<float>::max());
+			Vec3 centroid_max(-std::numeric_limits<float>::max());
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				const float* c = build_item_[i].centroid;
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					centroid_min.data[axis] = std::min(centroid_min.data[axis], c[axis]);
+					centroid_max.data[axis] = std::max(centroid_max.data[axis], c[axis]);
+				}
+			}
+
+			// 各軸をビンに分けて, ビン境界での分割のSAHコストが最小のものを選ぶ. 複数軸のビンは要素の1回の走査で集計する.
+			// 最内ループのためVec3を使わずfloatで集計する.
+			struct Bin
+			{
+				float		min[3] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+				float		max[3] = { -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+				uint32_t	count = 0;
+
+				void Expand(const float* in_min, const float* in_max)
+				{
+					for (int i = 0; i < 3; ++i)
+					{
+						min[i] = std::min(min[i], in_min[i]);
+						max[i] = std::max(max[i], in_max[i]);
+					}
+				}
+				double SurfaceArea() const
+				{
+					return math::SurfaceArea(Vec3(min[0], min[1], min[2]), Vec3(max[0], max[1], max[2]));
+				}
+			};
+			const Vec3 centroid_extent = centroid_max - centroid_min;
+			const int longest_axis = (centroid_extent.x >= centroid_extent.y && centroid_extent.x >= centroid_extent.z) ? 0 : ((centroid_extent.y >= centroid_extent.z) ? 1 : 2);
+			const bool is_all_axis = k_all_axis_bin_max_item >= count;
+			const int axis_begin = is_all_axis ? 0 : longest_axis;
+			const int axis_end = is_all_axis ? 3 : longest_axis + 1;
+
+			Bin bin[3][k_bin_count];
+			float bin_offset[3];
+			float bin_scale[3];
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				bin_offset[axis] = centroid_min.data[axis];
+				bin_scale[axis] = (axis_begin <= axis && axis_end > axis && 0.0f < centroid_extent.data[axis]) ? (static_cast<float>(k_bin_count) / centroid_extent.data[axis]) : 0.0f;
+			}
+			auto calc_bin = [&](const float* centroid, int axis)
+			{
+				return std::min(k_bin_count - 1, static_cast<uint32_t>((centroid[axis] - bin_offset[axis]) * bin_scale[axis]));
+			};
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				const BuildItem& item = build_item_[i];
+				for (int axis = axis_begin; axis < axis_end; ++axis)
+				{
+					Bin& b = bin[axis][calc_bin(item.centroid, axis)];
+					b.Expand(item.min, item.max);
+					++b.count;
+				}
+			}
+
+			double best_cost = std::numeric_limits<double>::max();
+			int best_axis = -1;
+			uint32_t best_split = 0;
+			for (int axis = axis_begin; axis < axis_end; ++axis)
+			{
+				if (!(0.0f < bin_scale[axis]))
+					continue;
+
+				// 右側からの累積.
+				double right_area[k_bin_count] = {};
+				uint32_t right_count[k_bin_count] = {};
+				{
+					Bin right = {};
+					for (uint32_t b = k_bin_count - 1; 0 < b; --b)
+					{
+						right.Expand(bin[axis][b].min, bin[axis][b].max);
+						right.count += bin[axis][b].count;
+						right_area[b] = right.SurfaceArea();
+						right_count[b] = right.count;
+					}
+				}
+				Bin left = {};
+				for (uint32_t split = 1; split < k_bin_count; ++split)
+				{
+					left.Expand(bin[axis][split - 1].min, bin[axis][split - 1].max);
+					left.count += bin[axis][split - 1].count;
+					if (0 == left.count || 0 == right_count[split])
+						continue;
+					const double cost = left.SurfaceArea() * left.count + right_area[split] * right_count[split];
+					if (cost < best_cost)
+					{
+						best_cost = cost;
+						best_axis = axis;
+						best_split = split;
+					}
+				}
+			}
+
+			uint32_t mid = begin + count / 2;
+			if (0 <= best_axis && k_max_sah_depth > depth)
+			{
+				auto* p_mid = std::partition(build_item_.data() + begin, build_item_.data() + end, [&](const BuildItem& item)
+					{
+						return calc_bin(item.centroid, best_axis) < best_split;
+					});
+				mid = static_cast<uint32_t>(p_mid - build_item_.data());
+			}
+			else
+			{
+				// 中心が全て同じ位置か, 深さの上限. 最長軸の中央値で分割する.
+				std::nth_element(build_item_.data() + begin, build_item_.data() + mid, build_item_.data() + end, [&](const BuildItem& a, const BuildItem& b)
+					{
+						return a.centroid[longest_axis] < b.centroid[longest_axis];
+					});
+			}
+			if (begin == mid || end == mid)
+				mid = begin + count / 2;
+
+			BuildNode(begin, mid, node_index, depth + 1);
+			const uint32_t right_index = BuildNode(mid, end, node_index, depth + 1);
+
+			BvhNode& node = node_array_[node_index];
+			node.first_ = right_index;
+			node.count_ = 0;
+			node.min_ = Min3(node_array_[node_index + 1].min_, node_array_[right_index].min_);
+			node.max_ = Max3(node_array_[node_index + 1].max_, node_array_[right_index].max_);
+			return node_index;
+		}
+
+		void AabbBvh::SetLeafBounds(BvhNode& node) const
+		{
+			Aabb bounds = {};
+			for (uint32_t i = node.first_; i < node.first_ + node.count_; ++i)
+				bounds.Expand(item_aabb_[item_index_[i]]);
+			node.min_ = bounds.min_;
+			node.max_ = bounds.max_;
+		}
+
+		void AabbBvh::UpdateItem(uint32_t id, const Aabb& aabb)
+		{
+			assert(id < NumItem());
+			item_aabb_[id] = aabb;
+
+			const uint32_t leaf = item_leaf_[id];
+			if (!node_dirty_flag_[leaf])
+			{
+				node_dirty_flag_[leaf] = 1;
+				dirty_node_.push_back(leaf);
+			}
+		}
+
+		uint32_t AabbBvh::Refit()
+		{
+			if (dirty_node_.empty())
+				return 0;
+
+			// 子は親より後ろに配置されているため, インデックスの大きい順に処理すると子が先に確定する.
+			std::priority_queue<uint32_t> queue(std::less<uint32_t>(), std::move(dirty_node_));
+			dirty_node_ = {};
+
+			uint32_t refit_count = 0;
+			while (!queue.empty())
+			{
+				const uint32_t node_index = queue.top();
+				queue.pop();
+				node_dirty_flag_[node_index] = 0;
+				++refit_count;
+
+				BvhNode& node = node_array_[node_index];
+				const Vec3 prev_min = node.min_;
+				const Vec3 prev_max = node.max_;
+				if (node.IsLeaf())
+				{
+					SetLeafBounds(node);
+				}
+				else
+				{
+					node.min_ = Min3(node_array_[node_index + 1].min_, node_array_[node.first_].min_);
+					node.max_ = Max3(node_array_[node_index + 1].max_, node_array_[node.first_].max_);
+				}
+
+				// 変化が無ければ親には伝搬しない.
+				if (prev_min == node.min_ && prev_max == node.max_)
+					continue;
+				const uint32_t parent = node_parent_[node_index];
+				if (k_invalid_index != parent && !node_dirty_flag_[parent])
+				{
+					node_dirty_flag_[parent] = 1;
+					queue.push(parent);
+				}
+			}
+			return refit_count;
+		}
+
+		float AabbBvh::CalcSahCost() const
+		{
+			if (node_array_.empty())
+				return 0.0f;
+			const double root_area = SurfaceArea(node_array_[0].min_, node_array_[0].max_);
+			if (!(0.0 < root_area))
+				return 0.0f;
+
+			double cost = 0.0;
+			for (const auto& node : node_array_)
+			{
+				const double area = SurfaceArea(node.min_, node.max_);
+				cost += area * (node.IsLeaf() ? node.count_ : 1.0);
+			}
+			return static_cast<float>(cost / root_area);
+		}
+
+		void AabbBvh::QueryFrustum(std::vector<uint32_t>& out_id, const Frustum& frustum) const
+		{
+			if (node_array_.empty())
+				return;
+
+			// 判定が必要な平面のマスク. 親が内側の平面は子も内側のため判定しない.
+			constexpr uint32_t k_all_plane_mask = (1u << Frustum::EPlaneIndex::_MAX) - 1;
+			uint32_t stack_node[k_traverse_stack_size];
+			uint32_t stack_mask[k_traverse_stack_size];
+			uint32_t stack_count = 0;
+			stack_node[stack_count] = 0;
+			stack_mask[stack_count] = k_all_plane_mask;
+			++stack_count;
+
+			while (0 < stack_count)
+			{
+				--stack_count;
+				const BvhNode& node = node_array_[stack_node[stack_count]];
+				const uint32_t node_index = stack_node[stack_count];
+				uint32_t mask = stack_mask[stack_count];
+
+				if (0 != mask)
+				{
+					const Vec3 center = (node.min_ + node.max_) * 0.5f;
+					const Vec3 extent = (node.max_ - node.min_) * 0.5f;
+					bool is_outside = false;
+					for (int pi = 0; pi < Frustum::EPlaneIndex::_MAX && !is_outside; ++pi)
+					{
+						if (0 == (mask & (1u << pi)))
+							continue;
+						const EPlaneSide side = ClassifyPlaneAabb(frustum.planes_[pi], center, extent);
+						is_outside = EPlaneSide::Outside == side;
+						if (EPlaneSide::Inside == side)
+							mask &= ~(1u << pi);
+					}
+					if (is_outside)
+						continue;
+				}
+
+				if (node.IsLeaf())
+				{
+					for (uint32_t i = node.first_; i < node.first_ + node.count_; ++i)
+					{
+						const uint32_t id = item_index_[i];
+						bool is_outside = false;
+						if (0 != mask)
+						{
+							const Vec3 center = item_aabb_[id].GetCenter();
+							const Vec3 extent = item_aabb_[id].GetExtent();
+							for (int pi = 0; pi < Frustum::EPlaneIndex::_MAX && !is_outside; ++pi)
+							{
+								if (mask & (1u << pi))
+									is_outside = EPlaneSide::Outside == ClassifyPlaneAabb(frustum.planes_[pi], center, extent);
+							}
+						}
+						if (!is_outside)
+							out_id.push_back(id);
+					}
+					continue;
+				}
+
+				assert(k_traverse_stack_size >= stack_count + 2);
+				stack_node[stack_count] = node.first_;
+				stack_mask[stack_count] = mask;
+				++stack_count;
+				stack_node[stack_count] = node_index + 1;
+				stack_mask[stack_count] = mask;
+				++stack_count;
+			}
+		}
+
+		void AabbBvh::QuerySphere(std::vector<uint32_t>& out_id, const Vec3& center, float radius) const
+		{
+			if (node_array_.empty())
+				return;
+
+			const float radius_sq = radius * radius;
+			uint32_t stack_node[k_traverse_stack_size];
+			uint32_t stack_count = 0;
+			stack_node[stack_count++] = 0;
+			while (0 < stack_count)
+			{
+				const uint32_t node_index = stack_node[--stack_count];
+				const BvhNode& node = node_array_[node_index];
+				if (!IsIntersectSphereAabb(center, radius_sq, node.min_, node.max_))
+					continue;
+
+				if (node.IsLeaf())
+				{
+					for (uint32_t i = node.first_; i < node.first_ + node.count_; ++i)
+					{
+						const uint32_t id = item_index_[i];
+						if (IsIntersectSphereAabb(center, radius_sq, item_aabb_[id].min_, item_aabb_[id].max_))
+							out_id.push_back(id);
+					}
+					continue;
+				}
+
+				assert(k_traverse_stack_size >= stack_count + 2);
+				stack_node[stack_count++] = node.first_;
+				stack_node[stack_count++] = node_index + 1;
+			}
+		}
+
+		void AabbBvh::QueryRay(std::vector<uint32_t>& out_id, const Vec3& origin, const Vec3& dir, float t_max) const
+		{
+			if (node_array_.empty())
+				return;
+
+			const Vec3 inv_dir(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+			uint32_t stack_node[k_traverse_stack_size];
+			uint32_t stack_count = 0;
+			stack_node[stack_count++] = 0;
+			while (0 < stack_count)
+			{
+				const uint32_t node_index = stack_node[--stack_count];
+				const BvhNode& node = node_array_[node_index];
+				float t;
+				if (!IntersectRayAabb(t, origin, inv_dir, t_max, node.min_, node.max_))
+					continue;
+
+				if (node.IsLeaf())
+				{
+					for (uint32_t i = node.first_; i < node.first_ + node.count_; ++i)
+					{
+						const uint32_t id = item_index_[i];
+						if (IntersectRayAabb(t, origin, inv_dir, t_max, item_aabb_[id].min_, item_aabb_[id].max_))
+							out_id.push_back(id);
+					}
+					continue;
+				}
+
+				assert(k_traverse_stack_size >= stack_count + 2);
+				stack_node[stack_count++] = node.first_;
+				stack_node[stack_count++] = node_index + 1;
+			}
+		}
+
+		bool AabbBvh::RaycastNearest(uint32_t& out_id, float& out_t, const Vec3& origin, const Vec3& dir, float t_max) const
+		{
+			if (node_array_.empty())
+				return false;
+
+			const Vec3 inv_dir(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+			float nearest_t = t_max;
+			uint32_t nearest_id = k_invalid_index;
+
+			// 近い子から処理し, 最近接より遠いノードは枝刈りする.
+			uint32_t stack_node[k_traverse_stack_size];
+			float stack_t[k_traverse_stack_size];
+			uint32_t stack_count = 0;
+			{
+				float t;
+				if (!IntersectRayAabb(t, origin, inv_dir, nearest_t, node_array_[0].min_, node_array_[0].max_))
+					return false;
+				stack_node[stack_count] = 0;
+				stack_t[stack_count] = t;
+				++stack_count;
+			}
+			while (0 < stack_count)
+			{
+				--stack_count;
+				const uint32_t node_index = stack_node[stack_count];
+				if (stack_t[stack_count] > nearest_t)
+					continue;
+				const BvhNode& node = node_array_[node_index];
+
+				if (node.IsLeaf())
+				{
+					for (uint32_t i = node.first_; i < node.first_ + node.count_; ++i)
+					{
+						const uint32_t id = item_index_[i];
+						float t;
+						if (IntersectRayAabb(t, origin, inv_dir, nearest_t, item_aabb_[id].min_, item_aabb_[id].max_) && (t < nearest_t || k_invalid_index == nearest_id))
+						{
+							nearest_t = t;
+							nearest_id = id;
+						}
+					}
+					continue;
+				}
+
+				const uint32_t child[2] = { node_index + 1, node.first_ };
+				float child_t[2];
+				bool child_hit[2];
+				for (int ci = 0; ci < 2; ++ci)
+					child_hit[ci] = IntersectRayAabb(child_t[ci], origin, inv_dir, nearest_t, node_array_[child[ci]].min_, node_array_[child[ci]].max_);
+
+				// 遠い方を先に積む.
+				const int near_ci = (child_hit[0] && (!child_hit[1] || child_t[0] <= child_t[1])) ? 0 : 1;
+				const int far_ci = 1 - near_ci;
+				assert(k_traverse_stack_size >= stack_count + 2);
+				if (child_hit[far_ci])
+				{
+					stack_node[stack_count] = child[far_ci];
+					stack_t[stack_count] = child_t[far_ci];
+					++stack_count;
+				}
+				if (child_hit[near_ci])
+				{
+					stack_node[stack_count] = child[near_ci];
+					stack_t[stack_count] = child_t[near_ci];
+					++stack_count;
+				}
+			}
+
+			if (k_invalid_index == nearest_id)
+				return false;
+			out_id = nearest_id;
+			out_t = nearest_t;
+			return true;
+		}
+	}
+}
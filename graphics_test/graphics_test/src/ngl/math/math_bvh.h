@@ -0,0 +1,114 @@
+﻿#pragma once
+
+/*
+	AABBのBVH (Bounding Volume Hierarchy).
+
+	要素のAABBからビン分割のSAH(Surface Area Heuristic)でトップダウンに構築する.
+		ノードは深さ優先順の配列に平坦化し, 内部ノードの1つ目の子は直後のノード, 2つ目の子はインデックスで参照する.
+		ノードは32byteでキャッシュラインに2つ載る. 走査はスタックを使ったループで再帰しない.
+	要素のAABBの変更は UpdateItem で記録し, Refit で変更された要素を含むノードのみ親方向に再計算する.
+		Refitではトポロジは変わらないため, 移動が大きいとSAHコストが悪化する. CalcSahCost を構築直後と比較して再構築を判断する.
+
+	math::AabbBvh bvh;
+	bvh.Build(aabb_array.data(), count);
+
+	bvh.UpdateItem(moved_id, moved_aabb);
+	bvh.Refit();
+
+	std::vector<uint32_t> visible;
+	bvh.QueryFrustum(visible, frustum);
+*/
+
+#include <cstdint>
+#include <vector>
+
+#include "math.h"
+
+namespace ngl
+{
+	namespace math
+	{
+		// 平坦化したBVHのノード.
+		struct BvhNode
+		{
+			Vec3		min_ = {};
+			// 葉: 要素インデックス配列の先頭. 内部ノード: 2つ目の子のノードインデックス.
+			uint32_t	first_ = 0;
+			Vec3		max_ = {};
+			// 葉: 要素数. 内部ノード: 0.
+			uint32_t	count_ = 0;
+
+			bool IsLeaf() const { return 0 != count_; }
+		};
+		static_assert(32 == sizeof(BvhNode));
+
+		class AabbBvh
+		{
+		public:
+			static constexpr uint32_t k_invalid_index = ~uint32_t(0);
+			// 葉の最大要素数.
+			static constexpr uint32_t k_max_leaf_item = 4;
+			// SAH評価の軸毎のビン数.
+			static constexpr uint32_t k_bin_count = 16;
+
+			AabbBvh() {}
+			~AabbBvh() {}
+
+			// count個のAABBから構築する. 要素のIDは配列のインデックス.
+			void Build(const Aabb* aabb_array, uint32_t count);
+			// 構築済みの要素のAABBで再構築する. UpdateItemの変更も含む.
+			void Rebuild();
+			void Clear();
+
+			// 要素のAABBを変更する. Refitまでノードには反映されない.
+			void UpdateItem(uint32_t id, const Aabb& aabb);
+			// UpdateItemで変更された要素を含むノードを再計算する. 再計算したノード数を返す.
+			uint32_t Refit();
+
+			// SAHコスト. ルートの表面積に対する各ノードの表面積の比で, 内部ノードの走査と葉の要素の判定のコストを1として重み付けした和.
+			float CalcSahCost() const;
+
+			// Frustumと交差する要素のIDをout_idへ追加する. 判定は math::IsIntersectFrustumAabb と同じ.
+			void QueryFrustum(std::vector<uint32_t>& out_id, const Frustum& frustum) const;
+			// 球と交差する要素のIDをout_idへ追加する.
+			void QuerySphere(std::vector<uint32_t>& out_id, const Vec3& center, float radius) const;
+			// 線分 origin + dir * t (0 <= t <= t_max) と交差する要素のIDをout_idへ追加する.
+			void QueryRay(std::vector<uint32_t>& out_id, const Vec3& origin, const Vec3& dir, float t_max) const;
+			// 線分と最初に交差する要素のAABB. 交差しない場合はfalse.
+			bool RaycastNearest(uint32_t& out_id, float& out_t, const Vec3& origin, const Vec3& dir, float t_max) const;
+
+			uint32_t NumItem() const { return static_cast<uint32_t>(item_aabb_.size()); }
+			uint32_t NumNode() const { return static_cast<uint32_t>(node_array_.size()); }
+			const std::vector<BvhNode>& GetNodeArray() const { return node_array_; }
+			const Aabb& GetItemAabb(uint32_t id) const { return item_aabb_[id]; }
+
+		private:
+			uint32_t BuildNode(uint32_t begin, uint32_t end, uint32_t parent, uint32_t depth);
+			void SetLeafBounds(BvhNode& node) const;
+
+		private:
+			std::vector<BvhNode>	node_array_ = {};
+			std::vector<uint32_t>	node_parent_ = {};
+			// 葉の順に並べた要素のID. 葉は[first_, first_ + count_)を参照する.
+			std::vector<uint32_t>	item_index_ = {};
+
+			std::vector<Aabb>		item_aabb_ = {};
+			// 要素を含む葉のノードインデックス.
+			std::vector<uint32_t>	item_leaf_ = {};
+
+			// Refit待ちのノード.
+			std::vector<uint32_t>	dirty_node_ = {};
+			std::vector<uint8_t>	node_dirty_flag_ = {};
+
+			// 構築時の作業用.
+			struct BuildItem
+			{
+				float		min[3];
+				float		max[3];
+				float		centroid[3];
+				uint32_t	id;
+			};
+			std::vector<BuildItem>	build_item_ = {};
+		};
+	}
+}
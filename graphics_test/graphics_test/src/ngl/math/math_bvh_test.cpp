@@ -0,0 +1,375 @@
+﻿
+#include "math_bvh_test.h"
+#include "math_bvh.h"
+#include "math_frustum_culling.h"
+
+#include <vector>
+#include <random>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+
+#include <assert.h>
+
+// 時間の計測. ngl::math の演算子テンプレートが std::chrono の演算と衝突するため名前空間の外に置く.
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	double ToMillisec(Clock::duration d)
+	{
+		return std::chrono::duration<double, std::milli>(d).count();
+	}
+
+	template<typename Func>
+	Clock::duration Measure(Func func)
+	{
+		const auto t0 = Clock::now();
+		func();
+		return Clock::now() - t0;
+	}
+}
+
+namespace ngl
+{
+namespace math
+{
+namespace test
+{
+	namespace
+	{
+		constexpr uint32_t k_num_instance = 1000000;
+		// 移動する要素の割合.
+		constexpr uint32_t k_move_divisor = 10;
+		constexpr int k_query_loop = 10;
+		constexpr int k_ray_count = 1000;
+		// 境界付近の判定の誤差の許容. 座標の大きさに対して十分大きい値.
+		constexpr float k_border_epsilon = 1e-2f;
+
+		// 地面に広く配置したインスタンス群.
+		Aabb RandomInstanceAabb(std::mt19937& rng)
+		{
+			std::uniform_real_distribution<float> pos_xz(-2000.0f, 2000.0f);
+			std::uniform_real_distribution<float> pos_y(0.0f, 50.0f);
+			std::uniform_real_distribution<float> size(0.5f, 5.0f);
+			const Vec3 center(pos_xz(rng), pos_y(rng), pos_xz(rng));
+			const Vec3 extent(size(rng), size(rng), size(rng));
+			return Aabb(center - extent, center + extent);
+		}
+
+		bool IsContain(const Vec3& outer_min, const Vec3& outer_max, const Vec3& inner_min, const Vec3& inner_max)
+		{
+			return outer_min.x <= inner_min.x && outer_min.y <= inner_min.y && outer_min.z <= inner_min.z
+				&& outer_max.x >= inner_max.x && outer_max.y >= inner_max.y && outer_max.z >= inner_max.z;
+		}
+
+		// 全ノードが子と要素を包含している.
+		int VerifyHierarchy(const AabbBvh& bvh)
+		{
+			int fail_count = 0;
+			const auto& node_array = bvh.GetNodeArray();
+			std::vector<uint32_t> leaf_item_count(1, 0);
+			uint32_t total_leaf_item = 0;
+			for (uint32_t ni = 0; ni < node_array.size(); ++ni)
+			{
+				const auto& node = node_array[ni];
+				if (node.IsLeaf())
+				{
+					total_leaf_item += node.count_;
+					if (AabbBvh::k_max_leaf_item < node.count_)
+						++fail_count;
+					continue;
+				}
+				const auto& left = node_array[ni + 1];
+				const auto& right = node_array[node.first_];
+				if (node.first_ <= ni + 1 || !IsContain(node.min_, node.max_, left.min_, left.max_) || !IsContain(node.min_, node.max_, right.min_, right.max_))
+					++fail_count;
+			}
+			if (total_leaf_item != bvh.NumItem())
+				++fail_count;
+			return fail_count;
+		}
+
+		// 問い合わせ結果と総当たりの判定を比較する. is_hitの判定が食い違う場合はis_borderであること.
+		template<typename IsHit, typename IsBorder>
+		int VerifyQuery(std::vector<uint32_t> result, uint32_t count, IsHit is_hit, IsBorder is_border)
+		{
+			int fail_count = 0;
+			std::sort(result.begin(), result.end());
+			if (std::adjacent_find(result.begin(), result.end()) != result.end())
+				++fail_count;
+			auto it = result.begin();
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				const bool in_result = (it != result.end() && *it == i);
+				if (in_result)
+					++it;
+				if (in_result != is_hit(i) && !is_border(i))
+					++fail_count;
+			}
+			return fail_count;
+		}
+
+		bool IsBorderFrustum(const Frustum& frustum, const Aabb& aabb)
+		{
+			const Vec3 center = aabb.GetCenter();
+			const Vec3 extent = aabb.GetExtent();
+			for (const auto& plane : frustum.planes_)
+			{
+				const float dist = Vec3::Dot(plane.normal_, center) - plane.distance_;
+				const float radius = std::abs(plane.normal_.x) * extent.x + std::abs(plane.normal_.y) * extent.y + std::abs(plane.normal_.z) * extent.z;
+				if (std::abs(dist + radius) < k_border_epsilon)
+					return true;
+			}
+			return false;
+		}
+		float DistanceSqPointAabb(const Vec3& p, const Aabb& aabb)
+		{
+			const Vec3 closest(std::min(std::max(p.x, aabb.min_.x), aabb.max_.x), std::min(std::max(p.y, aabb.min_.y), aabb.max_.y), std::min(std::max(p.z, aabb.min_.z), aabb.max_.z));
+			return Vec3::LengthSq(closest - p);
+		}
+		// 線分とAABBの交差の総当たり用. 交差する場合は進入位置.
+		bool IntersectSegmentAabb(float& out_t, const Vec3& origin, const Vec3& dir, float t_max, const Aabb& aabb)
+		{
+			float t_enter = 0.0f;
+			float t_exit = t_max;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				const float inv = 1.0f / dir.data[axis];
+				float t0 = (aabb.min_.data[axis] - origin.data[axis]) * inv;
+				float t1 = (aabb.max_.data[axis] - origin.data[axis]) * inv;
+				if (t0 > t1)
+					std::swap(t0, t1);
+				t_enter = std::max(t_enter, t0);
+				t_exit = std::min(t_exit, t1);
+			}
+			out_t = t_enter;
+			return t_enter <= t_exit;
+		}
+
+		Mat44 ToMat44(const Mat34& m)
+		{
+			return Mat44(m.r0, m.r1, m.r2, Vec4::UnitW());
+		}
+
+		// 検証用のFrustum. 地上のカメラの透視投影とシャドウ用の平行投影.
+		std::vector<Frustum> CreateTestFrustumArray()
+		{
+			std::vector<Frustum> frustum_array;
+			{
+				const Mat34 view = CalcViewMatrix(Vec3(0.0f, 20.0f, 0.0f), Vec3::Normalize(Vec3(1.0f, -0.1f, 0.5f)), Vec3::UnitY());
+				Frustum frustum;
+				CreateFrustum(frustum, CalcReverseInfiniteFarPerspectiveMatrix(Deg2Rad(60.0f), 16.0f / 9.0f, 0.1f) * ToMat44(view));
+				frustum_array.push_back(frustum);
+			}
+			{
+				const Mat34 view = CalcViewMatrix(Vec3(100.0f, 10.0f, -300.0f), Vec3::Normalize(Vec3(-0.2f, 0.0f, 1.0f)), Vec3::UnitY());
+				Frustum frustum;
+				CreateFrustum(frustum, CalcStandardPerspectiveMatrix(Deg2Rad(40.0f), 1.0f, 1.0f, 500.0f) * ToMat44(view), false);
+				frustum_array.push_back(frustum);
+			}
+			{
+				const Mat34 view = CalcViewMatrix(Vec3::Zero(), Vec3::Normalize(Vec3(0.3f, -1.0f, 0.2f)), Vec3::UnitX());
+				Frustum frustum;
+				CreateFrustum(frustum, CalcReverseOrthographicMatrix(-150.0f, 150.0f, -150.0f, 150.0f, -500.0f, 500.0f) * ToMat44(view));
+				frustum_array.push_back(frustum);
+			}
+			return frustum_array;
+		}
+
+		// 全種類の問い合わせを総当たりと比較する.
+		int VerifyAllQuery(const AabbBvh& bvh, const std::vector<Aabb>& aabb, const std::vector<Frustum>& frustum_array, std::mt19937& rng)
+		{
+			const uint32_t count = static_cast<uint32_t>(aabb.size());
+			int fail_count = 0;
+			std::vector<uint32_t> result;
+
+			for (const auto& frustum : frustum_array)
+			{
+				result.clear();
+				bvh.QueryFrustum(result, frustum);
+				fail_count += VerifyQuery(result, count,
+					[&](uint32_t i) { return IsIntersectFrustumAabb(frustum, aabb[i].GetCenter(), aabb[i].GetExtent()); },
+					[&](uint32_t i) { return IsBorderFrustum(frustum, aabb[i]); });
+			}
+
+			std::uniform_real_distribution<float> pos_xz(-2000.0f, 2000.0f);
+			std::uniform_real_distribution<float> radius_dist(1.0f, 100.0f);
+			for (int si = 0; si < 4; ++si)
+			{
+				const Vec3 center(pos_xz(rng), 10.0f, pos_xz(rng));
+				const float radius = radius_dist(rng);
+				result.clear();
+				bvh.QuerySphere(result, center, radius);
+				fail_count += VerifyQuery(result, count,
+					[&](uint32_t i) { return DistanceSqPointAabb(center, aabb[i]) <= radius * radius; },
+					[&](uint32_t i) { return std::abs(std::sqrt(DistanceSqPointAabb(center, aabb[i])) - radius) < k_border_epsilon; });
+			}
+
+			std::uniform_real_distribution<float> dir_dist(-1.0f, 1.0f);
+			for (int ri = 0; ri < 4; ++ri)
+			{
+				const Vec3 origin(pos_xz(rng), 10.0f, pos_xz(rng));
+				const Vec3 dir = Vec3::Normalize(Vec3(dir_dist(rng), dir_dist(rng) * 0.1f, dir_dist(rng)));
+				const float t_max = 3000.0f;
+				result.clear();
+				bvh.QueryRay(result, origin, dir, t_max);
+				std::vector<float> hit_t(count, -1.0f);
+				fail_count += VerifyQuery(result, count,
+					[&](uint32_t i) { float t; return IntersectSegmentAabb(t, origin, dir, t_max, aabb[i]); },
+					[&](uint32_t i)
+					{
+						// 線分をわずかに太らせた判定と細らせた判定が異なる場合は境界.
+						Aabb expand = aabb[i];
+						expand.min_ = expand.min_ - Vec3(k_border_epsilon);
+						expand.max_ = expand.max_ + Vec3(k_border_epsilon);
+						Aabb shrink = aabb[i];
+						shrink.min_ = shrink.min_ + Vec3(k_border_epsilon);
+						shrink.max_ = shrink.max_ - Vec3(k_border_epsilon);
+						float t;
+						return IntersectSegmentAabb(t, origin, dir, t_max, expand) != IntersectSegmentAabb(t, origin, dir, t_max, shrink);
+					});
+
+				// 最近接は総当たりの最小のtと一致.
+				float nearest_t = t_max;
+				bool is_hit = false;
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					float t;
+					if (IntersectSegmentAabb(t, origin, dir, t_max, aabb[i]) && t <= nearest_t)
+					{
+						nearest_t = t;
+						is_hit = true;
+					}
+				}
+				uint32_t bvh_id = 0;
+				float bvh_t = 0.0f;
+				const bool bvh_is_hit = bvh.RaycastNearest(bvh_id, bvh_t, origin, dir, t_max);
+				if (is_hit != bvh_is_hit || (is_hit && k_border_epsilon < std::abs(bvh_t - nearest_t)))
+					++fail_count;
+			}
+			return fail_count;
+		}
+	}
+
+	void MathBvhBenchmark()
+	{
+		std::mt19937 rng(3456);
+		std::vector<Aabb> aabb(k_num_instance);
+		for (auto& e : aabb)
+			e = RandomInstanceAabb(rng);
+		const std::vector<Frustum> frustum_array = CreateTestFrustumArray();
+
+		int fail_count = 0;
+		AabbBvh bvh;
+
+		// 空と少数.
+		{
+			bvh.Build(aabb.data(), 0);
+			std::vector<uint32_t> result;
+			bvh.QueryFrustum(result, frustum_array[0]);
+			uint32_t id;
+			float t;
+			if (!result.empty() || 0 != bvh.NumNode() || bvh.RaycastNearest(id, t, Vec3::Zero(), Vec3::UnitX(), 1.0f))
+				++fail_count;
+
+			bvh.Build(aabb.data(), 3);
+			fail_count += VerifyHierarchy(bvh);
+			if (1 != bvh.NumNode())
+				++fail_count;
+		}
+
+		// 構築.
+		const auto build_time = Measure([&]() { bvh.Build(aabb.data(), k_num_instance); });
+		const float build_sah_cost = bvh.CalcSahCost();
+		fail_count += VerifyHierarchy(bvh);
+		fail_count += VerifyAllQuery(bvh, aabb, frustum_array, rng);
+
+		// 一部の要素を移動してRefit.
+		std::uniform_real_distribution<float> move_dist(-20.0f, 20.0f);
+		uint32_t refit_node_count = 0;
+		const auto update_time = Measure([&]()
+			{
+				for (uint32_t i = 0; i < k_num_instance; i += k_move_divisor)
+				{
+					const Vec3 move(move_dist(rng), 0.0f, move_dist(rng));
+					aabb[i] = Aabb(aabb[i].min_ + move, aabb[i].max_ + move);
+					bvh.UpdateItem(i, aabb[i]);
+				}
+			});
+		const auto refit_time = Measure([&]() { refit_node_count = bvh.Refit(); });
+		const float refit_sah_cost = bvh.CalcSahCost();
+		fail_count += VerifyHierarchy(bvh);
+		fail_count += VerifyAllQuery(bvh, aabb, frustum_array, rng);
+		// 変更が無ければRefitは何もしない.
+		if (0 != bvh.Refit())
+			++fail_count;
+
+		// 再構築でSAHコストが回復する.
+		const auto rebuild_time = Measure([&]() { bvh.Rebuild(); });
+		const float rebuild_sah_cost = bvh.CalcSahCost();
+		if (!(rebuild_sah_cost <= refit_sah_cost))
+			++fail_count;
+		fail_count += VerifyHierarchy(bvh);
+
+		// Frustumの問い合わせと総当たりのSIMD判定の比較.
+		std::vector<float> center[3], extent[3];
+		for (int ai = 0; ai < 3; ++ai)
+		{
+			center[ai].resize(k_num_instance);
+			extent[ai].resize(k_num_instance);
+		}
+		for (uint32_t i = 0; i < k_num_instance; ++i)
+		{
+			const Vec3 c = aabb[i].GetCenter();
+			const Vec3 e = aabb[i].GetExtent();
+			for (int ai = 0; ai < 3; ++ai)
+			{
+				center[ai][i] = c.data[ai];
+				extent[ai][i] = e.data[ai];
+			}
+		}
+		const AabbSoaRef aabb_soa = { { center[0].data(), center[1].data(), center[2].data() }, { extent[0].data(), extent[1].data(), extent[2].data() } };
+		std::vector<uint32_t> visible(k_num_instance);
+		std::vector<uint32_t> query_result;
+		query_result.reserve(k_num_instance);
+
+		std::cout << "[MathBvhBenchmark] instance " << k_num_instance << ", node " << bvh.NumNode() << std::endl;
+		std::cout << "  build : " << ToMillisec(build_time) << " ms, rebuild : " << ToMillisec(rebuild_time) << " ms" << std::endl;
+		std::cout << "  sah cost : build " << build_sah_cost << ", refit " << refit_sah_cost << ", rebuild " << rebuild_sah_cost << std::endl;
+		std::cout << "  move " << (k_num_instance / k_move_divisor) << " : update " << ToMillisec(update_time) << " ms, refit " << ToMillisec(refit_time) << " ms (" << refit_node_count << " node)" << std::endl;
+		for (uint32_t fi = 0; fi < frustum_array.size(); ++fi)
+		{
+			Clock::duration query_time = Clock::duration::max();
+			Clock::duration brute_time = Clock::duration::max();
+			uint32_t visible_count = 0;
+			for (int l = 0; l < k_query_loop; ++l)
+			{
+				query_time = std::min(query_time, Measure([&]() { query_result.clear(); bvh.QueryFrustum(query_result, frustum_array[fi]); }));
+				brute_time = std::min(brute_time, Measure([&]() { visible_count = CullFrustumAabb(visible.data(), frustum_array[fi], aabb_soa, 0, k_num_instance); }));
+			}
+			std::cout << "  frustum" << fi << " : visible " << query_result.size() << ", bvh " << ToMillisec(query_time) << " ms, simd brute force " << ToMillisec(brute_time) << " ms (" << visible_count << ")" << std::endl;
+		}
+		{
+			std::uniform_real_distribution<float> pos_xz(-2000.0f, 2000.0f);
+			std::uniform_real_distribution<float> dir_dist(-1.0f, 1.0f);
+			uint32_t hit_count = 0;
+			const auto ray_time = Measure([&]()
+				{
+					for (int ri = 0; ri < k_ray_count; ++ri)
+					{
+						const Vec3 origin(pos_xz(rng), 10.0f, pos_xz(rng));
+						const Vec3 dir = Vec3::Normalize(Vec3(dir_dist(rng), dir_dist(rng) * 0.1f, dir_dist(rng)));
+						uint32_t id;
+						float t;
+						hit_count += bvh.RaycastNearest(id, t, origin, dir, 1000.0f) ? 1 : 0;
+					}
+				});
+			std::cout << "  raycast nearest x" << k_ray_count << " : " << ToMillisec(ray_time) << " ms (hit " << hit_count << ")" << std::endl;
+		}
+		std::cout << "  fail " << fail_count << std::endl;
+		assert(0 == fail_count);
+	}
+}
+}
+}
@@ -0,0 +1,18 @@
+﻿#pragma once
+
+#include "math.h"
+
+
+namespace ngl
+{
+namespace math
+{
+namespace test
+{
+	// AabbBvhのテスト.
+	// 100万個のAABBの合成シーンで構築し, Frustum, 球, 線分の問い合わせを総当たりの判定と比較する.
+	// 一部を移動してRefitした後の包含関係と問い合わせ結果も検証し, 構築, Refit, 問い合わせの処理時間を標準出力に出力する.
+	void MathBvhBenchmark();
+}
+}
+}
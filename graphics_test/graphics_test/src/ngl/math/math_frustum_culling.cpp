@@ -0,0 +1,237 @@
+﻿
+#include "math_frustum_culling.h"
+
+#include <algorithm>
+
+namespace ngl
+{
+	namespace math
+	{
+		namespace
+		{
+			using simd_detail::F4;
+
+			// Frustumの平面の各成分を全レーンに複製したもの.
+			struct FrustumPlaneF4
+			{
+				F4 n[Frustum::EPlaneIndex::_MAX][3];
+				F4 abs_n[Frustum::EPlaneIndex::_MAX][3];
+				F4 d[Frustum::EPlaneIndex::_MAX];
+
+				explicit FrustumPlaneF4(const Frustum& frustum)
+				{
+					using namespace simd_detail;
+					for (int pi = 0; pi < Frustum::EPlaneIndex::_MAX; ++pi)
+					{
+						const Plane& plane = frustum.planes_[pi];
+						n[pi][0] = Set1(plane.normal_.x);
+						n[pi][1] = Set1(plane.normal_.y);
+						n[pi][2] = Set1(plane.normal_.z);
+						abs_n[pi][0] = Abs(n[pi][0]);
+						abs_n[pi][1] = Abs(n[pi][1]);
+						abs_n[pi][2] = Abs(n[pi][2]);
+						d[pi] = Set1(plane.distance_);
+					}
+				}
+
+				// 4個のAABBの交差判定. 交差するレーンは全bitが1.
+				F4 Intersect(F4 cx, F4 cy, F4 cz, F4 ex, F4 ey, F4 ez) const
+				{
+					using namespace simd_detail;
+
+					// dot(n, c) + dot(|n|, e) >= d であれば平面の内側にかかる.
+					F4 inside = CmpGe(Zero(), Zero());
+					for (int pi = 0; pi < Frustum::EPlaneIndex::_MAX; ++pi)
+					{
+						F4 dist = Mul(n[pi][0], cx);
+						dist = MulAdd(n[pi][1], cy, dist);
+						dist = MulAdd(n[pi][2], cz, dist);
+						dist = MulAdd(abs_n[pi][0], ex, dist);
+						dist = MulAdd(abs_n[pi][1], ey, dist);
+						dist = MulAdd(abs_n[pi][2], ez, dist);
+						inside = And(inside, CmpGe(dist, d[pi]));
+					}
+					return inside;
+				}
+			};
+		}
+
+		uint32_t CullFrustumAabb(uint32_t* out_index, const Frustum& frustum, const AabbSoaRef& aabb, uint32_t begin, uint32_t end)
+		{
+			using namespace simd_detail;
+			const FrustumPlaneF4 plane(frustum);
+
+			uint32_t visible_count = 0;
+			uint32_t i = begin;
+			for (; i + 4 <= end; i += 4)
+			{
+				const F4 cx = Load4(aabb.center[0] + i), cy = Load4(aabb.center[1] + i), cz = Load4(aabb.center[2] + i);
+				const F4 ex = Load4(aabb.extent[0] + i), ey = Load4(aabb.extent[1] + i), ez = Load4(aabb.extent[2] + i);
+				const int mask = MoveMask(plane.Intersect(cx, cy, cz, ex, ey, ez));
+
+				// 可視のレーンのインデックスを詰めて書き込む. 分岐せず常に書き込み, 可視の場合のみ進める.
+				for (uint32_t l = 0; l < 4; ++l)
+				{
+					out_index[visible_count] = i + l;
+					visible_count += (mask >> l) & 1;
+				}
+			}
+			// 端数.
+			for (; i < end; ++i)
+			{
+				const Vec3 center(aabb.center[0][i], aabb.center[1][i], aabb.center[2][i]);
+				const Vec3 extent(aabb.extent[0][i], aabb.extent[1][i], aabb.extent[2][i]);
+				if (IsIntersectFrustumAabb(frustum, center, extent))
+					out_index[visible_count++] = i;
+			}
+			return visible_count;
+		}
+
+		void CreateShadowCascadeCullVolume(ShadowCascadeCullVolume& out_volume, const Mat34& light_view_mtx,
+			const Vec3& receiver_min_ls, const Vec3& receiver_max_ls, float extend_toward_light,
+			const Frustum& view_frustum, const Vec3& view_pos, const Vec3& view_forward, float covered_view_depth)
+		{
+			// 受影範囲を光源側へ延長したOrtho. Far側は受影範囲の奥までで, それより奥のCasterは受影点に影を落とさない.
+			const Mat44 light_view_mtx44(light_view_mtx.r0, light_view_mtx.r1, light_view_mtx.r2, Vec4::UnitW());
+			const Mat44 cull_ortho = CalcReverseOrthographicMatrix(
+				receiver_min_ls.x, receiver_max_ls.x,
+				receiver_min_ls.y, receiver_max_ls.y,
+				receiver_min_ls.z - extend_toward_light, receiver_max_ls.z);
+			CreateFrustum(out_volume.frustum, cull_ortho * light_view_mtx44);
+
+			// Light View空間のzは dot(light_dir, p) + r2.w.
+			out_volume.light_dir = light_view_mtx.r2.XYZ();
+			out_volume.receiver_far_light_z = receiver_max_ls.z - light_view_mtx.r2.w;
+			out_volume.view_frustum = view_frustum;
+			out_volume.view_pos = view_pos;
+			out_volume.view_forward = view_forward;
+			out_volume.covered_view_depth = covered_view_depth;
+		}
+
+		bool IsShadowCascadeCaster(bool& out_is_covered, const ShadowCascadeCullVolume& volume, const Vec3& center, const Vec3& extent)
+		{
+			out_is_covered = false;
+			if (!IsIntersectFrustumAabb(volume.frustum, center, extent))
+				return false;
+
+			const Vec3 d = volume.light_dir;
+			const Vec3 f = volume.view_forward;
+			// AABBを光源方向へ掃引した範囲のView深度の最大.
+			//	掃引の長さはAABBの全ての点が受影範囲の奥に達するか, View Frustumの平面の外側へ出るまでの長さの最小.
+			const float caster_near_light_z = Vec3::Dot(d, center) - (std::abs(d.x) * extent.x + std::abs(d.y) * extent.y + std::abs(d.z) * extent.z);
+			float sweep = std::max(0.0f, volume.receiver_far_light_z - caster_near_light_z);
+			for (const auto& plane : volume.view_frustum.planes_)
+			{
+				const Vec3 n = plane.normal_;
+				const float n_dot_d = Vec3::Dot(n, d);
+				if (0.0f <= n_dot_d)
+					continue;
+				const float inv_speed = 1.0f / -n_dot_d;
+				const float dist_max = Vec3::Dot(n, center) + (std::abs(n.x) * extent.x + std::abs(n.y) * extent.y + std::abs(n.z) * extent.z) - plane.distance_;
+				sweep = std::min(sweep, std::max(0.0f, dist_max * inv_speed));
+			}
+			const float depth_max = Vec3::Dot(f, center) - Vec3::Dot(f, volume.view_pos)
+				+ (std::abs(f.x) * extent.x + std::abs(f.y) * extent.y + std::abs(f.z) * extent.z)
+				+ std::max(0.0f, Vec3::Dot(f, d)) * sweep;
+			out_is_covered = depth_max <= volume.covered_view_depth;
+			return !out_is_covered;
+		}
+
+		uint32_t CullShadowCascadeAabb(uint32_t* out_index, uint32_t& out_covered_count, const ShadowCascadeCullVolume& volume, const AabbSoaRef& aabb, uint32_t begin, uint32_t end)
+		{
+			using namespace simd_detail;
+			const FrustumPlaneF4 plane(volume.frustum);
+
+			const F4 d[3] = { Set1(volume.light_dir.x), Set1(volume.light_dir.y), Set1(volume.light_dir.z) };
+			const F4 abs_d[3] = { Abs(d[0]), Abs(d[1]), Abs(d[2]) };
+			const F4 f[3] = { Set1(volume.view_forward.x), Set1(volume.view_forward.y), Set1(volume.view_forward.z) };
+			const F4 abs_f[3] = { Abs(f[0]), Abs(f[1]), Abs(f[2]) };
+			const F4 view_depth_offset = Set1(-Vec3::Dot(volume.view_forward, volume.view_pos));
+			const F4 sweep_depth_rate = Set1(std::max(0.0f, Vec3::Dot(volume.view_forward, volume.light_dir)));
+			const F4 receiver_far_light_z = Set1(volume.receiver_far_light_z);
+			const F4 covered_view_depth = Set1(volume.covered_view_depth);
+
+			// 掃引方向に外側へ出るView Frustumの平面.
+			F4 exit_n[Frustum::EPlaneIndex::_MAX][3];
+			F4 exit_abs_n[Frustum::EPlaneIndex::_MAX][3];
+			F4 exit_dist[Frustum::EPlaneIndex::_MAX];
+			F4 exit_inv_speed[Frustum::EPlaneIndex::_MAX];
+			int exit_plane_count = 0;
+			for (const auto& plane : volume.view_frustum.planes_)
+			{
+				const float n_dot_d = Vec3::Dot(plane.normal_, volume.light_dir);
+				if (0.0f <= n_dot_d)
+					continue;
+				const int pi = exit_plane_count++;
+				exit_n[pi][0] = Set1(plane.normal_.x);
+				exit_n[pi][1] = Set1(plane.normal_.y);
+				exit_n[pi][2] = Set1(plane.normal_.z);
+				exit_abs_n[pi][0] = Abs(exit_n[pi][0]);
+				exit_abs_n[pi][1] = Abs(exit_n[pi][1]);
+				exit_abs_n[pi][2] = Abs(exit_n[pi][2]);
+				exit_dist[pi] = Set1(plane.distance_);
+				exit_inv_speed[pi] = Set1(1.0f / -n_dot_d);
+			}
+
+			uint32_t caster_count = 0;
+			uint32_t covered_count = 0;
+			uint32_t i = begin;
+			for (; i + 4 <= end; i += 4)
+			{
+				const F4 cx = Load4(aabb.center[0] + i), cy = Load4(aabb.center[1] + i), cz = Load4(aabb.center[2] + i);
+				const F4 ex = Load4(aabb.extent[0] + i), ey = Load4(aabb.extent[1] + i), ez = Load4(aabb.extent[2] + i);
+				const int intersect_mask = MoveMask(plane.Intersect(cx, cy, cz, ex, ey, ez));
+
+				// IsShadowCascadeCaster と同じ判定.
+				F4 near_light_z = Mul(d[0], cx);
+				near_light_z = MulAdd(d[1], cy, near_light_z);
+				near_light_z = MulAdd(d[2], cz, near_light_z);
+				F4 light_extent = Mul(abs_d[0], ex);
+				light_extent = MulAdd(abs_d[1], ey, light_extent);
+				light_extent = MulAdd(abs_d[2], ez, light_extent);
+				near_light_z = Sub(near_light_z, light_extent);
+				F4 sweep = Max(Zero(), Sub(receiver_far_light_z, near_light_z));
+				for (int pi = 0; pi < exit_plane_count; ++pi)
+				{
+					F4 dist_max = Mul(exit_n[pi][0], cx);
+					dist_max = MulAdd(exit_n[pi][1], cy, dist_max);
+					dist_max = MulAdd(exit_n[pi][2], cz, dist_max);
+					dist_max = MulAdd(exit_abs_n[pi][0], ex, dist_max);
+					dist_max = MulAdd(exit_abs_n[pi][1], ey, dist_max);
+					dist_max = MulAdd(exit_abs_n[pi][2], ez, dist_max);
+					dist_max = Sub(dist_max, exit_dist[pi]);
+					sweep = Min(sweep, Max(Zero(), Mul(dist_max, exit_inv_speed[pi])));
+				}
+
+				F4 depth_max = MulAdd(f[0], cx, view_depth_offset);
+				depth_max = MulAdd(f[1], cy, depth_max);
+				depth_max = MulAdd(f[2], cz, depth_max);
+				depth_max = MulAdd(abs_f[0], ex, depth_max);
+				depth_max = MulAdd(abs_f[1], ey, depth_max);
+				depth_max = MulAdd(abs_f[2], ez, depth_max);
+				depth_max = MulAdd(sweep_depth_rate, sweep, depth_max);
+				const int covered_mask = intersect_mask & MoveMask(CmpGe(covered_view_depth, depth_max));
+				const int caster_mask = intersect_mask & ~covered_mask;
+
+				for (uint32_t l = 0; l < 4; ++l)
+				{
+					out_index[caster_count] = i + l;
+					caster_count += (caster_mask >> l) & 1;
+					covered_count += (covered_mask >> l) & 1;
+				}
+			}
+			// 端数.
+			for (; i < end; ++i)
+			{
+				const Vec3 center(aabb.center[0][i], aabb.center[1][i], aabb.center[2][i]);
+				const Vec3 extent(aabb.extent[0][i], aabb.extent[1][i], aabb.extent[2][i]);
+				bool is_covered;
+				if (IsShadowCascadeCaster(is_covered, volume, center, extent))
+					out_index[caster_count++] = i;
+				covered_count += is_covered ? 1 : 0;
+			}
+			out_covered_count += covered_count;
+			return caster_count;
+		}
+	}
+}
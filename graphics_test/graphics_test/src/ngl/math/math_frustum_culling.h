@@ -0,0 +1,80 @@
+﻿#pragma once
+
+/*
+	FrustumとAABBの一括交差判定.
+
+	AABBは中心と中心から各面までの距離(extent)の軸毎の配列(SoA)で渡す. 4個単位でSIMDの各レーンに載せて6平面と判定する.
+		平面毎に中心の符号付き距離と, 法線方向へのextentの投影の和が負ならその平面の外側.
+		判定はmath::IsIntersectFrustumAabbと同じで, Frustumの角付近の交差しないAABBも可視とする場合がある.
+
+	math::AabbSoaRef aabb = { {cx, cy, cz}, {ex, ey, ez} };
+	std::vector<uint32_t> visible(count);
+	const uint32_t visible_count = math::CullFrustumAabb(visible.data(), frustum, aabb, 0, count);
+
+	DirectionalShadowのCascade毎のCaster判定.
+		Cascadeの受影範囲(View Frustumの分割範囲)のLight空間AABBを光源側へ延長した直方体をCasterの判定範囲とする.
+		さらにCasterのAABBを光源方向へ掃引した範囲が, 全て手前のCascadeを参照するView深度に収まる場合はスキップする.
+			シェーダはView深度で参照するCascadeを選択するため, その範囲の受影点は手前のCascadeのみを参照する.
+			受影点は受影範囲の奥より手前で, かつView Frustumの内側のため, 掃引はそのどちらかを出るまでとする.
+
+	math::ShadowCascadeCullVolume volume;
+	math::CreateShadowCascadeCullVolume(volume, light_view_mtx, receiver_min_ls, receiver_max_ls, extend_toward_light,
+		view_frustum, view_pos, view_forward, prev_cascade_far_depth);
+	uint32_t covered_count = 0;
+	const uint32_t caster_count = math::CullShadowCascadeAabb(caster.data(), covered_count, volume, aabb, 0, count);
+*/
+
+#include <cstdint>
+#include <limits>
+
+#include "math.h"
+
+namespace ngl
+{
+	namespace math
+	{
+		// SoAのAABB配列の参照.
+		struct AabbSoaRef
+		{
+			const float*	center[3] = {};
+			const float*	extent[3] = {};
+		};
+
+		// [begin, end)のうちFrustumと交差するAABBのインデックスをout_indexへ昇順に書き込み, その数を返す.
+		//	out_indexは最大(end - begin)個.
+		uint32_t CullFrustumAabb(uint32_t* out_index, const Frustum& frustum, const AabbSoaRef& aabb, uint32_t begin, uint32_t end);
+
+		// DirectionalShadowのCascade1つのCaster判定範囲.
+		struct ShadowCascadeCullVolume
+		{
+			// Casterが受影範囲に影を落とし得る範囲.
+			Frustum	frustum = {};
+			// 光源の向き. 影はこの方向へ落ちる.
+			Vec3	light_dir = Vec3::UnitZ();
+			// 受影範囲の光源方向の最遠位置. dot(p, light_dir).
+			float	receiver_far_light_z = 0.0f;
+			// 受影点の範囲を制限するView Frustum.
+			Frustum	view_frustum = {};
+			Vec3	view_pos = {};
+			Vec3	view_forward = Vec3::UnitZ();
+			// 影の範囲のView深度が全てこの値以下のCasterはスキップする. 最も手前のCascadeは負の最大値で無効とする.
+			float	covered_view_depth = -std::numeric_limits<float>::max();
+		};
+
+		// Cascadeの判定範囲を生成する.
+		//	light_view_mtx : 回転のみのLight View行列. receiver_min_ls, receiver_max_ls : 受影範囲のLight View空間のAABB.
+		//	extend_toward_light : 光源側への延長距離. 描画するOrthoのNearと合わせる.
+		//	view_frustum, view_pos, view_forward : 受影点を描画するView.
+		//	covered_view_depth : 手前のCascadeを参照するView深度の上限. 最も手前のCascadeは負の最大値.
+		void CreateShadowCascadeCullVolume(ShadowCascadeCullVolume& out_volume, const Mat34& light_view_mtx,
+			const Vec3& receiver_min_ls, const Vec3& receiver_max_ls, float extend_toward_light,
+			const Frustum& view_frustum, const Vec3& view_pos, const Vec3& view_forward, float covered_view_depth);
+
+		// [begin, end)のうちCascadeに描画するAABBのインデックスをout_indexへ昇順に書き込み, その数を返す.
+		//	判定範囲と交差するが手前のCascadeでカバーされるためスキップした数をout_covered_countへ加算する.
+		uint32_t CullShadowCascadeAabb(uint32_t* out_index, uint32_t& out_covered_count, const ShadowCascadeCullVolume& volume, const AabbSoaRef& aabb, uint32_t begin, uint32_t end);
+
+		// CullShadowCascadeAabbの1要素の判定. 描画する場合はtrue.
+		bool IsShadowCascadeCaster(bool& out_is_covered, const ShadowCascadeCullVolume& volume, const Vec3& center, const Vec3& extent);
+	}
+}
@@ -0,0 +1,754 @@
+﻿
+#include "math_simd_test.h"
+#include "math_transform_batch.h"
+#include "math_frustum_culling.h"
+#include "math_bvh.h"
+
+#include <vector>
+#include <random>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+#include <utility>
+#include <cfloat>
+
+#include <assert.h>
+
+// 時間の計測. ngl::math の演算子テンプレートが std::chrono の演算と衝突するため名前空間の外に置く.
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	double ToMillisec(Clock::duration d)
+	{
+		return std::chrono::duration<double, std::milli>(d).count();
+	}
+
+	// funcをloop_count回実行する時間.
+	template<typename Func>
+	Clock::duration Measure(int loop_count, Func func)
+	{
+		const auto t0 = Clock::now();
+		for (int l = 0; l < loop_count; ++l)
+			func();
+		return Clock::now() - t0;
+	}
+	// funcをloop_count回実行したうちの最短時間.
+	template<typename Func>
+	Clock::duration MeasureMin(int loop_count, Func func)
+	{
+		Clock::duration r = Clock::duration::max();
+		for (int l = 0; l < loop_count; ++l)
+			r = std::min(r, Measure(1, func));
+		return r;
+	}
+}
+
+namespace ngl
+{
+namespace math
+{
+namespace test
+{
+	namespace
+	{
+		constexpr int k_num_instance = 4096;
+		constexpr int k_loop_count = 200;
+		constexpr int k_verify_count = 10000;
+
+		// constexprのAPIは定数式で評価できる.
+		constexpr Mat44 k_ce_mat44(
+			2.0f, 0.0f, 0.0f, 1.0f,
+			0.0f, 4.0f, 0.0f, 2.0f,
+			0.0f, 0.0f, 8.0f, 3.0f,
+			0.0f, 0.0f, 0.0f, 1.0f);
+		constexpr Mat44 k_ce_mat44_inv = Mat44::Inverse(k_ce_mat44);
+		constexpr Mat44 k_ce_mat44_mul = k_ce_mat44 * k_ce_mat44_inv;
+		static_assert(1.0f == k_ce_mat44_mul.r0.x && 0.0f == k_ce_mat44_mul.r0.w && 1.0f == k_ce_mat44_mul.r2.z);
+		constexpr Vec4 k_ce_vec4 = k_ce_mat44 * Vec4(1.0f, 1.0f, 1.0f, 1.0f);
+		static_assert(3.0f == k_ce_vec4.x && 6.0f == k_ce_vec4.y && 11.0f == k_ce_vec4.z);
+		constexpr Vec3 k_ce_cross = Vec3::Cross(Vec3::UnitX(), Vec3::UnitY());
+		static_assert(1.0f == k_ce_cross.z);
+		constexpr Mat33 k_ce_cofactor = Mat33::Cofactor(Mat33(2.0f, 0.0f, 0.0f, 0.0f, 4.0f, 0.0f, 0.0f, 0.0f, 8.0f));
+		static_assert(32.0f == k_ce_cofactor.r0.x && 16.0f == k_ce_cofactor.r1.y && 8.0f == k_ce_cofactor.r2.z);
+		constexpr Vec3 k_ce_point = Mat34(k_ce_mat44) * Vec3(1.0f, 1.0f, 1.0f);
+		static_assert(3.0f == k_ce_point.x && 11.0f == k_ce_point.z);
+
+		// 許容誤差付きの比較. 積和の順序とFMAの有無で丸めが異なる.
+		bool NearlyEqual(const float* a, const float* b, int n, float scale)
+		{
+			for (int i = 0; i < n; ++i)
+			{
+				const float tolerance = 1e-4f * std::max(1.0f, scale);
+				if (!(std::abs(a[i] - b[i]) <= tolerance))
+					return false;
+			}
+			return true;
+		}
+		template<typename T>
+		float MaxAbs(const T& v)
+		{
+			const float* p = reinterpret_cast<const float*>(&v);
+			float r = 0.0f;
+			for (int i = 0; i < static_cast<int>(sizeof(T) / sizeof(float)); ++i)
+				r = std::max(r, std::abs(p[i]));
+			return r;
+		}
+		template<typename T>
+		bool NearlyEqual(const T& a, const T& b)
+		{
+			return NearlyEqual(reinterpret_cast<const float*>(&a), reinterpret_cast<const float*>(&b), static_cast<int>(sizeof(T) / sizeof(float)), std::max(MaxAbs(a), MaxAbs(b)));
+		}
+
+		Mat44 ToMat44(const Mat34& m)
+		{
+			return Mat44(m.r0, m.r1, m.r2, Vec4::UnitW());
+		}
+
+		// 回転, 不均一スケール, 平行移動のトランスフォーム.
+		Mat34 RandomTransform(std::mt19937& rng)
+		{
+			std::uniform_real_distribution<float> angle(-k_pi_f, k_pi_f);
+			std::uniform_real_distribution<float> scale(0.5f, 4.0f);
+			std::uniform_real_distribution<float> trans(-100.0f, 100.0f);
+			Mat33 rot = Mat33::RotAxisY(angle(rng)) * Mat33::RotAxisX(angle(rng)) * Mat33::RotAxisZ(angle(rng));
+			rot = rot * Mat33(scale(rng), 0.0f, 0.0f, 0.0f, scale(rng), 0.0f, 0.0f, 0.0f, scale(rng));
+			Mat34 m(rot);
+			m.SetColumn3(Vec3(trans(rng), trans(rng), trans(rng)));
+			return m;
+		}
+		Vec4 RandomVec4(std::mt19937& rng)
+		{
+			std::uniform_real_distribution<float> dist(-10.0f, 10.0f);
+			return Vec4(dist(rng), dist(rng), dist(rng), dist(rng));
+		}
+
+	}
+
+	void MathSimdBenchmark()
+	{
+		int fail_count = 0;
+		std::mt19937 rng(1234);
+
+		// 結果の一致.
+		for (int i = 0; i < k_verify_count; ++i)
+		{
+			const Mat44 a = ToMat44(RandomTransform(rng));
+			Mat44 b = ToMat44(RandomTransform(rng));
+			b.r3 = Vec4(0.1f, -0.2f, 0.05f, 1.0f);// 射影成分を含む.
+			Mat44 c;
+			for (int r = 0; r < 4; ++r)
+				for (int k = 0; k < 4; ++k)
+					c.m[r][k] = std::uniform_real_distribution<float>(-5.0f, 5.0f)(rng);
+			const Vec4 v4 = RandomVec4(rng);
+			Vec4 v4_row = v4;
+
+			if (!NearlyEqual(MulSimd(a, b), MulConstexpr(a, b)) || !NearlyEqual(MulSimd(c, b), MulConstexpr(c, b)))
+				++fail_count;
+			if (!NearlyEqual(MulSimd(b, v4), MulConstexpr(b, v4)) || !NearlyEqual(MulSimd(v4, b), MulConstexpr(v4, b)))
+				++fail_count;
+			if (!NearlyEqual(Mat44::InverseOrCofactorSimd<true>(b), Mat44::InverseOrCofactorConstexpr<true>(b))
+				|| !NearlyEqual(Mat44::InverseOrCofactorSimd<true>(c), Mat44::InverseOrCofactorConstexpr<true>(c)))
+				++fail_count;
+			// 行列式が小さい場合は逆行列の誤差が大きいため比較しない.
+			if (1.0f < std::abs(Mat44::Determinant(b)) && !NearlyEqual(Mat44::InverseOrCofactorSimd<false>(b), Mat44::InverseOrCofactorConstexpr<false>(b)))
+				++fail_count;
+			if (1.0f < std::abs(Mat44::Determinant(c)) && !NearlyEqual(Mat44::InverseOrCofactorSimd<false>(c), Mat44::InverseOrCofactorConstexpr<false>(c)))
+				++fail_count;
+			if (!NearlyEqual(Vec4::NormalizeSimd(v4), Vec4::NormalizeScalar(v4)))
+				++fail_count;
+
+			// 逆行列との積は単位行列. 誤差は要素の大きさに比例する.
+			if (1.0f < std::abs(Mat44::Determinant(b)))
+			{
+				const Mat44 b_inv = Mat44::Inverse(b);
+				const Mat44 b_mul = b * b_inv;
+				const Mat44 identity = Mat44::Identity();
+				if (!NearlyEqual(b_mul.m[0], identity.m[0], 16, MaxAbs(b) * MaxAbs(b_inv)))
+					++fail_count;
+			}
+
+#if NGL_MATH_SIMD
+			// 実行時の演算子はSIMD実装.
+			if (!((a * b).r0 == MulSimd(a, b).r0) || !(b * v4 == MulSimd(b, v4)) || !(v4_row * b == MulSimd(v4, b)) || !(Vec4::Normalize(v4) == Vec4::NormalizeSimd(v4)))
+				++fail_count;
+#endif
+		}
+
+		// インスタンス毎のトランスフォーム.
+		std::vector<Mat34> world(k_num_instance);
+		std::vector<Vec3> bounds(k_num_instance * 2);
+		for (int i = 0; i < k_num_instance; ++i)
+		{
+			world[i] = RandomTransform(rng);
+			bounds[i * 2 + 0] = RandomVec4(rng).XYZ();
+			bounds[i * 2 + 1] = bounds[i * 2 + 0] + Vec3(1.0f, 2.0f, 3.0f);
+		}
+		const Mat44 view_proj = CalcStandardPerspectiveMatrix(Deg2Rad(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f) * ToMat44(CalcViewMatrix(Vec3(0.0f, 10.0f, -50.0f), Vec3::UnitZ(), Vec3::UnitY()));
+
+		std::vector<Mat44> out_mat44(k_num_instance);
+		std::vector<Vec4> out_vec4(k_num_instance * 8);
+
+		struct Result
+		{
+			const char*		name;
+			Clock::duration	constexpr_time;
+			Clock::duration	simd_time;
+		};
+		std::vector<Result> result;
+
+		// WorldViewProj行列.
+		result.push_back({ "Mat44 * Mat44 (world view proj)",
+			Measure(k_loop_count, [&]() { for (int i = 0; i < k_num_instance; ++i) out_mat44[i] = MulConstexpr(view_proj, ToMat44(world[i])); }),
+			Measure(k_loop_count, [&]() { for (int i = 0; i < k_num_instance; ++i) out_mat44[i] = MulSimd(view_proj, ToMat44(world[i])); }) });
+		auto corner = [&](int i, int c) { return Vec3(bounds[i * 2 + (c & 1)].x, bounds[i * 2 + ((c >> 1) & 1)].y, bounds[i * 2 + ((c >> 2) & 1)].z); };
+		// 境界箱の8頂点のクリップ空間変換.
+		result.push_back({ "Mat44 * Vec4 (clip 8 corner)",
+			Measure(k_loop_count, [&]() { for (int i = 0; i < k_num_instance; ++i) for (int c = 0; c < 8; ++c) out_vec4[i * 8 + c] = MulConstexpr(out_mat44[i], Vec4(corner(i, c), 1.0f)); }),
+			Measure(k_loop_count, [&]() { for (int i = 0; i < k_num_instance; ++i) for (int c = 0; c < 8; ++c) out_vec4[i * 8 + c] = MulSimd(out_mat44[i], Vec4(corner(i, c), 1.0f)); }) });
+		result.push_back({ "Vec4 * Mat44 (row vector)",
+			Measure(k_loop_count, [&]() { for (int i = 0; i < k_num_instance; ++i) out_vec4[i] = MulConstexpr(Vec4(bounds[i * 2], 1.0f), out_mat44[i]); }),
+			Measure(k_loop_count, [&]() { for (int i = 0; i < k_num_instance; ++i) out_vec4[i] = MulSimd(Vec4(bounds[i * 2], 1.0f), out_mat44[i]); }) });
+		result.push_back({ "Vec4 Normalize",
+			Measure(k_loop_count, [&]() { for (int i = 0; i < k_num_instance; ++i) out_vec4[i] = Vec4::NormalizeScalar(Vec4(bounds[i * 2], 1.0f)); }),
+			Measure(k_loop_count, [&]() { for (int i = 0; i < k_num_instance; ++i) out_vec4[i] = Vec4::NormalizeSimd(Vec4(bounds[i * 2], 1.0f)); }) });
+		result.push_back({ "Mat44 Inverse",
+			Measure(k_loop_count, [&]() { for (int i = 0; i < k_num_instance; ++i) out_mat44[i] = Mat44::InverseOrCofactorConstexpr<false>(ToMat44(world[i])); }),
+			Measure(k_loop_count, [&]() { for (int i = 0; i < k_num_instance; ++i) out_mat44[i] = Mat44::InverseOrCofactorSimd<false>(ToMat44(world[i])); }) });
+		result.push_back({ "Mat44 Cofactor",
+			Measure(k_loop_count, [&]() { for (int i = 0; i < k_num_instance; ++i) out_mat44[i] = Mat44::InverseOrCofactorConstexpr<true>(ToMat44(world[i])); }),
+			Measure(k_loop_count, [&]() { for (int i = 0; i < k_num_instance; ++i) out_mat44[i] = Mat44::InverseOrCofactorSimd<true>(ToMat44(world[i])); }) });
+
+		std::cout << "[MathSimdBenchmark] simd " << NGL_MATH_SIMD << ", fma " << NGL_MATH_SIMD_FMA << ", instance " << k_num_instance << std::endl;
+		const double scale = 1000000.0 / (static_cast<double>(k_loop_count) * k_num_instance);
+		for (const auto& e : result)
+		{
+			std::cout << "  " << e.name << " : constexpr " << ToMillisec(e.constexpr_time) * scale << " ns, simd " << ToMillisec(e.simd_time) * scale
+				<< " ns (" << (ToMillisec(e.constexpr_time) / ToMillisec(e.simd_time)) << "x)" << std::endl;
+		}
+		std::cout << "  fail " << fail_count << std::endl;
+		assert(0 == fail_count);
+	}
+
+	void MathTransformBatchBenchmark()
+	{
+		constexpr uint32_t k_count = 100000;
+
+		// 描画用のインスタンス情報を模した出力先.
+		struct InstanceOutput
+		{
+			Mat34	mtx;
+			Mat44	mtx_cofactor;
+			Mat34	mtx_prev;
+		};
+
+		std::mt19937 rng(5678);
+		std::vector<Mat34> transform(k_count);
+		std::vector<Mat34> transform_prev(k_count);
+		for (uint32_t i = 0; i < k_count; ++i)
+		{
+			transform[i] = RandomTransform(rng);
+			transform_prev[i] = RandomTransform(rng);
+		}
+		const Mat34 parent = RandomTransform(rng);
+		const Mat34 parent_prev = RandomTransform(rng);
+
+		std::vector<Mat34Soa4> soa(Mat34Soa4::BlockCount(k_count));
+		std::vector<Mat34Soa4> soa_prev(Mat34Soa4::BlockCount(k_count));
+		std::vector<InstanceOutput> out_scalar(k_count);
+		std::vector<InstanceOutput> out_batch(k_count);
+
+		auto calc_scalar = [&]()
+		{
+			for (uint32_t i = 0; i < k_count; ++i)
+			{
+				Mat34 world = Mat34(ToMat44(parent) * ToMat44(transform[i]));
+				out_scalar[i].mtx = world;
+				out_scalar[i].mtx_cofactor = Mat44(Mat33::Cofactor(world.GetMat33()));
+				out_scalar[i].mtx_prev = Mat34(ToMat44(parent_prev) * ToMat44(transform_prev[i]));
+			}
+		};
+		auto pack = [&]()
+		{
+			PackMat34Soa4(soa.data(), transform.data(), k_count);
+			PackMat34Soa4(soa_prev.data(), transform_prev.data(), k_count);
+		};
+		auto calc_batch = [&](uint32_t count)
+		{
+			InstanceTransformBatchOutput out = {};
+			out.world = &out_batch[0].mtx;
+			out.world_stride = sizeof(InstanceOutput);
+			out.cofactor = &out_batch[0].mtx_cofactor;
+			out.cofactor_stride = sizeof(InstanceOutput);
+			out.world_prev = &out_batch[0].mtx_prev;
+			out.world_prev_stride = sizeof(InstanceOutput);
+			out.parent = &parent;
+			out.parent_prev = &parent_prev;
+			CalcInstanceTransformBatch(out, soa.data(), soa_prev.data(), count);
+		};
+
+		int fail_count = 0;
+		// 端数のブロックは余りのインスタンスのみ書き込む.
+		{
+			const InstanceOutput sentinel = { Mat34(-1.0f), Mat44(-1.0f), Mat34(-1.0f) };
+			std::fill(out_batch.begin(), out_batch.end(), sentinel);
+			pack();
+			calc_batch(k_count - 3);
+			if (!(out_batch[k_count - 3].mtx.r0 == sentinel.mtx.r0) || !(out_batch[k_count - 1].mtx_prev.r2 == sentinel.mtx_prev.r2))
+				++fail_count;
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				if (!(soa[i / 4].Get(i % 4).r1 == transform[i].r1))
+					++fail_count;
+			}
+		}
+		calc_scalar();
+		calc_batch(k_count);
+		for (uint32_t i = 0; i < k_count; ++i)
+		{
+			if (!NearlyEqual(out_scalar[i].mtx, out_batch[i].mtx) || !NearlyEqual(out_scalar[i].mtx_cofactor, out_batch[i].mtx_cofactor) || !NearlyEqual(out_scalar[i].mtx_prev, out_batch[i].mtx_prev))
+				++fail_count;
+		}
+
+		// 展開すると元の行列に戻る.
+		{
+			std::vector<Mat34> unpacked(k_count - 3);
+			UnpackMat34Soa4(unpacked.data(), soa.data(), k_count - 3);
+			for (uint32_t i = 0; i < k_count - 3; ++i)
+			{
+				if (!(unpacked[i].r0 == transform[i].r0) || !(unpacked[i].r1 == transform[i].r1) || !(unpacked[i].r2 == transform[i].r2))
+					++fail_count;
+			}
+		}
+
+		// gfx::MeshInstanceBuffer と同じ形式. Componentのtransform_のポインタ配列から詰め, 256byte毎のInstanceInfoへ書き込む.
+		struct alignas(256) InstanceSlot
+		{
+			Mat34	mtx;
+			Mat44	mtx_cofactor;
+		};
+		std::vector<const Mat34*> transform_ptr(k_count);
+		for (uint32_t i = 0; i < k_count; ++i)
+			transform_ptr[i] = &transform[i];
+		std::vector<InstanceSlot> slot_scalar(k_count);
+		std::vector<InstanceSlot> slot_batch(k_count);
+		// インスタンス毎に計算して書き込む. Component毎の定数バッファ更新に相当.
+		auto calc_slot_scalar = [&]()
+		{
+			for (uint32_t i = 0; i < k_count; ++i)
+			{
+				Mat34 world = *transform_ptr[i];
+				slot_scalar[i].mtx = world;
+				slot_scalar[i].mtx_cofactor = Mat44(Mat33::Cofactor(world.GetMat33()));
+			}
+		};
+		auto calc_slot_batch = [&]()
+		{
+			PackMat34Soa4(soa.data(), transform_ptr.data(), k_count);
+			InstanceTransformBatchOutput out = {};
+			out.world = &slot_batch[0].mtx;
+			out.world_stride = sizeof(InstanceSlot);
+			out.cofactor = &slot_batch[0].mtx_cofactor;
+			out.cofactor_stride = sizeof(InstanceSlot);
+			CalcInstanceTransformBatch(out, soa.data(), nullptr, k_count);
+		};
+		calc_slot_scalar();
+		calc_slot_batch();
+		for (uint32_t i = 0; i < k_count; ++i)
+		{
+			if (!NearlyEqual(slot_scalar[i].mtx, slot_batch[i].mtx) || !NearlyEqual(slot_scalar[i].mtx_cofactor, slot_batch[i].mtx_cofactor))
+				++fail_count;
+		}
+
+		// 他の処理の影響を除くため最短時間.
+		constexpr int k_loop = 20;
+		const auto scalar_time = MeasureMin(k_loop, calc_scalar);
+		const auto pack_time = MeasureMin(k_loop, pack);
+		const auto batch_time = MeasureMin(k_loop, [&]() { calc_batch(k_count); });
+		const auto slot_scalar_time = MeasureMin(k_loop, calc_slot_scalar);
+		const auto slot_batch_time = MeasureMin(k_loop, calc_slot_batch);
+
+		std::cout << "[MathTransformBatchBenchmark] simd " << NGL_MATH_SIMD << ", fma " << NGL_MATH_SIMD_FMA << ", instance " << k_count << std::endl;
+		std::cout << "  scalar : " << ToMillisec(scalar_time) << " ms" << std::endl;
+		std::cout << "  pack soa : " << ToMillisec(pack_time) << " ms" << std::endl;
+		std::cout << "  batch : " << ToMillisec(batch_time) << " ms (" << (ToMillisec(scalar_time) / ToMillisec(batch_time)) << "x)" << std::endl;
+		std::cout << "  instance buffer scalar : " << ToMillisec(slot_scalar_time) << " ms" << std::endl;
+		std::cout << "  instance buffer pack + batch : " << ToMillisec(slot_batch_time) << " ms (" << (ToMillisec(slot_scalar_time) / ToMillisec(slot_batch_time)) << "x)" << std::endl;
+		std::cout << "  fail " << fail_count << std::endl;
+		assert(0 == fail_count);
+	}
+
+	void MathFrustumCullingBenchmark()
+	{
+		constexpr uint32_t k_count = 100000;
+		constexpr int k_loop = 50;
+		constexpr int k_point_count = 100000;
+
+		std::mt19937 rng(9012);
+		int fail_count = 0;
+
+		// 点のFrustum判定とクリップ空間の判定が一致する. 境界付近の点は除く.
+		{
+			std::uniform_real_distribution<float> pos(-300.0f, 300.0f);
+			const Mat34 view = CalcViewMatrix(Vec3(10.0f, 5.0f, -20.0f), Vec3::Normalize(Vec3(0.3f, -0.2f, 1.0f)), Vec3::UnitY());
+			const std::pair<Mat44, bool> proj_array[] =
+			{
+				{ CalcReverseInfiniteFarPerspectiveMatrix(ngl::math::Deg2Rad(60.0f), 16.0f / 9.0f, 0.1f), true },
+				{ CalcStandardPerspectiveMatrix(ngl::math::Deg2Rad(45.0f), 1.0f, 1.0f, 200.0f), false },
+				{ CalcReverseOrthographicMatrix(-50.0f, 80.0f, -30.0f, 40.0f, -100.0f, 150.0f), true },
+			};
+			for (const auto& [proj, is_reverse_z] : proj_array)
+			{
+				const Mat44 view_proj = proj * ToMat44(view);
+				Frustum frustum;
+				CreateFrustum(frustum, view_proj, is_reverse_z);
+				for (int i = 0; i < k_point_count; ++i)
+				{
+					const Vec3 p(pos(rng), pos(rng), pos(rng));
+					const Vec4 clip = view_proj * Vec4(p, 1.0f);
+					const float margin = 1e-3f * std::abs(clip.w);
+					const float dist[] = { clip.w + clip.x, clip.w - clip.x, clip.w + clip.y, clip.w - clip.y, clip.z, clip.w - clip.z };
+					bool is_border = 1e-4f > std::abs(clip.w);
+					bool is_inside = 0.0f < clip.w;
+					for (const float d : dist)
+					{
+						is_border |= std::abs(d) <= margin;
+						is_inside &= 0.0f <= d;
+					}
+					if (is_border)
+						continue;
+					if (is_inside != IsIntersectFrustumAabb(frustum, p, Vec3::Zero()))
+						++fail_count;
+				}
+			}
+		}
+		// カメラの基底ベクトルから生成したFrustumは変換行列から生成したものと一致する.
+		{
+			const Vec3 view_pos(10.0f, 5.0f, -20.0f);
+			const Vec3 view_dir = Vec3::Normalize(Vec3(0.3f, -0.2f, 1.0f));
+			const Vec3 view_right = Vec3::Normalize(Vec3::Cross(Vec3::UnitY(), view_dir));
+			const Vec3 view_up = Vec3::Cross(view_dir, view_right);
+			const float fov_y = ngl::math::Deg2Rad(45.0f);
+			Frustum frustum_vec, frustum_mtx;
+			CreateFrustum(frustum_vec, view_pos, view_dir, view_up, view_right, 1.0f, 200.0f, fov_y, 16.0f / 9.0f);
+			CreateFrustum(frustum_mtx, CalcStandardPerspectiveMatrix(fov_y, 16.0f / 9.0f, 1.0f, 200.0f) * ToMat44(CalcViewMatrix(view_pos, view_dir, view_up)), false);
+			for (int pi = 0; pi < Frustum::EPlaneIndex::_MAX; ++pi)
+			{
+				const Plane& a = frustum_vec.planes_[pi];
+				const Plane& b = frustum_mtx.planes_[pi];
+				if (1e-3f < Vec3::Length(a.normal_ - b.normal_) || 1e-2f < std::abs(a.distance_ - b.distance_))
+					++fail_count;
+			}
+		}
+
+		// ランダムなAABBのSoA.
+		std::uniform_real_distribution<float> center_dist(-400.0f, 400.0f);
+		std::uniform_real_distribution<float> extent_dist(0.0f, 20.0f);
+		std::vector<float> center[3], extent[3];
+		for (int ai = 0; ai < 3; ++ai)
+		{
+			center[ai].resize(k_count);
+			extent[ai].resize(k_count);
+			for (uint32_t i = 0; i < k_count; ++i)
+			{
+				center[ai][i] = center_dist(rng);
+				extent[ai][i] = extent_dist(rng);
+			}
+		}
+		const AabbSoaRef aabb = { { center[0].data(), center[1].data(), center[2].data() }, { extent[0].data(), extent[1].data(), extent[2].data() } };
+
+		const Mat34 view = CalcViewMatrix(Vec3(0.0f, 20.0f, 0.0f), Vec3::Normalize(Vec3(1.0f, -0.1f, 0.5f)), Vec3::UnitY());
+		Frustum frustum;
+		CreateFrustum(frustum, CalcReverseInfiniteFarPerspectiveMatrix(ngl::math::Deg2Rad(60.0f), 16.0f / 9.0f, 0.1f) * ToMat44(view));
+
+		auto is_visible_scalar = [&](uint32_t i)
+		{
+			return IsIntersectFrustumAabb(frustum, Vec3(center[0][i], center[1][i], center[2][i]), Vec3(extent[0][i], extent[1][i], extent[2][i]));
+		};
+		// 判定が一致しない場合は平面との距離が誤差の範囲であること.
+		auto is_border = [&](uint32_t i)
+		{
+			for (const auto& plane : frustum.planes_)
+			{
+				const Vec3 n = plane.normal_;
+				const float dist = Vec3::Dot(n, Vec3(center[0][i], center[1][i], center[2][i])) - plane.distance_
+					+ std::abs(n.x) * extent[0][i] + std::abs(n.y) * extent[1][i] + std::abs(n.z) * extent[2][i];
+				if (std::abs(dist) < 1e-3f)
+					return true;
+			}
+			return false;
+		};
+
+		std::vector<uint32_t> visible(k_count);
+		std::vector<uint32_t> visible_scalar(k_count);
+		uint32_t visible_count = 0;
+		uint32_t visible_scalar_count = 0;
+
+		// 範囲の先頭と末尾が4の倍数でない場合も昇順で範囲内のインデックスのみ.
+		for (const uint32_t begin : { 0u, 3u, 17u })
+		{
+			const uint32_t end = k_count - begin;
+			visible_count = CullFrustumAabb(visible.data(), frustum, aabb, begin, end);
+			std::vector<bool> is_visible(k_count, false);
+			for (uint32_t i = 0; i < visible_count; ++i)
+			{
+				if (visible[i] < begin || visible[i] >= end || (0 < i && visible[i - 1] >= visible[i]))
+					++fail_count;
+				else
+					is_visible[visible[i]] = true;
+			}
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				if (is_visible[i] != is_visible_scalar(i) && !is_border(i))
+					++fail_count;
+			}
+		}
+		// 空の範囲.
+		if (0 != CullFrustumAabb(visible.data(), frustum, aabb, 8, 8))
+			++fail_count;
+
+		auto cull_scalar = [&]()
+		{
+			visible_scalar_count = 0;
+			for (uint32_t i = 0; i < k_count; ++i)
+			{
+				if (is_visible_scalar(i))
+					visible_scalar[visible_scalar_count++] = i;
+			}
+		};
+		auto cull_simd = [&]()
+		{
+			visible_count = CullFrustumAabb(visible.data(), frustum, aabb, 0, k_count);
+		};
+
+		const auto scalar_time = MeasureMin(k_loop, cull_scalar);
+		const auto simd_time = MeasureMin(k_loop, cull_simd);
+
+		std::cout << "[MathFrustumCullingBenchmark] simd " << NGL_MATH_SIMD << ", fma " << NGL_MATH_SIMD_FMA << ", aabb " << k_count << ", visible " << visible_count << std::endl;
+		std::cout << "  scalar : " << ToMillisec(scalar_time) << " ms" << std::endl;
+		std::cout << "  simd : " << ToMillisec(simd_time) << " ms (" << (ToMillisec(scalar_time) / ToMillisec(simd_time)) << "x)" << std::endl;
+		std::cout << "  fail " << fail_count << std::endl;
+		assert(0 == fail_count);
+	}
+
+	void MathShadowCascadeCullingBenchmark()
+	{
+		constexpr uint32_t k_count = 200000;
+		constexpr int k_cascade_count = 3;
+		constexpr int k_loop = 20;
+		constexpr int k_receiver_sample_count = 2000;
+
+		// test_pass の TaskDirectionalShadowPass と同じ設定.
+		constexpr float k_split_distance[k_cascade_count] = { 12.0f, 60.0f, 160.0f };
+		constexpr float k_blend_width = 5.0f;
+		constexpr float k_cover_margin = 1.0f;
+		constexpr float k_extend_toward_light = 200.0f;
+		constexpr float k_near_z = 0.1f;
+		const float k_fov_y = ngl::math::Deg2Rad(60.0f);
+		constexpr float k_aspect = 16.0f / 9.0f;
+
+		std::mt19937 rng(3456);
+		int fail_count = 0;
+
+		// 地面付近に分布するAABB.
+		std::uniform_real_distribution<float> xz_dist(-250.0f, 250.0f);
+		std::uniform_real_distribution<float> y_dist(0.0f, 40.0f);
+		std::uniform_real_distribution<float> extent_dist(0.3f, 6.0f);
+		std::vector<float> center[3], extent[3];
+		std::vector<Aabb> aabb_array(k_count);
+		for (int ai = 0; ai < 3; ++ai)
+		{
+			center[ai].resize(k_count);
+			extent[ai].resize(k_count);
+		}
+		for (uint32_t i = 0; i < k_count; ++i)
+		{
+			const Vec3 c(xz_dist(rng), y_dist(rng), xz_dist(rng));
+			const Vec3 e(extent_dist(rng), extent_dist(rng), extent_dist(rng));
+			for (int ai = 0; ai < 3; ++ai)
+			{
+				center[ai][i] = c.data[ai];
+				extent[ai][i] = e.data[ai];
+			}
+			aabb_array[i] = Aabb(c - e, c + e);
+		}
+		const AabbSoaRef aabb = { { center[0].data(), center[1].data(), center[2].data() }, { extent[0].data(), extent[1].data(), extent[2].data() } };
+		AabbBvh bvh;
+		bvh.Build(aabb_array.data(), k_count);
+
+		// View.
+		const Vec3 view_pos(0.0f, 15.0f, 0.0f);
+		const Vec3 view_forward = Vec3::Normalize(Vec3(1.0f, -0.15f, 0.4f));
+		const Vec3 view_right = Vec3::Normalize(Vec3::Cross(Vec3::UnitY(), view_forward));
+		const Vec3 view_up = Vec3::Cross(view_forward, view_right);
+		const float tan_v = std::tan(k_fov_y * 0.5f);
+		const float tan_h = tan_v * k_aspect;
+		auto view_point = [&](float depth, float x, float y)
+		{
+			return view_pos + view_forward * depth + view_right * (x * tan_h * depth) + view_up * (y * tan_v * depth);
+		};
+		Frustum view_frustum;
+		CreateFrustum(view_frustum, CalcReverseInfiniteFarPerspectiveMatrix(k_fov_y, k_aspect, k_near_z) * ToMat44(CalcViewMatrix(view_pos, view_forward, view_up)));
+
+		// Light View.
+		const Vec3 light_dir = Vec3::Normalize(Vec3(0.3f, -1.0f, 0.5f));
+		const Vec3 light_helper_side = (0.9f > std::abs(light_dir.x)) ? Vec3::UnitX() : Vec3::UnitZ();
+		const Vec3 light_up = Vec3::Normalize(Vec3::Cross(light_dir, light_helper_side));
+		const Mat34 light_view_mtx = CalcViewMatrix(Vec3::Zero(), light_dir, light_up);
+		auto to_light_space = [&](const Vec3& p)
+		{
+			const Vec4 p4(p, 1.0f);
+			return Vec3(Vec4::Dot(light_view_mtx.r0, p4), Vec4::Dot(light_view_mtx.r1, p4), Vec4::Dot(light_view_mtx.r2, p4));
+		};
+
+		// Cascadeの受影範囲と判定範囲.
+		float cascade_near[k_cascade_count];
+		Vec3 receiver_min_ls[k_cascade_count];
+		Vec3 receiver_max_ls[k_cascade_count];
+		ShadowCascadeCullVolume volume[k_cascade_count];
+		Frustum full_ortho_frustum[k_cascade_count];
+		for (int ci = 0; ci < k_cascade_count; ++ci)
+		{
+			cascade_near[ci] = (0 == ci) ? k_near_z : std::max(0.0f, k_split_distance[ci - 1] - k_blend_width);
+			receiver_min_ls[ci] = Vec3(FLT_MAX);
+			receiver_max_ls[ci] = Vec3(-FLT_MAX);
+			for (const float depth : { cascade_near[ci], k_split_distance[ci] })
+			{
+				for (const float x : { -1.0f, 1.0f })
+				{
+					for (const float y : { -1.0f, 1.0f })
+					{
+						const Vec3 p_ls = to_light_space(view_point(depth, x, y));
+						for (int ai = 0; ai < 3; ++ai)
+						{
+							receiver_min_ls[ci].data[ai] = std::min(receiver_min_ls[ci].data[ai], p_ls.data[ai]);
+							receiver_max_ls[ci].data[ai] = std::max(receiver_max_ls[ci].data[ai], p_ls.data[ai]);
+						}
+					}
+				}
+			}
+			const float covered_view_depth = (0 == ci) ? -FLT_MAX : cascade_near[ci] - k_cover_margin;
+			CreateShadowCascadeCullVolume(volume[ci], light_view_mtx, receiver_min_ls[ci], receiver_max_ls[ci], k_extend_toward_light, view_frustum, view_pos, view_forward, covered_view_depth);
+
+			// 比較用の描画するOrthoの範囲全体.
+			const Mat44 ortho = CalcReverseOrthographicMatrix(
+				receiver_min_ls[ci].x, receiver_max_ls[ci].x, receiver_min_ls[ci].y, receiver_max_ls[ci].y,
+				receiver_min_ls[ci].z - k_extend_toward_light, receiver_max_ls[ci].z + k_extend_toward_light);
+			CreateFrustum(full_ortho_frustum[ci], ortho * ToMat44(light_view_mtx));
+		}
+
+		// 判定が一致しない場合は平面またはカバー判定の境界が誤差の範囲であること.
+		auto is_border = [&](const ShadowCascadeCullVolume& v, uint32_t i)
+		{
+			const Vec3 c(center[0][i], center[1][i], center[2][i]);
+			const Vec3 e(extent[0][i], extent[1][i], extent[2][i]);
+			for (const auto& plane : v.frustum.planes_)
+			{
+				const Vec3 n = plane.normal_;
+				const float dist = Vec3::Dot(n, c) - plane.distance_ + std::abs(n.x) * e.x + std::abs(n.y) * e.y + std::abs(n.z) * e.z;
+				if (std::abs(dist) < 1e-2f)
+					return true;
+			}
+			// カバー判定の境界をずらして結果が変わる場合.
+			ShadowCascadeCullVolume v_lo = v, v_hi = v;
+			v_lo.covered_view_depth -= 1e-2f;
+			v_hi.covered_view_depth += 1e-2f;
+			bool is_covered_lo, is_covered_hi;
+			IsShadowCascadeCaster(is_covered_lo, v_lo, c, e);
+			IsShadowCascadeCaster(is_covered_hi, v_hi, c, e);
+			return is_covered_lo != is_covered_hi;
+		};
+
+		std::vector<uint32_t> caster[k_cascade_count];
+		uint32_t caster_count[k_cascade_count] = {};
+		uint32_t covered_count[k_cascade_count] = {};
+		for (int ci = 0; ci < k_cascade_count; ++ci)
+		{
+			caster[ci].resize(k_count);
+
+			// 範囲の先頭と末尾が4の倍数でない場合もスカラーの判定と一致する.
+			for (const uint32_t begin : { 17u, 3u, 0u })
+			{
+				const uint32_t end = k_count - begin;
+				covered_count[ci] = 0;
+				caster_count[ci] = CullShadowCascadeAabb(caster[ci].data(), covered_count[ci], volume[ci], aabb, begin, end);
+
+				std::vector<bool> is_caster(k_count, false);
+				for (uint32_t i = 0; i < caster_count[ci]; ++i)
+				{
+					if (caster[ci][i] < begin || caster[ci][i] >= end || (0 < i && caster[ci][i - 1] >= caster[ci][i]))
+						++fail_count;
+					else
+						is_caster[caster[ci][i]] = true;
+				}
+				uint32_t covered_scalar_count = 0;
+				uint32_t border_count = 0;
+				for (uint32_t i = begin; i < end; ++i)
+				{
+					bool is_covered;
+					const bool is_caster_scalar = IsShadowCascadeCaster(is_covered, volume[ci], Vec3(center[0][i], center[1][i], center[2][i]), Vec3(extent[0][i], extent[1][i], extent[2][i]));
+					covered_scalar_count += is_covered ? 1 : 0;
+					const bool border = is_border(volume[ci], i);
+					border_count += border ? 1 : 0;
+					if (is_caster[i] != is_caster_scalar && !border)
+						++fail_count;
+				}
+				if (std::max(covered_count[ci], covered_scalar_count) - std::min(covered_count[ci], covered_scalar_count) > border_count)
+					++fail_count;
+			}
+			// 最も手前のCascadeはスキップしない.
+			if (0 == ci && 0 != covered_count[ci])
+				++fail_count;
+		}
+
+		// このCascadeを参照する受影点から光源方向へ, 描画するOrthoのNearまでの線分と交差するAABBは全て描画対象である.
+		for (int ci = 0; ci < k_cascade_count; ++ci)
+		{
+			std::vector<bool> is_caster(k_count, false);
+			for (uint32_t i = 0; i < caster_count[ci]; ++i)
+				is_caster[caster[ci][i]] = true;
+
+			std::uniform_real_distribution<float> depth_dist(cascade_near[ci], k_split_distance[ci]);
+			std::uniform_real_distribution<float> ndc_dist(-1.0f, 1.0f);
+			std::vector<uint32_t> hit;
+			for (int si = 0; si < k_receiver_sample_count; ++si)
+			{
+				const Vec3 receiver = view_point(depth_dist(rng), ndc_dist(rng), ndc_dist(rng));
+				const float t_max = to_light_space(receiver).z - (receiver_min_ls[ci].z - k_extend_toward_light) - 1e-2f;
+				hit.clear();
+				bvh.QueryRay(hit, receiver, -light_dir, t_max);
+				for (const uint32_t id : hit)
+				{
+					if (!is_caster[id])
+						++fail_count;
+				}
+			}
+		}
+
+		// 処理時間.
+		const auto cull_time = MeasureMin(k_loop, [&]()
+			{
+				for (int ci = 0; ci < k_cascade_count; ++ci)
+				{
+					covered_count[ci] = 0;
+					caster_count[ci] = CullShadowCascadeAabb(caster[ci].data(), covered_count[ci], volume[ci], aabb, 0, k_count);
+				}
+			});
+
+		std::cout << "[MathShadowCascadeCullingBenchmark] simd " << NGL_MATH_SIMD << ", fma " << NGL_MATH_SIMD_FMA << ", aabb " << k_count << std::endl;
+		uint32_t total_draw = 0;
+		for (int ci = 0; ci < k_cascade_count; ++ci)
+		{
+			const uint32_t full_ortho_count = CullFrustumAabb(caster[ci].data(), full_ortho_frustum[ci], aabb, 0, k_count);
+			total_draw += caster_count[ci];
+			std::cout << "  cascade" << ci << " : draw " << caster_count[ci] << ", covered " << covered_count[ci]
+				<< ", full ortho " << full_ortho_count << ", saved " << (k_count - caster_count[ci])
+				<< " (vs full ortho " << (full_ortho_count - caster_count[ci]) << ")" << std::endl;
+		}
+		std::cout << "  draw total " << total_draw << " / " << (k_count * k_cascade_count) << ", cull " << ToMillisec(cull_time) << " ms" << std::endl;
+		std::cout << "  fail " << fail_count << std::endl;
+		assert(0 == fail_count);
+	}
+}
+}
+}
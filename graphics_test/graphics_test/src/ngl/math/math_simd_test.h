@@ -0,0 +1,31 @@
+﻿#pragma once
+
+#include "math.h"
+
+
+namespace ngl
+{
+namespace math
+{
+namespace test
+{
+	// ngl::math のSIMD実装のテスト.
+	// 乱数の行列とベクトルで実行時SIMD実装と定数式用のスカラー実装の結果の一致を検証し,
+	// インスタンス毎のトランスフォーム処理を模した演算で両実装の速度を標準出力に出力する.
+	void MathSimdBenchmark();
+
+	// インスタンスのトランスフォームの一括計算のテスト.
+	// インスタンス毎のスカラー計算との一致を検証し, 10万インスタンスの処理時間を標準出力に出力する.
+	void MathTransformBatchBenchmark();
+
+	// FrustumとAABBの一括交差判定のテスト.
+	// 投影行列からのFrustum生成をクリップ空間での判定と比較し, SIMDの一括判定とスカラーの判定の一致を検証して10万個の処理時間を標準出力に出力する.
+	void MathFrustumCullingBenchmark();
+
+	// DirectionalShadowのCascade毎のCaster判定のテスト.
+	// 合成シーンで3 Cascadeの判定をし, SIMDとスカラーの判定の一致と, 受影点から光源方向への線分と交差するAABBが全て描画対象であることを検証する.
+	// Cascade毎の描画数, 手前のCascadeでカバーされたためスキップした数, 描画の削減数と処理時間を標準出力に出力する.
+	void MathShadowCascadeCullingBenchmark();
+}
+}
+}
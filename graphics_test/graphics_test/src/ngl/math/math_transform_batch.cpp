@@ -0,0 +1,226 @@
+﻿
+#include "math_transform_batch.h"
+
+#include <algorithm>
+
+namespace ngl
+{
+	namespace math
+	{
+		namespace
+		{
+			using namespace simd_detail;
+
+			// 4インスタンス分のMat34. 各要素が4レーン.
+			struct Mat34F4
+			{
+				F4	e[3][4];
+			};
+
+			// ループを展開して書く. 全要素がレジスタに載るように.
+			inline Mat34F4 LoadMat34F4(const Mat34Soa4& m)
+			{
+				return { {
+					{ Load4(m.e[0][0]), Load4(m.e[0][1]), Load4(m.e[0][2]), Load4(m.e[0][3]) },
+					{ Load4(m.e[1][0]), Load4(m.e[1][1]), Load4(m.e[1][2]), Load4(m.e[1][3]) },
+					{ Load4(m.e[2][0]), Load4(m.e[2][1]), Load4(m.e[2][2]), Load4(m.e[2][3]) },
+				} };
+			}
+			// 全レーン共通の行列. 各要素を全レーンに複製.
+			inline Mat34F4 SplatMat34F4(const Mat34& m)
+			{
+				Mat34F4 r;
+				for (int i = 0; i < 3; ++i)
+					for (int k = 0; k < 4; ++k)
+						r.e[i][k] = Set1(m.m[i][k]);
+				return r;
+			}
+
+			// parent * m の1要素. 平行移動の列はparentの平行移動を加える.
+			inline F4 MulElement(F4 p0, F4 p1, F4 p2, F4 m0, F4 m1, F4 m2)
+			{
+				return MulAdd(p2, m2, MulAdd(p1, m1, Mul(p0, m0)));
+			}
+			inline F4 MulElementTranslate(F4 p0, F4 p1, F4 p2, F4 p3, F4 m0, F4 m1, F4 m2)
+			{
+				return MulAdd(p2, m2, MulAdd(p1, m1, MulAdd(p0, m0, p3)));
+			}
+			// parent * m. 4行目を(0,0,0,1)とした積.
+			inline Mat34F4 MulMat34F4(const Mat34F4& parent, const Mat34F4& m)
+			{
+				const auto& p = parent.e;
+				const auto& a = m.e;
+				return { {
+					{ MulElement(p[0][0], p[0][1], p[0][2], a[0][0], a[1][0], a[2][0]), MulElement(p[0][0], p[0][1], p[0][2], a[0][1], a[1][1], a[2][1]),
+					  MulElement(p[0][0], p[0][1], p[0][2], a[0][2], a[1][2], a[2][2]), MulElementTranslate(p[0][0], p[0][1], p[0][2], p[0][3], a[0][3], a[1][3], a[2][3]) },
+					{ MulElement(p[1][0], p[1][1], p[1][2], a[0][0], a[1][0], a[2][0]), MulElement(p[1][0], p[1][1], p[1][2], a[0][1], a[1][1], a[2][1]),
+					  MulElement(p[1][0], p[1][1], p[1][2], a[0][2], a[1][2], a[2][2]), MulElementTranslate(p[1][0], p[1][1], p[1][2], p[1][3], a[0][3], a[1][3], a[2][3]) },
+					{ MulElement(p[2][0], p[2][1], p[2][2], a[0][0], a[1][0], a[2][0]), MulElement(p[2][0], p[2][1], p[2][2], a[0][1], a[1][1], a[2][1]),
+					  MulElement(p[2][0], p[2][1], p[2][2], a[0][2], a[1][2], a[2][2]), MulElementTranslate(p[2][0], p[2][1], p[2][2], p[2][3], a[0][3], a[1][3], a[2][3]) },
+				} };
+			}
+
+			// a * b - c * d.
+			inline F4 MulSubMul(F4 a, F4 b, F4 c, F4 d)
+			{
+				return Sub(Mul(a, b), Mul(c, d));
+			}
+
+			// 4インスタンスの同じ行を転置すると要素毎の4レーンになる.
+			inline void PackMat34Soa4Block(Mat34Soa4& out, const Mat34* const (&src)[4])
+			{
+				for (int i = 0; i < 3; ++i)
+				{
+					F4 r0 = Load4(src[0]->m[i]), r1 = Load4(src[1]->m[i]), r2 = Load4(src[2]->m[i]), r3 = Load4(src[3]->m[i]);
+					Transpose(r0, r1, r2, r3);
+					Store4(out.e[i][0], r0);
+					Store4(out.e[i][1], r1);
+					Store4(out.e[i][2], r2);
+					Store4(out.e[i][3], r3);
+				}
+			}
+
+			// 3x3部分の余因子行列. Mat33::Cofactorと同じ式.
+			inline void Cofactor33F4(F4 (&out)[3][3], const Mat34F4& m)
+			{
+				const auto& w = m.e;
+				out[0][0] = MulSubMul(w[1][1], w[2][2], w[1][2], w[2][1]);
+				out[0][1] = MulSubMul(w[1][2], w[2][0], w[1][0], w[2][2]);
+				out[0][2] = MulSubMul(w[1][0], w[2][1], w[1][1], w[2][0]);
+
+				out[1][0] = MulSubMul(w[0][2], w[2][1], w[0][1], w[2][2]);
+				out[1][1] = MulSubMul(w[0][0], w[2][2], w[0][2], w[2][0]);
+				out[1][2] = MulSubMul(w[0][1], w[2][0], w[0][0], w[2][1]);
+
+				out[2][0] = MulSubMul(w[0][1], w[1][2], w[0][2], w[1][1]);
+				out[2][1] = MulSubMul(w[0][2], w[1][0], w[0][0], w[1][2]);
+				out[2][2] = MulSubMul(w[0][0], w[1][1], w[0][1], w[1][0]);
+			}
+		}
+
+		void Mat34Soa4::Set(uint32_t lane, const Mat34& m)
+		{
+			for (int i = 0; i < 3; ++i)
+				for (int k = 0; k < 4; ++k)
+					e[i][k][lane] = m.m[i][k];
+		}
+		Mat34 Mat34Soa4::Get(uint32_t lane) const
+		{
+			Mat34 m;
+			for (int i = 0; i < 3; ++i)
+				for (int k = 0; k < 4; ++k)
+					m.m[i][k] = e[i][k][lane];
+			return m;
+		}
+
+		void PackMat34Soa4(Mat34Soa4* out, const Mat34* in, uint32_t count)
+		{
+			const Mat34 identity = Mat34::Identity();
+			for (uint32_t bi = 0; bi < Mat34Soa4::BlockCount(count); ++bi)
+			{
+				const uint32_t base = bi * Mat34Soa4::k_width;
+				const Mat34* src[4];
+				for (uint32_t l = 0; l < 4; ++l)
+					src[l] = (base + l < count) ? &in[base + l] : &identity;
+				PackMat34Soa4Block(out[bi], src);
+			}
+		}
+		void PackMat34Soa4(Mat34Soa4* out, const Mat34* const* in, uint32_t count)
+		{
+			const Mat34 identity = Mat34::Identity();
+			for (uint32_t bi = 0; bi < Mat34Soa4::BlockCount(count); ++bi)
+			{
+				const uint32_t base = bi * Mat34Soa4::k_width;
+				const Mat34* src[4];
+				for (uint32_t l = 0; l < 4; ++l)
+					src[l] = (base + l < count) ? in[base + l] : &identity;
+				PackMat34Soa4Block(out[bi], src);
+			}
+		}
+		void UnpackMat34Soa4(Mat34* out, const Mat34Soa4* in, uint32_t count)
+		{
+			for (uint32_t bi = 0; bi < Mat34Soa4::BlockCount(count); ++bi)
+			{
+				const uint32_t base = bi * Mat34Soa4::k_width;
+				const uint32_t lane_count = std::min(Mat34Soa4::k_width, count - base);
+				for (int i = 0; i < 3; ++i)
+				{
+					F4 r[4] = { Load4(in[bi].e[i][0]), Load4(in[bi].e[i][1]), Load4(in[bi].e[i][2]), Load4(in[bi].e[i][3]) };
+					Transpose(r[0], r[1], r[2], r[3]);
+					for (uint32_t l = 0; l < lane_count; ++l)
+						Store4(out[base + l].m[i], r[l]);
+				}
+			}
+		}
+
+		void CalcInstanceTransformBatch(const InstanceTransformBatchOutput& out, const Mat34Soa4* transform, const Mat34Soa4* transform_prev, uint32_t count)
+		{
+			const Mat34F4 parent = SplatMat34F4(out.parent ? *out.parent : Mat34::Identity());
+			const Mat34F4 parent_prev = SplatMat34F4(out.parent_prev ? *out.parent_prev : Mat34::Identity());
+			const bool has_world_prev = out.world_prev && transform_prev;
+			const F4 zero = Zero();
+
+			// 出力先. ループ中の書き込みとの別名を避けてローカルに保持.
+			uint8_t* out_world = static_cast<uint8_t*>(out.world);
+			uint8_t* out_cofactor = static_cast<uint8_t*>(out.cofactor);
+			uint8_t* out_world_prev = static_cast<uint8_t*>(out.world_prev);
+			const size_t world_stride = out.world_stride;
+			const size_t cofactor_stride = out.cofactor_stride;
+			const size_t world_prev_stride = out.world_prev_stride;
+			const bool has_parent = nullptr != out.parent;
+			const bool has_parent_prev = nullptr != out.parent_prev;
+
+			// 4レーンの行(r0, r1, r2, r3)を転置してインスタンス毎に書き込む.
+			auto store_row = [](uint8_t* base, size_t stride, uint32_t lane_count, size_t row_offset, F4 r0, F4 r1, F4 r2, F4 r3)
+			{
+				Transpose(r0, r1, r2, r3);
+				float* p = reinterpret_cast<float*>(base + row_offset);
+				if (Mat34Soa4::k_width == lane_count)
+				{
+					Store4(p, r0);
+					Store4(reinterpret_cast<float*>(base + stride + row_offset), r1);
+					Store4(reinterpret_cast<float*>(base + stride * 2 + row_offset), r2);
+					Store4(reinterpret_cast<float*>(base + stride * 3 + row_offset), r3);
+					return;
+				}
+				const F4 lane[4] = { r0, r1, r2, r3 };
+				for (uint32_t l = 0; l < lane_count; ++l)
+					Store4(reinterpret_cast<float*>(base + stride * l + row_offset), lane[l]);
+			};
+
+			for (uint32_t bi = 0; bi < Mat34Soa4::BlockCount(count); ++bi)
+			{
+				const uint32_t base = bi * Mat34Soa4::k_width;
+				const uint32_t lane_count = std::min(Mat34Soa4::k_width, count - base);
+
+				const Mat34F4 world = (has_parent) ? MulMat34F4(parent, LoadMat34F4(transform[bi])) : LoadMat34F4(transform[bi]);
+				if (out_world)
+				{
+					uint8_t* p = out_world + world_stride * base;
+					store_row(p, world_stride, lane_count, 0, world.e[0][0], world.e[0][1], world.e[0][2], world.e[0][3]);
+					store_row(p, world_stride, lane_count, 16, world.e[1][0], world.e[1][1], world.e[1][2], world.e[1][3]);
+					store_row(p, world_stride, lane_count, 32, world.e[2][0], world.e[2][1], world.e[2][2], world.e[2][3]);
+				}
+				if (out_cofactor)
+				{
+					F4 c[3][3];
+					Cofactor33F4(c, world);
+					// Mat44(Mat33)と同様に4列目と4行目は0.
+					uint8_t* p = out_cofactor + cofactor_stride * base;
+					store_row(p, cofactor_stride, lane_count, 0, c[0][0], c[0][1], c[0][2], zero);
+					store_row(p, cofactor_stride, lane_count, 16, c[1][0], c[1][1], c[1][2], zero);
+					store_row(p, cofactor_stride, lane_count, 32, c[2][0], c[2][1], c[2][2], zero);
+					store_row(p, cofactor_stride, lane_count, 48, zero, zero, zero, zero);
+				}
+				if (has_world_prev)
+				{
+					const Mat34F4 world_prev = (has_parent_prev) ? MulMat34F4(parent_prev, LoadMat34F4(transform_prev[bi])) : LoadMat34F4(transform_prev[bi]);
+					uint8_t* p = out_world_prev + world_prev_stride * base;
+					store_row(p, world_prev_stride, lane_count, 0, world_prev.e[0][0], world_prev.e[0][1], world_prev.e[0][2], world_prev.e[0][3]);
+					store_row(p, world_prev_stride, lane_count, 16, world_prev.e[1][0], world_prev.e[1][1], world_prev.e[1][2], world_prev.e[1][3]);
+					store_row(p, world_prev_stride, lane_count, 32, world_prev.e[2][0], world_prev.e[2][1], world_prev.e[2][2], world_prev.e[2][3]);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,78 @@
+﻿#pragma once
+
+/*
+	インスタンスのトランスフォームの一括計算.
+
+	数千から数十万のインスタンスのMat34から, 描画用のワールド行列, 法線変換用の余因子行列, 前フレームのワールド行列をまとめて計算する.
+		入力は4インスタンス単位で要素毎に並べたMat34Soa4(AoSoA)の配列. 各要素がそのままSIMDの4レーンになり, 転置やシャッフル無しで計算できる.
+		出力はインスタンス毎の構造体(InstanceInfo等)の配列を想定したストライド指定で, Mapしたアップロードバッファへ直接書き込める.
+			書き込みは16byte単位の連続したストアのみで, 出力先を読み込まないため書き込み結合メモリでも遅くならない.
+
+	std::vector<math::Mat34Soa4> soa(math::Mat34Soa4::BlockCount(count));
+	math::PackMat34Soa4(soa.data(), transform_array, count);
+
+	math::InstanceTransformBatchOutput out = {};
+	out.world = &mapped->mtx;
+	out.world_stride = sizeof(InstanceInfo);
+	out.cofactor = &mapped->mtx_cofactor;
+	out.cofactor_stride = sizeof(InstanceInfo);
+	math::CalcInstanceTransformBatch(out, soa.data(), nullptr, count);
+*/
+
+#include <cstdint>
+
+#include "math.h"
+
+namespace ngl
+{
+	namespace math
+	{
+		// 4インスタンス分のMat34. e[row][column][instance].
+		struct alignas(16) Mat34Soa4
+		{
+			static constexpr uint32_t k_width = 4;
+
+			float	e[3][4][k_width];
+
+			// count個のインスタンスに必要なブロック数.
+			static constexpr uint32_t BlockCount(uint32_t count)
+			{
+				return (count + k_width - 1) / k_width;
+			}
+
+			void Set(uint32_t lane, const Mat34& m);
+			Mat34 Get(uint32_t lane) const;
+		};
+
+		// 配列の index 番目のインスタンスを設定する.
+		inline void SetMat34Soa4(Mat34Soa4* blocks, uint32_t index, const Mat34& m)
+		{
+			blocks[index / Mat34Soa4::k_width].Set(index % Mat34Soa4::k_width, m);
+		}
+		// Mat34配列をMat34Soa4配列に変換する. 最後のブロックの余りは単位行列で埋める.
+		void PackMat34Soa4(Mat34Soa4* out, const Mat34* in, uint32_t count);
+		// Mat34のポインタ配列から変換する. Componentのメンバ等, 連続していないMat34を集める.
+		void PackMat34Soa4(Mat34Soa4* out, const Mat34* const* in, uint32_t count);
+		// Mat34Soa4配列をMat34配列に戻す.
+		void UnpackMat34Soa4(Mat34* out, const Mat34Soa4* in, uint32_t count);
+
+		// CalcInstanceTransformBatch の出力先. nullptrの出力はスキップする.
+		//	strideはインスタンス毎のbyte数.
+		struct InstanceTransformBatchOutput
+		{
+			void*		world = nullptr;		// Mat34. parent * transform.
+			uint32_t	world_stride = sizeof(Mat34);
+			void*		cofactor = nullptr;		// Mat44. ワールド行列の3x3部分の余因子行列. Mat44(Mat33::Cofactor())と同じ配置.
+			uint32_t	cofactor_stride = sizeof(Mat44);
+			void*		world_prev = nullptr;	// Mat34. parent_prev * transform_prev.
+			uint32_t	world_prev_stride = sizeof(Mat34);
+
+			const Mat34*	parent = nullptr;		// 全インスタンスに共通の親. nullptrは単位行列.
+			const Mat34*	parent_prev = nullptr;	// 前フレームの親. nullptrは単位行列.
+		};
+
+		// count個のインスタンスのトランスフォームを一括計算する.
+		//	transform, transform_prev は Mat34Soa4::BlockCount(count) 個. transform_prevがnullptrの場合は world_prev を出力しない.
+		void CalcInstanceTransformBatch(const InstanceTransformBatchOutput& out, const Mat34Soa4* transform, const Mat34Soa4* transform_prev, uint32_t count);
+	}
+}
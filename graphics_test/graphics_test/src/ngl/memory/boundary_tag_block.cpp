@@ -3,6 +3,74 @@
 
 namespace ngl
 {
+#if defined(NGL_TLSF_COMPACT_BOUNDARY_TAG)
+
+	// 指定されたメモリにBoundaryTagオブジェクトを配置して未使用状態で初期化しそのポインタとして返す
+	BoundaryTagBlock* BoundaryTagBlock::Placement(void* placement_memory, u32 data_size, u32 offset)
+	{
+		u8* m = reinterpret_cast<u8*>(placement_memory);
+
+		// 直前ブロックのサイズを維持するためコンストラクタは通さない
+		BoundaryTagBlock* obj = reinterpret_cast<BoundaryTagBlock*>(m + offset);
+		obj->size_word_ = data_size + GetAppendInfoDataSize();
+
+		FreeLink* link = obj->GetFreeLink();
+		link->prev = link->next = nullptr;
+		return obj;
+	}
+
+	// 渡されたオブジェクトを自身の後ろに追加する
+	BoundaryTagBlock* BoundaryTagBlock::InsertNext(BoundaryTagBlock* new_object)
+	{
+		FreeLink* link = GetFreeLink();
+		FreeLink* new_link = new_object->GetFreeLink();
+		new_link->next = link->next;
+		new_link->prev = this;
+		if (nullptr != link->next)
+			link->next->GetFreeLink()->prev = new_object;
+		link->next = new_object;
+		return this;
+	}
+	// 渡されたオブジェクトを自身の前に追加する
+	BoundaryTagBlock* BoundaryTagBlock::InsertPrev(BoundaryTagBlock* new_object)
+	{
+		FreeLink* link = GetFreeLink();
+		FreeLink* new_link = new_object->GetFreeLink();
+		new_link->next = this;
+		new_link->prev = link->prev;
+		if (nullptr != link->prev)
+			link->prev->GetFreeLink()->next = new_object;
+		link->prev = new_object;
+		return this;
+	}
+	// リストから離脱
+	BoundaryTagBlock* BoundaryTagBlock::Remove()
+	{
+		FreeLink* link = GetFreeLink();
+		if (nullptr != link->next)
+			link->next->GetFreeLink()->prev = link->prev;
+		if (nullptr != link->prev)
+			link->prev->GetFreeLink()->next = link->next;
+		link->prev = link->next = nullptr;
+		return this;
+	}
+
+#else
+
+	// データ部のポインタからブロックを取得
+	BoundaryTagBlock* BoundaryTagBlock::FromDataPtr(void* data)
+	{
+		// アライメントのためにブロックの先頭のすぐ後にデータ部がない場合があるため, サイズタグから辿る
+		u8* data_head = reinterpret_cast<u8*>(data);
+
+		// 直前の4バイトにデータ部サイズがある
+		const u32 data_size = *reinterpret_cast<u32*>(data_head - sizeof(u32));
+		// データ部の先頭からデータ部サイズ分オフセットした位置にブロックサイズがある
+		const u32 block_size = *reinterpret_cast<u32*>(data_head + data_size);
+		// データサイズ + データサイズの後ろのブロックサイズ部u32 - ブロックサイズ でブロックの先頭が得られる
+		const s64 offset_to_block = s64(data_size) + GetTailTagSize() - s64(block_size);
+		return reinterpret_cast<BoundaryTagBlock*>(data_head + offset_to_block);
+	}
 
 	// 指定されたメモリにBoundaryTagオブジェクトを配置して初期化しそのポインタとして返す
 	BoundaryTagBlock* BoundaryTagBlock::Placement(void* placement_memory, u32 data_size, u32 offset)
@@ -119,4 +187,5 @@ namespace ngl
 	{
 		return prev_;
 	}
+#endif
 }
\ No newline at end of file
@@ -7,9 +7,138 @@
 #include "ngl/util/types.h"
 #include <new>
 
+/*
+	ブロック形式の選択
+		NGL_TLSF_COMPACT_BOUNDARY_TAG 定義時はコンパクト形式.
+			先頭タグは直前ブロックのサイズと, 自身のサイズ及び使用フラグを格納したワードのみの8byte.
+			フリーリスト用のリンクはフリーブロックのデータ部に格納するため, 使用中ブロックの管理情報は8byteとなる.
+		未定義時は従来形式.
+			先頭タグにデータ部へのポインタ, リスト用ポインタ, サイズタグへのポインタ, 使用フラグを持ち, 末尾にサイズタグを持つ.
+			使用中ブロックの管理情報は52byte.
+*/
+#define NGL_TLSF_COMPACT_BOUNDARY_TAG
+
 namespace ngl
 {
+#if defined(NGL_TLSF_COMPACT_BOUNDARY_TAG)
 
+	// コンパクト形式
+	//	ブロックの先頭はデータ部がALIGNMENTに揃うように配置され, ブロック全体サイズはALIGNMENTの倍数.
+	//	サイズワードの下位ビットは全体サイズがALIGNMENTの倍数であるため使用フラグとして利用する.
+	class BoundaryTagBlock
+	{
+	public:
+		// データ部
+		u8* GetDataPtr() const
+		{
+			return reinterpret_cast<u8*>(const_cast<BoundaryTagBlock*>(this)) + GetHeadTagSize();
+		}
+
+		// オブジェクトが占有する全サイズを取得
+		u32 GetAllSize() const
+		{
+			return size_word_ & ~SIZE_WORD_FLAG_MASK;
+		}
+
+		// データ部のサイズ
+		u32 GetDataSize() const
+		{
+			return GetAllSize() - GetAppendInfoDataSize();
+		}
+
+		// メモリ管理用に付加するデータのサイズ　データ部のサイズ以外に必要な部分のサイズ
+		static inline u32 GetAppendInfoDataSize()
+		{
+			return GetHeadTagSize() + GetTailTagSize();
+		}
+
+		// データ部の保証アライメント
+		static constexpr u32 ALIGNMENT = 16;
+
+		// メモリ管理用の先頭タグサイズ
+		static inline u32 GetHeadTagSize()
+		{
+			return sizeof(u32) * 2;
+		}
+		// メモリ管理用の末端タグサイズ. コンパクト形式では末尾タグを持たない.
+		static inline u32 GetTailTagSize()
+		{
+			return 0;
+		}
+		// データ部の最小サイズ. フリーブロックのデータ部にリンクを格納するため.
+		static inline u32 GetMinDataSize()
+		{
+			return sizeof(FreeLink);
+		}
+
+		void SetIsUsed(bool f)
+		{
+			size_word_ = f ? (size_word_ | SIZE_WORD_USED_BIT) : (size_word_ & ~SIZE_WORD_USED_BIT);
+		}
+		bool IsUsed() const
+		{
+			return 0 != (size_word_ & SIZE_WORD_USED_BIT);
+		}
+
+		// 渡されたオブジェクトを自身の後ろに追加する
+		BoundaryTagBlock* InsertNext(BoundaryTagBlock* new_object);
+		// 渡されたオブジェクトを自身の前に追加する
+		BoundaryTagBlock* InsertPrev(BoundaryTagBlock* new_object);
+		// リストから離脱
+		BoundaryTagBlock* Remove();
+
+		BoundaryTagBlock* GetNext() const { return GetFreeLink()->next; }
+		BoundaryTagBlock* GetPrev() const { return GetFreeLink()->prev; }
+
+		// 物理的に直前のブロック. 管理領域先頭のダミータグに対しては無効.
+		BoundaryTagBlock* GetPrevPhysicalBlock() const
+		{
+			return reinterpret_cast<BoundaryTagBlock*>(reinterpret_cast<u8*>(const_cast<BoundaryTagBlock*>(this)) - prev_all_size_);
+		}
+		// 物理的に直後のブロック. 管理領域末尾のダミータグに対しては無効.
+		BoundaryTagBlock* GetNextPhysicalBlock() const
+		{
+			return reinterpret_cast<BoundaryTagBlock*>(reinterpret_cast<u8*>(const_cast<BoundaryTagBlock*>(this)) + GetAllSize());
+		}
+		// 物理的に直後のブロックへ自身のサイズを設定する. サイズを変更した場合に呼び出す.
+		void LinkPhysicalNext()
+		{
+			GetNextPhysicalBlock()->prev_all_size_ = GetAllSize();
+		}
+
+		// データ部のポインタからブロックを取得
+		static BoundaryTagBlock* FromDataPtr(void* data)
+		{
+			return reinterpret_cast<BoundaryTagBlock*>(reinterpret_cast<u8*>(data) - GetHeadTagSize());
+		}
+
+		// 指定されたメモリにBoundaryTagオブジェクトを配置して未使用状態で初期化しそのポインタとして返す
+		//	直前ブロックのサイズは書き換えないため, ブロックの先頭位置が変わらない分割やマージではそのまま維持される.
+		static BoundaryTagBlock* Placement(void* placement_memory, u32 dataSize, u32 offset = 0);
+
+	private:
+		static constexpr u32 SIZE_WORD_USED_BIT = 0x1;
+		static constexpr u32 SIZE_WORD_FLAG_MASK = ALIGNMENT - 1;
+
+		// フリーブロックのデータ部に配置するリンク
+		struct FreeLink
+		{
+			BoundaryTagBlock* prev;
+			BoundaryTagBlock* next;
+		};
+		FreeLink* GetFreeLink() const
+		{
+			return reinterpret_cast<FreeLink*>(GetDataPtr());
+		}
+
+		u32		prev_all_size_;	// 物理的に直前のブロックの全体サイズ
+		u32		size_word_;		// 全体サイズと使用フラグ
+	};
+	static_assert(sizeof(BoundaryTagBlock) == sizeof(u32) * 2, "");
+
+#else
+
+	// 従来形式
 	class BoundaryTagBlock
 	{
 	public:
@@ -40,10 +169,15 @@ namespace ngl
 			return GetHeadTagSize() + GetTailTagSize();
 		}
 
+		// ブロック先頭とデータ部の保証アライメント
+		//	先頭タグサイズをこの倍数とし, ブロックサイズもこの倍数で扱うことでデータ部のアライメントを保証する.
+		static constexpr u32 ALIGNMENT = 16;
+
 		// メモリ管理用の先頭タグサイズ
 		static inline u32 GetHeadTagSize()
 		{
-			return sizeof(BoundaryTagBlock)+sizeof(u32); // サイズ部もずらした
+			// サイズ部もずらした. データ部がALIGNMENTに揃うように切り上げる.
+			return (sizeof(BoundaryTagBlock) + sizeof(u32) + (ALIGNMENT - 1)) & ~(ALIGNMENT - 1);
 		}
 		// メモリ管理用の末端タグサイズ
 		static inline u32 GetTailTagSize()
@@ -64,6 +198,31 @@ namespace ngl
 		BoundaryTagBlock* GetNext() const;
 		BoundaryTagBlock* GetPrev() const;
 
+		// データ部の最小サイズ
+		static inline u32 GetMinDataSize()
+		{
+			return 0;
+		}
+
+		// 物理的に直前のブロック. 直前ブロックの末尾タグから求める.
+		BoundaryTagBlock* GetPrevPhysicalBlock() const
+		{
+			const u8* head = reinterpret_cast<const u8*>(this);
+			return reinterpret_cast<BoundaryTagBlock*>(const_cast<u8*>(head - *reinterpret_cast<const u32*>(head - sizeof(u32))));
+		}
+		// 物理的に直後のブロック
+		BoundaryTagBlock* GetNextPhysicalBlock() const
+		{
+			return reinterpret_cast<BoundaryTagBlock*>(reinterpret_cast<u8*>(const_cast<BoundaryTagBlock*>(this)) + GetAllSize());
+		}
+		// 従来形式は末尾タグで直前ブロックを辿るため何もしない.
+		void LinkPhysicalNext()
+		{
+		}
+
+		// データ部のポインタからブロックを取得
+		static BoundaryTagBlock* FromDataPtr(void* data);
+
 		// 指定されたメモリにBoundaryTagオブジェクトを配置して初期化しそのポインタとして返す
 		static BoundaryTagBlock* Placement(void* placement_memory, u32 dataSize, u32 offset = 0);
 
@@ -78,6 +237,8 @@ namespace ngl
 		// 使用フラグ
 		u8		is_used_ = 0;
 	};
+
+#endif
 }
 
 #endif // _NGL_BOUNDARY_TAG_BLOCK_
\ No newline at end of file
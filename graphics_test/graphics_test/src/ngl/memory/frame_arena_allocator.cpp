@@ -0,0 +1,259 @@
+﻿#include "ngl/memory/frame_arena_allocator.h"
+
+#include <assert.h>
+
+namespace ngl
+{
+	namespace memory
+	{
+		namespace
+		{
+			// Initialize毎に一意な値を発行する.
+			std::atomic<u64> s_serial_counter = 0;
+
+			// スレッド毎に直前に利用したアロケータとサブアリーナのインデックスを覚えておき, 通常はロック無しで引く.
+			struct ThreadArenaEntry
+			{
+				const void*	allocator = nullptr;
+				u64			serial = 0;
+				u32			index = 0;
+			};
+			thread_local ThreadArenaEntry tls_thread_arena_entry = {};
+
+			u64 AlignUp(u64 v, u64 alignment)
+			{
+				return (v + (alignment - 1)) & ~(alignment - 1);
+			}
+		}
+
+		FrameArenaAllocator::FrameArenaAllocator()
+		{
+		}
+		FrameArenaAllocator::~FrameArenaAllocator()
+		{
+			Destroy();
+		}
+
+		bool FrameArenaAllocator::Initialize(const Desc& desc)
+		{
+			if (is_initialized_)
+			{
+				// 前回のInitialize()からDestroy()される前に再度Initializeしようとした
+				return false;
+			}
+			if (0 == desc.buffer_count || 0 == desc.page_size)
+				return false;
+
+			desc_ = desc;
+			desc_.page_size = AlignUp(desc_.page_size, k_default_alignment);
+			sub_arena_.reset(new SubArena[desc_.buffer_count * (k_max_thread_arena + 1)]);
+			buffer_index_ = 0;
+			serial_ = ++s_serial_counter;
+
+			is_initialized_ = true;
+			return true;
+		}
+
+		void FrameArenaAllocator::Destroy()
+		{
+			if (sub_arena_)
+			{
+				for (u32 i = 0; i < desc_.buffer_count * (k_max_thread_arena + 1); ++i)
+				{
+					ReleaseSubArena(&sub_arena_[i]);
+				}
+				sub_arena_.reset();
+			}
+
+			for (auto& e : thread_id_)
+				e = {};
+			thread_arena_count_ = 0;
+			buffer_index_ = 0;
+			serial_ = 0;
+			reserved_size_ = 0;
+			is_initialized_ = false;
+		}
+
+		void FrameArenaAllocator::ReadyToNewFrame(u32 buffer_index)
+		{
+			if (!is_initialized_)
+				return;
+			assert(desc_.buffer_count > buffer_index);
+
+			buffer_index_ = buffer_index % desc_.buffer_count;
+			for (u32 i = 0; i < k_max_thread_arena + 1; ++i)
+			{
+				ResetSubArena(GetSubArena(buffer_index_, i));
+			}
+		}
+
+		void* FrameArenaAllocator::Allocate(u64 size, u32 alignment)
+		{
+			if (!is_initialized_ || 0 == size)
+				return nullptr;
+			// 2の冪乗のみ
+			if (0 == alignment || 0 != (alignment & (alignment - 1)))
+				return nullptr;
+
+			const u32 arena_index = GetThreadArenaIndex();
+			if (k_max_thread_arena > arena_index)
+			{
+				return AllocateFromSubArena(GetSubArena(buffer_index_, arena_index), size, alignment);
+			}
+
+			// サブアリーナを割り当てられなかったスレッドは共有のサブアリーナから確保.
+			std::unique_lock<std::mutex> lock(shared_arena_mutex_);
+			return AllocateFromSubArena(GetSubArena(buffer_index_, k_max_thread_arena), size, alignment);
+		}
+
+		u64 FrameArenaAllocator::GetFrameAllocatedSize() const
+		{
+			if (!is_initialized_)
+				return 0;
+			u64 size = 0;
+			for (u32 i = 0; i < k_max_thread_arena + 1; ++i)
+			{
+				size += sub_arena_[buffer_index_ * (k_max_thread_arena + 1) + i].allocated_size.load(std::memory_order_relaxed);
+			}
+			return size;
+		}
+
+		u32 FrameArenaAllocator::GetThreadArenaIndex()
+		{
+			const ThreadArenaEntry& entry = tls_thread_arena_entry;
+			if (entry.allocator == this && entry.serial == serial_)
+			{
+				return entry.index;
+			}
+			return RegisterThreadArena();
+		}
+		u32 FrameArenaAllocator::RegisterThreadArena()
+		{
+			const std::thread::id thread_id = std::this_thread::get_id();
+			u32 index = k_max_thread_arena;
+			{
+				std::unique_lock<std::mutex> lock(registry_mutex_);
+
+				// 別のアロケータを挟んで利用していた場合は割り当て済み.
+				const u32 arena_count = thread_arena_count_.load(std::memory_order_relaxed);
+				for (u32 i = 0; i < arena_count; ++i)
+				{
+					if (thread_id_[i] == thread_id)
+					{
+						index = i;
+						break;
+					}
+				}
+				if (k_max_thread_arena == index && k_max_thread_arena > arena_count)
+				{
+					index = arena_count;
+					thread_id_[index] = thread_id;
+					thread_arena_count_.store(arena_count + 1, std::memory_order_relaxed);
+				}
+			}
+
+			// 割り当てられなかった場合も記録して再検索を避ける.
+			ThreadArenaEntry& entry = tls_thread_arena_entry;
+			entry.allocator = this;
+			entry.serial = serial_;
+			entry.index = index;
+			return index;
+		}
+
+		void* FrameArenaAllocator::AllocateFromSubArena(SubArena* arena, u64 size, u32 alignment)
+		{
+			for (;;)
+			{
+				// 確保中のページから順に, 収まるページを探す. リセット後は保持しているページを先頭から再利用する.
+				for (Page* page = arena->current; nullptr != page; page = page->next)
+				{
+					u8* data = reinterpret_cast<u8*>(page) + k_page_header_size;
+					const u64 head = AlignUp(reinterpret_cast<u64>(data) + page->used, alignment) - reinterpret_cast<u64>(data);
+					if (head + size <= page->capacity)
+					{
+						page->used = head + size;
+						arena->current = page;
+						// 所有スレッドのみが書き込むためロック命令を避ける.
+						arena->allocated_size.store(arena->allocated_size.load(std::memory_order_relaxed) + size, std::memory_order_relaxed);
+						return data + head;
+					}
+				}
+
+				// 収まるページが無ければ末尾に追加して再試行.
+				const u64 require_size = AlignUp(size + ((k_default_alignment < alignment) ? alignment : 0), k_default_alignment);
+				Page* page = NewPage((desc_.page_size < require_size) ? require_size : desc_.page_size);
+				if (nullptr == page)
+					return nullptr;
+				if (nullptr != arena->page_tail)
+					arena->page_tail->next = page;
+				else
+					arena->page_list = page;
+				arena->page_tail = page;
+
+				// 大きな要求用のページは確保中のページを変えずに末尾に追加し, 確保中のページの残りを無駄にしない.
+				// 再試行時は確保中のページから末尾まで辿るため追加したページが見つかる.
+				if (desc_.page_size >= require_size || nullptr == arena->current)
+					arena->current = page;
+			}
+		}
+
+		void FrameArenaAllocator::ResetSubArena(SubArena* arena)
+		{
+			Page* prev = nullptr;
+			for (Page* page = arena->page_list; nullptr != page;)
+			{
+				Page* next = page->next;
+				if (desc_.page_size < page->capacity)
+				{
+					// 大きな要求用のページは保持しない.
+					if (nullptr != prev)
+						prev->next = next;
+					else
+						arena->page_list = next;
+					DeletePage(page);
+				}
+				else
+				{
+					page->used = 0;
+					prev = page;
+				}
+				page = next;
+			}
+			arena->page_tail = prev;
+			arena->current = arena->page_list;
+			arena->allocated_size.store(0, std::memory_order_relaxed);
+		}
+
+		void FrameArenaAllocator::ReleaseSubArena(SubArena* arena)
+		{
+			for (Page* page = arena->page_list; nullptr != page;)
+			{
+				Page* next = page->next;
+				DeletePage(page);
+				page = next;
+			}
+			arena->page_list = nullptr;
+			arena->page_tail = nullptr;
+			arena->current = nullptr;
+			arena->allocated_size.store(0, std::memory_order_relaxed);
+		}
+
+		FrameArenaAllocator::Page* FrameArenaAllocator::NewPage(u64 capacity)
+		{
+			u8* mem = new(std::nothrow) u8[k_page_header_size + capacity];
+			if (nullptr == mem)
+				return nullptr;
+			Page* page = new(mem) Page();
+			page->next = nullptr;
+			page->capacity = capacity;
+			page->used = 0;
+			reserved_size_.fetch_add(k_page_header_size + capacity, std::memory_order_relaxed);
+			return page;
+		}
+		void FrameArenaAllocator::DeletePage(Page* page)
+		{
+			reserved_size_.fetch_sub(k_page_header_size + page->capacity, std::memory_order_relaxed);
+			delete[] reinterpret_cast<u8*>(page);
+		}
+	}
+}
@@ -0,0 +1,211 @@
+﻿#pragma once
+#ifndef _NGL_MEMORY_FRAME_ARENA_ALLOCATOR_
+#define _NGL_MEMORY_FRAME_ARENA_ALLOCATOR_
+
+/*
+	フレーム単位のアリーナアロケータ
+		バンプポインタで確保するだけで個別の解放はしない. ReadyToNewFrame で確保したメモリをまとめて破棄する.
+		フレームを跨いで参照できるようにバッファリング数分のアリーナを持ち, ReadyToNewFrame で指定したバッファのアリーナをリセットして再利用する.
+		スレッド毎にサブアリーナを割り当てるため, Job Worker等の複数スレッドから確保してもロック競合しない.
+		ページはリセット後も保持して次の利用時に再利用する.
+
+	ngl::memory::FrameArenaAllocator arena;
+	ngl::memory::FrameArenaAllocator::Desc desc = {};
+	desc.buffer_count = 3;
+	arena.Initialize(desc);
+
+	// フレーム開始時.
+	arena.ReadyToNewFrame(buffer_index);
+
+	// 任意のスレッドから.
+	Vec3* p = arena.AllocateArray<Vec3>(128);
+	auto v = ngl::memory::MakeFrameArenaVector<int>(&arena);
+	v.push_back(1);
+*/
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <array>
+#include <vector>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+#include "ngl/util/types.h"
+
+namespace ngl
+{
+	namespace memory
+	{
+		class FrameArenaAllocator
+		{
+		public:
+			struct Desc
+			{
+				// バッファリング数. ReadyToNewFrameで指定するバッファインデックスはこれ未満.
+				u32		buffer_count = 3;
+				// サブアリーナ毎に確保するページサイズ. これより大きな要求はその要求サイズのページを確保し, リセット時に解放する.
+				u64		page_size = 1024 * 1024;
+			};
+
+			// サブアリーナを割り当て可能なスレッド数. これを超えたスレッドは共有のサブアリーナをロックして利用する.
+			static constexpr u32 k_max_thread_arena = 64;
+			// Allocateの標準アライメント
+			static constexpr u32 k_default_alignment = 16;
+
+			FrameArenaAllocator();
+			~FrameArenaAllocator();
+
+			bool Initialize(const Desc& desc);
+			// 全スレッドがアロケータを利用していない状態で呼ぶこと.
+			void Destroy();
+
+			// フレーム開始時に呼び出す. 以降の確保は buffer_index のアリーナから行う.
+			// buffer_index のアリーナで以前確保したメモリは全て無効になる.
+			// 全スレッドがアロケータを利用していない状態で呼ぶこと.
+			void ReadyToNewFrame(u32 buffer_index);
+
+			// 任意のスレッドから呼び出し可能. alignment は2の冪乗.
+			void* Allocate(u64 size, u32 alignment = k_default_alignment);
+
+			// 未初期化の配列を確保
+			template<typename T>
+			T* AllocateArray(u64 count)
+			{
+				return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+			}
+			// オブジェクトを生成. リセット時にデストラクタは呼ばれないため, トリビアルに破棄可能な型のみ.
+			template<typename T, typename... Args>
+			T* New(Args&&... args)
+			{
+				static_assert(std::is_trivially_destructible<T>::value, "FrameArenaAllocator does not call destructor.");
+				void* mem = Allocate(sizeof(T), alignof(T));
+				return (nullptr != mem) ? new(mem) T(std::forward<Args>(args)...) : nullptr;
+			}
+
+			// 現在のバッファで確保したサイズの合計. 取得中にも更新されるため概算.
+			u64 GetFrameAllocatedSize() const;
+			// 全ページの合計サイズ
+			u64 GetReservedSize() const { return reserved_size_.load(std::memory_order_relaxed); }
+			// サブアリーナを割り当てられたスレッド数
+			u32 GetThreadArenaCount() const { return thread_arena_count_.load(std::memory_order_relaxed); }
+
+		private:
+			// ページ. 確保したメモリの先頭に配置する.
+			struct Page
+			{
+				Page*	next;
+				u64		capacity;	// データ部のサイズ
+				u64		used;
+			};
+			static constexpr u64 k_page_header_size = (sizeof(Page) + (k_default_alignment - 1)) & ~u64(k_default_alignment - 1);
+
+			// サブアリーナ. 他スレッドとの偽共有を避けるためキャッシュライン境界に揃える.
+			struct alignas(64) SubArena
+			{
+				Page*	page_list = nullptr;
+				Page*	page_tail = nullptr;
+				// 確保中のページ. これより前のページは使い切っている.
+				Page*	current = nullptr;
+				std::atomic<u64>	allocated_size = 0;
+			};
+
+			// 呼び出しスレッドのサブアリーナのインデックス. 割り当てられなければk_max_thread_arena.
+			u32 GetThreadArenaIndex();
+			u32 RegisterThreadArena();
+
+			SubArena* GetSubArena(u32 buffer_index, u32 arena_index)
+			{
+				return &sub_arena_[buffer_index * (k_max_thread_arena + 1) + arena_index];
+			}
+
+			void* AllocateFromSubArena(SubArena* arena, u64 size, u32 alignment);
+			// サブアリーナのページを未使用状態に戻す. 大きな要求用のページは解放する.
+			void ResetSubArena(SubArena* arena);
+			// サブアリーナの全ページを解放する.
+			void ReleaseSubArena(SubArena* arena);
+
+			Page* NewPage(u64 capacity);
+			void DeletePage(Page* page);
+
+		private:
+			Desc					desc_ = {};
+			u32						buffer_index_ = 0;
+
+			// [buffer_count][k_max_thread_arena + 1]. 末尾は共有のサブアリーナ.
+			std::unique_ptr<SubArena[]>	sub_arena_;
+			std::mutex				shared_arena_mutex_;
+
+			// スレッドへのサブアリーナの割り当て用.
+			std::mutex				registry_mutex_;
+			std::atomic<u32>		thread_arena_count_ = 0;
+			std::array<std::thread::id, k_max_thread_arena> thread_id_{};
+
+			// Initialize毎に一意な値. スレッドローカルのインデックス参照の有効性判定に利用.
+			u64						serial_ = 0;
+
+			std::atomic<u64>		reserved_size_ = 0;
+			bool					is_initialized_ = false;
+		};
+
+
+		// STLコンテナ用アロケータ
+		//	解放は何もしないため, コンテナの再確保で不要になった領域もフレーム終了まで保持される.
+		//	要素数の見積もりが可能な場合はreserveすること.
+		template<typename T>
+		struct FrameArenaStlAllocator
+		{
+			typedef T value_type;
+
+			FrameArenaStlAllocator(FrameArenaAllocator* arena) noexcept
+				: arena_(arena)
+			{
+			}
+			template<typename U>
+			FrameArenaStlAllocator(const FrameArenaStlAllocator<U>& other) noexcept
+				: arena_(other.GetArena())
+			{
+			}
+
+			T* allocate(size_t num_to_allocate)
+			{
+				void* mem = arena_->Allocate(sizeof(T) * num_to_allocate, alignof(T));
+				if (nullptr == mem)
+					throw std::bad_alloc();
+				return static_cast<T*>(mem);
+			}
+			void deallocate(T*, size_t) noexcept
+			{
+			}
+
+			FrameArenaAllocator* GetArena() const { return arena_; }
+
+			template<typename U>
+			bool operator==(const FrameArenaStlAllocator<U>& other) const
+			{
+				return arena_ == other.GetArena();
+			}
+			template<typename U>
+			bool operator!=(const FrameArenaStlAllocator<U>& other) const
+			{
+				return !(*this == other);
+			}
+
+		private:
+			FrameArenaAllocator*	arena_ = nullptr;
+		};
+
+		template<typename T>
+		using FrameArenaVector = std::vector<T, FrameArenaStlAllocator<T>>;
+
+		// 空のFrameArenaVectorを生成
+		template<typename T>
+		inline FrameArenaVector<T> MakeFrameArenaVector(FrameArenaAllocator* arena)
+		{
+			return FrameArenaVector<T>(FrameArenaStlAllocator<T>(arena));
+		}
+	}
+}
+
+#endif // _NGL_MEMORY_FRAME_ARENA_ALLOCATOR_
@@ -0,0 +1,178 @@
+﻿
+#include "frame_arena_allocator_test.h"
+
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <cstring>
+
+#include <assert.h>
+
+namespace ngl
+{
+namespace memory
+{
+namespace test
+{
+	namespace
+	{
+		using Clock = std::chrono::steady_clock;
+
+		constexpr u32 k_buffer_count = 3;
+		constexpr int k_frame_count = 60;
+		constexpr int k_alloc_per_frame = 20000;
+
+		struct FrameRecord
+		{
+			u8*		ptr;
+			u32		size;
+			u8		value;
+		};
+
+		// 1フレーム分の確保. 各確保に値を書き込み, 後のフレームで壊されていないか検証する.
+		void FrameWorker(FrameArenaAllocator* arena, int thread_index, int frame, std::vector<FrameRecord>* out_record, std::atomic<u64>* fail_count)
+		{
+			u32 rand_state = 0x9e3779b9u * (thread_index + 1) + frame;
+			out_record->clear();
+			for (int i = 0; i < k_alloc_per_frame; ++i)
+			{
+				rand_state = rand_state * 1664525u + 1013904223u;
+				const u32 size = 8 + ((rand_state >> 8) % 256);
+				const u32 alignment = 1u << ((rand_state >> 20) % 8);
+				u8* p = reinterpret_cast<u8*>(arena->Allocate(size, alignment));
+				if (nullptr == p || 0 != (reinterpret_cast<u64>(p) & (alignment - 1)))
+				{
+					fail_count->fetch_add(1);
+					continue;
+				}
+				const u8 value = static_cast<u8>(thread_index * 31 + frame);
+				memset(p, value, size);
+				out_record->push_back({ p, size, value });
+			}
+		}
+
+		bool VerifyRecord(const std::vector<FrameRecord>& record)
+		{
+			for (const auto& e : record)
+			{
+				for (u32 i = 0; i < e.size; ++i)
+				{
+					if (e.ptr[i] != e.value)
+						return false;
+				}
+			}
+			return true;
+		}
+
+		// 一時配列の構築コストの比較. vector_per_frame 毎にフレームを進める.
+		template<typename VectorT>
+		double BuildTransientVectors(VectorT make_vector(), void new_frame(), int vector_count, int vector_per_frame)
+		{
+			const auto t0 = Clock::now();
+			u64 sum = 0;
+			for (int i = 0; i < vector_count; ++i)
+			{
+				if (0 == (i % vector_per_frame))
+					new_frame();
+				auto v = make_vector();
+				for (int k = 0; k < 64; ++k)
+					v.push_back(k);
+				sum += v.back();
+			}
+			const auto t1 = Clock::now();
+			assert(0 < sum);
+			return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()) / vector_count;
+		}
+
+		FrameArenaAllocator* s_bench_arena = nullptr;
+		std::vector<int> MakeHeapVector()
+		{
+			return std::vector<int>();
+		}
+		FrameArenaVector<int> MakeArenaVector()
+		{
+			return MakeFrameArenaVector<int>(s_bench_arena);
+		}
+		void NewFrameHeap()
+		{
+		}
+		void NewFrameArena()
+		{
+			s_bench_arena->ReadyToNewFrame(0);
+		}
+	}
+
+	void FrameArenaAllocatorTest()
+	{
+		std::cout << "[FrameArenaAllocatorTest]" << std::endl;
+
+		FrameArenaAllocator arena;
+		FrameArenaAllocator::Desc desc = {};
+		desc.buffer_count = k_buffer_count;
+		desc.page_size = 256 * 1024;
+		if (!arena.Initialize(desc))
+		{
+			assert(false);
+			return;
+		}
+
+		const int thread_count = static_cast<int>(std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() : 2);
+		std::atomic<u64> fail_count = 0;
+		u64 corrupt_count = 0;
+
+		// [buffer][thread]. バッファがリセットされるまで内容が保持されていることを確認する.
+		std::vector<std::vector<std::vector<FrameRecord>>> record(k_buffer_count, std::vector<std::vector<FrameRecord>>(thread_count));
+
+		const auto t0 = Clock::now();
+		for (int frame = 0; frame < k_frame_count; ++frame)
+		{
+			const u32 buffer_index = frame % k_buffer_count;
+
+			// リセット直前に前回の内容を検証.
+			for (const auto& e : record[buffer_index])
+			{
+				if (!VerifyRecord(e))
+					++corrupt_count;
+			}
+			arena.ReadyToNewFrame(buffer_index);
+
+			std::vector<std::thread> threads;
+			for (int t = 0; t < thread_count; ++t)
+			{
+				threads.emplace_back(FrameWorker, &arena, t, frame, &record[buffer_index][t], &fail_count);
+			}
+			for (auto& t : threads)
+				t.join();
+		}
+		const auto t1 = Clock::now();
+
+		// 大きな要求.
+		void* large = arena.Allocate(desc.page_size * 4, 4096);
+		if (nullptr == large || 0 != (reinterpret_cast<u64>(large) & 4095))
+			fail_count.fetch_add(1);
+
+		const double frame_ms = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count()) / 1000.0 / k_frame_count;
+		std::cout << "	thread " << thread_count << "	: " << frame_ms << " ms/frame (including thread launch)"
+			<< "	thread arena " << arena.GetThreadArenaCount()
+			<< "	reserved " << (arena.GetReservedSize() / 1024) << " KB"
+			<< "	frame allocated " << (arena.GetFrameAllocatedSize() / 1024) << " KB"
+			<< std::endl;
+
+		// std::vectorの一時配列の構築.
+		s_bench_arena = &arena;
+		constexpr int k_vector_count = 100000;
+		constexpr int k_vector_per_frame = 1000;
+		const double heap_ns = BuildTransientVectors(MakeHeapVector, NewFrameHeap, k_vector_count, k_vector_per_frame);
+		const double arena_ns = BuildTransientVectors(MakeArenaVector, NewFrameArena, k_vector_count, k_vector_per_frame);
+		std::cout << "	transient vector	: new/delete " << heap_ns << " ns/vector	arena " << arena_ns << " ns/vector" << std::endl;
+		s_bench_arena = nullptr;
+
+		std::cout << "	fail count " << fail_count.load() << "	corrupt count " << corrupt_count << std::endl;
+
+		arena.Destroy();
+		std::cout << "Test End FrameArenaAllocatorTest" << std::endl;
+	}
+}
+}
+}
@@ -0,0 +1,17 @@
+﻿#pragma once
+
+#include "frame_arena_allocator.h"
+
+
+namespace ngl
+{
+namespace memory
+{
+namespace test
+{
+	// FrameArenaAllocatorのテスト.
+	// 複数スレッドからのフレーム毎の確保とバッファリングされたデータの保持を検証し, new/deleteとの比較を標準出力に出力する.
+	void FrameArenaAllocatorTest();
+}
+}
+}
@@ -47,7 +47,7 @@ namespace ngl
 
 			// 初期化
 			// 面倒なので現状では内部でヒープを確保して初期化
-			bool Initialize( u32 byteSize )
+			bool Initialize( u64 byteSize )
 			{
 				if (is_initialized_)
 				{
@@ -83,7 +83,7 @@ namespace ngl
 				tlsf_core_.Release();// ハンドル解放
 				if (nullptr != pool_memory_)
 				{
-					delete pool_memory_;
+					delete[] pool_memory_;
 					pool_memory_ = nullptr;
 				}
 				pool_size_ = 0;
@@ -95,6 +95,11 @@ namespace ngl
 			{
 				tlsf_core_->LeakReport();
 			}
+			// 使用状況レポート
+			void UsageReport() const
+			{
+				tlsf_core_->UsageReport();
+			}
 
 			TlsfAllocator()
 			{
@@ -144,7 +149,8 @@ namespace ngl
 
 			T * allocate(size_t num_to_allocate)
 			{
-				return static_cast<T*>(tlsf_core_->Allocate(sizeof(T)* num_to_allocate));
+				// 型のアライメントを満たすように確保する
+				return static_cast<T*>(tlsf_core_->AllocateAligned(sizeof(T)* num_to_allocate, alignof(T)));
 			}
 			void deallocate(T * ptr, size_t num_to_free)
 			{
@@ -179,7 +185,7 @@ namespace ngl
 
 
 			u8*					pool_memory_	= nullptr;
-			u32					pool_size_		= 0;
+			u64					pool_size_		= 0;
 			bool				is_initialized_ = false;
 			TlsfAllocatorCoreHandle tlsf_core_;
 		};
@@ -3,6 +3,11 @@
 #include "ngl/util/bit_operation.h"
 
 #include <iostream>
+#include <cstring>
+#include <new>
+#include <map>
+#include <string>
+#include <algorithm>
 #ifdef _DEBUG
 #include <assert.h>
 #endif
@@ -12,71 +17,221 @@ namespace ngl
 	namespace memory
 	{
 		TlsfAllocatorCore::TlsfAllocatorCore()
-			: head_(nullptr)
-			, size_(0)
-			, second_level_exponentiation_(0)
+			: second_level_exponentiation_(0)
+			, region_list_(nullptr)
+			, region_count_(0)
+			, total_region_size_(0)
 			, free_list_bit_fli_(0)
+			, used_size_(0)
+			, peak_used_size_(0)
+			, used_block_count_(0)
+			, free_size_(0)
+			, free_block_count_(0)
+			, allocate_count_(0)
+			, deallocate_count_(0)
+			, allocate_fail_count_(0)
+			, is_allocation_tag_enabled_(false)
 		{
 			memset(free_list_bit_sli_, 0x00, sizeof(free_list_bit_sli_));
 			memset(free_list_, 0x00, sizeof(free_list_));
+			memset(free_block_histogram_, 0x00, sizeof(free_block_histogram_));
 		}
 		TlsfAllocatorCore::~TlsfAllocatorCore()
 		{
 		}
 		bool TlsfAllocatorCore::Initialize(void* mem, u64 size, u32 second_level_exponentiation)
 		{
-			// 先頭・末尾・最初のフリーリスト要素　の3つ分の最低限必要なサイズを計算
-			u32 manageInfoDataSize = BoundaryTagBlock::GetAppendInfoDataSize() * 3;
-			// 第二レベルの分割数に応じた最小のデータ部サイズ
-
 			u32 sliExp = SECOND_LEVEL_INDEX_EXP_MAX < second_level_exponentiation
 				? SECOND_LEVEL_INDEX_EXP_MAX : second_level_exponentiation;
+			if (nullptr == mem || 0 >= sliExp)
+				return false;
 
-			u32 minDataSize = 1;
-			for (u32 i = 0; i < sliExp; ++i)
-				minDataSize *= 2;
+			Destroy();
+			second_level_exponentiation_ = sliExp;
 
-			u64 total_size_tmp = static_cast<u64>(manageInfoDataSize) + static_cast<u64>(minDataSize);
-			if (nullptr == mem || total_size_tmp > size || 0 >= sliExp)
+			if (!AddRegion(mem, size))
+			{
+				Destroy();
 				return false;
-			head_ = mem;
-			size_ = size;
-			second_level_exponentiation_ = sliExp;
+			}
+			return true;
+		}
+		// 解放
+		//		特に削除処理はしないが管理用情報などをクリア
+		void TlsfAllocatorCore::Destroy()
+		{
+			region_list_ = nullptr;
+			region_count_ = 0;
+			total_region_size_ = 0;
+			second_level_exponentiation_ = 0;
+			free_list_bit_fli_ = 0;
+			memset(free_list_bit_sli_, 0x00, sizeof(free_list_bit_sli_));
+			memset(free_list_, 0x00, sizeof(free_list_));
+
+			used_size_ = 0;
+			peak_used_size_ = 0;
+			used_block_count_ = 0;
+			free_size_ = 0;
+			free_block_count_ = 0;
+			allocate_count_ = 0;
+			deallocate_count_ = 0;
+			allocate_fail_count_ = 0;
+			memset(free_block_histogram_, 0x00, sizeof(free_block_histogram_));
+			allocation_tag_.clear();
+		}
+
+		// ALIGNMENT境界からブロック先頭までのずれ. データ部がALIGNMENTに揃うようにブロック先頭を配置する.
+		u32 TlsfAllocatorCore::GetBlockHeadPhase()
+		{
+			return RoundUpAlignment(BoundaryTagBlock::GetHeadTagSize()) - BoundaryTagBlock::GetHeadTagSize();
+		}
+		// 管理領域の先頭と末尾のダミータグのデータ部サイズ. タグ全体をALIGNMENTの倍数にするためのパディング.
+		u32 TlsfAllocatorCore::GetRegionTagDataSize()
+		{
+			return RoundUpAlignment(BoundaryTagBlock::GetAppendInfoDataSize() + BoundaryTagBlock::GetMinDataSize()) - BoundaryTagBlock::GetAppendInfoDataSize();
+		}
+		// 管理領域先頭から先頭タグまでのオフセット
+		u32 TlsfAllocatorCore::GetRegionHeadTagOffset()
+		{
+			return RoundUpAlignment(static_cast<u32>(sizeof(RegionHeader))) + GetBlockHeadPhase();
+		}
+		// 管理領域先頭から最初のブロックまでのオフセット. 領域情報と先頭タグを含む.
+		u32 TlsfAllocatorCore::GetRegionFirstBlockOffset()
+		{
+			return GetRegionHeadTagOffset() + GetRegionTagDataSize() + BoundaryTagBlock::GetAppendInfoDataSize();
+		}
+		u32 TlsfAllocatorCore::GetRegionOverheadSize()
+		{
+			// 先頭と末尾のアライメント調整・領域情報と先頭タグ・末尾タグ・最初のフリーリスト要素
+			return BoundaryTagBlock::ALIGNMENT * 2 + GetRegionFirstBlockOffset() + GetRegionTagDataSize() + BoundaryTagBlock::GetAppendInfoDataSize() * 2;
+		}
+		BoundaryTagBlock* TlsfAllocatorCore::GetRegionHeadTag(const RegionHeader* region)
+		{
+			u8* head = reinterpret_cast<u8*>(const_cast<RegionHeader*>(region));
+			return reinterpret_cast<BoundaryTagBlock*>(head + GetRegionHeadTagOffset());
+		}
+
+		// 管理領域の追加
+		bool TlsfAllocatorCore::AddRegion(void* mem, u64 size)
+		{
+			if (nullptr == mem || 0 >= second_level_exponentiation_)
+				return false;
+
+			// ブロックサイズをu32で扱うため, 大きすぎる領域は分割して登録する.
+			u8* head = reinterpret_cast<u8*>(mem);
+			while (REGION_SIZE_MAX < size)
+			{
+				if (!AddRegionInternal(head, REGION_SIZE_MAX))
+					return false;
+				head += REGION_SIZE_MAX;
+				size -= REGION_SIZE_MAX;
+			}
+			// 端数が小さすぎて領域にならない場合は無視する.
+			return AddRegionInternal(head, size) || (head != mem);
+		}
+		bool TlsfAllocatorCore::AddRegionInternal(void* mem, u64 size)
+		{
+			// 領域情報・先頭・末尾・最初のフリーリスト要素　の最低限必要なサイズを計算
+			// 第二レベルの分割数に応じた最小のデータ部サイズ
+			const u64 minDataSize = GetMinDataSize();
+			if (static_cast<u64>(GetRegionOverheadSize()) + minDataSize > size)
+				return false;
+
+			// 全てのブロックの先頭をALIGNMENTに揃えるため, 領域の先頭を揃える.
+			u8* head = reinterpret_cast<u8*>(AlignUpPointer(mem, BoundaryTagBlock::ALIGNMENT));
+			size -= static_cast<u64>(head - reinterpret_cast<u8*>(mem));
 
 			// 最初と最後にダミーのタグを仕込む
-			head_tag_ = BoundaryTagBlock::Placement(mem, 0);// データサイズ0で先頭に配置
-			// データサイズ0で末尾に配置 ヘッドと同じサイズなので流用
-			tail_tag_ = BoundaryTagBlock::Placement(mem, 0, static_cast<u32>(size - head_tag_->GetAllSize()));
+			// ダミーのタグもALIGNMENTの倍数のサイズとし, 末尾タグは他のブロックと同様にデータ部がALIGNMENTに揃う位置に配置する.
+			const u32 tag_data_size = GetRegionTagDataSize();
+			const u32 tag_all_size = tag_data_size + BoundaryTagBlock::GetAppendInfoDataSize();
+			const u32 first_block_offset = GetRegionFirstBlockOffset();
+			const u32 tail_tag_offset = static_cast<u32>((size - tag_all_size - GetBlockHeadPhase()) & ~u64(BoundaryTagBlock::ALIGNMENT - 1)) + GetBlockHeadPhase();
 
-			// マージしないためにダミーはフラグをON
-			head_tag_->SetIsUsed(true);
-			tail_tag_->SetIsUsed(true);
+			RegionHeader* region = new(head) RegionHeader();
+			region->size = tail_tag_offset + tag_all_size;
 
-			// フラグをリセット
-			free_list_bit_fli_ = 0;
-			memset(free_list_bit_sli_, 0x00, sizeof(free_list_bit_sli_));
-			memset(free_list_, 0x00, sizeof(free_list_));
+			BoundaryTagBlock* head_tag = BoundaryTagBlock::Placement(head, tag_data_size, first_block_offset - tag_all_size);// 先頭に配置
+			// 末尾に配置
+			BoundaryTagBlock* tail_tag = BoundaryTagBlock::Placement(head, tag_data_size, tail_tag_offset);
 
+			// マージしないためにダミーはフラグをON
+			head_tag->SetIsUsed(true);
+			tail_tag->SetIsUsed(true);
 
 			// 残った部分を最初の唯一のブロックとする
-			// 残ったサイズは先頭、末尾とこのブロック自体の管理情報サイズを除いたもの
-			u32 first_data_size = static_cast<u32>(size)-head_tag_->GetAllSize() - tail_tag_->GetAllSize() - BoundaryTagBlock::GetAppendInfoDataSize();
-			BoundaryTagBlock* first_block = BoundaryTagBlock::Placement(mem, first_data_size, head_tag_->GetAllSize());
+			// 残ったサイズは領域情報, 先頭、末尾とこのブロック自体の管理情報サイズを除いたもの
+			u32 first_data_size = tail_tag_offset - first_block_offset - BoundaryTagBlock::GetAppendInfoDataSize();
+			BoundaryTagBlock* first_block = BoundaryTagBlock::Placement(head, first_data_size, first_block_offset);
+			head_tag->LinkPhysicalNext();
+			first_block->LinkPhysicalNext();
+
+			// 管理領域リストの先頭に追加
+			region->prev = nullptr;
+			region->next = region_list_;
+			if (nullptr != region_list_)
+				region_list_->prev = region;
+			region_list_ = region;
+			++region_count_;
+			total_region_size_ += region->size;
 
 			RegisterFreeList(first_block);
 
 			return true;
 		}
-		// 解放
-		//		特に削除処理はしないが管理用情報などをクリア
-		void TlsfAllocatorCore::Destroy()
+
+		TlsfAllocatorCore::RegionHeader* TlsfAllocatorCore::FindRegion(void* mem) const
 		{
-			head_ = nullptr;
-			size_ = 0;
-			second_level_exponentiation_ = 0;
-			free_list_bit_fli_ = 0;
-			memset(free_list_bit_sli_, 0x00, sizeof(free_list_bit_sli_));
-			memset(free_list_, 0x00, sizeof(free_list_));
+			for (RegionHeader* region = region_list_; nullptr != region; region = region->next)
+			{
+				// 先頭はアライメント調整されている.
+				if (reinterpret_cast<void*>(region) == AlignUpPointer(mem, BoundaryTagBlock::ALIGNMENT))
+					return region;
+			}
+			return nullptr;
+		}
+
+		// 管理領域内の全てのメモリが未使用か
+		bool TlsfAllocatorCore::IsRegionEmpty(void* mem) const
+		{
+			const RegionHeader* region = FindRegion(mem);
+			if (nullptr == region)
+				return false;
+
+			// 先頭タグの次のブロックが未使用で, かつその次が末尾タグであれば全て未使用.
+			const BoundaryTagBlock* head_tag = GetRegionHeadTag(region);
+			const u8* block_head = reinterpret_cast<const u8*>(head_tag) + head_tag->GetAllSize();
+			const BoundaryTagBlock* block = reinterpret_cast<const BoundaryTagBlock*>(block_head);
+			if (block->IsUsed())
+				return false;
+			const u8* region_end = reinterpret_cast<const u8*>(region) + region->size;
+			return (block_head + block->GetAllSize() + head_tag->GetAllSize()) == region_end;
+		}
+
+		// 管理領域の除外
+		bool TlsfAllocatorCore::RemoveRegion(void* mem)
+		{
+			if (!IsRegionEmpty(mem))
+				return false;
+
+			RegionHeader* region = FindRegion(mem);
+			BoundaryTagBlock* head_tag = GetRegionHeadTag(region);
+			BoundaryTagBlock* block = reinterpret_cast<BoundaryTagBlock*>(reinterpret_cast<u8*>(head_tag) + head_tag->GetAllSize());
+
+			// 唯一のフリーブロックをフリーリストから除去
+			RemoveFreeList(block);
+
+			// 管理領域リストから除去
+			if (nullptr != region->prev)
+				region->prev->next = region->next;
+			else
+				region_list_ = region->next;
+			if (nullptr != region->next)
+				region->next->prev = region->prev;
+			--region_count_;
+			total_region_size_ -= region->size;
+
+			return true;
 		}
 
 		// メモリリークのチェック
@@ -84,90 +239,304 @@ namespace ngl
 		void TlsfAllocatorCore::LeakReport()
 		{
 			// 管理メモリ先頭からひとつづつブロックをたどって行って使用中のものがあれば出力
-			u8* cur = reinterpret_cast<u8*>(head_);
-			u8* end = cur + size_;
-			for (; cur < end ;)
+			for (RegionHeader* region = region_list_; nullptr != region; region = region->next)
 			{
-				BoundaryTagBlock* block = reinterpret_cast<BoundaryTagBlock*>(cur);
+				// 管理用の先頭と終端タグは無視
+				BoundaryTagBlock* head_tag = GetRegionHeadTag(region);
+				u8* cur = reinterpret_cast<u8*>(head_tag) + head_tag->GetAllSize();
+				u8* end = reinterpret_cast<u8*>(region) + region->size - head_tag->GetAllSize();
+				for (; cur < end;)
+				{
+					BoundaryTagBlock* block = reinterpret_cast<BoundaryTagBlock*>(cur);
+
+					if (block->IsUsed())
+					{
+						std::cout << "[TlsfAllocatorCore] Memory Leak !" << std::endl;
+						std::cout << "	dataSize : " << block->GetDataSize() << std::endl;
+						const auto tag = allocation_tag_.find(block->GetDataPtr());
+						if (allocation_tag_.end() != tag && nullptr != tag->second)
+						{
+							std::cout << "	tag : " << tag->second << std::endl;
+						}
+					}
 
-				// データサイズが0のものは管理用の先頭と終端タグなので無視
-				if (0 < block->GetDataSize() && block->IsUsed())
+					cur = cur + block->GetAllSize();
+				}
+			}
+		}
+
+		// 使用状況の取得
+		TlsfAllocatorCoreUsage TlsfAllocatorCore::GetUsage() const
+		{
+			TlsfAllocatorCoreUsage usage = {};
+			usage.region_size = total_region_size_;
+			for (RegionHeader* region = region_list_; nullptr != region; region = region->next)
+			{
+				// 管理用の先頭と終端タグは無視
+				const BoundaryTagBlock* head_tag = GetRegionHeadTag(region);
+				const u8* cur = reinterpret_cast<const u8*>(head_tag) + head_tag->GetAllSize();
+				const u8* end = reinterpret_cast<const u8*>(region) + region->size - head_tag->GetAllSize();
+				for (; cur < end;)
 				{
-					std::cout << "[TlsfAllocatorCore] Memory Leak !" << std::endl;
-					std::cout << "	dataSize : " << block->GetDataSize() << std::endl;
+					const BoundaryTagBlock* block = reinterpret_cast<const BoundaryTagBlock*>(cur);
+					if (block->IsUsed())
+					{
+						++usage.used_block_count;
+						usage.used_data_size += block->GetDataSize();
+						usage.used_block_size += block->GetAllSize();
+					}
+					else
+					{
+						++usage.free_block_count;
+						usage.free_data_size += block->GetDataSize();
+						usage.free_block_size += block->GetAllSize();
+					}
+					cur = cur + block->GetAllSize();
 				}
+			}
+			usage.region_overhead_size = usage.region_size - usage.used_block_size - usage.free_block_size;
+			return usage;
+		}
 
-				cur = cur + block->GetAllSize();
+		// 使用状況のレポート
+		void TlsfAllocatorCore::UsageReport() const
+		{
+			const TlsfAllocatorCoreUsage usage = GetUsage();
+			std::cout << "[TlsfAllocatorCore] Usage" << std::endl;
+			std::cout << "	regionSize : " << usage.region_size << " (overhead " << usage.region_overhead_size << ")" << std::endl;
+			std::cout << "	usedBlock : " << usage.used_block_count << " dataSize : " << usage.used_data_size << " blockSize : " << usage.used_block_size << std::endl;
+			std::cout << "	freeBlock : " << usage.free_block_count << " dataSize : " << usage.free_data_size << " blockSize : " << usage.free_block_size << std::endl;
+			std::cout << "	overheadRatio : " << usage.GetOverheadRatio() << " (headTag " << BoundaryTagBlock::GetHeadTagSize() << " tailTag " << BoundaryTagBlock::GetTailTagSize() << ")" << std::endl;
+		}
+
+
+
+		// 統計情報の取得
+		TlsfAllocatorCoreStatistics TlsfAllocatorCore::GetStatistics() const
+		{
+			TlsfAllocatorCoreStatistics stat = {};
+			stat.region_size = total_region_size_;
+			stat.used_size = used_size_;
+			stat.peak_used_size = peak_used_size_;
+			stat.used_block_count = used_block_count_;
+			stat.free_size = free_size_;
+			stat.free_block_count = free_block_count_;
+			stat.largest_free_size = GetLargestFreeBlockSize();
+			stat.allocate_count = allocate_count_;
+			stat.deallocate_count = deallocate_count_;
+			stat.allocate_fail_count = allocate_fail_count_;
+			return stat;
+		}
+		// FLI/SLI毎のフリーブロック数の取得
+		void TlsfAllocatorCore::GetFreeBlockHistogram(FreeBlockHistogram& out) const
+		{
+			out.second_level_exponentiation = second_level_exponentiation_;
+			memcpy(out.count, free_block_histogram_, sizeof(out.count));
+		}
+		// 最大のフリーブロックのデータ部サイズ
+		u64 TlsfAllocatorCore::GetLargestFreeBlockSize() const
+		{
+			if (0 == free_list_bit_fli_)
+				return 0;
+			// 最大のFLI/SLIのリスト内から探す
+			const s32 fli = MostSignificantBit64Fast(free_list_bit_fli_);
+			const s32 sli = MostSignificantBit64Fast(free_list_bit_sli_[fli]);
+			u64 largest = 0;
+			for (const BoundaryTagBlock* block = free_list_[fli][sli]; nullptr != block; block = block->GetNext())
+			{
+				largest = (block->GetDataSize() > largest) ? block->GetDataSize() : largest;
+			}
+			return largest;
+		}
+		// 使用量の最大値を現在の使用量でリセット
+		void TlsfAllocatorCore::ResetPeakUsedSize()
+		{
+			peak_used_size_ = used_size_;
+		}
+
+		// 確保箇所タグの記録の有効化
+		void TlsfAllocatorCore::EnableAllocationTag(bool enable)
+		{
+			is_allocation_tag_enabled_ = enable;
+			if (!enable)
+				allocation_tag_.clear();
+		}
+		// 確保箇所タグ毎の使用状況を使用量の多い順に取得
+		void TlsfAllocatorCore::GetAllocationTagStatistics(std::vector<TlsfAllocationTagStatistics>& out) const
+		{
+			out.clear();
+			// 別の翻訳単位の同一文字列はアドレスが異なる場合があるため文字列で集計する
+			std::map<std::string, TlsfAllocationTagStatistics> tag_map;
+			for (const auto& e : allocation_tag_)
+			{
+				const BoundaryTagBlock* block = BoundaryTagBlock::FromDataPtr(const_cast<void*>(e.first));
+				TlsfAllocationTagStatistics& stat = tag_map[(nullptr != e.second) ? e.second : ""];
+				stat.tag = e.second;
+				++stat.block_count;
+				stat.used_size += block->GetDataSize();
 			}
+			for (const auto& e : tag_map)
+			{
+				out.push_back(e.second);
+			}
+			std::sort(out.begin(), out.end(), [](const TlsfAllocationTagStatistics& a, const TlsfAllocationTagStatistics& b) { return a.used_size > b.used_size; });
 		}
 
+		// 確保したブロックを使用状態にして統計を更新する
+		void* TlsfAllocatorCore::CommitAllocatedBlock(BoundaryTagBlock* block, const char* tag)
+		{
+			block->SetIsUsed(true);
 
+			used_size_ += block->GetDataSize();
+			peak_used_size_ = (used_size_ > peak_used_size_) ? used_size_ : peak_used_size_;
+			++used_block_count_;
+			++allocate_count_;
+
+			if (is_allocation_tag_enabled_)
+			{
+				allocation_tag_[block->GetDataPtr()] = tag;
+			}
+			return block->GetDataPtr();
+		}
 
 		// 割り当て
-		void* TlsfAllocatorCore::Allocate(u64 size)
+		void* TlsfAllocatorCore::Allocate(u64 size, const char* tag)
 		{
-			// FLI-SLIに一致するフリーブロックがあればそれを割り当て
-			// 無ければビットフラグチェックをして大き目のブロックを割り当てる
+			// 要求サイズを切り上げたFLI-SLI以上でフリーブロックを持つリストをビットマップから探して割り当てる
+			// 切り上げているため見つかったリストのブロックは必ず要求サイズ以上となる
 			// サイズが前方タグ一つ後方タグ一つ分＋最小割り当てメモリサイズ　を残して分割できる場合は
 			// フリーブロックを分割して残った部分を適切なフリーリストに登録する
 			if (0 == size)
 				return NULL;
 
-			// 強制的に最小サイズ以上にする
-			const u32 min_size = 1 << second_level_exponentiation_;
-			size = size < min_size ? min_size : size;
+			// 強制的に最小サイズ以上にし, ブロックサイズをALIGNMENTの倍数にする
+			size = GetBlockDataSize(size);
+			s32 fli, sli;
+			if (0 == size || !FindSuitableFreeList(size, fli, sli))
+			{
+				++allocate_fail_count_;
+				return NULL;
+			}
 
-			s32 fli = GetFirstLevelIndex(size);
-			s32 sli = GetSecondLevelIndex(size, fli, second_level_exponentiation_);
+			// ついでに　RemoveFreeListTop　の中でフリーリストビットの操作もされている
+			BoundaryTagBlock* block = RemoveFreeListTop(fli, sli);
 
-			if (0 != (free_list_bit_fli_ & ((~u64(0x00)) << fli)))
+			// 分割できるなら分割
+			BoundaryTagBlock* div_block = DivideBlock(block, static_cast<u32>(size));
+			if (NULL != div_block)
 			{
-				// 第一インデックスに空きあり
-				if (0 != (free_list_bit_sli_[fli] & (u64(1) << sli)))
-				{
-					// 第二インデックスに一致するフリーブロック発見
-					BoundaryTagBlock* block = RemoveFreeListTop(fli, sli);
+				RegisterFreeList(div_block);
+			}
 
-					// フリーリストから取り出して利用状態になっているブロックの管理も必要だろうか？
+			// 使用状態にして返す
+			return CommitAllocatedBlock(block, tag);
+		}
 
-					// 使用状態にする
-					block->SetIsUsed(true);
+		// アライメント指定の割り当て
+		void* TlsfAllocatorCore::AllocateAligned(u64 size, u32 alignment, const char* tag)
+		{
+			// 2の冪乗のみ
+			if (0 == alignment || 0 != (alignment & (alignment - 1)) || ALIGNMENT_MAX < alignment)
+				return NULL;
+			// 標準のアライメントで足りる場合
+			if (BoundaryTagBlock::ALIGNMENT >= alignment)
+				return Allocate(size, tag);
+			if (0 == size)
+				return NULL;
 
-					// 返す
-					return block->GetDataPtr();
-				}
-				else
-				{
-					// 第二インデックスに空きがなかったので同一第一カテゴリでの空きを探す
-					s32 up_level_fli = GetFreeListFirstLevelIndex(fli);
-					if (0 <= up_level_fli)
-					{
-						s32 up_level_sli = GetFreeListSecondLevelIndex(up_level_fli);
-						if (0 <= up_level_sli)
-						{
-							// 第二インデックスに一致するフリーブロック発見
-							// ついでに　RemoveFreeListTop　の中でフリーリストビットの操作もされている
-							BoundaryTagBlock* block = RemoveFreeListTop(up_level_fli, up_level_sli);
-
-							// アロケート時間の30％くらいがここの分割？
-							// 分割できるなら分割
-							BoundaryTagBlock* div_block = DivideBlock(block, static_cast<u32>(size));
-							if (NULL != div_block)
-							{
-								RegisterFreeList(div_block);
-							}
-
-							// 使用状態にする
-							block->SetIsUsed(true);
-
-							// 返す
-							return block->GetDataPtr();
-						}
-					}
-				}
+			size = GetBlockDataSize(size);
+
+			// 前方の余剰部分をフリーブロックとして切り出すための最小サイズ
+			const u64 min_lead_size = GetMinBlockSize();
+			// 先頭位置をずらしても要求サイズを満たすブロックを探す
+			s32 fli, sli;
+			if (0 == size || !FindSuitableFreeList(size + alignment + min_lead_size, fli, sli))
+			{
+				++allocate_fail_count_;
+				return NULL;
 			}
 
-			return NULL;
+			BoundaryTagBlock* block = RemoveFreeListTop(fli, sli);
+
+			const u64 data_addr = reinterpret_cast<u64>(block->GetDataPtr());
+			if (0 != (data_addr & (alignment - 1)))
+			{
+				// 前方の余剰部分をフリーブロックに出来るだけ空けたうえでアライメントに揃える
+				const u64 aligned_addr = (data_addr + min_lead_size + (alignment - 1)) & ~u64(alignment - 1);
+				const u32 lead_size = static_cast<u32>(aligned_addr - data_addr);
+				const u32 remain_data_size = block->GetDataSize() - lead_size;
+
+				// 前方の余剰部分をフリーリストへ戻す
+				// フリーブロックの直前は必ず使用中のブロックなのでマージは不要
+				BoundaryTagBlock* lead_block = BoundaryTagBlock::Placement(block, lead_size - BoundaryTagBlock::GetAppendInfoDataSize());
+				BoundaryTagBlock* aligned_block = BoundaryTagBlock::Placement(block, remain_data_size, lead_size);
+				lead_block->LinkPhysicalNext();
+				aligned_block->LinkPhysicalNext();
+				lead_block->SetIsUsed(false);
+				RegisterFreeList(lead_block);
+
+				block = aligned_block;
+			}
+
+			// 分割できるなら分割
+			BoundaryTagBlock* div_block = DivideBlock(block, static_cast<u32>(size));
+			if (NULL != div_block)
+			{
+				RegisterFreeList(div_block);
+			}
+
+			return CommitAllocatedBlock(block, tag);
+		}
+
+		// 要求サイズから実際のブロックのデータ部サイズを求める
+		u64 TlsfAllocatorCore::GetBlockDataSize(u64 size) const
+		{
+			// 強制的に最小サイズ以上にする
+			const u64 min_size = GetMinDataSize();
+			size = size < min_size ? min_size : size;
+			// ブロック全体サイズがALIGNMENTの倍数になるようにする
+			const u64 append_size = BoundaryTagBlock::GetAppendInfoDataSize();
+			size = ((size + append_size + (BoundaryTagBlock::ALIGNMENT - 1)) & ~u64(BoundaryTagBlock::ALIGNMENT - 1)) - append_size;
+			// 一つの管理領域に収まらないサイズは扱えない
+			return (REGION_SIZE_MAX < size) ? 0 : size;
+		}
+		// ブロックのデータ部の最小サイズ
+		u64 TlsfAllocatorCore::GetMinDataSize() const
+		{
+			const u64 min_size = u64(1) << second_level_exponentiation_;
+			return (BoundaryTagBlock::GetMinDataSize() > min_size) ? BoundaryTagBlock::GetMinDataSize() : min_size;
+		}
+		// 分割して残すことのできるブロックの最小全体サイズ
+		u64 TlsfAllocatorCore::GetMinBlockSize()
+		{
+			return RoundUpAlignment(BoundaryTagBlock::GetAppendInfoDataSize() + SECOND_LEVEL_INDEX_MAX);
+		}
+
+		// 要求サイズを満たすことが保証されるフリーリストを探す
+		bool TlsfAllocatorCore::FindSuitableFreeList(u64 size, s32& out_fli, s32& out_sli) const
+		{
+			// 同一SLI内のブロックは要求サイズより小さい可能性があるため, 次のSLI境界へ切り上げる
+			const s32 raw_fli = GetFirstLevelIndex(size);
+			const u64 round_size = size + ((u64(1) << (raw_fli - second_level_exponentiation_)) - 1);
+
+			s32 fli = GetFirstLevelIndex(round_size);
+			if (64 <= fli)
+				return false;
+			s32 sli = GetSecondLevelIndex(round_size, fli, second_level_exponentiation_);
+
+			// まず同一FLI内でSLI以上のリストを探す
+			sli = GetFreeListSecondLevelIndex(fli, sli);
+			if (0 > sli)
+			{
+				// 無ければより大きいFLIのリストから最小のものを探す
+				fli = GetFreeListFirstLevelIndex(fli + 1);
+				if (0 > fli)
+					return false;
+				sli = GetFreeListSecondLevelIndex(fli);
+			}
+			out_fli = fli;
+			out_sli = sli;
+			return 0 <= sli;
 		}
 
 		// 割り当て解除
@@ -175,37 +544,26 @@ namespace ngl
 		{
 			if (NULL == mem)
 				return false;
-			// 渡されたメモリの前方 sizeof(BoundaryTagBlock) の位置にブロックが配置されているはずなので
+			// 渡されたメモリの前方にブロックが配置されているはずなので
 			// それの使用フラグをfalseとして割り当て解除する
 			// さらにブロックの前後をチェックして未割当ブロックがある場合はそれらとマージしてフリーリストに登録する
+			BoundaryTagBlock* block = BoundaryTagBlock::FromDataPtr(mem);
 
-			u8* data_head = reinterpret_cast<u8*>(mem);
-
-			// 面倒なことしているがこれはアライメントのためにブロックの先頭のすぐ後にデータ部がない場合があるため
-
-			// 直前の4バイトにデータ部サイズがある
-			u32 data_size = *reinterpret_cast<u32*>(data_head - sizeof(u32));
-
-			// データ部の先頭からデータ部サイズ分オフセットした位置にブロックサイズがある
-			u32 block_size = *reinterpret_cast<u32*>(data_head + data_size);
-
-			// データサイズ + データサイズの後ろのブロックサイズ部u32 - ブロックサイズ でブロックの先頭が得られる
-			s64 offset_to_block = s64(data_size) + BoundaryTagBlock::GetTailTagSize() - s64(block_size);
-			BoundaryTagBlock* block = reinterpret_cast<BoundaryTagBlock*>(data_head + offset_to_block);
-
-			u8* block_head = reinterpret_cast<u8*>(block);
+			used_size_ -= block->GetDataSize();
+			--used_block_count_;
+			++deallocate_count_;
+			if (is_allocation_tag_enabled_)
+			{
+				allocation_tag_.erase(mem);
+			}
 
 			//前方ブロック
-			BoundaryTagBlock* prev_block = reinterpret_cast<BoundaryTagBlock*>(
-				block_head - *reinterpret_cast<u32*>(block_head - sizeof(u32))
-				);
+			BoundaryTagBlock* prev_block = block->GetPrevPhysicalBlock();
 			// 後方ブロック
-			BoundaryTagBlock* nextBlock = reinterpret_cast<BoundaryTagBlock*>(
-				block_head + block_size
-				);
+			BoundaryTagBlock* nextBlock = block->GetNextPhysicalBlock();
 
 			BoundaryTagBlock* merge_head = block;
-			u32 merge_block_size = block_size;
+			u32 merge_block_size = block->GetAllSize();
 			if (!prev_block->IsUsed())
 			{
 				// 前方ブロックをフリーリストから除去
@@ -226,6 +584,7 @@ namespace ngl
 
 			// マージ
 			block = BoundaryTagBlock::Placement(merge_head, merge_block_size - BoundaryTagBlock::GetAppendInfoDataSize());
+			block->LinkPhysicalNext();
 
 			// マージが必要なら完了したはずなのでフリーリストに登録
 			block->SetIsUsed(false);
@@ -254,6 +613,10 @@ namespace ngl
 
 			free_list_bit_sli_[fli] |= (1 << sli);
 
+			free_size_ += block->GetDataSize();
+			++free_block_count_;
+			++free_block_histogram_[fli][sli];
+
 			return true;
 		}
 		BoundaryTagBlock* TlsfAllocatorCore::RemoveFreeList(BoundaryTagBlock* block)
@@ -275,6 +638,10 @@ namespace ngl
 				free_list_bit_sli_[fli] &= ~(u64(NULL == free_list_[fli][sli]) << sli);
 				free_list_bit_fli_ &= ~(u64(0 == free_list_bit_sli_[fli]) << fli);
 
+				free_size_ -= block->GetDataSize();
+				--free_block_count_;
+				--free_block_histogram_[fli][sli];
+
 				return block;
 			}
 			return NULL;
@@ -288,7 +655,7 @@ namespace ngl
 		{
 			u32 start_data_size = block->GetDataSize();
 
-			u32 need_size = size + BoundaryTagBlock::GetHeadTagSize() + BoundaryTagBlock::GetTailTagSize();
+			u32 need_size = size + BoundaryTagBlock::GetAppendInfoDataSize();
 
 			//　そもそもデータ部に別のブロックが入るのか
 			if (start_data_size < need_size)
@@ -308,39 +675,9 @@ namespace ngl
 			block = BoundaryTagBlock::Placement(block, size);
 
 			BoundaryTagBlock* div_block = BoundaryTagBlock::Placement(block, div_data_size, block->GetAllSize());
+			block->LinkPhysicalNext();
+			div_block->LinkPhysicalNext();
 			return div_block;
 		}
-
-		s32 TlsfAllocatorCore::GetFirstLevelIndex(u64 require_size)
-		{
-			return MostSignificantBit64(require_size);
-		}
-		// 第二レベル
-		s32 TlsfAllocatorCore::GetSecondLevelIndex(u64 require_size, u32 fli, u32 second_level_exp)
-		{
-			// 最上位ビット未満のビット列だけを有効にするマスク
-			const unsigned mask = (1 << fli) - 1;   // 1000 0000 -> 0111 1111
-
-			// 右へのシフト数を算出
-			const unsigned rs = fli - second_level_exp;	// 7 - 3 = 4 （8分割ならN=3です）
-
-			// 引数sizeにマスクをかけて、右へシフトすればインデックスに
-			return (require_size & mask) >> rs;
-		}
-
-		// フリーリストで指定レベルより大きい最小のFLIを返す
-		s32 TlsfAllocatorCore::GetFreeListFirstLevelIndex(u32 fli)
-		{
-			u32 all1 = ~u32(0x00);
-			u32 mask = all1 << fli;
-			u32 find = mask & free_list_bit_fli_;
-			return LeastSignificantBit64(find);
-		}
-		// フリーリストで指定したFLI内で最小のSLIを返す
-		s32 TlsfAllocatorCore::GetFreeListSecondLevelIndex(u32 fli)
-		{
-			s32 sli = LeastSignificantBit64(free_list_bit_sli_[fli]);
-			return sli;
-		}
 	}
 }
\ No newline at end of file
@@ -4,15 +4,100 @@
 #define _NGL_TLSF_ALLOCATOR_CORE_
 /*
 	TLSF アロケータ
+
+	統計情報
+		GetStatistics() は確保解放時に更新しているカウンタを返すだけなので毎フレーム取得してよい.
+		確保回数等は累積値なので, 確保レートは前回取得時との差分から求める.
+
+	確保箇所タグ
+		EnableAllocationTag(true) の間は Allocate に渡したタグを確保したメモリ毎に記録する.
+		記録はアロケータ外のヒープを利用するため, 調査時のみ有効にする.
+
+		allocator.EnableAllocationTag(true);
+		void* p = allocator.Allocate(256, NGL_TLSF_ALLOCATION_SITE);
+		std::vector<ngl::memory::TlsfAllocationTagStatistics> tag_stat;
+		allocator.GetAllocationTagStatistics(tag_stat);
 */
 
+#include <vector>
+#include <unordered_map>
+
 #include "ngl/util/types.h"
+#include "ngl/util/bit_operation.h"
 #include "ngl/memory/boundary_tag_block.h"
 
+// 確保箇所タグ用のソース位置文字列 "file(line)"
+#define NGL_TLSF_STRINGIFY_IMPL(x) #x
+#define NGL_TLSF_STRINGIFY(x) NGL_TLSF_STRINGIFY_IMPL(x)
+#define NGL_TLSF_ALLOCATION_SITE __FILE__ "(" NGL_TLSF_STRINGIFY(__LINE__) ")"
+
 namespace ngl
 {
 	namespace memory
 	{
+		// 使用状況. 管理領域の全ブロックを走査して集計する.
+		struct TlsfAllocatorCoreUsage
+		{
+			// 全管理領域の合計サイズ
+			u64 region_size			= 0;
+			// 管理領域の情報とダミータグ及びアライメント調整のサイズ
+			u64 region_overhead_size	= 0;
+
+			u32 used_block_count	= 0;
+			// 使用中ブロックのデータ部サイズの合計
+			u64 used_data_size		= 0;
+			// 使用中ブロックの全体サイズの合計. データ部との差がブロックの管理情報.
+			u64 used_block_size		= 0;
+
+			u32 free_block_count	= 0;
+			u64 free_data_size		= 0;
+			u64 free_block_size		= 0;
+
+			// 使用中ブロックの全体サイズに対するブロック管理情報の割合
+			double GetOverheadRatio() const
+			{
+				return (0 < used_block_size) ? double(used_block_size - used_data_size) / double(used_block_size) : 0.0;
+			}
+		};
+
+		// 統計情報. 確保解放時に更新しているカウンタから取得する.
+		struct TlsfAllocatorCoreStatistics
+		{
+			// 全管理領域の合計サイズ
+			u64 region_size			= 0;
+
+			// 使用中ブロックのデータ部サイズの合計とその最大値
+			u64 used_size			= 0;
+			u64 peak_used_size		= 0;
+			u32 used_block_count	= 0;
+
+			// フリーブロックのデータ部サイズの合計
+			u64 free_size			= 0;
+			u32 free_block_count	= 0;
+			// 最大のフリーブロックのデータ部サイズ
+			// 確保時は要求サイズをSLI境界へ切り上げて探索するため, このサイズの確保が成功するとは限らない.
+			u64 largest_free_size	= 0;
+
+			// 累積の確保, 解放, 確保失敗回数
+			u64 allocate_count		= 0;
+			u64 deallocate_count	= 0;
+			u64 allocate_fail_count	= 0;
+
+			// 外部断片化率. フリーブロック合計に対して最大フリーブロックで確保できない割合.
+			double GetFragmentationRatio() const
+			{
+				return (0 < free_size) ? 1.0 - double(largest_free_size) / double(free_size) : 0.0;
+			}
+		};
+
+		// 確保箇所タグ毎の使用状況
+		struct TlsfAllocationTagStatistics
+		{
+			// タグ無しで確保されたものはnullptr
+			const char*	tag			= nullptr;
+			u32			block_count	= 0;
+			u64			used_size	= 0;
+		};
 
 		class TlsfAllocatorCore
 		{
@@ -35,6 +120,12 @@ namespace ngl
 			TlsfAllocatorCore();
 			~TlsfAllocatorCore();
 
+			// 一つの管理領域の最大サイズ. ブロックサイズをu32で保持しているため.
+			// これを超えるサイズを渡された場合は複数の管理領域に分割して登録する.
+			static const u64 REGION_SIZE_MAX = u64(1) << 31;
+			// AllocateAlignedで指定可能な最大アライメント
+			static const u32 ALIGNMENT_MAX = 4096;
+
 			// void* mem : 管理メモリを渡す
 			//				このメモリの解放責任はこのアロケータにはありません
 			// secondLevelExponentiation : 第二レベルの分割数2^nの指数部
@@ -44,30 +135,94 @@ namespace ngl
 			// 解放
 			void Destroy();
 
+			// 管理領域の追加
+			//	Initialize済みのアロケータに別のメモリを管理領域として追加する. 既存の管理領域とはマージされない.
+			//	このメモリの解放責任はこのアロケータにはありません
+			bool AddRegion(void* mem, u64 size);
+			// 管理領域の除外
+			//	領域内の全てのメモリが未使用の場合のみ管理から外して true を返す.
+			//	mem は AddRegion に渡したポインタ. REGION_SIZE_MAX を超えて分割登録された領域は対象外.
+			bool RemoveRegion(void* mem);
+			// 管理領域内の全てのメモリが未使用か
+			bool IsRegionEmpty(void* mem) const;
+			// 管理領域数
+			u32 GetRegionCount() const { return region_count_; }
+			// 全管理領域の合計サイズ
+			u64 GetTotalRegionSize() const { return total_region_size_; }
+			// 管理領域一つ分の管理用情報サイズ. 管理領域のサイズはこれに加えて確保サイズ分必要.
+			static u32 GetRegionOverheadSize();
+
+			// FLI/SLI毎のフリーブロック数
+			struct FreeBlockHistogram
+			{
+				u32 second_level_exponentiation = 0;
+				u32 count[64][SECOND_LEVEL_INDEX_MAX] = {};
+
+				// バケットに登録されるブロックのデータ部の最小サイズ
+				u64 GetBucketMinSize(u32 fli, u32 sli) const
+				{
+					return (u64(1) << fli) + (u64(sli) << (fli - second_level_exponentiation));
+				}
+			};
+
+			// 統計情報の取得. 毎フレーム呼び出し可能.
+			TlsfAllocatorCoreStatistics GetStatistics() const;
+			// FLI/SLI毎のフリーブロック数の取得
+			void GetFreeBlockHistogram(FreeBlockHistogram& out) const;
+			// 最大のフリーブロックのデータ部サイズ
+			u64 GetLargestFreeBlockSize() const;
+			// 使用量の最大値を現在の使用量でリセット
+			void ResetPeakUsedSize();
+
+			// 確保箇所タグの記録の有効化. 無効化すると記録は破棄される.
+			void EnableAllocationTag(bool enable);
+			bool IsAllocationTagEnabled() const { return is_allocation_tag_enabled_; }
+			// 確保箇所タグ毎の使用状況を使用量の多い順に取得
+			void GetAllocationTagStatistics(std::vector<TlsfAllocationTagStatistics>& out) const;
+
 
 			// メモリリークのチェック
 			// 標準出力にリーク情報を出力する
 			void LeakReport();
 
+			// 使用状況の取得. 全ブロックを走査するため頻繁には呼ばないこと.
+			TlsfAllocatorCoreUsage GetUsage() const;
+			// 使用状況のレポート
+			// 標準出力にブロック数とブロック管理情報の割合を出力する
+			void UsageReport() const;
+
 
 			// 割り当て
-			// Deallocateに比べて2倍程度時間がかかっているのであとで調査
-			void* Allocate(u64 size);
+			// FLI/SLIの計算とフリーリスト探索はビットスキャン命令による定数時間.
+			// tag : 確保箇所タグ. 記録が有効な場合のみ利用する. 文字列はアロケータより長い寿命が必要.
+			void* Allocate(u64 size, const char* tag = nullptr);
+			// アライメント指定の割り当て
+			//	alignment は2の冪乗でALIGNMENT_MAXまで. BoundaryTagBlock::ALIGNMENT以下の場合はAllocateと同じ.
+			//	アライメント調整で生じる前方の余剰部分はフリーブロックとしてフリーリストに戻す.
+			void* AllocateAligned(u64 size, u32 alignment, const char* tag = nullptr);
 			// 割り当て解除
+			//	Allocate/AllocateAlignedどちらで確保したメモリも解放できる.
 			bool Deallocate(void* mem);
 
 		public:
 			// 第一レベルインデックス
-			s32 GetFirstLevelIndex(u64 require_size);
+			s32 GetFirstLevelIndex(u64 require_size) const;
 			// 第二レベル
-			s32 GetSecondLevelIndex(u64 require_size, u32 first_level_index, u32 second_level_exp);
+			s32 GetSecondLevelIndex(u64 require_size, u32 first_level_index, u32 second_level_exp) const;
 
-			// フリーリストでFLIより大きい最小のFLIを返す
-			s32 GetFreeListFirstLevelIndex(u32 first_level_index);
-			// フリーリストで指定したFLI内で最小のSLIを返す
-			s32 GetFreeListSecondLevelIndex(u32 first_level_index);
+			// フリーリストでFLI以上の最小のFLIを返す. なければ負数.
+			s32 GetFreeListFirstLevelIndex(u32 first_level_index) const;
+			// フリーリストで指定したFLI内で最小のSLIを返す. なければ負数.
+			s32 GetFreeListSecondLevelIndex(u32 first_level_index) const;
+			// フリーリストで指定したFLI内でSLI以上の最小のSLIを返す. なければ負数.
+			s32 GetFreeListSecondLevelIndex(u32 first_level_index, u32 second_level_index) const;
 
 		private:
+			// 要求サイズを満たすことが保証されるフリーリストを探す.
+			// 要求サイズを次のSLI境界へ切り上げてからFLI/SLIを求め, そこからビットマップを探索する.
+			// 見つからなければ false.
+			bool FindSuitableFreeList(u64 size, s32& out_fli, s32& out_sli) const;
+
 			bool RegisterFreeList(BoundaryTagBlock* block);
 			BoundaryTagBlock* RemoveFreeList(BoundaryTagBlock* block);
 
@@ -77,21 +232,118 @@ namespace ngl
 			// fli sliに対してblock分割可能なら分割して残りの部分を返す
 			BoundaryTagBlock* DivideBlock(BoundaryTagBlock* block, u32 size);
 
+			// 管理領域の情報. 各管理領域の先頭に配置する.
+			// 管理領域の先頭と末尾にはマーカーとして空のタグを仕込み, 管理領域を跨いだマージを防ぐ.
+			struct RegionHeader
+			{
+				RegionHeader*	prev;
+				RegionHeader*	next;
+				u64				size;
+				u64				reserved;
+			};
+			// 管理領域の先頭タグ
+			static BoundaryTagBlock* GetRegionHeadTag(const RegionHeader* region);
+			// ALIGNMENT境界からブロック先頭までのずれ
+			static u32 GetBlockHeadPhase();
+			// 管理領域の先頭と末尾のダミータグのデータ部サイズ
+			static u32 GetRegionTagDataSize();
+			// 管理領域先頭から先頭タグまでのオフセット
+			static u32 GetRegionHeadTagOffset();
+			// 管理領域先頭から最初のブロックまでのオフセット
+			static u32 GetRegionFirstBlockOffset();
+
+			// 要求サイズから実際のブロックのデータ部サイズを求める. 扱えないサイズの場合は0.
+			u64 GetBlockDataSize(u64 size) const;
+			// ブロックのデータ部の最小サイズ
+			u64 GetMinDataSize() const;
+			// 分割して残すことのできるブロックの最小全体サイズ
+			static u64 GetMinBlockSize();
+
+			static u32 RoundUpAlignment(u32 size)
+			{
+				return (size + (BoundaryTagBlock::ALIGNMENT - 1)) & ~(BoundaryTagBlock::ALIGNMENT - 1);
+			}
+			static void* AlignUpPointer(void* ptr, u64 alignment)
+			{
+				return reinterpret_cast<void*>((reinterpret_cast<u64>(ptr) + (alignment - 1)) & ~(alignment - 1));
+			}
+
+			bool AddRegionInternal(void* mem, u64 size);
+			RegionHeader* FindRegion(void* mem) const;
+
+			// 確保したブロックを使用状態にして統計を更新する
+			void* CommitAllocatedBlock(BoundaryTagBlock* block, const char* tag);
+
 		private:
-			void* head_;
-			u64 size_;
 			u32 second_level_exponentiation_;
 
-			// 管理領域の先頭と末尾にマーカーとしてからのタグを仕込む 
-			BoundaryTagBlock*	head_tag_;
-			BoundaryTagBlock*	tail_tag_;
+			// 管理領域の双方向リスト
+			RegionHeader*		region_list_;
+			u32					region_count_;
+			u64					total_region_size_;
 
 			u64					free_list_bit_fli_;// 0-63 の各第一レベルフリーリストの有無を示すビット
 			u32					free_list_bit_sli_[64];// 対応する第一レベル内部の第二レベルフリーリストの有無を示すビット
 
 			// 分割幅レベル以下の要素は使われないけどまあいいか　
 			BoundaryTagBlock*	free_list_[64][SECOND_LEVEL_INDEX_MAX];
+
+			// 統計
+			u64					used_size_;
+			u64					peak_used_size_;
+			u32					used_block_count_;
+			u64					free_size_;
+			u32					free_block_count_;
+			u64					allocate_count_;
+			u64					deallocate_count_;
+			u64					allocate_fail_count_;
+			u32					free_block_histogram_[64][SECOND_LEVEL_INDEX_MAX];
+
+			// 確保箇所タグ. データ部の先頭アドレスからタグ.
+			bool				is_allocation_tag_enabled_;
+			std::unordered_map<const void*, const char*>	allocation_tag_;
 		};
+
+		// 実装
+		// Allocate/Deallocateの度に呼ばれるためインライン化しておく.
+
+		inline s32 TlsfAllocatorCore::GetFirstLevelIndex(u64 require_size) const
+		{
+			return MostSignificantBit64Fast(require_size);
+		}
+		// 第二レベル
+		inline s32 TlsfAllocatorCore::GetSecondLevelIndex(u64 require_size, u32 fli, u32 second_level_exp) const
+		{
+			// 最上位ビット未満のビット列だけを有効にするマスク
+			const u64 mask = (u64(1) << fli) - 1;   // 1000 0000 -> 0111 1111
+
+			// 右へのシフト数を算出
+			const u32 rs = fli - second_level_exp;	// 7 - 3 = 4 （8分割ならN=3です）
+
+			// 引数sizeにマスクをかけて、右へシフトすればインデックスに
+			return static_cast<s32>((require_size & mask) >> rs);
+		}
+		// フリーリストでFLI以上の最小のFLIを返す
+		inline s32 TlsfAllocatorCore::GetFreeListFirstLevelIndex(u32 fli) const
+		{
+			if (64 <= fli)
+				return -1;
+			const u64 mask = (~u64(0)) << fli;
+			return LeastSignificantBit64Fast(mask & free_list_bit_fli_);
+		}
+		// フリーリストで指定したFLI内で最小のSLIを返す
+		inline s32 TlsfAllocatorCore::GetFreeListSecondLevelIndex(u32 fli) const
+		{
+			return LeastSignificantBit64Fast(free_list_bit_sli_[fli]);
+		}
+		// フリーリストで指定したFLI内でSLI以上の最小のSLIを返す
+		inline s32 TlsfAllocatorCore::GetFreeListSecondLevelIndex(u32 fli, u32 sli) const
+		{
+			if (SECOND_LEVEL_INDEX_MAX <= sli)
+				return -1;
+			const u32 mask = (~u32(0)) << sli;
+			return LeastSignificantBit64Fast(mask & free_list_bit_sli_[fli]);
+		}
 	}
 }
 
@@ -0,0 +1,270 @@
+﻿
+#include "tlsf_allocator_core_test.h"
+
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+
+#include <assert.h>
+
+namespace ngl
+{
+namespace memory
+{
+namespace test
+{
+	namespace
+	{
+		using Clock = std::chrono::steady_clock;
+
+		double ElapsedNanoSec(Clock::time_point begin, Clock::time_point end)
+		{
+			return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+		}
+
+		// 固定サイズで連続確保した後に全て解放する.
+		void BenchmarkFixedSize(TlsfAllocatorCore& allocator, u64 alloc_size, int alloc_count, int loop_count)
+		{
+			std::vector<void*> ptr_array(alloc_count, nullptr);
+
+			double alloc_ns = 0.0;
+			double dealloc_ns = 0.0;
+			int alloc_op = 0;
+			int dealloc_op = 0;
+			for (int loop = 0; loop < loop_count; ++loop)
+			{
+				const auto t0 = Clock::now();
+				for (int i = 0; i < alloc_count; ++i)
+				{
+					ptr_array[i] = allocator.Allocate(alloc_size);
+				}
+				const auto t1 = Clock::now();
+				// 解放はランダム順にして断片化とマージを発生させる.
+				for (int i = 0; i < alloc_count; ++i)
+				{
+					const int index = (i * 7919) % alloc_count;
+					if (allocator.Deallocate(ptr_array[index]))
+						++dealloc_op;
+					ptr_array[index] = nullptr;
+				}
+				const auto t2 = Clock::now();
+
+				alloc_ns += ElapsedNanoSec(t0, t1);
+				dealloc_ns += ElapsedNanoSec(t1, t2);
+				alloc_op += alloc_count;
+			}
+
+			std::cout << "	size " << alloc_size
+				<< "	: Allocate " << (alloc_ns / alloc_op) << " ns/op"
+				<< "	Deallocate " << (dealloc_ns / (0 < dealloc_op ? dealloc_op : 1)) << " ns/op"
+				<< std::endl;
+		}
+
+		// ランダムサイズで確保と解放を混在させる.
+		void BenchmarkRandomSize(TlsfAllocatorCore& allocator, u64 min_size, u64 max_size, int op_count)
+		{
+			std::mt19937 rand_engine(0);
+			std::uniform_int_distribution<u64> size_dist(min_size, max_size);
+
+			constexpr int k_slot_count = 1024;
+			std::vector<void*> slot(k_slot_count, nullptr);
+
+			// 乱数生成を計測から除外するために事前に生成しておく.
+			std::vector<u64> size_array(op_count);
+			for (auto& e : size_array)
+				e = size_dist(rand_engine);
+
+			const auto t0 = Clock::now();
+			for (int i = 0; i < op_count; ++i)
+			{
+				const int index = i % k_slot_count;
+				if (slot[index])
+					allocator.Deallocate(slot[index]);
+				slot[index] = allocator.Allocate(size_array[i]);
+			}
+			const auto t1 = Clock::now();
+			for (auto& e : slot)
+			{
+				allocator.Deallocate(e);
+				e = nullptr;
+			}
+
+			std::cout << "	random size " << min_size << "-" << max_size
+				<< "	: Allocate+Deallocate " << (ElapsedNanoSec(t0, t1) / op_count) << " ns/op"
+				<< std::endl;
+		}
+
+		// アライメント指定で確保する. アライメントが満たされているかも検証.
+		void BenchmarkAligned(TlsfAllocatorCore& allocator, u32 alignment, int alloc_count)
+		{
+			std::vector<void*> ptr_array(alloc_count, nullptr);
+			int misaligned_count = 0;
+
+			const auto t0 = Clock::now();
+			for (int i = 0; i < alloc_count; ++i)
+			{
+				// サイズもばらつかせて前方余剰部分の切り出しを発生させる.
+				ptr_array[i] = allocator.AllocateAligned(64 + (i % 16) * 24, alignment);
+			}
+			const auto t1 = Clock::now();
+			for (int i = 0; i < alloc_count; ++i)
+			{
+				if (0 != (reinterpret_cast<u64>(ptr_array[i]) & (alignment - 1)))
+					++misaligned_count;
+				allocator.Deallocate(ptr_array[i]);
+			}
+			const auto t2 = Clock::now();
+			assert(0 == misaligned_count);
+
+			std::cout << "	aligned " << alignment
+				<< "	: AllocateAligned " << (ElapsedNanoSec(t0, t1) / alloc_count) << " ns/op"
+				<< "	Deallocate " << (ElapsedNanoSec(t1, t2) / alloc_count) << " ns/op"
+				<< "	misaligned " << misaligned_count
+				<< std::endl;
+		}
+		// 小サイズを多数確保した状態でのブロック管理情報の割合.
+		void ReportSmallObjectOverhead(TlsfAllocatorCore& allocator, u64 alloc_size, int alloc_count)
+		{
+			std::vector<void*> ptr_array(alloc_count, nullptr);
+			for (int i = 0; i < alloc_count; ++i)
+			{
+				ptr_array[i] = allocator.Allocate(alloc_size);
+			}
+
+			const TlsfAllocatorCoreUsage usage = allocator.GetUsage();
+			// 要求サイズに対して実際に消費したブロックサイズの割合.
+			const double request_size = static_cast<double>(alloc_size) * usage.used_block_count;
+			std::cout << "	small object " << alloc_size
+				<< "	: overhead ratio " << usage.GetOverheadRatio()
+				<< "	block/request " << ((0.0 < request_size) ? (usage.used_block_size / request_size) : 0.0)
+				<< std::endl;
+
+			for (auto p : ptr_array)
+			{
+				allocator.Deallocate(p);
+			}
+		}
+	}
+
+	namespace
+	{
+		// 統計カウンタがブロック走査の結果と一致するか, 取得コストは十分小さいか.
+		void TestStatistics(TlsfAllocatorCore& allocator, int alloc_count)
+		{
+			std::mt19937 rand(7);
+			std::uniform_int_distribution<u64> size_dist(8, 4096);
+
+			allocator.EnableAllocationTag(true);
+			std::vector<void*> ptr_array;
+			for (int i = 0; i < alloc_count; ++i)
+			{
+				const char* tag = (0 == (i % 3)) ? "statistics_a" : "statistics_b";
+				ptr_array.push_back(allocator.Allocate(size_dist(rand), tag));
+			}
+			// 半分解放して断片化させる.
+			for (int i = 0; i < alloc_count; i += 2)
+			{
+				allocator.Deallocate(ptr_array[i]);
+				ptr_array[i] = nullptr;
+			}
+
+			constexpr int k_sample_count = 10000;
+			TlsfAllocatorCoreStatistics stat = {};
+			const auto t0 = Clock::now();
+			for (int i = 0; i < k_sample_count; ++i)
+			{
+				stat = allocator.GetStatistics();
+			}
+			const auto t1 = Clock::now();
+
+			const TlsfAllocatorCoreUsage usage = allocator.GetUsage();
+			const bool is_consistent = (stat.used_size == usage.used_data_size)
+				&& (stat.used_block_count == usage.used_block_count)
+				&& (stat.free_size == usage.free_data_size)
+				&& (stat.free_block_count == usage.free_block_count);
+
+			TlsfAllocatorCore::FreeBlockHistogram histogram;
+			allocator.GetFreeBlockHistogram(histogram);
+			u32 histogram_count = 0;
+			for (const auto& fl : histogram.count)
+			{
+				for (auto c : fl)
+					histogram_count += c;
+			}
+
+			std::vector<TlsfAllocationTagStatistics> tag_stat;
+			allocator.GetAllocationTagStatistics(tag_stat);
+			u32 tag_block_count = 0;
+			for (const auto& e : tag_stat)
+				tag_block_count += e.block_count;
+
+			std::cout << "	statistics	: GetStatistics " << (ElapsedNanoSec(t0, t1) / k_sample_count) << " ns/op"
+				<< "	used " << stat.used_size << " (peak " << stat.peak_used_size << ")"
+				<< "	free block " << stat.free_block_count
+				<< "	largest free " << stat.largest_free_size
+				<< "	fragmentation " << stat.GetFragmentationRatio()
+				<< "	consistent " << (is_consistent && (histogram_count == stat.free_block_count) && (tag_block_count == stat.used_block_count))
+				<< std::endl;
+			for (const auto& e : tag_stat)
+			{
+				std::cout << "		tag " << e.tag << "	: block " << e.block_count << "	size " << e.used_size << std::endl;
+			}
+
+			for (auto p : ptr_array)
+			{
+				if (nullptr != p)
+					allocator.Deallocate(p);
+			}
+			allocator.EnableAllocationTag(false);
+		}
+	}
+
+	void TlsfAllocatorCoreBenchmark()
+	{
+		constexpr u64 k_pool_size = 256 * 1024 * 1024;
+		std::vector<u8> pool_memory(k_pool_size);
+
+		TlsfAllocatorCore allocator;
+		if (!allocator.Initialize(pool_memory.data(), k_pool_size))
+		{
+			assert(false);
+			return;
+		}
+
+		std::cout << "[TlsfAllocatorCoreBenchmark]" << std::endl;
+
+		constexpr u64 k_size_class[] = { 16, 64, 256, 1024, 4 * 1024, 64 * 1024 };
+		for (auto size : k_size_class)
+		{
+			// プールに収まる範囲の個数で計測.
+			const int alloc_count = static_cast<int>(std::min<u64>(10000, (k_pool_size / 2) / (size + 64)));
+			BenchmarkFixedSize(allocator, size, alloc_count, 10);
+		}
+		BenchmarkRandomSize(allocator, 8, 512, 1000000);
+		BenchmarkRandomSize(allocator, 8, 64 * 1024, 1000000);
+
+		constexpr u32 k_alignment[] = { 16, 64, 256, 4096 };
+		for (auto alignment : k_alignment)
+		{
+			BenchmarkAligned(allocator, alignment, 10000);
+		}
+
+		constexpr u64 k_small_object_size[] = { 8, 16, 24, 48 };
+		for (auto size : k_small_object_size)
+		{
+			ReportSmallObjectOverhead(allocator, size, 10000);
+		}
+
+		TestStatistics(allocator, 10000);
+
+		// 全て解放されているはず.
+		allocator.LeakReport();
+		allocator.Destroy();
+
+		std::cout << "Test End TlsfAllocatorCoreBenchmark" << std::endl;
+	}
+}
+}
+}
@@ -0,0 +1,17 @@
+﻿#pragma once
+
+#include "tlsf_allocator_core.h"
+
+
+namespace ngl
+{
+namespace memory
+{
+namespace test
+{
+	// TlsfAllocatorCoreのAllocate/Deallocateのサイズ別計測.
+	// 結果は標準出力にns/opで出力する.
+	void TlsfAllocatorCoreBenchmark();
+}
+}
+}
@@ -0,0 +1,517 @@
+﻿
+#include "ngl/memory/tlsf_concurrent_allocator.h"
+#include "ngl/util/bit_operation.h"
+
+#include <new>
+#include <vector>
+#include <algorithm>
+
+namespace ngl
+{
+	namespace memory
+	{
+		namespace
+		{
+			// Initialize毎に一意な値を発行する.
+			std::atomic<u64> s_serial_counter = 0;
+
+			// スレッド毎に直前に利用したアロケータとキャッシュを覚えておき, 通常はロック無しでキャッシュを引く.
+			struct ThreadCacheEntry
+			{
+				const void*	allocator = nullptr;
+				u64			serial = 0;
+				void*		cache = nullptr;
+			};
+			thread_local ThreadCacheEntry tls_thread_cache_entry = {};
+
+			// 生存中のアロケータのserial. スレッド終了時の返却で破棄済みのアロケータに触れないように判定する.
+			std::mutex& GetLiveAllocatorMutex()
+			{
+				static std::mutex s_mutex;
+				return s_mutex;
+			}
+			std::vector<u64>& GetLiveAllocatorSerial()
+			{
+				static std::vector<u64> s_serial;
+				return s_serial;
+			}
+			void RegisterLiveAllocator(u64 serial)
+			{
+				std::unique_lock<std::mutex> lock(GetLiveAllocatorMutex());
+				GetLiveAllocatorSerial().push_back(serial);
+			}
+			void UnregisterLiveAllocator(u64 serial)
+			{
+				std::unique_lock<std::mutex> lock(GetLiveAllocatorMutex());
+				auto& serial_array = GetLiveAllocatorSerial();
+				serial_array.erase(std::remove(serial_array.begin(), serial_array.end(), serial), serial_array.end());
+			}
+		}
+
+		// スレッドが割り当てを受けたキャッシュを記録し, スレッドローカル変数の破棄(スレッド終了)時に返却する.
+		struct TlsfConcurrentAllocator::ThreadExitReleaser
+		{
+			struct Entry
+			{
+				TlsfConcurrentAllocator*	allocator = nullptr;
+				u64							serial = 0;
+				ThreadCache*				cache = nullptr;
+			};
+			std::vector<Entry> entry_array;
+
+			void Add(TlsfConcurrentAllocator* allocator, u64 serial, ThreadCache* cache)
+			{
+				// 同じアロケータの以前のInitializeでの記録は不要.
+				entry_array.erase(std::remove_if(entry_array.begin(), entry_array.end(), [allocator](const Entry& e) { return e.allocator == allocator; }), entry_array.end());
+				entry_array.push_back({ allocator, serial, cache });
+			}
+
+			~ThreadExitReleaser()
+			{
+				// 返却中にDestroyされないようにロックしたまま返却する.
+				std::unique_lock<std::mutex> lock(GetLiveAllocatorMutex());
+				const auto& serial_array = GetLiveAllocatorSerial();
+				for (const auto& e : entry_array)
+				{
+					if (serial_array.end() != std::find(serial_array.begin(), serial_array.end(), e.serial))
+						e.allocator->ReleaseThreadCache(e.cache);
+				}
+			}
+		};
+
+		TlsfConcurrentAllocator::TlsfConcurrentAllocator()
+		{
+		}
+		TlsfConcurrentAllocator::~TlsfConcurrentAllocator()
+		{
+			Destroy();
+		}
+
+		bool TlsfConcurrentAllocator::Initialize(void* manage_memory, u64 size)
+		{
+			Destroy();
+			bool success = allocator_.Initialize(manage_memory, size);
+			if (success)
+			{
+				manage_memory_ = manage_memory;
+				is_outer_manage_memory_ = true;
+				serial_ = ++s_serial_counter;
+				RegisterLiveAllocator(serial_);
+			}
+			return success;
+		}
+		// 内部で管理用メモリ確保
+		// 解放責任は内部
+		bool TlsfConcurrentAllocator::Initialize(u64 size)
+		{
+			Destroy();
+			void* manage_memory = new u8[size];
+			if (NULL == manage_memory)
+				return false;
+
+			bool success = allocator_.Initialize(manage_memory, size);
+			if (success)
+			{
+				manage_memory_ = manage_memory;
+				is_outer_manage_memory_ = false;
+				serial_ = ++s_serial_counter;
+				RegisterLiveAllocator(serial_);
+			}
+			else
+			{
+				delete[] reinterpret_cast<u8*>(manage_memory);
+				manage_memory = NULL;
+			}
+			return success;
+		}
+		void TlsfConcurrentAllocator::Destroy()
+		{
+			// 以降に終了するスレッドからキャッシュを返却させない. 返却中であれば完了を待つ.
+			if (0 != serial_)
+			{
+				UnregisterLiveAllocator(serial_);
+			}
+
+			// キャッシュのリセット. 回収待ちスタックは管理メモリ上のノードを辿るため管理メモリの解放前に空にする.
+			for (u32 i = 0; i < k_max_thread_cache; ++i)
+			{
+				ThreadCache& cache = thread_cache_[i];
+				if (nullptr != manage_memory_)
+				{
+					cache.remote_free.PopAll();
+				}
+				cache.thread_id = {};
+				cache.index = i;
+				cache.is_active = false;
+				for (u32 c = 0; c < k_size_class_count; ++c)
+				{
+					cache.free_list[c] = nullptr;
+					cache.free_count[c] = 0;
+				}
+				cache.allocate_count = 0;
+				cache.deallocate_count = 0;
+				cache.cache_hit_count = 0;
+				cache.refill_count = 0;
+				cache.flush_count = 0;
+				cache.remote_drain_count = 0;
+			}
+			thread_cache_count_ = 0;
+
+			remote_free_count_ = 0;
+			uncached_allocate_count_ = 0;
+			uncached_deallocate_count_ = 0;
+			core_lock_count_ = 0;
+			core_lock_contention_count_ = 0;
+
+			allocator_.Destroy();
+
+			if (!is_outer_manage_memory_)
+			{
+				delete[] reinterpret_cast<u8*>(manage_memory_);
+			}
+			manage_memory_ = NULL;
+			is_outer_manage_memory_ = false;
+			serial_ = 0;
+		}
+
+		void* TlsfConcurrentAllocator::Allocate(u64 size)
+		{
+			if (0 == size)
+				return NULL;
+
+			const u32 size_class = GetSizeClass(size);
+			if (k_large_size_class != size_class)
+			{
+				if (ThreadCache* cache = GetThreadCache())
+				{
+					IncrementCounter(cache->allocate_count);
+
+					if (nullptr != cache->free_list[size_class])
+					{
+						IncrementCounter(cache->cache_hit_count);
+						return PopFreeList(cache, size_class);
+					}
+
+					// 別スレッドから返却されたブロックを回収してから, それでも無ければ共有コアから補充.
+					DrainRemoteFree(cache);
+					if (nullptr == cache->free_list[size_class])
+					{
+						Refill(cache, size_class);
+					}
+					return PopFreeList(cache, size_class);
+				}
+			}
+
+			// キャッシュ対象外サイズ, もしくはキャッシュを割り当てられなかったスレッドは共有コアから直接確保.
+			uncached_allocate_count_.fetch_add(1, std::memory_order_relaxed);
+			LockCore();
+			void* mem = AllocateFromCore(size, size_class, k_invalid_owner);
+			UnlockCore();
+			return mem;
+		}
+
+		bool TlsfConcurrentAllocator::Deallocate(void* mem)
+		{
+			if (NULL == mem)
+				return false;
+
+			BlockHeader* header = GetHeader(mem);
+			const u32 owner = header->owner;
+			if (k_invalid_owner == owner)
+			{
+				uncached_deallocate_count_.fetch_add(1, std::memory_order_relaxed);
+				LockCore();
+				DeallocateToCore(mem);
+				UnlockCore();
+				return true;
+			}
+
+			const u32 size_class = header->size_class;
+			ThreadCache* cache = GetThreadCache();
+			if (nullptr != cache && cache->index == owner)
+			{
+				// 自スレッドで確保したブロックはローカルフリーリストへ.
+				IncrementCounter(cache->deallocate_count);
+				PushFreeList(cache, size_class, mem);
+
+				// キャッシュが溜まり過ぎたら一括補充数分を共有コアへ返却.
+				const u32 batch = GetBatchCount(size_class);
+				if (cache->free_count[size_class] > batch * 2)
+				{
+					Flush(cache, size_class, batch);
+				}
+				return true;
+			}
+
+			// 確保元スレッドが終了済みであれば共有コアへ直接返却する.
+			remote_free_count_.fetch_add(1, std::memory_order_relaxed);
+			if (!thread_cache_[owner].is_active.load(std::memory_order_acquire))
+			{
+				LockCore();
+				DeallocateToCore(mem);
+				UnlockCore();
+				return true;
+			}
+			// 別スレッドで確保したブロックは確保元スレッドの回収待ちスタックへ.
+			// 確保元スレッドの終了と競合した場合は枠を再利用したスレッド, またはLeakReportとDestroyで回収される.
+			RemoteFreeNode* node = new(mem) RemoteFreeNode();
+			thread_cache_[owner].remote_free.Push(node);
+			return true;
+		}
+
+		void TlsfConcurrentAllocator::FlushThreadCache()
+		{
+			ThreadCache* cache = GetThreadCache();
+			if (nullptr == cache)
+				return;
+
+			DrainRemoteFree(cache);
+			for (u32 c = 0; c < k_size_class_count; ++c)
+			{
+				Flush(cache, c, cache->free_count[c]);
+			}
+		}
+
+		void TlsfConcurrentAllocator::LeakReport()
+		{
+			// キャッシュ上のブロックは共有コアからは使用中に見えるため, 全て返却してからチェックする.
+			const u32 cache_count = thread_cache_count_.load();
+			for (u32 i = 0; i < cache_count && i < k_max_thread_cache; ++i)
+			{
+				ThreadCache* cache = &thread_cache_[i];
+				DrainRemoteFree(cache);
+				for (u32 c = 0; c < k_size_class_count; ++c)
+				{
+					Flush(cache, c, cache->free_count[c]);
+				}
+			}
+
+			LockCore();
+			allocator_.LeakReport();
+			UnlockCore();
+		}
+
+		TlsfConcurrentAllocatorStatistics TlsfConcurrentAllocator::GetStatistics() const
+		{
+			TlsfConcurrentAllocatorStatistics stat = {};
+
+			const u32 cache_count = thread_cache_count_.load(std::memory_order_acquire);
+			for (u32 i = 0; i < cache_count && i < k_max_thread_cache; ++i)
+			{
+				const ThreadCache& cache = thread_cache_[i];
+				if (cache.is_active.load(std::memory_order_relaxed))
+					++stat.active_thread_cache_count;
+				stat.allocate_count += cache.allocate_count.load(std::memory_order_relaxed);
+				stat.deallocate_count += cache.deallocate_count.load(std::memory_order_relaxed);
+				stat.cache_hit_count += cache.cache_hit_count.load(std::memory_order_relaxed);
+				stat.refill_count += cache.refill_count.load(std::memory_order_relaxed);
+				stat.flush_count += cache.flush_count.load(std::memory_order_relaxed);
+				stat.remote_drain_count += cache.remote_drain_count.load(std::memory_order_relaxed);
+			}
+
+			stat.uncached_allocate_count = uncached_allocate_count_.load(std::memory_order_relaxed);
+			stat.remote_free_count = remote_free_count_.load(std::memory_order_relaxed);
+			stat.allocate_count += stat.uncached_allocate_count;
+			stat.deallocate_count += uncached_deallocate_count_.load(std::memory_order_relaxed) + stat.remote_free_count;
+			stat.core_lock_count = core_lock_count_.load(std::memory_order_relaxed);
+			stat.core_lock_contention_count = core_lock_contention_count_.load(std::memory_order_relaxed);
+			stat.thread_cache_count = (cache_count < k_max_thread_cache) ? cache_count : k_max_thread_cache;
+			return stat;
+		}
+
+
+		TlsfConcurrentAllocator::ThreadCache* TlsfConcurrentAllocator::GetThreadCache()
+		{
+			const ThreadCacheEntry& entry = tls_thread_cache_entry;
+			if (entry.allocator == this && entry.serial == serial_)
+			{
+				return reinterpret_cast<ThreadCache*>(entry.cache);
+			}
+			return RegisterThreadCache();
+		}
+		TlsfConcurrentAllocator::ThreadCache* TlsfConcurrentAllocator::RegisterThreadCache()
+		{
+			const std::thread::id thread_id = std::this_thread::get_id();
+			ThreadCache* cache = nullptr;
+			{
+				std::unique_lock<std::mutex> lock(registry_mutex_);
+
+				// 別のアロケータを挟んで利用していた場合は割り当て済みのキャッシュがある.
+				const u32 cache_count = thread_cache_count_.load(std::memory_order_relaxed);
+				for (u32 i = 0; i < cache_count; ++i)
+				{
+					if (thread_cache_[i].thread_id == thread_id)
+					{
+						cache = &thread_cache_[i];
+						break;
+					}
+				}
+				if (nullptr == cache)
+				{
+					// 終了したスレッドが返却した枠を優先して再利用する.
+					ThreadCache* new_cache = nullptr;
+					for (u32 i = 0; i < cache_count; ++i)
+					{
+						if (std::thread::id() == thread_cache_[i].thread_id)
+						{
+							new_cache = &thread_cache_[i];
+							break;
+						}
+					}
+					if (nullptr == new_cache && k_max_thread_cache > cache_count)
+					{
+						new_cache = &thread_cache_[cache_count];
+						thread_cache_count_.store(cache_count + 1, std::memory_order_release);
+					}
+					if (nullptr != new_cache)
+					{
+						new_cache->thread_id = thread_id;
+						new_cache->is_active.store(true, std::memory_order_release);
+
+						thread_local ThreadExitReleaser tls_thread_exit_releaser;
+						tls_thread_exit_releaser.Add(this, serial_, new_cache);
+						cache = new_cache;
+					}
+				}
+			}
+
+			// 割り当てられなかった場合もnullptrを記録して再検索を避ける.
+			ThreadCacheEntry& entry = tls_thread_cache_entry;
+			entry.allocator = this;
+			entry.serial = serial_;
+			entry.cache = cache;
+			return cache;
+		}
+
+		void TlsfConcurrentAllocator::ReleaseThreadCache(ThreadCache* cache)
+		{
+			// 以降の別スレッドからの解放は共有コアへ直接返却される.
+			cache->is_active.store(false, std::memory_order_release);
+
+			DrainRemoteFree(cache);
+			for (u32 c = 0; c < k_size_class_count; ++c)
+			{
+				Flush(cache, c, cache->free_count[c]);
+			}
+
+			// 返却が済んでから他のスレッドへの割り当てを許可する.
+			std::unique_lock<std::mutex> lock(registry_mutex_);
+			cache->thread_id = {};
+		}
+
+		u32 TlsfConcurrentAllocator::GetSizeClass(u64 size)
+		{
+			if (k_max_cached_size < size)
+				return k_large_size_class;
+			if ((u64(1) << k_min_size_class_exp) >= size)
+				return 0;
+			// 切り上げた2の冪乗の指数からサイズクラスを求める.
+			return static_cast<u32>(MostSignificantBit64Fast(size - 1) + 1) - k_min_size_class_exp;
+		}
+		u32 TlsfConcurrentAllocator::GetSizeClassByteSize(u32 size_class)
+		{
+			return 1u << (k_min_size_class_exp + size_class);
+		}
+		u32 TlsfConcurrentAllocator::GetBatchCount(u32 size_class)
+		{
+			// 一回の補充でおよそ8KBを確保する. 最小4, 最大64個.
+			const u32 count = (8 * 1024) / GetSizeClassByteSize(size_class);
+			return (4 > count) ? 4 : ((64 < count) ? 64 : count);
+		}
+
+		void TlsfConcurrentAllocator::LockCore()
+		{
+			if (!core_mutex_.try_lock())
+			{
+				core_lock_contention_count_.fetch_add(1, std::memory_order_relaxed);
+				core_mutex_.lock();
+			}
+			core_lock_count_.fetch_add(1, std::memory_order_relaxed);
+		}
+		void TlsfConcurrentAllocator::UnlockCore()
+		{
+			core_mutex_.unlock();
+		}
+
+		void* TlsfConcurrentAllocator::AllocateFromCore(u64 size, u32 size_class, u32 owner)
+		{
+			// 共有コアの確保メモリはk_data_alignmentに揃っているため, ヘッダ分を加えて確保する.
+			void* raw = allocator_.Allocate(size + k_data_alignment);
+			if (NULL == raw)
+				return NULL;
+
+			BlockHeader* header = reinterpret_cast<BlockHeader*>(raw);
+			header->size_class = size_class;
+			header->owner = owner;
+			return reinterpret_cast<u8*>(raw) + k_data_alignment;
+		}
+		void TlsfConcurrentAllocator::DeallocateToCore(void* mem)
+		{
+			allocator_.Deallocate(reinterpret_cast<u8*>(mem) - k_data_alignment);
+		}
+
+		void TlsfConcurrentAllocator::Refill(ThreadCache* cache, u32 size_class)
+		{
+			const u32 batch = GetBatchCount(size_class);
+			const u64 byte_size = GetSizeClassByteSize(size_class);
+
+			IncrementCounter(cache->refill_count);
+			LockCore();
+			for (u32 i = 0; i < batch; ++i)
+			{
+				void* mem = AllocateFromCore(byte_size, size_class, cache->index);
+				if (NULL == mem)
+					break;
+				PushFreeList(cache, size_class, mem);
+			}
+			UnlockCore();
+		}
+		void TlsfConcurrentAllocator::Flush(ThreadCache* cache, u32 size_class, u32 count)
+		{
+			if (0 == count || nullptr == cache->free_list[size_class])
+				return;
+
+			IncrementCounter(cache->flush_count);
+			LockCore();
+			for (u32 i = 0; i < count; ++i)
+			{
+				void* mem = PopFreeList(cache, size_class);
+				if (NULL == mem)
+					break;
+				DeallocateToCore(mem);
+			}
+			UnlockCore();
+		}
+		void TlsfConcurrentAllocator::DrainRemoteFree(ThreadCache* cache)
+		{
+			// 回収待ちは所有スレッドのみが取り出すため, まとめて取り出してからリストを辿る.
+			RemoteFreeNode* next = cache->remote_free.PopAll();
+			while (RemoteFreeNode* node = next)
+			{
+				next = node->GetNext();
+				node->~RemoteFreeNode();
+
+				void* mem = node;
+				PushFreeList(cache, GetHeader(mem)->size_class, mem);
+				IncrementCounter(cache->remote_drain_count);
+			}
+		}
+
+		void TlsfConcurrentAllocator::PushFreeList(ThreadCache* cache, u32 size_class, void* mem)
+		{
+			*reinterpret_cast<void**>(mem) = cache->free_list[size_class];
+			cache->free_list[size_class] = mem;
+			++cache->free_count[size_class];
+		}
+		void* TlsfConcurrentAllocator::PopFreeList(ThreadCache* cache, u32 size_class)
+		{
+			void* mem = cache->free_list[size_class];
+			if (nullptr != mem)
+			{
+				cache->free_list[size_class] = *reinterpret_cast<void**>(mem);
+				--cache->free_count[size_class];
+			}
+			return mem;
+		}
+	}
+}
@@ -0,0 +1,223 @@
+﻿#pragma once
+#ifndef _NGL_MEMORY_TLSF_CONCURRENT_ALLOCATOR_
+#define _NGL_MEMORY_TLSF_CONCURRENT_ALLOCATOR_
+
+/*
+	マルチスレッド対応TLSFアロケータ
+		共有のTlsfAllocatorCoreをMutexで保護し, その前段にスレッド毎の小サイズブロックキャッシュを置く.
+		小サイズの確保解放は基本的にスレッドローカルなキャッシュで完結し, キャッシュが空になった場合のみ
+		共有コアからまとめて補充する.
+		別スレッドが確保したブロックの解放はロックフリーのスタックで確保元スレッドへ返却され,
+		確保元スレッドがキャッシュを補充する際に回収する.
+		スレッドの終了時にはそのスレッドのキャッシュを共有コアへ返却し, キャッシュの枠を他のスレッドで再利用する.
+
+	ngl::memory::TlsfConcurrentAllocator allocator;
+	allocator.Initialize(64 * 1024 * 1024);
+
+	// 任意のスレッドから.
+	void* p = allocator.Allocate(48);
+	allocator.Deallocate(p);
+
+	// スレッドの終了を待たずにキャッシュをコアへ返却する場合.
+	allocator.FlushThreadCache();
+
+	allocator.Destroy();
+*/
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <array>
+
+#include "ngl/util/types.h"
+#include "ngl/memory/tlsf_allocator_core.h"
+#include "ngl/thread/lockfree_stack_intrusive.h"
+
+namespace ngl
+{
+	namespace memory
+	{
+		// 統計情報.
+		struct TlsfConcurrentAllocatorStatistics
+		{
+			u64 allocate_count				= 0;
+			u64 deallocate_count			= 0;
+			// スレッドキャッシュから供給した数.
+			u64 cache_hit_count				= 0;
+			// 共有コアからのまとめての補充回数.
+			u64 refill_count				= 0;
+			// キャッシュ過多による共有コアへのまとめての返却回数.
+			u64 flush_count					= 0;
+			// 別スレッドからの解放要求数.
+			u64 remote_free_count			= 0;
+			// 別スレッドからの解放要求を回収した数.
+			u64 remote_drain_count			= 0;
+			// スレッドキャッシュを経由せず共有コアから直接確保した数. キャッシュ対象外サイズ等.
+			u64 uncached_allocate_count		= 0;
+			// 共有コアのロック回数と, そのうち他スレッドと競合した回数.
+			u64 core_lock_count				= 0;
+			u64 core_lock_contention_count	= 0;
+			// キャッシュを割り当てられたことのある枠の数.
+			u32 thread_cache_count			= 0;
+			// 現在キャッシュを割り当てているスレッド数. 終了したスレッドの枠は含まない.
+			u32 active_thread_cache_count	= 0;
+		};
+
+		class TlsfConcurrentAllocator
+		{
+		public:
+			// キャッシュ対象のサイズクラス. 16,32,64,128,256,512 byte.
+			static constexpr u32 k_size_class_count = 6;
+			static constexpr u32 k_min_size_class_exp = 4;
+			static constexpr u32 k_max_cached_size = 1u << (k_min_size_class_exp + k_size_class_count - 1);
+			// 同時にキャッシュを割り当て可能なスレッド数. これを超えたスレッドはキャッシュ無しで共有コアを直接利用する.
+			// 終了したスレッドの枠は再利用される.
+			static constexpr u32 k_max_thread_cache = 64;
+			// ユーザ領域のアライメント. 共有コアの保証アライメントと同じ.
+			static constexpr u32 k_data_alignment = BoundaryTagBlock::ALIGNMENT;
+
+			TlsfConcurrentAllocator();
+			~TlsfConcurrentAllocator();
+
+			// 外部から管理メモリを渡す
+			// 解放責任は外
+			bool Initialize(void* manage_memory, u64 size);
+			// 内部で管理用メモリ確保
+			// 解放責任は内部
+			bool Initialize(u64 size);
+
+			// 全スレッドがアロケータを利用していない状態で呼ぶこと.
+			void Destroy();
+
+			// 任意のスレッドから呼び出し可能.
+			void* Allocate(u64 size);
+			// 任意のスレッドから呼び出し可能. 別スレッドで確保したメモリも解放できる.
+			bool Deallocate(void* mem);
+
+			// 呼び出しスレッドのキャッシュと回収待ちのブロックを全て共有コアへ返却する.
+			// スレッドの終了時には自動で返却されるため, 終了前に呼ぶ必要はない.
+			void FlushThreadCache();
+
+			// メモリリークのチェック
+			// 全スレッドのキャッシュを共有コアへ返却してから標準出力にリーク情報を出力する.
+			// 全スレッドがアロケータを利用していない状態で呼ぶこと.
+			void LeakReport();
+
+			// 統計情報の取得. 各値は取得中にも更新されるため概算.
+			TlsfConcurrentAllocatorStatistics GetStatistics() const;
+
+		private:
+			static constexpr u32 k_invalid_owner = ~u32(0);
+			static constexpr u32 k_large_size_class = ~u32(0);
+
+			// ユーザ領域の直前に配置するヘッダ. 共有コアから確保したポインタの位置に配置する.
+			struct BlockHeader
+			{
+				u32		size_class;		// サイズクラス. キャッシュ対象外はk_large_size_class.
+				u32		owner;			// 確保元スレッドキャッシュのインデックス. キャッシュ無しはk_invalid_owner.
+			};
+			static_assert(sizeof(BlockHeader) <= k_data_alignment, "");
+
+			// 別スレッドからの解放用ノード. 解放されたブロックのユーザ領域に配置される.
+			struct RemoteFreeNode : public thread::LockFreeStackIntrusive<RemoteFreeNode>::Node
+			{
+			};
+			static_assert(sizeof(RemoteFreeNode) <= (1u << k_min_size_class_exp), "");
+
+			// スレッド毎のキャッシュ. 他スレッドとの偽共有を避けるためキャッシュライン境界に揃える.
+			struct alignas(64) ThreadCache
+			{
+				// 所有スレッド. 未割り当ての枠は空.
+				std::thread::id	thread_id = {};
+				u32				index = k_invalid_owner;
+				// 所有スレッドが利用中か. falseの枠へ解放されたブロックは共有コアへ直接返却する.
+				std::atomic<bool>	is_active = false;
+
+				// ローカルフリーリスト. ユーザ領域の先頭にnextを格納する単方向リスト. 所有スレッドのみアクセス.
+				void*			free_list[k_size_class_count] = {};
+				u32				free_count[k_size_class_count] = {};
+
+				// 別スレッドから解放されたブロック.
+				thread::LockFreeStackIntrusive<RemoteFreeNode> remote_free;
+
+				// 統計. 所有スレッドのみ書き込み.
+				std::atomic<u64>	allocate_count = 0;
+				std::atomic<u64>	deallocate_count = 0;
+				std::atomic<u64>	cache_hit_count = 0;
+				std::atomic<u64>	refill_count = 0;
+				std::atomic<u64>	flush_count = 0;
+				std::atomic<u64>	remote_drain_count = 0;
+			};
+
+			// スレッド終了時にキャッシュを返却する. スレッド毎に1つ.
+			struct ThreadExitReleaser;
+
+			// 呼び出しスレッドのキャッシュを取得. 割り当てられなければnullptr.
+			ThreadCache* GetThreadCache();
+			ThreadCache* RegisterThreadCache();
+			// キャッシュを全て共有コアへ返却して枠を未割り当てに戻す. 所有スレッドの終了時に呼ばれる.
+			void ReleaseThreadCache(ThreadCache* cache);
+
+			static u32 GetSizeClass(u64 size);
+			static u32 GetSizeClassByteSize(u32 size_class);
+			// サイズクラス毎の一括補充数.
+			static u32 GetBatchCount(u32 size_class);
+
+			// 共有コアのロック.
+			void LockCore();
+			void UnlockCore();
+
+			// 共有コアから確保してヘッダを設定する. ロックは呼び出し側.
+			void* AllocateFromCore(u64 size, u32 size_class, u32 owner);
+			// 共有コアへ返却する. ロックは呼び出し側.
+			void DeallocateToCore(void* mem);
+
+			// 共有コアからまとめて補充.
+			void Refill(ThreadCache* cache, u32 size_class);
+			// 指定数をキャッシュから共有コアへまとめて返却.
+			void Flush(ThreadCache* cache, u32 size_class, u32 count);
+			// 別スレッドから解放されたブロックをローカルフリーリストへ回収.
+			void DrainRemoteFree(ThreadCache* cache);
+
+			void PushFreeList(ThreadCache* cache, u32 size_class, void* mem);
+			void* PopFreeList(ThreadCache* cache, u32 size_class);
+
+			static BlockHeader* GetHeader(void* mem)
+			{
+				return reinterpret_cast<BlockHeader*>(reinterpret_cast<u8*>(mem) - k_data_alignment);
+			}
+
+			// 所有スレッドのみが書き込むカウンタの加算. ロック命令を避ける.
+			static void IncrementCounter(std::atomic<u64>& counter)
+			{
+				counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			}
+
+		private:
+			TlsfAllocatorCore	allocator_ = {};
+			std::mutex			core_mutex_;
+
+			// スレッドキャッシュの割り当て用.
+			std::mutex			registry_mutex_;
+			std::atomic<u32>	thread_cache_count_ = 0;
+			std::array<ThreadCache, k_max_thread_cache> thread_cache_{};
+
+			// Initialize毎に一意な値. スレッドローカルのキャッシュ参照の有効性判定に利用.
+			u64					serial_ = 0;
+
+			// キャッシュ外からの統計.
+			std::atomic<u64>	remote_free_count_ = 0;
+			std::atomic<u64>	uncached_allocate_count_ = 0;
+			std::atomic<u64>	uncached_deallocate_count_ = 0;
+			std::atomic<u64>	core_lock_count_ = 0;
+			std::atomic<u64>	core_lock_contention_count_ = 0;
+
+			// アロケータ管理メモリが外部確保か?
+			// 外部確保の場合はDestroy()内部で解放しない
+			bool				is_outer_manage_memory_ = false;
+			void*				manage_memory_ = nullptr;
+		};
+	}
+}
+
+#endif // _NGL_MEMORY_TLSF_CONCURRENT_ALLOCATOR_
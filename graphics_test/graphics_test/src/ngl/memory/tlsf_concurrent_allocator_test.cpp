@@ -0,0 +1,258 @@
+﻿
+#include "tlsf_concurrent_allocator_test.h"
+
+#include <thread>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <iostream>
+
+#include <assert.h>
+
+namespace ngl
+{
+namespace memory
+{
+namespace test
+{
+	namespace
+	{
+		using Clock = std::chrono::steady_clock;
+
+		constexpr int k_slot_count = 256;
+		constexpr int k_op_per_thread = 400000;
+
+		// 比較用. 単一Mutexで保護したTlsfAllocatorCore.
+		class MutexTlsfAllocator
+		{
+		public:
+			bool Initialize(void* mem, u64 size)
+			{
+				return core_.Initialize(mem, size);
+			}
+			void* Allocate(u64 size)
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				return core_.Allocate(size);
+			}
+			bool Deallocate(void* mem)
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				return core_.Deallocate(mem);
+			}
+		private:
+			TlsfAllocatorCore core_;
+			std::mutex mutex_;
+		};
+
+		// 各スレッドでスロットに対して確保と解放を繰り返す.
+		template<typename AllocatorT>
+		void StressWorker(AllocatorT* allocator, int thread_index, std::atomic<u64>* fail_count)
+		{
+			std::vector<u8*> slot(k_slot_count, nullptr);
+			u32 rand_state = 0x12345678u + thread_index;
+			for (int i = 0; i < k_op_per_thread; ++i)
+			{
+				rand_state = rand_state * 1664525u + 1013904223u;
+				const int index = (rand_state >> 8) % k_slot_count;
+				if (slot[index])
+				{
+					// 書き込んだ値が他スレッドに壊されていないか.
+					if (slot[index][0] != static_cast<u8>(thread_index))
+						fail_count->fetch_add(1);
+					allocator->Deallocate(slot[index]);
+					slot[index] = nullptr;
+				}
+				else
+				{
+					// 16-512byte中心に時々大きいサイズを混ぜる.
+					const u64 size = (0 == (rand_state & 0xff)) ? 4096 : (16 + ((rand_state >> 16) % 497));
+					slot[index] = reinterpret_cast<u8*>(allocator->Allocate(size));
+					if (slot[index])
+						slot[index][0] = static_cast<u8>(thread_index);
+					else
+						fail_count->fetch_add(1);
+				}
+			}
+			for (auto& e : slot)
+			{
+				if (e)
+					allocator->Deallocate(e);
+			}
+		}
+
+		template<typename AllocatorT>
+		double RunStress(AllocatorT* allocator, int thread_count, std::atomic<u64>* fail_count)
+		{
+			std::vector<std::thread> threads;
+			const auto t0 = Clock::now();
+			for (int i = 0; i < thread_count; ++i)
+			{
+				threads.emplace_back(StressWorker<AllocatorT>, allocator, i, fail_count);
+			}
+			for (auto& e : threads)
+				e.join();
+			const auto t1 = Clock::now();
+
+			const double sec = std::chrono::duration<double>(t1 - t0).count();
+			return static_cast<double>(k_op_per_thread) * thread_count / sec;
+		}
+
+		// 別スレッドで確保したメモリを解放する.
+		void CrossThreadFreeTest(TlsfConcurrentAllocator* allocator, std::atomic<u64>* fail_count)
+		{
+			constexpr int k_thread_count = 4;
+			constexpr int k_alloc_count = 10000;
+			std::vector<std::vector<void*>> ptr_array(k_thread_count);
+
+			std::vector<std::thread> threads;
+			for (int i = 0; i < k_thread_count; ++i)
+			{
+				threads.emplace_back([allocator, &ptr_array, i, fail_count]()
+				{
+					for (int n = 0; n < k_alloc_count; ++n)
+					{
+						void* p = allocator->Allocate(16 + (n % 64) * 8);
+						if (!p)
+							fail_count->fetch_add(1);
+						ptr_array[i].push_back(p);
+					}
+				});
+			}
+			for (auto& e : threads)
+				e.join();
+			threads.clear();
+
+			// 隣のスレッドが確保したものを解放.
+			for (int i = 0; i < k_thread_count; ++i)
+			{
+				threads.emplace_back([allocator, &ptr_array, i, k_thread_count]()
+				{
+					for (auto* p : ptr_array[(i + 1) % k_thread_count])
+						allocator->Deallocate(p);
+					allocator->FlushThreadCache();
+				});
+			}
+			for (auto& e : threads)
+				e.join();
+		}
+
+		// 短命なスレッドを繰り返し生成する. 終了したスレッドのキャッシュは返却されて枠が再利用されるはず.
+		void ThreadChurnTest(TlsfConcurrentAllocator* allocator, std::atomic<u64>* fail_count)
+		{
+			constexpr int k_generation_count = 64;
+			constexpr int k_thread_count = 4;
+			constexpr int k_alloc_count = 256;
+
+			std::vector<void*> survivor_array;
+			for (int g = 0; g < k_generation_count; ++g)
+			{
+				std::vector<std::vector<void*>> ptr_array(k_thread_count);
+				std::vector<std::thread> threads;
+				for (int i = 0; i < k_thread_count; ++i)
+				{
+					threads.emplace_back([allocator, &ptr_array, i, fail_count]()
+					{
+						for (int n = 0; n < k_alloc_count; ++n)
+						{
+							void* p = allocator->Allocate(16 + (n % 32) * 16);
+							if (!p)
+								fail_count->fetch_add(1);
+							// 半分はスレッドの終了後まで残す.
+							if (n & 1)
+								ptr_array[i].push_back(p);
+							else
+								allocator->Deallocate(p);
+						}
+					});
+				}
+				for (auto& e : threads)
+					e.join();
+				for (auto& e : ptr_array)
+					survivor_array.insert(survivor_array.end(), e.begin(), e.end());
+			}
+
+			const auto stat = allocator->GetStatistics();
+			// 全スレッドがキャッシュを割り当てられ, 枠は同時に存在したスレッド数程度に収まる.
+			if (0 != stat.uncached_allocate_count || 0 != stat.active_thread_cache_count || k_thread_count < stat.thread_cache_count)
+				fail_count->fetch_add(1);
+
+			// 終了済みスレッドが確保したブロックの解放は共有コアへ直接返却される.
+			std::thread free_thread([allocator, &survivor_array]()
+			{
+				for (auto* p : survivor_array)
+					allocator->Deallocate(p);
+			});
+			free_thread.join();
+
+			std::cout << "	thread churn : thread " << (k_generation_count * k_thread_count)
+				<< "	cache slot " << stat.thread_cache_count
+				<< "	active " << allocator->GetStatistics().active_thread_cache_count
+				<< std::endl;
+		}
+	}
+
+	void TlsfConcurrentAllocatorTest()
+	{
+		constexpr u64 k_pool_size = 512 * 1024 * 1024;
+		std::vector<u8> pool_memory(k_pool_size);
+		std::atomic<u64> fail_count = 0;
+
+		std::cout << "[TlsfConcurrentAllocatorTest]" << std::endl;
+
+		const int hardware_thread = static_cast<int>(std::thread::hardware_concurrency());
+		const int k_thread_count[] = { 1, 2, 4, 8, 16 };
+		for (int thread_count : k_thread_count)
+		{
+			TlsfConcurrentAllocator concurrent_allocator;
+			if (!concurrent_allocator.Initialize(pool_memory.data(), k_pool_size))
+			{
+				assert(false);
+				return;
+			}
+			const double concurrent_ops = RunStress(&concurrent_allocator, thread_count, &fail_count);
+			const auto stat = concurrent_allocator.GetStatistics();
+			concurrent_allocator.LeakReport();
+			concurrent_allocator.Destroy();
+
+			MutexTlsfAllocator mutex_allocator;
+			mutex_allocator.Initialize(pool_memory.data(), k_pool_size);
+			const double mutex_ops = RunStress(&mutex_allocator, thread_count, &fail_count);
+
+			std::cout << "	thread " << thread_count << ((thread_count > hardware_thread) ? " (oversubscribed)" : "")
+				<< "	: concurrent " << (concurrent_ops / 1000000.0) << " Mops/s"
+				<< "	mutex " << (mutex_ops / 1000000.0) << " Mops/s"
+				<< "	cache hit " << (100.0 * stat.cache_hit_count / (stat.allocate_count ? stat.allocate_count : 1)) << "%"
+				<< "	core lock " << stat.core_lock_count
+				<< " (contention " << stat.core_lock_contention_count << ")"
+				<< std::endl;
+		}
+
+		{
+			TlsfConcurrentAllocator concurrent_allocator;
+			concurrent_allocator.Initialize(pool_memory.data(), k_pool_size);
+			CrossThreadFreeTest(&concurrent_allocator, &fail_count);
+			const auto stat = concurrent_allocator.GetStatistics();
+			std::cout << "	cross thread free : remote free " << stat.remote_free_count << std::endl;
+			// 全て解放されているはず.
+			concurrent_allocator.LeakReport();
+			concurrent_allocator.Destroy();
+		}
+		{
+			TlsfConcurrentAllocator concurrent_allocator;
+			concurrent_allocator.Initialize(pool_memory.data(), k_pool_size);
+			ThreadChurnTest(&concurrent_allocator, &fail_count);
+			// 全て解放されているはず.
+			concurrent_allocator.LeakReport();
+			concurrent_allocator.Destroy();
+		}
+
+		// 確保失敗や他スレッドによる破壊は無いはず.
+		assert(0 == fail_count);
+		std::cout << "	fail count " << fail_count << std::endl;
+
+		std::cout << "Test End TlsfConcurrentAllocatorTest" << std::endl;
+	}
+}
+}
+}
@@ -0,0 +1,17 @@
+﻿#pragma once
+
+#include "tlsf_concurrent_allocator.h"
+
+
+namespace ngl
+{
+namespace memory
+{
+namespace test
+{
+	// TlsfConcurrentAllocatorのマルチスレッドストレステスト.
+	// スレッド数毎のスループットと, 単一Mutexで保護したTlsfAllocatorCoreとの比較を標準出力に出力する.
+	void TlsfConcurrentAllocatorTest();
+}
+}
+}
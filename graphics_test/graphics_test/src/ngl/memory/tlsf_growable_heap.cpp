@@ -0,0 +1,208 @@
+﻿
+#include "ngl/memory/tlsf_growable_heap.h"
+
+#include <iostream>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace ngl
+{
+	namespace memory
+	{
+		namespace
+		{
+			// 管理領域サイズの切り上げ単位. WindowsのVirtualAllocの割り当て粒度に合わせる.
+			constexpr u64 k_region_granularity = 64 * 1024;
+
+			u64 RoundUpRegionSize(u64 size)
+			{
+				return (size + (k_region_granularity - 1)) & ~(k_region_granularity - 1);
+			}
+
+			// OSから仮想メモリを確保.
+			void* OsAllocateRegion(u64 size)
+			{
+#if defined(_WIN32)
+				return VirtualAlloc(nullptr, static_cast<SIZE_T>(size), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+				void* mem = mmap(nullptr, static_cast<size_t>(size), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+				return (MAP_FAILED == mem) ? nullptr : mem;
+#endif
+			}
+			// OSへ仮想メモリを返却.
+			void OsReleaseRegion(void* mem, u64 size)
+			{
+#if defined(_WIN32)
+				VirtualFree(mem, 0, MEM_RELEASE);
+#else
+				munmap(mem, static_cast<size_t>(size));
+#endif
+			}
+		}
+
+		TlsfGrowableHeap::TlsfGrowableHeap()
+		{
+		}
+		TlsfGrowableHeap::~TlsfGrowableHeap()
+		{
+			Destroy();
+		}
+
+		bool TlsfGrowableHeap::Initialize(const Desc& desc)
+		{
+			if (is_initialized_)
+			{
+				// 前回のInitialize()からDestroy()される前に再度Initializeしようとした
+				return false;
+			}
+			desc_ = desc;
+
+			// 初期領域の確保.
+			const u64 initial_size = RoundUpRegionSize(desc_.initial_size);
+			void* mem = OsAllocateRegion(initial_size);
+			if (nullptr == mem)
+				return false;
+			if (!allocator_.Initialize(mem, initial_size, desc_.second_level_exponentiation))
+			{
+				OsReleaseRegion(mem, initial_size);
+				return false;
+			}
+
+			Region region = {};
+			region.mem = mem;
+			region.size = initial_size;
+			region.is_permanent = true;
+			region_array_.push_back(region);
+			reserved_size_ = initial_size;
+
+			is_initialized_ = true;
+			return true;
+		}
+
+		void TlsfGrowableHeap::Destroy()
+		{
+			allocator_.Destroy();
+			for (auto& e : region_array_)
+			{
+				OsReleaseRegion(e.mem, e.size);
+			}
+			region_array_.clear();
+			reserved_size_ = 0;
+			is_initialized_ = false;
+		}
+
+		void* TlsfGrowableHeap::Allocate(u64 size)
+		{
+			if (!is_initialized_)
+				return nullptr;
+
+			void* mem = allocator_.Allocate(size);
+			if (nullptr == mem)
+			{
+				// 管理領域を追加して再試行.
+				if (Grow(size))
+				{
+					mem = allocator_.Allocate(size);
+				}
+			}
+			return mem;
+		}
+
+		bool TlsfGrowableHeap::Deallocate(void* mem)
+		{
+			return allocator_.Deallocate(mem);
+		}
+
+		u32 TlsfGrowableHeap::ReleaseIdleRegions()
+		{
+			if (0.0 > desc_.release_idle_sec)
+				return 0;
+
+			const auto now = Clock::now();
+			u32 release_count = 0;
+			for (auto it = region_array_.begin(); it != region_array_.end();)
+			{
+				Region& region = *it;
+				if (region.is_permanent || !allocator_.IsRegionEmpty(region.mem))
+				{
+					region.is_empty = false;
+					++it;
+					continue;
+				}
+
+				if (!region.is_empty)
+				{
+					// 未使用になったことを検出した時点から計測.
+					region.is_empty = true;
+					region.empty_begin = now;
+				}
+
+				const double idle_sec = std::chrono::duration<double>(now - region.empty_begin).count();
+				if (desc_.release_idle_sec <= idle_sec && allocator_.RemoveRegion(region.mem))
+				{
+					OsReleaseRegion(region.mem, region.size);
+					reserved_size_ -= region.size;
+					it = region_array_.erase(it);
+					++release_count;
+					continue;
+				}
+				++it;
+			}
+			return release_count;
+		}
+
+		void TlsfGrowableHeap::LeakReport()
+		{
+			allocator_.LeakReport();
+		}
+
+		bool TlsfGrowableHeap::Grow(u64 require_size)
+		{
+			// TLSFは要求サイズを次のSLI境界へ切り上げて探索するため, その分の余裕を持たせる.
+			const u64 search_size = require_size + (require_size >> desc_.second_level_exponentiation) + 1;
+			const u64 need_size = search_size + TlsfAllocatorCore::GetRegionOverheadSize();
+			if (TlsfAllocatorCore::REGION_SIZE_MAX < need_size)
+			{
+				// 一つの管理領域に収まらない.
+				return false;
+			}
+
+			u64 region_size = RoundUpRegionSize((desc_.grow_size > need_size) ? desc_.grow_size : need_size);
+			if (TlsfAllocatorCore::REGION_SIZE_MAX < region_size)
+				region_size = TlsfAllocatorCore::REGION_SIZE_MAX;
+
+			if (0 < desc_.max_size && desc_.max_size < reserved_size_ + region_size)
+			{
+				// 上限を超える場合は必要最小限のサイズで再試行.
+				region_size = RoundUpRegionSize(need_size);
+				if (desc_.max_size < reserved_size_ + region_size)
+					return false;
+			}
+			return AddRegion(region_size, false);
+		}
+
+		bool TlsfGrowableHeap::AddRegion(u64 size, bool is_permanent)
+		{
+			void* mem = OsAllocateRegion(size);
+			if (nullptr == mem)
+				return false;
+			if (!allocator_.AddRegion(mem, size))
+			{
+				OsReleaseRegion(mem, size);
+				return false;
+			}
+
+			Region region = {};
+			region.mem = mem;
+			region.size = size;
+			region.is_permanent = is_permanent;
+			region_array_.push_back(region);
+			reserved_size_ += size;
+			return true;
+		}
+	}
+}
@@ -0,0 +1,108 @@
+﻿#pragma once
+#ifndef _NGL_MEMORY_TLSF_GROWABLE_HEAP_
+#define _NGL_MEMORY_TLSF_GROWABLE_HEAP_
+
+/*
+	拡張可能なTLSFヒープ
+		管理メモリが不足した場合にOSから新たな管理領域を確保してTlsfAllocatorCoreに追加する.
+		ブロックのマージは各管理領域内でのみ行われる.
+		追加した管理領域が全て未使用になってから一定時間経過した場合はOSへ返却する.
+		管理領域はOSの仮想メモリ機能(Windows:VirtualAlloc, Linux:mmap)で確保する.
+
+	ngl::memory::TlsfGrowableHeap heap;
+	ngl::memory::TlsfGrowableHeap::Desc desc = {};
+	desc.initial_size = 64 * 1024 * 1024;
+	desc.grow_size = 64 * 1024 * 1024;
+	desc.release_idle_sec = 5.0;
+	heap.Initialize(desc);
+
+	void* p = heap.Allocate(1024);
+	heap.Deallocate(p);
+
+	// フレーム毎などに定期的に呼び出して未使用領域をOSへ返却.
+	heap.ReleaseIdleRegions();
+
+	heap.Destroy();
+*/
+
+#include <vector>
+#include <chrono>
+
+#include "ngl/util/types.h"
+#include "ngl/memory/tlsf_allocator_core.h"
+
+namespace ngl
+{
+	namespace memory
+	{
+		class TlsfGrowableHeap
+		{
+		public:
+			struct Desc
+			{
+				// 初期化時に確保する管理領域サイズ. この領域はDestroyまで返却しない.
+				u64		initial_size = 64 * 1024 * 1024;
+				// 追加する管理領域の最小サイズ. 要求サイズがこれより大きい場合は要求サイズに合わせる.
+				u64		grow_size = 64 * 1024 * 1024;
+				// 管理領域の合計サイズの上限. 0で無制限.
+				u64		max_size = 0;
+				// 追加した管理領域が全て未使用になってからOSへ返却するまでの時間(秒). 負数で返却しない.
+				double	release_idle_sec = 5.0;
+				// 第二レベルの分割数2^nの指数部
+				u32		second_level_exponentiation = 3;
+			};
+
+			TlsfGrowableHeap();
+			~TlsfGrowableHeap();
+
+			bool Initialize(const Desc& desc);
+			void Destroy();
+
+			// 割り当て. 管理メモリが不足した場合は管理領域を追加する.
+			void* Allocate(u64 size);
+			// 割り当て解除
+			bool Deallocate(void* mem);
+
+			// 全て未使用の状態でrelease_idle_sec以上経過した追加領域をOSへ返却する.
+			// フレーム毎などに定期的に呼び出す. 返却した領域数を返す.
+			u32 ReleaseIdleRegions();
+
+			// メモリリークのチェック
+			// 標準出力にリーク情報を出力する
+			void LeakReport();
+
+			// 管理領域数
+			u32 GetRegionCount() const { return static_cast<u32>(region_array_.size()); }
+			// OSから確保している合計サイズ
+			u64 GetReservedSize() const { return reserved_size_; }
+
+		private:
+			using Clock = std::chrono::steady_clock;
+
+			struct Region
+			{
+				void*				mem = nullptr;
+				u64					size = 0;
+				// 初期領域はDestroyまで返却しない.
+				bool				is_permanent = false;
+				// 全て未使用になった時刻. 使用中はis_empty=false.
+				bool				is_empty = false;
+				Clock::time_point	empty_begin = {};
+			};
+
+			// 指定サイズの確保が可能な管理領域を追加する.
+			bool Grow(u64 require_size);
+			// OSから管理領域を確保してアロケータに追加する.
+			bool AddRegion(u64 size, bool is_permanent);
+
+		private:
+			Desc				desc_ = {};
+			TlsfAllocatorCore	allocator_ = {};
+			std::vector<Region>	region_array_ = {};
+			u64					reserved_size_ = 0;
+			bool				is_initialized_ = false;
+		};
+	}
+}
+
+#endif // _NGL_MEMORY_TLSF_GROWABLE_HEAP_
@@ -0,0 +1,95 @@
+﻿
+#include "tlsf_growable_heap_test.h"
+
+#include <vector>
+#include <iostream>
+
+#include <assert.h>
+
+namespace ngl
+{
+namespace memory
+{
+namespace test
+{
+	void TlsfGrowableHeapTest()
+	{
+		std::cout << "[TlsfGrowableHeapTest]" << std::endl;
+
+		// 小さな初期領域から追加領域が必要になるまで確保する.
+		{
+			TlsfGrowableHeap heap;
+			TlsfGrowableHeap::Desc desc = {};
+			desc.initial_size = 1 * 1024 * 1024;
+			desc.grow_size = 4 * 1024 * 1024;
+			desc.release_idle_sec = 0.0;
+			const bool init_result = heap.Initialize(desc);
+			assert(init_result);
+
+			std::vector<void*> ptr_array;
+			for (int i = 0; i < 4096; ++i)
+			{
+				void* p = heap.Allocate(8 * 1024);
+				assert(nullptr != p);
+				ptr_array.push_back(p);
+			}
+			// 領域を超えるサイズも確保できる.
+			void* large = heap.Allocate(16 * 1024 * 1024);
+			assert(nullptr != large);
+
+			const u32 grow_region_count = heap.GetRegionCount();
+			std::cout << "	grow : region " << grow_region_count << "	reserved " << (heap.GetReservedSize() / (1024 * 1024)) << " MB" << std::endl;
+			assert(1 < grow_region_count);
+
+			// 使用中の領域は返却されない.
+			const u32 release_count0 = heap.ReleaseIdleRegions();
+			assert(0 == release_count0);
+
+			for (auto p : ptr_array)
+				heap.Deallocate(p);
+			heap.Deallocate(large);
+
+			// 全て解放したので追加領域は全て返却される.
+			const u32 release_count1 = heap.ReleaseIdleRegions();
+			std::cout << "	release : region " << release_count1 << "	remain " << heap.GetRegionCount() << std::endl;
+			assert(1 == heap.GetRegionCount());
+
+			heap.LeakReport();
+			heap.Destroy();
+		}
+
+		// 4GiBを超える合計サイズ.
+		{
+			TlsfGrowableHeap heap;
+			TlsfGrowableHeap::Desc desc = {};
+			desc.initial_size = 1 * 1024 * 1024;
+			desc.grow_size = 256 * 1024 * 1024;
+			desc.release_idle_sec = -1.0;
+			heap.Initialize(desc);
+
+			std::vector<void*> ptr_array;
+			for (int i = 0; i < 3; ++i)
+			{
+				// 1.5GiBを3つ.
+				void* p = heap.Allocate(u64(1536) * 1024 * 1024);
+				if (nullptr == p)
+					break;
+				ptr_array.push_back(p);
+			}
+			std::cout << "	large : allocated " << ptr_array.size() << " x 1.5GB	reserved " << (heap.GetReservedSize() / (1024 * 1024)) << " MB" << std::endl;
+
+			for (auto p : ptr_array)
+				heap.Deallocate(p);
+			// release_idle_sec < 0 のため返却されない.
+			const u32 release_count = heap.ReleaseIdleRegions();
+			assert(0 == release_count);
+
+			heap.LeakReport();
+			heap.Destroy();
+		}
+
+		std::cout << "Test End TlsfGrowableHeapTest" << std::endl;
+	}
+}
+}
+}
@@ -0,0 +1,16 @@
+﻿#pragma once
+
+#include "tlsf_growable_heap.h"
+
+
+namespace ngl
+{
+namespace memory
+{
+namespace test
+{
+	// TlsfGrowableHeapの領域追加と返却のテスト.
+	void TlsfGrowableHeapTest();
+}
+}
+}
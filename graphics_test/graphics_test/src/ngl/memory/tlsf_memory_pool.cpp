@@ -12,7 +12,7 @@ namespace ngl
 		{
 		}
 
-		bool TlsfMemoryPool::Initialize(void* manage_memory, u32 size)
+		bool TlsfMemoryPool::Initialize(void* manage_memory, u64 size)
 		{
 			Destroy();
 			bool success = allocator_.Initialize(manage_memory, size);
@@ -25,7 +25,7 @@ namespace ngl
 		}
 		// 内部で管理用メモリ確保
 		// 解放責任は内部
-		bool TlsfMemoryPool::Initialize(u32 size)
+		bool TlsfMemoryPool::Initialize(u64 size)
 		{
 			Destroy();
 			void* manage_memory = new u8[size];
@@ -69,5 +69,27 @@ namespace ngl
 		{
 			allocator_.LeakReport();
 		}
+		// 使用状況のレポート
+		void TlsfMemoryPool::UsageReport() const
+		{
+			allocator_.UsageReport();
+		}
+
+		TlsfAllocatorCoreStatistics TlsfMemoryPool::GetStatistics() const
+		{
+			return allocator_.GetStatistics();
+		}
+		void TlsfMemoryPool::GetFreeBlockHistogram(TlsfAllocatorCore::FreeBlockHistogram& out) const
+		{
+			allocator_.GetFreeBlockHistogram(out);
+		}
+		void TlsfMemoryPool::EnableAllocationTag(bool enable)
+		{
+			allocator_.EnableAllocationTag(enable);
+		}
+		void TlsfMemoryPool::GetAllocationTagStatistics(std::vector<TlsfAllocationTagStatistics>& out) const
+		{
+			allocator_.GetAllocationTagStatistics(out);
+		}
 	}
 }
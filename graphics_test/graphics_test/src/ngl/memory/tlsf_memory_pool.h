@@ -368,20 +368,33 @@ namespace ngl
 
 			// 外部から管理メモリを渡す
 			// 解放責任は外
-			bool Initialize(void* manageMemory, u32 size);
+			bool Initialize(void* manageMemory, u64 size);
 			// 内部で管理用メモリ確保
 			// 解放責任は内部
-			bool Initialize(u32 size);
+			bool Initialize(u64 size);
 
 			//
 			void Destroy();
 
+			// tag : 確保箇所タグ. EnableAllocationTagで記録を有効にした場合のみ利用する.
 			template<typename T>
-			TlsfMemoryPtr<T> Allocate(u32 size = 1);
+			TlsfMemoryPtr<T> Allocate(u32 size = 1, const char* tag = nullptr);
 
 			// メモリリークのチェック
 			// 標準出力にリーク情報を出力する
 			void LeakReport();
+			// 使用状況のレポート
+			// 標準出力にブロック管理情報の割合などを出力する
+			void UsageReport() const;
+
+			// 統計情報の取得. 毎フレーム呼び出し可能.
+			TlsfAllocatorCoreStatistics GetStatistics() const;
+			// FLI/SLI毎のフリーブロック数の取得
+			void GetFreeBlockHistogram(TlsfAllocatorCore::FreeBlockHistogram& out) const;
+			// 確保箇所タグの記録の有効化
+			void EnableAllocationTag(bool enable);
+			// 確保箇所タグ毎の使用状況を使用量の多い順に取得
+			void GetAllocationTagStatistics(std::vector<TlsfAllocationTagStatistics>& out) const;
 
 		private:
 			void Deallocate(void* ptr);
@@ -401,9 +414,10 @@ namespace ngl
 		//
 		//	ngl::memory::TlsfMemoryPtr<ngl::math::Mtx44> ptrPool0 = memPool.allocate<ngl::math::Mtx44>(1);
 		//
-		inline TlsfMemoryPtr<T> TlsfMemoryPool::Allocate(u32 size)
+		inline TlsfMemoryPtr<T> TlsfMemoryPool::Allocate(u32 size, const char* tag)
 		{
-			void* mem = allocator_.Allocate(sizeof(T) * size);
+			// 型のアライメントを満たすように確保する
+			void* mem = allocator_.AllocateAligned(sizeof(T) * size, alignof(T), tag);
 			TlsfMemoryPtr<T> ptr(reinterpret_cast<T*>( mem ), size, TlsfMemoryDeleter(this), &allocator_);
 			
 			return ptr;
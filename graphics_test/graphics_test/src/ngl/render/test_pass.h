@@ -13,6 +13,7 @@
 
 #include "ngl/gfx/material/material_shader_manager.h"
 
+#include "ngl/thread/parallel_for.h"
 #include "ngl/util/time/timer.h"
 
 namespace ngl::render
@@ -45,6 +46,10 @@ namespace ngl::render
 				
 				rhi::RefCbvDep ref_scene_cbv{};
 				const std::vector<gfx::StaticMeshComponent*>* p_mesh_list{};
+				// p_mesh_listで更新したインスタンスバッファ.
+				const gfx::MeshInstanceBufferFrame* p_mesh_instance_buffer{};
+				// カリング結果. 指定された場合はp_mesh_listの代わりに可視Shapeのみ描画する. Runまで有効であること.
+				const gfx::MeshVisibleList* p_visible_list{};
 			};
 			SetupDesc desc_{};
 			
@@ -79,9 +84,13 @@ namespace ngl::render
 				// Mesh Rendering.
 				gfx::RenderMeshResource render_mesh_res = {};
 				{
-					render_mesh_res.cbv_sceneview = {"ngl_cb_sceneview", desc_.ref_scene_cbv.Get()};
+					render_mesh_res.cbv_sceneview = {NGL_TEXT_SYMBOL("ngl_cb_sceneview"), desc_.ref_scene_cbv.Get()};
+					render_mesh_res.p_instance_buffer = desc_.p_mesh_instance_buffer;
 				}
-				ngl::gfx::RenderMeshWithMaterial(*gfx_commandlist, gfx::MaterialPassPsoCreator_depth::k_name, *desc_.p_mesh_list, render_mesh_res);
+				if(desc_.p_visible_list)
+					ngl::gfx::RenderMeshWithMaterial(*gfx_commandlist, gfx::MaterialPassPsoCreator_depth::k_name, *desc_.p_visible_list, render_mesh_res);
+				else
+					ngl::gfx::RenderMeshWithMaterial(*gfx_commandlist, gfx::MaterialPassPsoCreator_depth::k_name, *desc_.p_mesh_list, render_mesh_res);
 			}
 		};
 
@@ -103,6 +112,10 @@ namespace ngl::render
 				
 				rhi::RefCbvDep ref_scene_cbv{};
 				const std::vector<gfx::StaticMeshComponent*>* p_mesh_list{};
+				// p_mesh_listで更新したインスタンスバッファ.
+				const gfx::MeshInstanceBufferFrame* p_mesh_instance_buffer{};
+				// カリング結果. 指定された場合はp_mesh_listの代わりに可視Shapeのみ描画する. Runまで有効であること.
+				const gfx::MeshVisibleList* p_visible_list{};
 			};
 			SetupDesc desc_{};
 			
@@ -189,9 +202,13 @@ namespace ngl::render
 				// Mesh Rendering.
 				gfx::RenderMeshResource render_mesh_res = {};
 				{
-					render_mesh_res.cbv_sceneview = {"ngl_cb_sceneview", desc_.ref_scene_cbv.Get()};
+					render_mesh_res.cbv_sceneview = {NGL_TEXT_SYMBOL("ngl_cb_sceneview"), desc_.ref_scene_cbv.Get()};
+					render_mesh_res.p_instance_buffer = desc_.p_mesh_instance_buffer;
 				}
-				ngl::gfx::RenderMeshWithMaterial(*gfx_commandlist, gfx::MaterialPassPsoCreator_gbuffer::k_name, *desc_.p_mesh_list, render_mesh_res);
+				if(desc_.p_visible_list)
+					ngl::gfx::RenderMeshWithMaterial(*gfx_commandlist, gfx::MaterialPassPsoCreator_gbuffer::k_name, *desc_.p_visible_list, render_mesh_res);
+				else
+					ngl::gfx::RenderMeshWithMaterial(*gfx_commandlist, gfx::MaterialPassPsoCreator_gbuffer::k_name, *desc_.p_mesh_list, render_mesh_res);
 			}
 		};
 
@@ -252,11 +269,22 @@ namespace ngl::render
 			rhi::RefCbvDep ref_d_shadow_sample_cbv_{};// 内部用.
 			// Cascade情報. Setupで計算.
 			CascadeShadowMapParameter csm_param_{};
+			// Cascade毎のカリング結果. p_mesh_cullingが指定された場合にSetupで計算.
+			gfx::MeshVisibleList cascade_visible_list_[CascadeShadowMapParameter::k_cascade_count]{};
+			// Cascade毎のCaster判定範囲. Setupで計算.
+			math::ShadowCascadeCullVolume cascade_cull_volume_[CascadeShadowMapParameter::k_cascade_count]{};
 
 			struct SetupDesc
 			{
 				rhi::RefCbvDep ref_scene_cbv{};
 				const std::vector<gfx::StaticMeshComponent*>* p_mesh_list{};
+				// p_mesh_listで更新したインスタンスバッファ.
+				const gfx::MeshInstanceBufferFrame* p_mesh_instance_buffer{};
+				// 指定された場合はCascade毎にカリングして可視Shapeのみ描画する.
+				const gfx::SceneMeshCulling* p_mesh_culling{};
+				thread::JobSystem* p_job_system{};
+				// 受影点を描画するViewのFrustum. Cascade毎のカリングで手前のCascadeでカバーされるCasterの判定に利用する.
+				math::Frustum view_frustum{};
 
 				math::Vec3 directional_light_dir{};
 			};
@@ -276,6 +304,10 @@ namespace ngl::render
 				const float shadowmap_cascade_split_power = 2.4f;
 				// Cascade間ブレンド幅.
 				const float k_cascade_blend_width_ws = 5.0f;
+				// 手前のCascadeでカバーされるCasterの判定の余裕. シェーダのサンプル位置のバイアス分.
+				const float k_cascade_cover_margin_ws = 1.0f;
+				// Orthoの受影範囲から光源側と奥側への拡張.
+				constexpr float shadow_near_far_offset = 200.0f;
 				// Cascade 1つのサイズ.
 				constexpr int shadowmap_single_reso = 1024*2;
 				// CascadeをAtlas管理する際のトータルサイズ.
@@ -382,7 +414,6 @@ namespace ngl::render
 							lightview_vtx_pos_max.z = std::max(lightview_vtx_pos_max.z, lightview_vtx_pos.z);
 						}
 						
-						constexpr float shadow_near_far_offset = 200.0f;
 						const math::Mat44 lightview_ortho = math::CalcReverseOrthographicMatrix(
 							lightview_vtx_pos_min.x, lightview_vtx_pos_max.x,
 							lightview_vtx_pos_min.y, lightview_vtx_pos_max.y,
@@ -391,9 +422,25 @@ namespace ngl::render
 
 						csm_param_.light_view_mtx[ci] = lightview_view_mtx;
 						csm_param_.light_ortho_mtx[ci] = lightview_ortho;
+
+						// Casterの判定範囲. 受影範囲をOrthoのNearまで光源側へ延長する. 奥側の拡張は受影点に影を落とさないため含めない.
+						//	このCascadeを参照するのはnear_dist_ws以降のため, それより手前に影が収まるCasterは手前のCascadeのみで描画する.
+						const float covered_view_depth = (0 == ci)? -FLT_MAX : near_dist_ws - k_cascade_cover_margin_ws;
+						math::CreateShadowCascadeCullVolume(cascade_cull_volume_[ci], lightview_view_mtx,
+							lightview_vtx_pos_min, lightview_vtx_pos_max, shadow_near_far_offset,
+							desc.view_frustum, view_info.camera_pos, view_forward_dir, covered_view_depth);
 					}
 				}
 
+				// Cascade毎のカリング. 各Cascadeは独立しているため並列に判定する.
+				if(desc.p_mesh_culling)
+				{
+					thread::ParallelFor(desc.p_job_system, 0, csm_param_.k_cascade_count, 1, [this, &desc](s64 ci)
+					{
+						desc.p_mesh_culling->CullShadowCascade(cascade_visible_list_[ci], cascade_cull_volume_[ci], desc.p_job_system);
+					});
+				}
+
 				for(int ci = 0; ci < csm_param_.k_cascade_count; ++ci)
 				{
 					// 2x2 Atlas のTileのマッピングを決定.
@@ -489,10 +536,14 @@ namespace ngl::render
 					// Mesh Rendering.
 					gfx::RenderMeshResource render_mesh_res = {};
 					{
-						render_mesh_res.cbv_sceneview = {"ngl_cb_sceneview", desc_.ref_scene_cbv.Get()};
-						render_mesh_res.cbv_d_shadowview = {"ngl_cb_shadowview", ref_shadow_render_cbv.Get()};
+						render_mesh_res.cbv_sceneview = {NGL_TEXT_SYMBOL("ngl_cb_sceneview"), desc_.ref_scene_cbv.Get()};
+						render_mesh_res.p_instance_buffer = desc_.p_mesh_instance_buffer;
+						render_mesh_res.cbv_d_shadowview = {NGL_TEXT_SYMBOL("ngl_cb_shadowview"), ref_shadow_render_cbv.Get()};
 					}
-					ngl::gfx::RenderMeshWithMaterial(*gfx_commandlist, gfx::MaterialPassPsoCreator_d_shadow::k_name, *desc_.p_mesh_list, render_mesh_res);
+					if(desc_.p_mesh_culling)
+						ngl::gfx::RenderMeshWithMaterial(*gfx_commandlist, gfx::MaterialPassPsoCreator_d_shadow::k_name, cascade_visible_list_[cascade_index], render_mesh_res);
+					else
+						ngl::gfx::RenderMeshWithMaterial(*gfx_commandlist, gfx::MaterialPassPsoCreator_d_shadow::k_name, *desc_.p_mesh_list, render_mesh_res);
 				}
 			}
 		};
@@ -569,9 +620,9 @@ namespace ngl::render
 				assert(res_linear_depth.tex_.IsValid() && res_linear_depth.uav_.IsValid());
 
 				ngl::rhi::DescriptorSetDep desc_set = {};
-				pso_->SetView(&desc_set, "TexHardwareDepth", res_depth.srv_.Get());
-				pso_->SetView(&desc_set, "RWTexLinearDepth", res_linear_depth.uav_.Get());
-				pso_->SetView(&desc_set, "ngl_cb_sceneview", desc_.ref_scene_cbv.Get());
+				pso_->SetView(&desc_set, NGL_TEXT_SYMBOL("TexHardwareDepth"), res_depth.srv_.Get());
+				pso_->SetView(&desc_set, NGL_TEXT_SYMBOL("RWTexLinearDepth"), res_linear_depth.uav_.Get());
+				pso_->SetView(&desc_set, NGL_TEXT_SYMBOL("ngl_cb_sceneview"), desc_.ref_scene_cbv.Get());
 				
 				gfx_commandlist->SetPipelineState(pso_.Get());
 				gfx_commandlist->SetDescriptorSet(pso_.Get(), &desc_set);
@@ -730,21 +781,21 @@ namespace ngl::render
 				gfx_commandlist->SetPipelineState(pso_.Get());
 				ngl::rhi::DescriptorSetDep desc_set = {};
 
-				pso_->SetView(&desc_set, "ngl_cb_sceneview", desc_.ref_scene_cbv.Get());
-				pso_->SetView(&desc_set, "ngl_cb_shadowview", desc_.ref_shadow_cbv.Get());
+				pso_->SetView(&desc_set, NGL_TEXT_SYMBOL("ngl_cb_sceneview"), desc_.ref_scene_cbv.Get());
+				pso_->SetView(&desc_set, NGL_TEXT_SYMBOL("ngl_cb_shadowview"), desc_.ref_shadow_cbv.Get());
 				
-				pso_->SetView(&desc_set, "tex_lineardepth", res_linear_depth.srv_.Get());
-				pso_->SetView(&desc_set, "tex_gbuffer0", res_gb0.srv_.Get());
-				pso_->SetView(&desc_set, "tex_gbuffer1", res_gb1.srv_.Get());
-				pso_->SetView(&desc_set, "tex_gbuffer2", res_gb2.srv_.Get());
-				pso_->SetView(&desc_set, "tex_gbuffer3", res_gb3.srv_.Get());
+				pso_->SetView(&desc_set, NGL_TEXT_SYMBOL("tex_lineardepth"), res_linear_depth.srv_.Get());
+				pso_->SetView(&desc_set, NGL_TEXT_SYMBOL("tex_gbuffer0"), res_gb0.srv_.Get());
+				pso_->SetView(&desc_set, NGL_TEXT_SYMBOL("tex_gbuffer1"), res_gb1.srv_.Get());
+				pso_->SetView(&desc_set, NGL_TEXT_SYMBOL("tex_gbuffer2"), res_gb2.srv_.Get());
+				pso_->SetView(&desc_set, NGL_TEXT_SYMBOL("tex_gbuffer3"), res_gb3.srv_.Get());
 				
-				pso_->SetView(&desc_set, "tex_prev_light", ref_prev_lit.Get());
+				pso_->SetView(&desc_set, NGL_TEXT_SYMBOL("tex_prev_light"), ref_prev_lit.Get());
 
-				pso_->SetView(&desc_set, "tex_shadowmap", res_shadowmap.srv_.Get());
+				pso_->SetView(&desc_set, NGL_TEXT_SYMBOL("tex_shadowmap"), res_shadowmap.srv_.Get());
 				
-				pso_->SetView(&desc_set, "samp", gfx::GlobalRenderResource::Instance().default_resource_.sampler_linear_wrap.Get());
-				pso_->SetView(&desc_set, "samp_shadow", gfx::GlobalRenderResource::Instance().default_resource_.sampler_shadow_linear.Get());
+				pso_->SetView(&desc_set, NGL_TEXT_SYMBOL("samp"), gfx::GlobalRenderResource::Instance().default_resource_.sampler_linear_wrap.Get());
+				pso_->SetView(&desc_set, NGL_TEXT_SYMBOL("samp_shadow"), gfx::GlobalRenderResource::Instance().default_resource_.sampler_shadow_linear.Get());
 				
 				gfx_commandlist->SetDescriptorSet(pso_.Get(), &desc_set);
 
@@ -977,18 +1028,18 @@ namespace ngl::render
 
 				gfx_commandlist->SetPipelineState(pso_.Get());
 				ngl::rhi::DescriptorSetDep desc_set = {};
-				pso_->SetView(&desc_set, "cb_final_screen_pass", ref_cbv.Get());
-				pso_->SetView(&desc_set, "tex_light", res_light.srv_.Get());
-				pso_->SetView(&desc_set, "tex_rt", ref_rt_result.Get());
-				pso_->SetView(&desc_set, "tex_res_data", ref_other_rtg_out.Get());
-
-				pso_->SetView(&desc_set, "tex_gbuffer0", ref_gbuffer0.Get());
-				pso_->SetView(&desc_set, "tex_gbuffer1", ref_gbuffer1.Get());
-				pso_->SetView(&desc_set, "tex_gbuffer2", ref_gbuffer2.Get());
-				pso_->SetView(&desc_set, "tex_gbuffer3", ref_gbuffer3.Get());
-				pso_->SetView(&desc_set, "tex_dshadow", ref_dshadow.Get());
+				pso_->SetView(&desc_set, NGL_TEXT_SYMBOL("cb_final_screen_pass"), ref_cbv.Get());
+				pso_->SetView(&desc_set, NGL_TEXT_SYMBOL("tex_light"), res_light.srv_.Get());
+				pso_->SetView(&desc_set, NGL_TEXT_SYMBOL("tex_rt"), ref_rt_result.Get());
+				pso_->SetView(&desc_set, NGL_TEXT_SYMBOL("tex_res_data"), ref_other_rtg_out.Get());
+
+				pso_->SetView(&desc_set, NGL_TEXT_SYMBOL("tex_gbuffer0"), ref_gbuffer0.Get());
+				pso_->SetView(&desc_set, NGL_TEXT_SYMBOL("tex_gbuffer1"), ref_gbuffer1.Get());
+				pso_->SetView(&desc_set, NGL_TEXT_SYMBOL("tex_gbuffer2"), ref_gbuffer2.Get());
+				pso_->SetView(&desc_set, NGL_TEXT_SYMBOL("tex_gbuffer3"), ref_gbuffer3.Get());
+				pso_->SetView(&desc_set, NGL_TEXT_SYMBOL("tex_dshadow"), ref_dshadow.Get());
 				
-				pso_->SetView(&desc_set, "samp", gfx::GlobalRenderResource::Instance().default_resource_.sampler_linear_wrap.Get());
+				pso_->SetView(&desc_set, NGL_TEXT_SYMBOL("samp"), gfx::GlobalRenderResource::Instance().default_resource_.sampler_linear_wrap.Get());
 				gfx_commandlist->SetDescriptorSet(pso_.Get(), &desc_set);
 
 				gfx_commandlist->SetPrimitiveTopology(ngl::rhi::EPrimitiveTopology::TriangleList);
@@ -1064,7 +1115,7 @@ namespace ngl::render
 				p_commandlist->SetPipelineState(pso_.Get());
 				
 				ngl::rhi::DescriptorSetDep desc_set = {};
-				pso_->SetView(&desc_set, "rwtex_out", res_work_tex.uav_.Get());
+				pso_->SetView(&desc_set, NGL_TEXT_SYMBOL("rwtex_out"), res_work_tex.uav_.Get());
 				p_commandlist->SetDescriptorSet(pso_.Get(), &desc_set);
 				
 				pso_->DispatchHelper(p_commandlist, res_work_tex.tex_->GetWidth(), res_work_tex.tex_->GetHeight(), 1);
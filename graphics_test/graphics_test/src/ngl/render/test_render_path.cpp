@@ -5,8 +5,10 @@
 #include "ngl/imgui/imgui_interface.h"
 
 #include "ngl/gfx/render/global_render_resource.h"
+#include "ngl/gfx/render/mesh_culling.h"
 #include "ngl/gfx/material/material_shader_manager.h"
 #include "ngl/util/time/timer.h"
+#include "ngl/util/time/profiler.h"
 
 namespace ngl::test
 {
@@ -14,8 +16,8 @@ namespace ngl::test
 			const RenderFrameDesc& render_frame_desc,
 			RenderFrameOut& out_frame_out,
 			ngl::rtg::RenderTaskGraphManager& rtg_manager,
-			std::vector<ngl::rtg::RtgSubmitCommandSequenceElem>& out_graphics_cmd,
-			std::vector<ngl::rtg::RtgSubmitCommandSequenceElem>& out_compute_cmd
+			ngl::rtg::RtgSubmitCommandSequence& out_graphics_cmd,
+			ngl::rtg::RtgSubmitCommandSequence& out_compute_cmd
 		) -> void
 	{
 		auto* p_device = render_frame_desc.p_device;
@@ -39,6 +41,11 @@ namespace ngl::test
 		}
 		
 				
+		static_assert(RenderFrameOut::k_stat_shadow_cascade_max == render::task::CascadeShadowMapParameter::k_cascade_count);
+
+		// MainViewのFrustum. SceneView定数バッファと同じ行列から計算.
+		math::Frustum view_frustum = {};
+
 		// Update View Constant Buffer.
 		ngl::rhi::RefBufferDep sceneview_buffer = new ngl::rhi::BufferDep();
 		ngl::rhi::RefCbvDep sceneview_cbv = new ngl::rhi::ConstantBufferViewDep();
@@ -58,6 +65,9 @@ namespace ngl::test
 			ngl::math::Mat44 proj_mat = ngl::math::CalcReverseInfiniteFarPerspectiveMatrix(view_info.camera_fov_y, view_info.aspect_ratio, view_info.near_z);
 			ngl::math::Vec4 ndc_z_to_view_z_coef = ngl::math::CalcViewDepthReconstructCoefForInfiniteFarReversePerspective(view_info.near_z);
 
+			const ngl::math::Mat44 view_mat44(view_mat.r0, view_mat.r1, view_mat.r2, ngl::math::Vec4::UnitW());
+			ngl::math::CreateFrustum(view_frustum, proj_mat * view_mat44);
+
 			if (auto* mapped = sceneview_buffer->MapAs<ngl::gfx::CbSceneView>())
 			{
 				mapped->cb_view_mtx = view_mat;
@@ -73,9 +83,22 @@ namespace ngl::test
 			}
 		}
 				
+		// メッシュのFrustumカリング. ワールドAABBはGameThreadで構築済み.
+		//	可視リストはRtgのExecuteで各PassのRunが完了するまで保持する.
+		thread::JobSystem* p_culling_job_system = rtg_manager.GetJobSystem();
+		const gfx::SceneMeshCulling* p_mesh_culling = p_scene->p_mesh_culling_;
+		gfx::MeshVisibleList view_visible_list;
+		const bool enable_mesh_culling = render_frame_desc.debug_mesh_culling && p_mesh_culling;
+		if (enable_mesh_culling)
+		{
+			time::ScopedProfileZone zone_culling("MeshCulling");
+			p_mesh_culling->Cull(view_visible_list, view_frustum, p_culling_job_system);
+		}
+				
 		// RtgによるRenderPathの構築.
 		{
-			time::Timer::Instance().StartTimer("rtg_pass_construct");
+			// 構築はこのゾーンの先頭からCompileまで.
+			time::ScopedProfileZone zone_rtg("RenderTaskGraph");
 			
 			// Rtg構築用オブジェクト, 1回の構築-Compile-実行で使い捨てされる.
 			ngl::rtg::RenderTaskGraphBuilder rtg_builder(screen_w, screen_h);
@@ -146,6 +169,8 @@ namespace ngl::test
 						
 						setup_desc.ref_scene_cbv = sceneview_cbv;
 						setup_desc.p_mesh_list = &p_scene->mesh_instance_array_;
+						setup_desc.p_mesh_instance_buffer = p_scene->p_mesh_instance_buffer_;
+						setup_desc.p_visible_list = (enable_mesh_culling)? &view_visible_list : nullptr;
 					}
 					task_depth->Setup(rtg_builder, p_device, view_info, setup_desc);
 				}
@@ -193,6 +218,8 @@ namespace ngl::test
 						
 						setup_desc.ref_scene_cbv = sceneview_cbv;
 						setup_desc.p_mesh_list = &p_scene->mesh_instance_array_;
+						setup_desc.p_mesh_instance_buffer = p_scene->p_mesh_instance_buffer_;
+						setup_desc.p_visible_list = (enable_mesh_culling)? &view_visible_list : nullptr;
 					}
 					task_gbuffer->Setup(rtg_builder, p_device, view_info, task_depth->h_depth_, async_compute_tex0, setup_desc);
 				}
@@ -205,12 +232,43 @@ namespace ngl::test
 					{
 						setup_desc.ref_scene_cbv = sceneview_cbv;
 						setup_desc.p_mesh_list = &p_scene->mesh_instance_array_;
+						setup_desc.p_mesh_instance_buffer = p_scene->p_mesh_instance_buffer_;
+						setup_desc.p_mesh_culling = (enable_mesh_culling)? p_mesh_culling : nullptr;
+						setup_desc.p_job_system = p_culling_job_system;
+						setup_desc.view_frustum = view_frustum;
 						
 						// Directionalのライト方向テスト.
 						setup_desc.directional_light_dir = ngl::math::Vec3::Normalize(render_frame_desc.directional_light_dir);
 					}
 					task_d_shadow->Setup(rtg_builder, p_device, view_info, setup_desc);
 				}
+
+				// カリング統計.
+				{
+					if (enable_mesh_culling)
+					{
+						out_frame_out.stat_mesh_shape_total = view_visible_list.num_total_;
+						out_frame_out.stat_mesh_shape_visible = view_visible_list.NumVisible();
+						for (int ci = 0; ci < RenderFrameOut::k_stat_shadow_cascade_max; ++ci)
+						{
+							out_frame_out.stat_shadow_shape_visible[ci] = task_d_shadow->cascade_visible_list_[ci].NumVisible();
+							out_frame_out.stat_shadow_shape_covered[ci] = task_d_shadow->cascade_visible_list_[ci].num_covered_;
+						}
+					}
+					else
+					{
+						u32 shape_count = 0;
+						for (const auto* e : p_scene->mesh_instance_array_)
+						{
+							if (const auto* p_mesh_data = e->GetMeshData())
+								shape_count += static_cast<u32>(p_mesh_data->data_.shape_array_.size());
+						}
+						out_frame_out.stat_mesh_shape_total = shape_count;
+						out_frame_out.stat_mesh_shape_visible = shape_count;
+						for (int ci = 0; ci < RenderFrameOut::k_stat_shadow_cascade_max; ++ci)
+							out_frame_out.stat_shadow_shape_visible[ci] = shape_count;
+					}
+				}
 					
 				// ----------------------------------------
 				// Deferred Lighting Pass.
@@ -292,21 +350,25 @@ namespace ngl::test
 					out_frame_out.h_propagate_lit = rtg_builder.PropagateResouceToNextFrame(task_light->h_light_);
 				}
 			}
-			out_frame_out.stat_rtg_construct_sec = static_cast<float>(time::Timer::Instance().GetElapsedSec("rtg_pass_construct"));
+			out_frame_out.stat_rtg_construct_sec = static_cast<float>(zone_rtg.GetElapsedSec());
 			
 			// 構築したRtgをCompile.
 			//	ここでリソース依存関係とBarrier, 非同期コンピュート同期, リソース再利用などが確定する.
-			time::Timer::Instance().StartTimer("rtg_manager_compile");
-			rtg_manager.Compile(rtg_builder);
-			out_frame_out.stat_rtg_compile_sec = static_cast<float>(time::Timer::Instance().GetElapsedSec("rtg_manager_compile"));
+			{
+				time::ScopedProfileZone zone_compile("RtgCompile");
+				rtg_manager.Compile(rtg_builder);
+				out_frame_out.stat_rtg_compile_sec = static_cast<float>(zone_compile.GetElapsedSec());
+			}
 				
 			// Rtgを実行し構成Taskの Run() を実行, CommandListを生成する.
 			//	Compileによってリソースプールのステートが更新され, その後にCompileされたGraphはそれを前提とするため, Graphは必ずExecuteする必要がある.
 			//	各TaskのRun()はそれぞれ別スレッドで並列実行される可能性がある.
 			thread::JobSystem* p_job_system = (render_frame_desc.debug_pass_render_parallel)? rtg_manager.GetJobSystem() : nullptr;
-			time::Timer::Instance().StartTimer("rtg_builder_execute");
-			rtg_builder.Execute(out_graphics_cmd, out_compute_cmd, p_job_system);
-			out_frame_out.stat_rtg_execute_sec = static_cast<float>(time::Timer::Instance().GetElapsedSec("rtg_builder_execute"));
+			{
+				time::ScopedProfileZone zone_execute("RtgExecute");
+				rtg_builder.Execute(out_graphics_cmd, out_compute_cmd, p_job_system);
+				out_frame_out.stat_rtg_execute_sec = static_cast<float>(zone_execute.GetElapsedSec());
+			}
 		}
 	}
 }
@@ -48,6 +48,8 @@ namespace ngl::test
 
 
     	bool debug_pass_render_parallel = true;
+    	// メッシュのFrustumカリング.
+    	bool debug_mesh_culling = true;
     	bool debugview_halfdot_gray = false;
     	bool debugview_subview_result = false;
     	bool debugview_raytrace_result = false;
@@ -64,6 +66,14 @@ namespace ngl::test
     	float	stat_rtg_construct_sec = {};
     	float	stat_rtg_compile_sec = {};
     	float	stat_rtg_execute_sec = {};
+
+    	// メッシュカリングの統計. Shape単位. カリング無効の場合は全て可視.
+    	static constexpr int k_stat_shadow_cascade_max = 3;
+    	u32		stat_mesh_shape_total = {};
+    	u32		stat_mesh_shape_visible = {};
+    	u32		stat_shadow_shape_visible[k_stat_shadow_cascade_max] = {};
+    	// Cascadeの範囲内だが手前のCascadeでカバーされるため描画しなかったShape数.
+    	u32		stat_shadow_shape_covered[k_stat_shadow_cascade_max] = {};
     };
 	
     // RtgによるRenderPathの構築と実行.
@@ -71,8 +81,8 @@ namespace ngl::test
 			const RenderFrameDesc& render_frame_desc,
 			RenderFrameOut& out_frame_out,
 			ngl::rtg::RenderTaskGraphManager& rtg_manager,
-			std::vector<ngl::rtg::RtgSubmitCommandSequenceElem>& out_graphics_cmd,
-			std::vector<ngl::rtg::RtgSubmitCommandSequenceElem>& out_compute_cmd
+			ngl::rtg::RtgSubmitCommandSequence& out_graphics_cmd,
+			ngl::rtg::RtgSubmitCommandSequence& out_compute_cmd
 		) -> void;
     
 }
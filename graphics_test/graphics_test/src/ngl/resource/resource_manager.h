@@ -13,6 +13,7 @@
 #include "ngl/math/math.h"
 #include "ngl/util/noncopyable.h"
 #include "ngl/util/singleton.h"
+#include "ngl/util/time/profiler.h"
 
 #include "ngl/rhi/d3d12/device.d3d12.h"
 
@@ -155,6 +156,7 @@ namespace res
 		}
 
 		// 存在しない場合は読み込み.
+		NGL_PROFILE_SCOPE(RES_TYPE::k_resource_type_name);
 
 		// 新規生成.
 		auto p_res = new RES_TYPE();
@@ -21,6 +21,31 @@ namespace ngl
 {
 	namespace rhi
 	{
+		// RhiObjectBaseのDevice参照. DeviceDepの定義が必要なためBackend側で実装する.
+		// -------------------------------------------------------------------------------------------------------------------------------------------------
+		IDevice* RhiObjectBase::GetParentDeviceInreface()
+		{
+			return p_parent_device_;
+		}
+		const IDevice* RhiObjectBase::GetParentDeviceInreface() const
+		{
+			return p_parent_device_;
+		}
+		DeviceDep* RhiObjectBase::GetParentDevice()
+		{
+			return p_parent_device_;
+		}
+		DeviceDep* RhiObjectBase::GetParentDevice() const
+		{
+			return p_parent_device_;
+		}
+		void RhiObjectBase::InitializeRhiObject(DeviceDep* p_device)
+		{
+			p_parent_device_ = p_device;
+		}
+		// -------------------------------------------------------------------------------------------------------------------------------------------------
+
+
 		namespace helper
 		{
 			bool SerializeAndCreateRootSignature(DeviceDep* p_device, const D3D12_ROOT_SIGNATURE_DESC& desc, Microsoft::WRL::ComPtr<ID3D12RootSignature>& out_root_signature)
@@ -227,9 +252,22 @@ namespace ngl
 				}
 			}
 
+			// FrameArenaAllocator.
+			{
+				memory::FrameArenaAllocator::Desc arena_desc = {};
+				arena_desc.buffer_count = desc_.swapchain_buffer_count;
+				arena_desc.page_size = desc_.frame_arena_page_size;
+				if (!frame_arena_.Initialize(arena_desc))
+				{
+					std::cout << "[ERROR] Initialize FrameArenaAllocator" << std::endl;
+					return false;
+				}
+			}
+
 			// Gabage Collector.
 			{
-				if (!gb_.Initialize())
+				GabageCollector::Desc gb_desc = {};
+				if (!gb_.Initialize(gb_desc))
 				{
 					std::cout << "[ERROR] Initialize RHI GabageCollector" << std::endl;
 					return false;
@@ -242,6 +280,8 @@ namespace ngl
 		{
 			gb_.Finalize();
 
+			frame_arena_.Destroy();
+
 			p_device_ = nullptr;
 			p_factory_ = nullptr;
 		}
@@ -254,10 +294,12 @@ namespace ngl
 
 			p_dynamic_descriptor_manager_->ReadyToNewFrame((u32)frame_index_);
 
+			frame_arena_.ReadyToNewFrame(buffer_index_);
+
 			gb_.ReadyToNewFrame();
 
 
-			// ガベコレ. 実際にはここを別スレッドに逃がすことも考えられる.
+			// ガベコレ. JobSystemが設定されていればWorkerで破棄する.
 			gb_.Execute();
 		}
 
@@ -21,6 +21,7 @@
 
 #include "ngl/rhi/rhi.h"
 #include "ngl/rhi/rhi_object_garbage_collect.h"
+#include "ngl/memory/frame_arena_allocator.h"
 
 #include "rhi_util.d3d12.h"
 #include "descriptor.d3d12.h"
@@ -77,6 +78,8 @@ namespace ngl
 				u32		persistent_descriptor_size	= 500000;
 				// フレームで連続Descriptorを確保するためのバッファのサイズ
 				u32		frame_descriptor_size		= 500000;
+				// フレーム単位の一時メモリ確保用アリーナのページサイズ
+				u64		frame_arena_page_size		= 1024 * 1024;
 				bool	enable_debug_layer			= false;
 			};
 
@@ -125,12 +128,19 @@ namespace ngl
 			u64	 GetDeviceFrameIndex() const { return frame_index_; }
 
 			const u32 GetFrameBufferIndex() const { return buffer_index_; }
+
+			// フレーム単位の一時メモリ確保用アリーナ. swapchainバッファ数でバッファリングされ, ReadyToNewFrameでリセットされる.
+			// 確保したメモリはswapchainバッファ数分のフレームの間有効.
+			memory::FrameArenaAllocator* GetFrameArenaAllocator() { return &frame_arena_; }
 		public:
 			// RHIオブジェクトガベージコレクト関連.
 
 			// RHIオブジェクトの参照ハンドルの破棄で呼び出されるオブジェクト破棄依頼関数.
 			void DestroyRhiObject(IRhiObject* p) override;
 
+			// RHIオブジェクトの遅延破棄. 破棄を実行するJobSystemの設定や統計の取得用.
+			GabageCollector* GetGabageCollector() { return &gb_; }
+
 		private:
 			Desc	desc_ = {};
 
@@ -167,6 +177,8 @@ namespace ngl
 
 
 			GabageCollector			gb_;
+
+			memory::FrameArenaAllocator	frame_arena_;
 		};
 
 
@@ -35,6 +35,19 @@ namespace ngl
 				return false;
 			}
 
+			// CBVのアドレスとサイズは256byteアライメントが必要.
+			if ((desc.byte_offset & 0xff) || (p_buffer->GetBufferSize() <= desc.byte_offset))
+			{
+				assert(false);
+				return false;
+			}
+			const u32 view_size = (0 < desc.byte_size) ? desc.byte_size : (p_buffer->GetBufferSize() - desc.byte_offset);
+			if ((view_size & 0xff) || (p_buffer->GetBufferSize() - desc.byte_offset < view_size))
+			{
+				assert(false);
+				return false;
+			}
+
 			auto&& p_device = p_buffer->GetParentDevice();
 
 			auto&& descriptor_allocator = p_device->GetPersistentDescriptorAllocator();
@@ -47,8 +60,8 @@ namespace ngl
 			}
 
 			D3D12_CONSTANT_BUFFER_VIEW_DESC view_desc = {};
-			view_desc.BufferLocation = p_buffer->GetD3D12Resource()->GetGPUVirtualAddress();
-			view_desc.SizeInBytes = p_buffer->GetBufferSize();// アライメント考慮サイズを指定している.
+			view_desc.BufferLocation = p_buffer->GetD3D12Resource()->GetGPUVirtualAddress() + desc.byte_offset;
+			view_desc.SizeInBytes = view_size;// アライメント考慮サイズを指定している.
 			auto handle = view_.cpu_handle;
 			p_device->GetD3D12Device()->CreateConstantBufferView(&view_desc, handle);
 
@@ -91,7 +91,10 @@ namespace ngl
 		public:
 			struct Desc
 			{
-				ngl::u32			dummy;
+				// バッファ先頭からのオフセット. 256byteアライメント.
+				ngl::u32			byte_offset = 0;
+				// Viewのサイズ. 0の場合はオフセットからバッファ末尾まで.
+				ngl::u32			byte_size = 0;
 			};
 
 			ConstantBufferViewDep();
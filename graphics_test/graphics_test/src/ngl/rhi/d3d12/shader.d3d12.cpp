@@ -804,7 +804,7 @@ namespace rhi
 
 
 		// Layout情報取得
-		auto func_setup_slot = [](EShaderStage stage, DeviceDep* p_device, const ShaderReflectionDep& p_reflection, std::unordered_map<ResourceViewName, Slot>& slot_map)
+		auto func_setup_slot = [](EShaderStage stage, DeviceDep* p_device, const ShaderReflectionDep& p_reflection, std::unordered_map<text::TextSymbol, Slot>& slot_map)
 		{
 			auto SetRegisterIndex = [](Slot& slot, u32 bind_point, ERootParameterType type, EShaderStage shader_stage)
 			{
@@ -824,7 +824,8 @@ namespace rhi
 			{
 				if (const auto* slot_info = p_reflection.GetResourceSlotInfo(i))
 				{
-					auto itr = slot_map.find(slot_info->name);
+					const text::TextSymbol slot_name(slot_info->name);
+					auto itr = slot_map.find(slot_name);
 					if (itr != slot_map.end())
 					{
 						// 登録済み
@@ -835,7 +836,7 @@ namespace rhi
 						// 未登録
 						Slot new_slot;
 						SetRegisterIndex(new_slot, slot_info->bind_point, slot_info->type, stage);
-						slot_map[slot_info->name] = new_slot;
+						slot_map[slot_name] = new_slot;
 					}
 				}
 			}
@@ -1054,6 +1055,14 @@ namespace rhi
 	}
 	// 名前でDescriptorSetへハンドル設定
 	void PipelineResourceViewLayoutDep::SetDescriptorHandle(DescriptorSetDep* p_desc_set, const char* name, D3D12_CPU_DESCRIPTOR_HANDLE cpu_handle) const
+	{
+		// 未登録の名前はどのシェーダにも存在しないため登録せずに検索のみ.
+		const text::TextSymbol symbol = text::TextSymbol::Find(name);
+		if (symbol.IsValid())
+			SetDescriptorHandle(p_desc_set, symbol, cpu_handle);
+	}
+	// シンボルでDescriptorSetへハンドル設定
+	void PipelineResourceViewLayoutDep::SetDescriptorHandle(DescriptorSetDep* p_desc_set, text::TextSymbol name, D3D12_CPU_DESCRIPTOR_HANDLE cpu_handle) const
 	{
 		assert(p_desc_set);
 
@@ -1543,6 +1552,22 @@ namespace rhi
 	{
 		view_layout_->SetDescriptorHandle(p_desc_set, name, p_view->GetView().cpu_handle);
 	}
+	void PipelineStateBaseDep::SetView(DescriptorSetDep* p_desc_set, text::TextSymbol name, const ConstantBufferViewDep* p_view) const
+	{
+		view_layout_->SetDescriptorHandle(p_desc_set, name, p_view->GetView().cpu_handle);
+	}
+	void PipelineStateBaseDep::SetView(DescriptorSetDep* p_desc_set, text::TextSymbol name, const ShaderResourceViewDep* p_view) const
+	{
+		view_layout_->SetDescriptorHandle(p_desc_set, name, p_view->GetView().cpu_handle);
+	}
+	void PipelineStateBaseDep::SetView(DescriptorSetDep* p_desc_set, text::TextSymbol name, const UnorderedAccessViewDep* p_view) const
+	{
+		view_layout_->SetDescriptorHandle(p_desc_set, name, p_view->GetView().cpu_handle);
+	}
+	void PipelineStateBaseDep::SetView(DescriptorSetDep* p_desc_set, text::TextSymbol name, const SamplerDep* p_view) const
+	{
+		view_layout_->SetDescriptorHandle(p_desc_set, name, p_view->GetView().cpu_handle);
+	}
 	
 	ID3D12PipelineState* PipelineStateBaseDep::GetD3D12PipelineState()
 	{
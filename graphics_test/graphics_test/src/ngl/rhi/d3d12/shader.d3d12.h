@@ -6,6 +6,7 @@
 
 #include "rhi_util.d3d12.h"
 #include "ngl/util/singleton.h"
+#include "ngl/text/text_symbol.h"
 
 namespace ngl
 {
@@ -262,6 +263,8 @@ namespace rhi
 
 		// 名前でDescriptorSetへハンドル設定
 		void SetDescriptorHandle(DescriptorSetDep* p_desc_set, const char* name, D3D12_CPU_DESCRIPTOR_HANDLE cpu_handle) const;
+		// シンボルでDescriptorSetへハンドル設定. 検索は整数比較のみ.
+		void SetDescriptorHandle(DescriptorSetDep* p_desc_set, text::TextSymbol name, D3D12_CPU_DESCRIPTOR_HANDLE cpu_handle) const;
 
 		ID3D12RootSignature* GetD3D12RootSignature();
 		const ID3D12RootSignature* GetD3D12RootSignature() const;
@@ -272,8 +275,8 @@ namespace rhi
 		// 頂点シェーダリフレクションは入力レイアウト情報などのために保持する
 		ShaderReflectionDep		vs_reflection_;
 
-		// リソース名とスロット(register)の対応情報map.
-		std::unordered_map<ResourceViewName, Slot> slot_map_;
+		// リソース名シンボルとスロット(register)の対応情報map.
+		std::unordered_map<text::TextSymbol, Slot> slot_map_;
 
 		// CommandListにDescriptorをセットする際の各シェーダステージ/リソースタイプの対応するRootTableインデックス.
 		ResourceTable					resource_table_;
@@ -301,6 +304,11 @@ namespace rhi
 		void SetView(DescriptorSetDep* p_desc_set, const char* name, const ShaderResourceViewDep* p_view) const;
 		void SetView(DescriptorSetDep* p_desc_set, const char* name, const UnorderedAccessViewDep* p_view) const;
 		void SetView(DescriptorSetDep* p_desc_set, const char* name, const SamplerDep* p_view) const;
+		// シンボル版. 毎フレーム多数呼び出す箇所ではNGL_TEXT_SYMBOL等で事前に取得したシンボルを渡す.
+		void SetView(DescriptorSetDep* p_desc_set, text::TextSymbol name, const ConstantBufferViewDep* p_view) const;
+		void SetView(DescriptorSetDep* p_desc_set, text::TextSymbol name, const ShaderResourceViewDep* p_view) const;
+		void SetView(DescriptorSetDep* p_desc_set, text::TextSymbol name, const UnorderedAccessViewDep* p_view) const;
+		void SetView(DescriptorSetDep* p_desc_set, text::TextSymbol name, const SamplerDep* p_view) const;
 
 	public:
 		ID3D12PipelineState* GetD3D12PipelineState();
@@ -1,7 +1,7 @@
 ﻿
 #include "rhi_object_garbage_collect.h"
 
-#include "d3d12/device.d3d12.h"
+#include <chrono>
 
 namespace ngl
 {
@@ -9,29 +9,13 @@ namespace rhi
 {
 
 
-	// -------------------------------------------------------------------------------------------------------------------------------------------------
-	IDevice* RhiObjectBase::GetParentDeviceInreface()
+	namespace
 	{
-		return p_parent_device_;
-	}
-	const IDevice* RhiObjectBase::GetParentDeviceInreface() const
-	{
-		return p_parent_device_;
-	}
-	DeviceDep* RhiObjectBase::GetParentDevice()
-	{
-		return p_parent_device_;
-	}
-	DeviceDep* RhiObjectBase::GetParentDevice() const
-	{
-		return p_parent_device_;
-	}
-	void RhiObjectBase::InitializeRhiObject(DeviceDep* p_device)
-	{
-		p_parent_device_ = p_device;
+		s64 GetTimeNs()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
 	}
-	// -------------------------------------------------------------------------------------------------------------------------------------------------
-
 
 	GabageCollector::GabageCollector()
 	{
@@ -41,12 +25,20 @@ namespace rhi
 		Finalize();
 	}
 
-	bool GabageCollector::Initialize()
+	bool GabageCollector::Initialize(const Desc& desc)
 	{
+		desc_ = desc;
+		if (0 == desc_.batch_size)
+			desc_.batch_size = 1;
 		return true;
 	}
 	void GabageCollector::Finalize()
 	{
+		// 以降は呼び出しスレッドで全て破棄する.
+		WaitForDestroyJob();
+		desc_.p_job_system = nullptr;
+		desc_.time_budget_ms = 0.0f;
+
 		const int max_frame = (int)frame_stack_.size();
 		for (int i = 0; i < max_frame; ++i)
 		{
@@ -55,6 +47,12 @@ namespace rhi
 		}
 	}
 
+	void GabageCollector::SetJobSystem(thread::JobSystem* p_job_system)
+	{
+		WaitForDestroyJob();
+		desc_.p_job_system = p_job_system;
+	}
+
 	// フレーム開始同期処理.
 	void GabageCollector::ReadyToNewFrame()
 	{
@@ -66,20 +64,132 @@ namespace rhi
 	// 破棄の実行.
 	void GabageCollector::Execute()
 	{
+		// 前回の破棄Jobの完了を待ってから持ち越し分を取り出す.
+		WaitForDestroyJob();
+
 		const int max_frame = (int)frame_stack_.size();
 
 		const int oldest_index = (flip_index_.load() + 1) % max_frame;
 
-		while (auto* e = frame_stack_[oldest_index].Pop())
+		// 持ち越し分を先頭にして一度にまとめて取り出す.
+		IRhiObject* head = carry_over_stack_.PopAll();
 		{
-			delete e;
+			IRhiObject* frame_head = frame_stack_[oldest_index].PopAll();
+			if (head)
+			{
+				IRhiObject* tail = head;
+				while (tail->GetNext())
+					tail = tail->GetNext();
+				tail->SetNext(frame_head);
+			}
+			else
+			{
+				head = frame_head;
+			}
+		}
+		if (!head)
+		{
+			last_statistics_ = {};
+			return;
+		}
+
+		budget_begin_ns_.store(0, std::memory_order_relaxed);
+		destroyed_count_.store(0, std::memory_order_relaxed);
+		carry_over_count_.store(0, std::memory_order_relaxed);
+		destroy_time_ns_.store(0, std::memory_order_relaxed);
+		batch_count_ = 0;
+		is_statistics_pending_ = true;
+
+		thread::JobSystem* p_job_system = desc_.p_job_system;
+		if (!p_job_system || 0 >= p_job_system->GetWorkerCount())
+		{
+			DestroyBatch(head);
+			batch_count_ = 1;
+			PublishStatistics();
+			return;
+		}
+
+		// batch_size毎に切り離してJobを発行.
+		while (head)
+		{
+			IRhiObject* batch_head = head;
+			IRhiObject* batch_tail = head;
+			for (u32 i = 1; i < desc_.batch_size && batch_tail->GetNext(); ++i)
+				batch_tail = batch_tail->GetNext();
+			head = batch_tail->GetNext();
+			batch_tail->SetNext(nullptr);
+
+			p_job_system->Add([this, batch_head]
+				{
+					DestroyBatch(batch_head);
+				}, &job_counter_);
+			++batch_count_;
 		}
 	}
 
+	void GabageCollector::WaitForDestroyJob()
+	{
+		if (desc_.p_job_system)
+			desc_.p_job_system->Wait(job_counter_);
+		PublishStatistics();
+	}
+
 	// 新規破棄オブジェクトのPush.
 	void GabageCollector::Enqueue(IRhiObject* p_obj)
 	{
 		frame_stack_[flip_index_.load()].Push(p_obj);
 	}
+
+	void GabageCollector::DestroyBatch(IRhiObject* head)
+	{
+		const s64 begin_ns = GetTimeNs();
+
+		// 時間上限は最初に開始したバッチの開始時刻から計る.
+		const s64 budget_ns = static_cast<s64>(static_cast<double>(desc_.time_budget_ms) * 1000000.0);
+		// 他のバッチが設定済みの場合はその時刻を取得する.
+		s64 budget_begin_ns = 0;
+		if (budget_begin_ns_.compare_exchange_strong(budget_begin_ns, begin_ns, std::memory_order_relaxed))
+			budget_begin_ns = begin_ns;
+
+		u32 destroyed = 0;
+		IRhiObject* e = head;
+		while (e)
+		{
+			// 進行を保証するため, バッチ毎に最低一つは破棄する.
+			if (0 < budget_ns && 0 < destroyed && budget_begin_ns + budget_ns <= GetTimeNs())
+			{
+				u32 carry_over = 1;
+				IRhiObject* tail = e;
+				while (tail->GetNext())
+				{
+					tail = tail->GetNext();
+					++carry_over;
+				}
+				carry_over_stack_.PushList(e, tail);
+				carry_over_count_.fetch_add(carry_over, std::memory_order_relaxed);
+				break;
+			}
+
+			IRhiObject* next = e->GetNext();
+			delete e;
+			e = next;
+			++destroyed;
+		}
+
+		destroyed_count_.fetch_add(destroyed, std::memory_order_relaxed);
+		destroy_time_ns_.fetch_add(GetTimeNs() - begin_ns, std::memory_order_relaxed);
+	}
+
+	void GabageCollector::PublishStatistics()
+	{
+		if (!is_statistics_pending_)
+			return;
+		is_statistics_pending_ = false;
+
+		last_statistics_.destroyed_count = destroyed_count_.load(std::memory_order_relaxed);
+		last_statistics_.carry_over_count = carry_over_count_.load(std::memory_order_relaxed);
+		last_statistics_.batch_count = batch_count_;
+		last_statistics_.destroy_time_ms = static_cast<double>(destroy_time_ns_.load(std::memory_order_relaxed)) / 1000000.0;
+	}
 }
 }
@@ -6,6 +6,7 @@
 #include <array>
 
 #include "ngl/rhi/rhi_ref.h"
+#include "ngl/thread/job_thread.h"
 
 
 
@@ -18,6 +19,7 @@ namespace rhi
 
 	// Dep側のRhiObject用基底.
 	//  RhiRef<>で保持して参照カウント遅延破棄するRhiObjectはこのクラスを継承する.
+	//  DeviceDepの定義に依存する実装はBackend側(device.d3d12.cpp)にあり, GabageCollectorはBackendに依存しない.
 	class RhiObjectBase : public IRhiObject
 	{
 	public:
@@ -43,28 +45,87 @@ namespace rhi
 	// RHIオブジェクトを安全なタイミングまで遅延してから破棄をするためのクラス.
 	// 参照管理オブジェクトの破棄からDevice経由でPushされ, フレーム同期を挟んで2フレーム後に実際の破棄をする
 	//	(2フレームは GameThread->RenderThread->GPU という構成での最大を考慮)
+	// 破棄対象はフレーム毎のStackから一度に取り出し, batch_size毎に分割してJobSystemのWorkerで破棄する.
+	// JobSystem未指定の場合はExecuteの呼び出しスレッドで破棄する.
+	// time_budget_msを指定した場合は破棄開始からの時間が超過した時点で残りを次回のExecuteに持ち越す.
 	class GabageCollector
 	{
+	public:
+		struct Desc
+		{
+			// 破棄を実行するJobSystem. nullptrの場合はExecuteの呼び出しスレッドで破棄する.
+			thread::JobSystem*	p_job_system = nullptr;
+			// 1Jobで破棄するオブジェクト数.
+			u32					batch_size = 64;
+			// フレーム毎の破棄時間の上限(ミリ秒). 0以下で無制限.
+			float				time_budget_ms = 0.0f;
+		};
+
+		// Execute一回分の統計.
+		struct Statistics
+		{
+			// 破棄したオブジェクト数.
+			u32		destroyed_count = 0;
+			// 時間上限により次回に持ち越したオブジェクト数.
+			u32		carry_over_count = 0;
+			// 発行したバッチ数.
+			u32		batch_count = 0;
+			// 各バッチの破棄時間の合計(ミリ秒).
+			double	destroy_time_ms = 0.0;
+		};
+
 	public:
 		GabageCollector();
 		~GabageCollector();
 
-		bool Initialize();
+		bool Initialize(const Desc& desc);
 		void Finalize();
 
+		// 破棄を実行するJobSystemの変更. 発行済みの破棄Jobの完了を待機してから切り替える.
+		void SetJobSystem(thread::JobSystem* p_job_system);
+
 		// フレーム開始同期処理.
 		void ReadyToNewFrame();
 
-		// 破棄の実行.
+		// 破棄の実行. JobSystem指定時は破棄Jobを発行して戻る.
 		void Execute();
 
+		// 発行済みの破棄Jobの完了を待機する.
+		void WaitForDestroyJob();
+
 		// 新規破棄オブジェクトのPush.
 		void Enqueue(IRhiObject* p_obj);
 
+		// 完了した直近のExecuteの統計. JobSystem指定時は次回のExecuteもしくはWaitForDestroyJobで更新される.
+		const Statistics& GetLastStatistics() const { return last_statistics_; }
+
 	private:
+		// head からnullptr終端までのリストを破棄する.
+		void DestroyBatch(IRhiObject* head);
+		// 完了したExecuteの統計を確定する.
+		void PublishStatistics();
+
+	private:
+		Desc	desc_ = {};
+
 		std::atomic_int	flip_index_ = 0;
 
 		std::array<RhiObjectGabageCollectStack, 3>	frame_stack_;
+		// 時間上限で持ち越したオブジェクト.
+		RhiObjectGabageCollectStack					carry_over_stack_;
+
+		// 発行した破棄Job.
+		thread::JobCounter		job_counter_;
+		bool					is_statistics_pending_ = false;
+
+		// 実行中のExecuteの集計. 破棄Jobから更新される.
+		std::atomic<s64>		budget_begin_ns_ = 0;
+		std::atomic<u32>		destroyed_count_ = 0;
+		std::atomic<u32>		carry_over_count_ = 0;
+		std::atomic<s64>		destroy_time_ns_ = 0;
+		u32						batch_count_ = 0;
+
+		Statistics				last_statistics_ = {};
 	};
 }
 }
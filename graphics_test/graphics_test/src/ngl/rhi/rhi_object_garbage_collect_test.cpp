@@ -0,0 +1,221 @@
+﻿
+#include "rhi_object_garbage_collect_test.h"
+
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <iostream>
+
+#include <assert.h>
+
+namespace ngl
+{
+namespace rhi
+{
+namespace test
+{
+	namespace
+	{
+		using Clock = std::chrono::steady_clock;
+
+		constexpr int k_object_count = 100000;
+
+		std::atomic<int>	s_live_count = 0;
+		std::atomic<int>	s_destroy_count = 0;
+
+		// Deviceを持たない模擬RhiObject. 破棄時にComPtrのRelease等に相当する処理時間を消費する.
+		class MockRhiObject : public IRhiObject
+		{
+		public:
+			MockRhiObject(int work, GabageCollector* p_child_gc = nullptr)
+				: work_(work), p_child_gc_(p_child_gc)
+			{
+				s_live_count.fetch_add(1, std::memory_order_relaxed);
+			}
+			~MockRhiObject()
+			{
+				volatile u32 v = 0;
+				for (int i = 0; i < work_; ++i)
+					v = v * 1664525u + 1013904223u;
+
+				// 子オブジェクトを持つ場合は破棄中にEnqueueする.
+				if (p_child_gc_)
+					p_child_gc_->Enqueue(new MockRhiObject(work_));
+
+				s_live_count.fetch_sub(1, std::memory_order_relaxed);
+				s_destroy_count.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			IDevice* GetParentDeviceInreface() override { return nullptr; }
+			const IDevice* GetParentDeviceInreface() const override { return nullptr; }
+
+		private:
+			int					work_ = 0;
+			GabageCollector*	p_child_gc_ = nullptr;
+		};
+
+		void ResetCount()
+		{
+			s_live_count.store(0);
+			s_destroy_count.store(0);
+		}
+
+		double ToMillisec(Clock::duration d)
+		{
+			return std::chrono::duration<double, std::milli>(d).count();
+		}
+
+		// Enqueueから2回目のReadyToNewFrame後のExecuteで破棄されることの検証.
+		int TestFrameDelay(thread::JobSystem* p_job_system)
+		{
+			int fail_count = 0;
+			ResetCount();
+
+			GabageCollector gc;
+			GabageCollector::Desc desc = {};
+			desc.p_job_system = p_job_system;
+			desc.batch_size = 100;
+			gc.Initialize(desc);
+
+			constexpr int k_count = 1000;
+			for (int i = 0; i < k_count; ++i)
+				gc.Enqueue(new MockRhiObject(0));
+
+			gc.ReadyToNewFrame();
+			gc.Execute();
+			gc.WaitForDestroyJob();
+			if (0 != s_destroy_count.load())
+			{
+				std::cout << "[GabageCollectorTest] destroyed too early." << std::endl;
+				++fail_count;
+			}
+
+			gc.ReadyToNewFrame();
+			gc.Execute();
+			gc.WaitForDestroyJob();
+			const auto& stat = gc.GetLastStatistics();
+			const u32 expect_batch = (p_job_system) ? (k_count / desc.batch_size) : 1;
+			if (k_count != s_destroy_count.load() || k_count != static_cast<int>(stat.destroyed_count) || expect_batch != stat.batch_count)
+			{
+				std::cout << "[GabageCollectorTest] frame delay destroyed " << s_destroy_count.load() << " stat " << stat.destroyed_count << " batch " << stat.batch_count << std::endl;
+				++fail_count;
+			}
+			return fail_count;
+		}
+
+		// 時間上限での持ち越しと破棄中のEnqueueの検証.
+		int TestTimeBudget(thread::JobSystem* p_job_system)
+		{
+			int fail_count = 0;
+			ResetCount();
+
+			{
+				GabageCollector gc;
+				GabageCollector::Desc desc = {};
+				desc.p_job_system = p_job_system;
+				desc.batch_size = 32;
+				desc.time_budget_ms = 0.5f;
+				gc.Initialize(desc);
+
+				constexpr int k_count = 20000;
+				for (int i = 0; i < k_count; ++i)
+					gc.Enqueue(new MockRhiObject(2000, (0 == i % 10) ? &gc : nullptr));
+
+				int frame = 0;
+				u32 total_destroyed = 0;
+				bool carried_over = false;
+				for (; frame < 10000 && 0 < s_live_count.load(); ++frame)
+				{
+					gc.ReadyToNewFrame();
+					gc.Execute();
+					gc.WaitForDestroyJob();
+					const auto& stat = gc.GetLastStatistics();
+					total_destroyed += stat.destroyed_count;
+					carried_over |= (0 < stat.carry_over_count);
+				}
+				const int expect = k_count + k_count / 10;
+				if (0 != s_live_count.load() || expect != s_destroy_count.load() || expect != static_cast<int>(total_destroyed) || !carried_over)
+				{
+					std::cout << "[GabageCollectorTest] budget live " << s_live_count.load() << " destroyed " << s_destroy_count.load() << " stat " << total_destroyed << " carry_over " << carried_over << std::endl;
+					++fail_count;
+				}
+				std::cout << "[GabageCollectorTest] budget 0.5ms : " << expect << " objects in " << frame << " frames." << std::endl;
+			}
+
+			// Finalizeで残りが全て破棄されること.
+			{
+				GabageCollector gc;
+				GabageCollector::Desc desc = {};
+				desc.p_job_system = p_job_system;
+				desc.time_budget_ms = 0.01f;
+				gc.Initialize(desc);
+				for (int i = 0; i < 1000; ++i)
+					gc.Enqueue(new MockRhiObject(2000));
+				gc.ReadyToNewFrame();
+				gc.ReadyToNewFrame();
+				gc.Execute();
+			}
+			if (0 != s_live_count.load())
+			{
+				std::cout << "[GabageCollectorTest] finalize leaked " << s_live_count.load() << std::endl;
+				++fail_count;
+			}
+			return fail_count;
+		}
+
+		// 大量破棄時のExecute呼び出しスレッドの所要時間.
+		double MeasureExecute(thread::JobSystem* p_job_system, double& out_complete_ms, GabageCollector::Statistics& out_stat)
+		{
+			ResetCount();
+
+			GabageCollector gc;
+			GabageCollector::Desc desc = {};
+			desc.p_job_system = p_job_system;
+			gc.Initialize(desc);
+			for (int i = 0; i < k_object_count; ++i)
+				gc.Enqueue(new MockRhiObject(200));
+			gc.ReadyToNewFrame();
+			gc.ReadyToNewFrame();
+
+			const auto t0 = Clock::now();
+			gc.Execute();
+			const auto t1 = Clock::now();
+			gc.WaitForDestroyJob();
+			const auto t2 = Clock::now();
+
+			out_complete_ms = ToMillisec(t2 - t0);
+			out_stat = gc.GetLastStatistics();
+			return ToMillisec(t1 - t0);
+		}
+	}
+
+	void GabageCollectorTest()
+	{
+		int num_thread = static_cast<int>(std::thread::hardware_concurrency());
+		num_thread = (1 < num_thread) ? num_thread - 1 : 1;
+
+		thread::JobSystem job_system;
+		job_system.Init(num_thread);
+
+		int fail_count = 0;
+		fail_count += TestFrameDelay(nullptr);
+		fail_count += TestFrameDelay(&job_system);
+		fail_count += TestTimeBudget(nullptr);
+		fail_count += TestTimeBudget(&job_system);
+
+		GabageCollector::Statistics serial_stat, parallel_stat;
+		double serial_complete_ms, parallel_complete_ms;
+		const double serial_ms = MeasureExecute(nullptr, serial_complete_ms, serial_stat);
+		const double parallel_ms = MeasureExecute(&job_system, parallel_complete_ms, parallel_stat);
+		if (k_object_count != static_cast<int>(serial_stat.destroyed_count) || k_object_count != static_cast<int>(parallel_stat.destroyed_count))
+			++fail_count;
+
+		std::cout << "[GabageCollectorTest] " << k_object_count << " objects, worker " << num_thread << std::endl;
+		std::cout << "	serial   : execute " << serial_ms << " ms, complete " << serial_complete_ms << " ms, destroy total " << serial_stat.destroy_time_ms << " ms" << std::endl;
+		std::cout << "	parallel : execute " << parallel_ms << " ms, complete " << parallel_complete_ms << " ms, destroy total " << parallel_stat.destroy_time_ms << " ms, batch " << parallel_stat.batch_count << std::endl;
+		std::cout << "	fail " << fail_count << std::endl;
+		assert(0 == fail_count);
+	}
+}
+}
+}
@@ -0,0 +1,18 @@
+﻿#pragma once
+
+#include "rhi_object_garbage_collect.h"
+
+
+namespace ngl
+{
+namespace rhi
+{
+namespace test
+{
+	// GabageCollectorのテスト.
+	// Deviceを持たない模擬RhiObjectで, 遅延フレーム数, JobSystemでのバッチ破棄, 時間上限による持ち越し, 破棄中のEnqueueを検証し,
+	// 逐次破棄とJobSystemでの破棄でExecute呼び出しスレッドの所要時間を比較して標準出力に出力する.
+	void GabageCollectorTest();
+}
+}
+}
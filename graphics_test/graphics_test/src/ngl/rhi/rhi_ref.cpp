@@ -2,50 +2,23 @@
 #include "rhi_ref.h"
 
 
-// とりあえずD3D12用
-#include "ngl/rhi/d3d12/device.d3d12.h"
-
-
 namespace ngl
 {
 namespace rhi
 {
-	namespace detail
+	void IRhiObject::DestroyByLastRhiRef()
 	{
-		RhiObjectHolder::RhiObjectHolder()
-		{
-		}
-		RhiObjectHolder::RhiObjectHolder(IRhiObject* p)
+		// 安全なタイミングでのRHIオブジェクト破棄対応.
+		if (IDevice* p_device = GetParentDeviceInreface())
 		{
-			p_obj_ = p;
+			// 実際の破棄処理をDeviceに依頼. Deviceの持つGabageCollectorに積み込む等.
+			p_device->DestroyRhiObject(this);
 		}
-		RhiObjectHolder::~RhiObjectHolder()
+		else
 		{
-#if 1
-			// 安全なタイミングでのRHIオブジェクト破棄対応.
-			if (nullptr == p_obj_)
-				return;
-
-			// Deviceの持つFrameDestroyListに積み込む等.
-			if (p_obj_->GetParentDeviceInreface())
-			{
-				// 実際の破棄処理をDeviceに依頼.
-				p_obj_->GetParentDeviceInreface()->DestroyRhiObject(p_obj_);
-				p_obj_ = nullptr;
-			}
-			else
-			{
-				// そうでなければ即時破棄.
-				delete p_obj_;
-			}
-#else
-			if (p_res_)
-			{
-				assert(false); // 本来はRhiオブジェクト破棄を安全なタイミングで遅延実行する.
-				delete p_res_;
-			}
-#endif
+			// そうでなければ即時破棄.
+			delete this;
 		}
 	}
 }
-}
\ No newline at end of file
+}
@@ -1,5 +1,7 @@
 ﻿#pragma once
 
+#include <atomic>
+
 #include "ngl/rhi/rhi.h"
 
 #include "ngl/thread/lockfree_stack_intrusive.h"
@@ -22,7 +24,11 @@ namespace ngl
 
 
 
+		template<typename RHI_CLASS>
+		class RhiRef;
+
 		// BufferやTexture等はこのクラスを継承することで, RhiRefによる参照管理と破棄時の安全な遅延破棄がサポートされる.
+		//	参照カウントはオブジェクト自身が持ち, RhiRefはポインタのみを保持する.
 		using RhiObjectGabageCollectStack = ngl::thread::LockFreeStackIntrusive<class IRhiObject>;
 		class IRhiObject : public RhiObjectGabageCollectStack::Node
 		{
@@ -32,32 +38,47 @@ namespace ngl
 			IRhiObject() {}
 			virtual ~IRhiObject() {}
 
+			IRhiObject(const IRhiObject& o)
+				: RhiObjectGabageCollectStack::Node(o)
+			{
+				// 参照カウントはコピーしない.
+			}
+			IRhiObject& operator=(const IRhiObject& o)
+			{
+				// 参照カウントはコピーしない.
+				RhiObjectGabageCollectStack::Node::operator=(o);
+				return *this;
+			}
+
 
 			// 派生クラスで親Deviceを返す実装.
 			virtual IDevice* GetParentDeviceInreface() = 0;
 			virtual const IDevice* GetParentDeviceInreface() const = 0;
 
-		};
-
-		namespace detail
-		{
-			class RhiObjectHolder
-			{
-			public:
-				RhiObjectHolder();
-				RhiObjectHolder(IRhiObject* p);
-
-				// IRhiObject実体の破棄.
-				~RhiObjectHolder();
+			// RhiRefによる参照数. デバッグ用.
+			u32 GetRhiRefCount() const { return ref_count_.load(std::memory_order_relaxed); }
 
+		private:
+			template<typename RHI_CLASS>
+			friend class RhiRef;
 
-				IRhiObject* p_obj_ = nullptr;
-			};
+			void AddRhiRef()
+			{
+				ref_count_.fetch_add(1, std::memory_order_relaxed);
+			}
+			void ReleaseRhiRef()
+			{
+				if (1 == ref_count_.fetch_sub(1, std::memory_order_acq_rel))
+					DestroyByLastRhiRef();
+			}
+			// 参照が無くなった際の破棄. 親Deviceがあれば遅延破棄を依頼し, 無ければ即時破棄する.
+			void DestroyByLastRhiRef();
 
-			using RhiObjectHolderHandle = std::shared_ptr<const RhiObjectHolder>;
-		}
+			std::atomic<u32>	ref_count_ = 0;
+		};
 
 		// IRhiObject継承クラスオブジェクトの安全な遅延破棄を提供するSharedPtr.
+		//	参照カウントはIRhiObjectが持つため, 参照の生成で追加のメモリ確保は発生しない.
 		template<typename RHI_CLASS>
 		class RhiRef
 		{
@@ -67,74 +88,85 @@ namespace ngl
 
 			RhiRef()
 			{}
-			RhiRef(RhiRef& ref)
-			{
-				raw_handle_ = ref.raw_handle_;
-			}
 			RhiRef(const RhiRef& ref)
 			{
-				raw_handle_ = ref.raw_handle_;
+				Reset(ref.p_obj_);
 			}
-			RhiRef(detail::RhiObjectHolderHandle& h)
+			RhiRef(RhiRef&& ref) noexcept
 			{
-				raw_handle_ = h;
+				p_obj_ = ref.p_obj_;
+				ref.p_obj_ = nullptr;
 			}
 			RhiRef(RHI_CLASS* p)
 			{
 				Reset(p);
 			}
-			~RhiRef() {}
+			~RhiRef()
+			{
+				Reset();
+			}
+
+			RhiRef& operator=(const RhiRef& ref)
+			{
+				Reset(ref.p_obj_);
+				return *this;
+			}
+			RhiRef& operator=(RhiRef&& ref) noexcept
+			{
+				if (this != &ref)
+				{
+					Reset();
+					p_obj_ = ref.p_obj_;
+					ref.p_obj_ = nullptr;
+				}
+				return *this;
+			}
 
 
 			void Reset(RHI_CLASS* p = nullptr)
 			{
+				// 同じオブジェクトの再設定で破棄されないように加算を先に行う.
 				if (p)
-				{
-					// 新規リソース実体のハンドルとなるため, 取り扱い注意.
-					raw_handle_.reset(new detail::RhiObjectHolder(p));
-				}
-				else
-				{
-					raw_handle_.reset();
-				}
+					static_cast<IRhiObject*>(p)->AddRhiRef();
+				RHI_CLASS* prev = p_obj_;
+				p_obj_ = p;
+				if (prev)
+					static_cast<IRhiObject*>(prev)->ReleaseRhiRef();
 			}
 
 			bool IsValid() const
 			{
-				return nullptr != raw_handle_.get() && nullptr != raw_handle_.get()->p_obj_;
+				return nullptr != p_obj_;
 			}
 
 			RHI_CLASS* Get()
 			{
-				return static_cast<RHI_CLASS*>(raw_handle_.get()->p_obj_);
+				return p_obj_;
 			}
 			const RHI_CLASS* Get() const
 			{
-				return static_cast<const RHI_CLASS*>(raw_handle_.get()->p_obj_);
+				return p_obj_;
 			}
 			RHI_CLASS* operator->()
 			{
-				return static_cast<RHI_CLASS*>(raw_handle_.get()->p_obj_);
+				return p_obj_;
 			}
 			const RHI_CLASS* operator->() const
 			{
-				return static_cast<const RHI_CLASS*>(raw_handle_.get()->p_obj_);
+				return p_obj_;
 			}
 			RHI_CLASS& operator*()
 			{
-				return *static_cast<RHI_CLASS*>(raw_handle_.get()->p_obj_);
+				return *p_obj_;
 			}
 			const RHI_CLASS& operator*() const
 			{
-				return *static_cast<const RHI_CLASS*>(raw_handle_.get()->p_obj_);
+				return *p_obj_;
 			}
 
 
 		private:
-			// Resouce基底ポインタを保持するオブジェクトの参照カウンタ.
-			//	これにより実体をハンドルで共有しつつ, ハンドルの参照が無くなった際の保持オブジェクトのデストラクタで実体の破棄をカスタマイズする.
-			detail::RhiObjectHolderHandle raw_handle_;
-
+			RHI_CLASS*	p_obj_ = nullptr;
 		};
 
 	}
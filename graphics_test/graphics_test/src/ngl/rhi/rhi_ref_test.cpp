@@ -0,0 +1,156 @@
+﻿
+#include "rhi_ref_test.h"
+
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <iostream>
+
+#include <assert.h>
+
+namespace ngl
+{
+namespace rhi
+{
+namespace test
+{
+	namespace
+	{
+		using Clock = std::chrono::steady_clock;
+
+		constexpr int k_object_count = 100000;
+		constexpr int k_copy_count = 8;
+
+		int s_live_count = 0;
+
+		// Deviceを持たない模擬RhiObject. 最後の参照の破棄で即時破棄される.
+		class MockRhiObject : public IRhiObject
+		{
+		public:
+			MockRhiObject(u32 v) : value_(v) { ++s_live_count; }
+			~MockRhiObject() { --s_live_count; }
+
+			IDevice* GetParentDeviceInreface() override { return nullptr; }
+			const IDevice* GetParentDeviceInreface() const override { return nullptr; }
+
+			u32 value_ = 0;
+		};
+
+		// 旧実装. 保持オブジェクトを別途確保してshared_ptrで共有する.
+		class LegacyRhiObjectHolder
+		{
+		public:
+			LegacyRhiObjectHolder(IRhiObject* p) : p_obj_(p) {}
+			~LegacyRhiObjectHolder() { delete p_obj_; }
+
+			IRhiObject* p_obj_ = nullptr;
+		};
+		template<typename RHI_CLASS>
+		class LegacyRhiRef
+		{
+		public:
+			LegacyRhiRef() {}
+			LegacyRhiRef(RHI_CLASS* p) { raw_handle_.reset(new LegacyRhiObjectHolder(p)); }
+
+			RHI_CLASS* operator->() { return static_cast<RHI_CLASS*>(raw_handle_.get()->p_obj_); }
+
+		private:
+			std::shared_ptr<const LegacyRhiObjectHolder> raw_handle_;
+		};
+
+		double ToMillisec(Clock::duration d)
+		{
+			return std::chrono::duration<double, std::milli>(d).count();
+		}
+
+		struct BenchmarkResult
+		{
+			double	create_ms = 0.0;
+			double	copy_ms = 0.0;
+			double	access_ms = 0.0;
+			double	destroy_ms = 0.0;
+			u64		sum = 0;
+		};
+
+		// 生成, 参照のコピー, 参照経由のアクセス, 全参照の破棄の時間.
+		template<typename REF>
+		BenchmarkResult Benchmark()
+		{
+			BenchmarkResult result;
+
+			std::vector<REF> ref_array;
+			ref_array.reserve(k_object_count);
+			std::vector<REF> copy_array;
+			copy_array.reserve(k_object_count * k_copy_count);
+
+			const auto t0 = Clock::now();
+			for (int i = 0; i < k_object_count; ++i)
+				ref_array.push_back(REF(new MockRhiObject(i)));
+			const auto t1 = Clock::now();
+			for (int c = 0; c < k_copy_count; ++c)
+				for (auto& e : ref_array)
+					copy_array.push_back(e);
+			const auto t2 = Clock::now();
+			for (auto& e : copy_array)
+				result.sum += e->value_;
+			const auto t3 = Clock::now();
+			copy_array.clear();
+			ref_array.clear();
+			const auto t4 = Clock::now();
+
+			result.create_ms = ToMillisec(t1 - t0);
+			result.copy_ms = ToMillisec(t2 - t1);
+			result.access_ms = ToMillisec(t3 - t2);
+			result.destroy_ms = ToMillisec(t4 - t3);
+			return result;
+		}
+
+		int TestFunction()
+		{
+			int fail_count = 0;
+			{
+				RhiRef<MockRhiObject> r0 = new MockRhiObject(1);
+				RhiRef<MockRhiObject> r1 = r0;
+				RhiRef<MockRhiObject> r2 = std::move(r1);
+				r0 = r0;
+				if (r1.IsValid() || !r0.IsValid() || r0.Get() != r2.Get() || 2 != r0->GetRhiRefCount())
+					++fail_count;
+
+				// 同じオブジェクトの再設定で破棄されない.
+				r2.Reset(r0.Get());
+				if (1 != s_live_count || 2 != r0->GetRhiRefCount())
+					++fail_count;
+
+				r0.Reset();
+				if (1 != s_live_count || 1 != r2->GetRhiRefCount())
+					++fail_count;
+
+				r0 = RhiRef<MockRhiObject>(new MockRhiObject(2));
+				if (2 != s_live_count)
+					++fail_count;
+			}
+			if (0 != s_live_count)
+				++fail_count;
+			return fail_count;
+		}
+	}
+
+	void RhiRefBenchmark()
+	{
+		int fail_count = TestFunction();
+
+		const BenchmarkResult legacy = Benchmark<LegacyRhiRef<MockRhiObject>>();
+		const BenchmarkResult intrusive = Benchmark<RhiRef<MockRhiObject>>();
+		if (legacy.sum != intrusive.sum || 0 != s_live_count)
+			++fail_count;
+
+		std::cout << "[RhiRefBenchmark] " << k_object_count << " objects, " << k_copy_count << " copies each" << std::endl;
+		std::cout << "	shared_ptr holder : create " << legacy.create_ms << " ms, copy " << legacy.copy_ms << " ms, access " << legacy.access_ms << " ms, destroy " << legacy.destroy_ms << " ms" << std::endl;
+		std::cout << "	intrusive         : create " << intrusive.create_ms << " ms, copy " << intrusive.copy_ms << " ms, access " << intrusive.access_ms << " ms, destroy " << intrusive.destroy_ms << " ms" << std::endl;
+		std::cout << "	sizeof shared_ptr holder " << sizeof(LegacyRhiRef<MockRhiObject>) << ", intrusive " << sizeof(RhiRef<MockRhiObject>) << std::endl;
+		std::cout << "	fail " << fail_count << std::endl;
+		assert(0 == fail_count);
+	}
+}
+}
+}
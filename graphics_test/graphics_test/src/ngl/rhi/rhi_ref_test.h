@@ -0,0 +1,17 @@
+﻿#pragma once
+
+#include "rhi_ref.h"
+
+
+namespace ngl
+{
+namespace rhi
+{
+namespace test
+{
+	// RhiRefのテスト.
+	// Deviceを持たない模擬RhiObjectで参照管理と破棄を検証し, 旧実装のshared_ptrによる保持オブジェクト方式と生成, コピー, 参照, 破棄の速度を比較して標準出力に出力する.
+	void RhiRefBenchmark();
+}
+}
+}
@@ -5,13 +5,21 @@
 
 #include <algorithm>
 #include <cassert>
+#include <functional>
+#include <iterator>
 #include <stdarg.h>
 
+#include "ngl/text/text_hash_simd.h"
+
 /*
 	文字列とそのhash値を保持し、等価演算を高速化する
 	templateによる固定長
 
 	サイズ違いのインスタンス同士の代入などは今後追加予定
+
+	ハッシュ関数はインスタンス毎にTextHashTypeで選択する. デフォルトはSIMD版.
+	ngl::text::HashText<256> path;								// TextHashType::Simd
+	ngl::text::HashText<32, ngl::text::TextHashType::Fnv1a> name;	// 従来のFNV-1a
 */
 
 
@@ -77,7 +85,23 @@ namespace ngl
 
 
 
-		template<int LEN>
+		// HashTextのハッシュ関数.
+		enum class TextHashType
+		{
+			Fnv1a,	// 1byte毎のFNV-1a.
+			Simd,	// 64byteストライプ単位のSIMDハッシュ. text_hash_simd.h.
+		};
+
+		template<TextHashType HASH_TYPE>
+		constexpr uint64_t TextHash(const char* str, size_t len)
+		{
+			if constexpr (TextHashType::Simd == HASH_TYPE)
+				return TextHashSimd(str, len);
+			else
+				return Fnv1a_Hash_array_representation_char(str, len);
+		}
+
+		template<int LEN, TextHashType HASH_TYPE = TextHashType::Simd>
 		class HashText
 		{
 		private:
@@ -102,27 +126,37 @@ namespace ngl
 				, valid_len_()
 				, hash_()
 			{
-				const int N = StrLenConstexpr(s);
-				valid_len_ = (LEN < N) ? LEN : N;
-				str_[valid_len_] = 0;
-				for (auto i = 0; i < valid_len_; ++i)
-					str_[i] = s[i];
+				if (NGL_TEXT_IS_CONSTANT_EVALUATED())
+				{
+					const int N = StrLenConstexpr(s);
+					valid_len_ = (LEN < N) ? LEN : N;
+					str_[valid_len_] = 0;
+					for (auto i = 0; i < valid_len_; ++i)
+						str_[i] = s[i];
+				}
+				else
+				{
+					const int N = static_cast<int>(std::strlen(s));
+					valid_len_ = (LEN < N) ? LEN : N;
+					std::memcpy(str_, s, valid_len_);
+				}
 
 				// Hash.
-				hash_ = ngl::text::Fnv1a_Hash_array_representation_char(str_, valid_len_);
+				hash_ = TextHash<HASH_TYPE>(str_, valid_len_);
 			}
 			void Set(const char* s, int len)
 			{
-				const int N = len;
-				valid_len_ = (LEN < N) ? LEN : N;
+				const size_t prev_len = static_cast<size_t>(valid_len_);
+				const size_t new_len = (0 < len) ? std::min(static_cast<size_t>(len), static_cast<size_t>(LEN)) : 0;
+				valid_len_ = static_cast<int>(new_len);
 
-				for (auto i = 0; i < valid_len_; ++i)
-					str_[i] = s[i];
-				for (auto i = valid_len_; i < LEN; ++i)
-					str_[i] = 0;
+				std::memcpy(str_, s, new_len);
+				// 有効文字列長より後ろは常にゼロのため, 既存の有効文字列長より短い場合の差分のみゼロ埋め. 範囲はバッファ内に制限する.
+				if (prev_len > new_len)
+					std::memset(str_ + new_len, 0, std::min(prev_len, sizeof(str_)) - new_len);
 
 				// Hash.
-				hash_ = ngl::text::Fnv1a_Hash_array_representation_char(str_, valid_len_);
+				hash_ = TextHash<HASH_TYPE>(str_, valid_len_);
 			}
 			constexpr const char* Get() const
 			{
@@ -140,38 +174,24 @@ namespace ngl
 			{
 				return LEN;
 			}
+			static constexpr TextHashType GetHashType()
+			{
+				return HASH_TYPE;
+			}
 
 		private:
 			char str_[LEN + 1] = {};
 			int  valid_len_ = {};
 			uint64_t hash_ = {};
 		};
-		namespace
-		{
-			template<int N0, int N1>
-			struct CompStr
-			{
-				constexpr CompStr(const HashText<N0>& v0, const HashText<N1>& v1)
-					: result()
-				{
-					result = true;
-					const int n = (v0.Length() < v1.Length()) ? v0.Length() : v1.Length();
-					for (int i = 0; i < n; ++i)
-					{
-						result &= (v0.Get()[i] == v1.Get()[i]);
-					}
-				}
-				bool result;
-			};
-		}
-		template<int LEN0, int LEN1>
-		static constexpr bool operator == (const HashText<LEN0>& v0, const HashText<LEN1>& v1)
+		// ハッシュ関数が同じインスタンス同士のみ比較できる.
+		template<int LEN0, int LEN1, TextHashType HASH_TYPE>
+		static constexpr bool operator == (const HashText<LEN0, HASH_TYPE>& v0, const HashText<LEN1, HASH_TYPE>& v1)
 		{
-			bool result = (v0.Hash() == v1.Hash()) && CompStr(v0, v1).result;
-			return result;
+			return (v0.Hash() == v1.Hash()) && (v0.Length() == v1.Length()) && TextEqualSimd(v0.Get(), v1.Get(), v0.Length());
 		}
-		template<int LEN0, int LEN1>
-		static constexpr bool operator != (const HashText<LEN0>& v0, const HashText<LEN1>& v1)
+		template<int LEN0, int LEN1, TextHashType HASH_TYPE>
+		static constexpr bool operator != (const HashText<LEN0, HASH_TYPE>& v0, const HashText<LEN1, HASH_TYPE>& v1)
 		{
 			return !(v0 == v1);
 		}
@@ -237,7 +257,7 @@ namespace ngl
 			{
 				if (obj.valid_len_ != valid_len_)
 					return false;
-				return 0 == std::memcmp(text_, obj.text_, valid_len_);
+				return TextEqualSimd(text_, obj.text_, valid_len_);
 			}
 
 			operator const char*() const
@@ -285,10 +305,10 @@ namespace ngl
 
 namespace std
 {
-	template <unsigned int SIZE>
-	struct hash<ngl::text::HashText<SIZE>>
+	template <int SIZE, ngl::text::TextHashType HASH_TYPE>
+	struct hash<ngl::text::HashText<SIZE, HASH_TYPE>>
 	{
-		size_t operator()(const ngl::text::HashText<SIZE>& v) const
+		size_t operator()(const ngl::text::HashText<SIZE, HASH_TYPE>& v) const
 		{
 			return v.Hash();
 		}
@@ -302,7 +322,7 @@ namespace std
 	{
 		size_t operator()(const ngl::text::FixedString<SIZE>& v) const
 		{
-			return ngl::text::Fnv1a_Hash_array_representation_char(v.Get(), v.GetValidLen());
+			return ngl::text::TextHashSimd(v.Get(), v.GetValidLen());
 		}
 	};
 }
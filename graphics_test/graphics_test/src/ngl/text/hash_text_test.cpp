@@ -0,0 +1,185 @@
+﻿
+#include "hash_text_test.h"
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <iostream>
+#include <unordered_set>
+
+#include <assert.h>
+
+#include "ngl/util/types.h"
+
+namespace ngl
+{
+namespace text
+{
+namespace test
+{
+	namespace
+	{
+		using Clock = std::chrono::steady_clock;
+
+		constexpr int k_max_length = 300;
+		constexpr int k_bench_loop = 200000;
+		constexpr int k_bench_length[] = { 8, 16, 32, 64, 128, 256 };
+
+		// 定数式でのハッシュ. 実行時の値と一致する必要がある.
+		constexpr HashText<64> k_constexpr_short("ngl_cb_sceneview");
+		constexpr HashText<256> k_constexpr_long("../third_party/model/sponza_gltf/glTF/textures/6772804448157695701_normal_texture_2k.png");
+		static_assert(k_constexpr_short == HashText<64>("ngl_cb_sceneview"), "constexpr compare");
+		static_assert(k_constexpr_short != HashText<64>("ngl_cb_sceneviex"), "constexpr compare");
+
+		// テスト用のパス風文字列.
+		std::string MakeText(int length, int seed)
+		{
+			static const char k_char[] = "abcdefghijklmnopqrstuvwxyz0123456789_/.";
+			std::string s(length, ' ');
+			u32 x = 0x12345678u ^ (seed * 0x9E3779B1u);
+			for (int i = 0; i < length; ++i)
+			{
+				x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+				s[i] = k_char[x % (sizeof(k_char) - 1)];
+			}
+			return s;
+		}
+
+		double ToNanosec(Clock::duration d, int count)
+		{
+			return std::chrono::duration<double, std::nano>(d).count() / count;
+		}
+	}
+
+	void HashTextBenchmark()
+	{
+		int fail_count = 0;
+
+		// 定数式と実行時の一致.
+		{
+			const std::string short_str(k_constexpr_short.Get(), k_constexpr_short.Length());
+			const std::string long_str(k_constexpr_long.Get(), k_constexpr_long.Length());
+			if (HashText<64>(short_str.c_str()) != k_constexpr_short || HashText<64>(short_str.c_str()).Hash() != k_constexpr_short.Hash())
+				++fail_count;
+			if (HashText<256>(long_str.c_str()).Hash() != k_constexpr_long.Hash())
+				++fail_count;
+		}
+
+		// 全長でスカラー版, SIMD版, 定数式用実装の一致と, 1byte変更でのハッシュと比較の変化.
+		{
+			std::unordered_set<u64> hash_set;
+			for (int len = 0; len <= k_max_length; ++len)
+			{
+				std::string s = MakeText(len, len);
+				const u64 h = TextHashSimd(s.data(), s.size());
+				if (h != text_hash_detail::HashConstexpr(s.data(), s.size()) || h != text_hash_detail::HashRuntimeScalar(s.data(), s.size()))
+					++fail_count;
+				hash_set.insert(h);
+
+				for (int i = 0; i < len; ++i)
+				{
+					std::string t = s;
+					t[i] ^= 0x01;
+					if (TextEqualSimd(s.data(), t.data(), len))
+						++fail_count;
+					if (h == TextHashSimd(t.data(), t.size()))
+						++fail_count;
+				}
+				if (!TextEqualSimd(s.data(), std::string(s).data(), len))
+					++fail_count;
+			}
+			// 末尾ゼロ詰めと長さ違い.
+			if (TextHashSimd("abc", 3) == TextHashSimd("abc\0", 4) || TextHashSimd("", 0) == TextHashSimd("\0", 1))
+				++fail_count;
+			// 同じ内容のストライプの入れ替え.
+			{
+				const std::string a = MakeText(64, 1), b = MakeText(64, 2);
+				if (TextHashSimd((a + b + a).data(), 192) == TextHashSimd((b + a + a).data(), 192))
+					++fail_count;
+			}
+			if (hash_set.size() != k_max_length + 1)
+				++fail_count;
+
+			// 長さ違いのHashTextは一致しない.
+			if (HashText<32>("abc") == HashText<32>("abcd") || !(HashText<32>("abc") == HashText<64>("abc")))
+				++fail_count;
+			// FixedString.
+			{
+				FixedString<64> fixed_a0, fixed_a1, fixed_b;
+				fixed_a0 = "texture/a.png";
+				fixed_a1 = "texture/a.png";
+				fixed_b = "texture/b.png";
+				if (!(fixed_a0 == fixed_a1) || (fixed_a0 == fixed_b) || std::hash<FixedString<64>>()(fixed_a0) != std::hash<FixedString<64>>()(fixed_a1))
+					++fail_count;
+			}
+		}
+
+		std::cout << "[HashTextBenchmark] sse2 " << NGL_TEXT_HASH_SSE2 << ", " << k_bench_loop << " loops" << std::endl;
+		for (int len : k_bench_length)
+		{
+			std::vector<std::string> text_array;
+			for (int i = 0; i < 16; ++i)
+				text_array.push_back(MakeText(len, i + 1000));
+
+			u64 sum_fnv = 0, sum_simd = 0;
+			auto t0 = Clock::now();
+			for (int l = 0; l < k_bench_loop; ++l)
+			{
+				const std::string& s = text_array[l & 15];
+				sum_fnv += Fnv1a_Hash_array_representation_char(s.data(), s.size());
+			}
+			auto t1 = Clock::now();
+			for (int l = 0; l < k_bench_loop; ++l)
+			{
+				const std::string& s = text_array[l & 15];
+				sum_simd += TextHashSimd(s.data(), s.size());
+			}
+			auto t2 = Clock::now();
+
+			// HashText<256>の構築.
+			u64 sum_build_fnv = 0, sum_build_simd = 0;
+			for (int l = 0; l < k_bench_loop; ++l)
+			{
+				const std::string& s = text_array[l & 15];
+				HashText<256, TextHashType::Fnv1a> h;
+				h.Set(s.data(), static_cast<int>(s.size()));
+				sum_build_fnv += h.Hash();
+			}
+			auto t3 = Clock::now();
+			for (int l = 0; l < k_bench_loop; ++l)
+			{
+				const std::string& s = text_array[l & 15];
+				HashText<256> h;
+				h.Set(s.data(), static_cast<int>(s.size()));
+				sum_build_simd += h.Hash();
+			}
+			auto t4 = Clock::now();
+
+			// ハッシュが一致する同じ文字列同士の比較.
+			int equal_count = 0;
+			std::vector<HashText<256>> h0, h1;
+			for (const auto& s : text_array)
+			{
+				h0.push_back(HashText<256>(s.c_str()));
+				h1.push_back(HashText<256>(s.c_str()));
+			}
+			auto t5 = Clock::now();
+			for (int l = 0; l < k_bench_loop; ++l)
+				equal_count += (h0[l & 15] == h1[l & 15]) ? 1 : 0;
+			auto t6 = Clock::now();
+			if (k_bench_loop != equal_count)
+				++fail_count;
+			if (sum_fnv != sum_build_fnv || sum_simd != sum_build_simd)
+				++fail_count;
+
+			std::cout << "  len " << len << std::endl;
+			std::cout << "    hash  fnv1a : " << ToNanosec(t1 - t0, k_bench_loop) << " ns, simd : " << ToNanosec(t2 - t1, k_bench_loop) << " ns (" << (ToNanosec(t1 - t0, 1) / ToNanosec(t2 - t1, 1)) << "x)" << std::endl;
+			std::cout << "    Set   fnv1a : " << ToNanosec(t3 - t2, k_bench_loop) << " ns, simd : " << ToNanosec(t4 - t3, k_bench_loop) << " ns (" << (ToNanosec(t3 - t2, 1) / ToNanosec(t4 - t3, 1)) << "x)" << std::endl;
+			std::cout << "    equal       : " << ToNanosec(t6 - t5, k_bench_loop) << " ns" << std::endl;
+		}
+		std::cout << "  fail " << fail_count << std::endl;
+		assert(0 == fail_count);
+	}
+}
+}
+}
@@ -0,0 +1,18 @@
+﻿#pragma once
+
+#include "hash_text.h"
+
+
+namespace ngl
+{
+namespace text
+{
+namespace test
+{
+	// HashTextのハッシュと比較のテスト.
+	// 定数式とSSE2版とスカラー版のハッシュの一致, 1byteだけ異なる文字列の比較結果を検証し,
+	// 長さ毎のFNV-1aとSIMD版のハッシュ, HashText構築, 比較の速度を標準出力に出力する.
+	void HashTextBenchmark();
+}
+}
+}
@@ -0,0 +1,403 @@
+﻿#pragma once
+
+#ifndef _NGL_TEXT_TEXT_HASH_SIMD_
+#define _NGL_TEXT_TEXT_HASH_SIMD_
+
+#include <cstdint>
+#include <cstring>
+
+/*
+	HashText, FixedString, TextSymbol用の文字列ハッシュと比較.
+
+	ハッシュは64byte単位で8本の64bitアキュムレータに積算するストライプ方式(xxh3の積算と同形式).
+		x64ではSSE2で4レーン x 128bitを同時に処理する. SSE2が使えない環境では同じ計算をスカラーで行う.
+		定数式評価ではバイト単位の読み込みで同じ計算を行うため, constexprで構築したHashTextと実行時に構築したHashTextのハッシュは一致する.
+		64byte以下はストライプを使わず, 16byte毎の128bit乗算の畳み込みで計算する.
+
+	NGL_TEXT_HASH_NO_SIMD を定義するとSIMDを使わない.
+*/
+
+#if !defined(NGL_TEXT_HASH_NO_SIMD) && (defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__))
+	#define NGL_TEXT_HASH_SSE2 1
+	#include <emmintrin.h>
+#else
+	#define NGL_TEXT_HASH_SSE2 0
+#endif
+
+#if defined(_MSC_VER) && defined(_M_X64)
+	#include <intrin.h>
+#endif
+
+// 定数式評価中かの判定. C++17では標準に無いためコンパイラ組み込み関数を使う.
+// 使えない場合はconstexpr関数は常に定数式用の実装を使う(結果は同じ).
+#if defined(_MSC_VER) && (1925 <= _MSC_VER)
+	#define NGL_TEXT_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#elif defined(__clang__)
+	#if defined(__has_builtin)
+		#if __has_builtin(__builtin_is_constant_evaluated)
+			#define NGL_TEXT_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+		#endif
+	#endif
+#elif defined(__GNUC__) && (9 <= __GNUC__)
+	#define NGL_TEXT_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+#if !defined(NGL_TEXT_IS_CONSTANT_EVALUATED)
+	#define NGL_TEXT_IS_CONSTANT_EVALUATED() true
+#endif
+
+
+namespace ngl
+{
+	namespace text
+	{
+		namespace text_hash_detail
+		{
+			constexpr uint64_t k_prime32_1 = 0x9E3779B1U;
+			constexpr uint64_t k_prime64_1 = 0x9E3779B185EBCA87ULL;
+			constexpr uint64_t k_prime64_2 = 0xC2B2AE3D27D4EB4FULL;
+			constexpr uint64_t k_prime64_3 = 0x165667B19E3779F9ULL;
+
+			constexpr size_t k_stripe_size = 64;
+			constexpr size_t k_lane_count = k_stripe_size / sizeof(uint64_t);
+			// スクランブルまでのストライプ数. ストライプ毎に鍵をずらすため同じ内容のストライプが入れ替わっても同じ値にならない.
+			constexpr size_t k_stripe_per_block = 4;
+
+			// ストライプの鍵. ストライプ毎に1要素ずつずらして参照する.
+			constexpr uint64_t k_key[k_lane_count + k_stripe_per_block] =
+			{
+				0xBE4BA423396CFEB8ULL, 0x1CAD21F72C81017CULL, 0xDB979083E96DD4DEULL, 0x1F67B3B7A4A44072ULL,
+				0x78E5C0CC4EE679CBULL, 0x2172FFCC7DD05A82ULL, 0x8E2443F7744608B8ULL, 0x4C263A81E69035E0ULL,
+				0xCB00C391BB52283CULL, 0xA32E531B8B65D088ULL, 0x4EF90DA297486471ULL, 0xD8ACDEA946EF1938ULL,
+			};
+			// 最後のストライプの鍵のオフセット.
+			constexpr size_t k_last_key_offset = 3;
+			// スクランブル, 集約用の鍵.
+			constexpr uint64_t k_scramble_key[k_lane_count] =
+			{
+				0x3F349CE33F76FAA8ULL, 0x1D4F0BC7C7BBDCF9ULL, 0x3159B4CD4BE0518AULL, 0x647378D9C97E9FC8ULL,
+				0xC3EBD33483ACC5EAULL, 0xEB6313FAFFA081C5ULL, 0x49DAF0B751DD0D17ULL, 0x9E68D429265516D3ULL,
+			};
+			constexpr uint64_t k_acc_init[k_lane_count] =
+			{
+				k_prime32_1, k_prime64_1, k_prime64_2, k_prime64_3,
+				0x85EBCA77C2B2AE63ULL, 0x27D4EB2F165667C5ULL, k_prime64_2 ^ k_prime64_3, k_prime64_1 ^ k_prime32_1,
+			};
+
+			// 64bit x 64bit の128bit積の上位と下位のxor.
+			constexpr uint64_t MulFoldConstexpr(uint64_t a, uint64_t b)
+			{
+				const uint64_t a_lo = a & 0xFFFFFFFFULL;
+				const uint64_t a_hi = a >> 32;
+				const uint64_t b_lo = b & 0xFFFFFFFFULL;
+				const uint64_t b_hi = b >> 32;
+				const uint64_t lo_lo = a_lo * b_lo;
+				const uint64_t hi_lo = a_hi * b_lo;
+				const uint64_t lo_hi = a_lo * b_hi;
+				const uint64_t hi_hi = a_hi * b_hi;
+				const uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFFULL) + lo_hi;
+				const uint64_t upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+				const uint64_t lower = (cross << 32) | (lo_lo & 0xFFFFFFFFULL);
+				return upper ^ lower;
+			}
+			inline uint64_t MulFold(uint64_t a, uint64_t b)
+			{
+#if defined(_MSC_VER) && defined(_M_X64)
+				uint64_t upper;
+				const uint64_t lower = _umul128(a, b, &upper);
+				return upper ^ lower;
+#elif defined(__SIZEOF_INT128__)
+				const unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+				return static_cast<uint64_t>(r >> 64) ^ static_cast<uint64_t>(r);
+#else
+				return MulFoldConstexpr(a, b);
+#endif
+			}
+
+			constexpr uint64_t Avalanche(uint64_t h)
+			{
+				h ^= h >> 37;
+				h *= 0x165667919E3779F9ULL;
+				h ^= h >> 32;
+				return h;
+			}
+
+			// リトルエンディアンでの読み込み.
+			constexpr uint64_t Read64Constexpr(const char* p)
+			{
+				uint64_t v = 0;
+				for (int i = 0; i < 8; ++i)
+					v |= static_cast<uint64_t>(static_cast<unsigned char>(p[i])) << (i * 8);
+				return v;
+			}
+			constexpr uint64_t Read32Constexpr(const char* p)
+			{
+				uint64_t v = 0;
+				for (int i = 0; i < 4; ++i)
+					v |= static_cast<uint64_t>(static_cast<unsigned char>(p[i])) << (i * 8);
+				return v;
+			}
+			inline uint64_t Read64(const char* p)
+			{
+				uint64_t v;
+				std::memcpy(&v, p, sizeof(v));
+				return v;
+			}
+			inline uint64_t Read32(const char* p)
+			{
+				uint32_t v;
+				std::memcpy(&v, p, sizeof(v));
+				return v;
+			}
+
+			// 16byte以下. 長さ1-3は先頭, 中央, 末尾の1byteずつ, 4-8は先頭と末尾の4byte, 9-16は先頭と末尾の8byteを使う.
+			template<bool CONSTEXPR>
+			constexpr uint64_t HashShort(const char* p, size_t n)
+			{
+				uint64_t a = 0;
+				uint64_t b = 0;
+				if (8 < n)
+				{
+					a = CONSTEXPR ? Read64Constexpr(p) : Read64(p);
+					b = CONSTEXPR ? Read64Constexpr(p + n - 8) : Read64(p + n - 8);
+				}
+				else if (4 <= n)
+				{
+					a = CONSTEXPR ? Read32Constexpr(p) : Read32(p);
+					b = CONSTEXPR ? Read32Constexpr(p + n - 4) : Read32(p + n - 4);
+				}
+				else if (0 < n)
+				{
+					a = static_cast<uint64_t>(static_cast<unsigned char>(p[0]))
+						| (static_cast<uint64_t>(static_cast<unsigned char>(p[n >> 1])) << 8)
+						| (static_cast<uint64_t>(static_cast<unsigned char>(p[n - 1])) << 16);
+				}
+				const uint64_t m = CONSTEXPR ? MulFoldConstexpr(a ^ k_key[0], b ^ k_key[1] ^ n) : MulFold(a ^ k_key[0], b ^ k_key[1] ^ n);
+				return Avalanche(m ^ (n * k_prime64_1));
+			}
+
+			// 17-64byte. 先頭と末尾から16byteずつ(33byte以上は32byteずつ)を畳み込む.
+			template<bool CONSTEXPR>
+			constexpr uint64_t Mix16(const char* p, uint64_t key0, uint64_t key1)
+			{
+				return CONSTEXPR ? MulFoldConstexpr(Read64Constexpr(p) ^ key0, Read64Constexpr(p + 8) ^ key1)
+					: MulFold(Read64(p) ^ key0, Read64(p + 8) ^ key1);
+			}
+			template<bool CONSTEXPR>
+			constexpr uint64_t HashMedium(const char* p, size_t n)
+			{
+				uint64_t h = n * k_prime64_1;
+				h += Mix16<CONSTEXPR>(p, k_key[0], k_key[1]);
+				h += Mix16<CONSTEXPR>(p + n - 16, k_key[2], k_key[3]);
+				if (32 < n)
+				{
+					h += Mix16<CONSTEXPR>(p + 16, k_key[4], k_key[5]);
+					h += Mix16<CONSTEXPR>(p + n - 32, k_key[6], k_key[7]);
+				}
+				return Avalanche(h);
+			}
+
+			// 1ストライプの積算. SSE2版と同じ計算.
+			constexpr void AccumulateScalar(uint64_t* acc, const uint64_t* data, const uint64_t* key)
+			{
+				for (size_t i = 0; i < k_lane_count; ++i)
+				{
+					const uint64_t data_key = data[i] ^ key[i];
+					acc[i ^ 1] += data[i];
+					acc[i] += (data_key & 0xFFFFFFFFULL) * (data_key >> 32);
+				}
+			}
+			constexpr void ScrambleScalar(uint64_t* acc)
+			{
+				for (size_t i = 0; i < k_lane_count; ++i)
+				{
+					uint64_t v = acc[i];
+					v ^= v >> 47;
+					v ^= k_scramble_key[i];
+					v *= k_prime32_1;
+					acc[i] = v;
+				}
+			}
+			template<bool CONSTEXPR>
+			constexpr uint64_t Merge(const uint64_t* acc, size_t n)
+			{
+				uint64_t h = n * k_prime64_1;
+				for (size_t i = 0; i < k_lane_count; i += 2)
+				{
+					h += CONSTEXPR ? MulFoldConstexpr(acc[i] ^ k_scramble_key[i], acc[i + 1] ^ k_scramble_key[i + 1])
+						: MulFold(acc[i] ^ k_scramble_key[i], acc[i + 1] ^ k_scramble_key[i + 1]);
+				}
+				return Avalanche(h);
+			}
+
+			// 65byte以上. 末尾のストライプは末尾から64byte(前のストライプと重なる).
+			// CONSTEXPR : バイト単位の読み込み. 定数式評価用.
+			template<bool CONSTEXPR>
+			constexpr uint64_t HashLongScalar(const char* p, size_t n)
+			{
+				uint64_t acc[k_lane_count] = {};
+				for (size_t i = 0; i < k_lane_count; ++i)
+					acc[i] = k_acc_init[i];
+
+				uint64_t data[k_lane_count] = {};
+				const size_t stripe_count = (n - 1) / k_stripe_size;
+				for (size_t s = 0; s < stripe_count; ++s)
+				{
+					const char* stripe = p + s * k_stripe_size;
+					for (size_t i = 0; i < k_lane_count; ++i)
+						data[i] = CONSTEXPR ? Read64Constexpr(stripe + i * 8) : Read64(stripe + i * 8);
+					AccumulateScalar(acc, data, k_key + (s % k_stripe_per_block));
+					if ((k_stripe_per_block - 1) == (s % k_stripe_per_block))
+						ScrambleScalar(acc);
+				}
+
+				const char* last_stripe = p + n - k_stripe_size;
+				for (size_t i = 0; i < k_lane_count; ++i)
+					data[i] = CONSTEXPR ? Read64Constexpr(last_stripe + i * 8) : Read64(last_stripe + i * 8);
+				AccumulateScalar(acc, data, k_key + k_last_key_offset);
+
+				return Merge<CONSTEXPR>(acc, n);
+			}
+
+#if NGL_TEXT_HASH_SSE2
+			inline void AccumulateSse2(__m128i* acc, const char* stripe, const uint64_t* key)
+			{
+				for (size_t i = 0; i < k_lane_count / 2; ++i)
+				{
+					const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(stripe) + i);
+					const __m128i key_vec = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key) + i);
+					const __m128i data_key = _mm_xor_si128(data, key_vec);
+					// 各64bitの下位32bit x 上位32bit.
+					const __m128i data_key_hi = _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+					const __m128i product = _mm_mul_epu32(data_key, data_key_hi);
+					// 隣のレーンへ入力を加算.
+					const __m128i data_swap = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+					acc[i] = _mm_add_epi64(acc[i], _mm_add_epi64(product, data_swap));
+				}
+			}
+			inline void ScrambleSse2(__m128i* acc)
+			{
+				const __m128i prime = _mm_set1_epi32(static_cast<int>(k_prime32_1));
+				for (size_t i = 0; i < k_lane_count / 2; ++i)
+				{
+					__m128i v = acc[i];
+					v = _mm_xor_si128(v, _mm_srli_epi64(v, 47));
+					v = _mm_xor_si128(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(k_scramble_key) + i));
+					// 64bit x 32bit. 下位32bitと上位32bitを別々に乗算して合成.
+					const __m128i lo = _mm_mul_epu32(v, prime);
+					const __m128i hi = _mm_mul_epu32(_mm_srli_epi64(v, 32), prime);
+					acc[i] = _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+				}
+			}
+			inline uint64_t HashLongSse2(const char* p, size_t n)
+			{
+				__m128i acc[k_lane_count / 2];
+				for (size_t i = 0; i < k_lane_count / 2; ++i)
+					acc[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(k_acc_init) + i);
+
+				const size_t stripe_count = (n - 1) / k_stripe_size;
+				for (size_t s = 0; s < stripe_count; ++s)
+				{
+					AccumulateSse2(acc, p + s * k_stripe_size, k_key + (s % k_stripe_per_block));
+					if ((k_stripe_per_block - 1) == (s % k_stripe_per_block))
+						ScrambleSse2(acc);
+				}
+
+				AccumulateSse2(acc, p + n - k_stripe_size, k_key + k_last_key_offset);
+
+				alignas(16) uint64_t acc_scalar[k_lane_count];
+				for (size_t i = 0; i < k_lane_count / 2; ++i)
+					_mm_store_si128(reinterpret_cast<__m128i*>(acc_scalar) + i, acc[i]);
+				return Merge<false>(acc_scalar, n);
+			}
+#endif
+
+			// 定数式評価用.
+			constexpr uint64_t HashConstexpr(const char* p, size_t n)
+			{
+				return (16 >= n) ? HashShort<true>(p, n) : (k_stripe_size >= n) ? HashMedium<true>(p, n) : HashLongScalar<true>(p, n);
+			}
+			// 実行時. SIMD非対応環境用のスカラー版.
+			inline uint64_t HashRuntimeScalar(const char* p, size_t n)
+			{
+				return (16 >= n) ? HashShort<false>(p, n) : (k_stripe_size >= n) ? HashMedium<false>(p, n) : HashLongScalar<false>(p, n);
+			}
+			inline uint64_t HashRuntime(const char* p, size_t n)
+			{
+#if NGL_TEXT_HASH_SSE2
+				return (16 >= n) ? HashShort<false>(p, n) : (k_stripe_size >= n) ? HashMedium<false>(p, n) : HashLongSse2(p, n);
+#else
+				return HashRuntimeScalar(p, n);
+#endif
+			}
+
+			constexpr bool EqualConstexpr(const char* a, const char* b, size_t n)
+			{
+				for (size_t i = 0; i < n; ++i)
+				{
+					if (a[i] != b[i])
+						return false;
+				}
+				return true;
+			}
+			inline bool EqualRuntime(const char* a, const char* b, size_t n)
+			{
+#if NGL_TEXT_HASH_SSE2
+				if (16 <= n)
+				{
+					// 16byte単位. 端数は末尾から16byte(重なってもよい).
+					size_t i = 0;
+					for (; i + 16 <= n; i += 16)
+					{
+						const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+						const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+						if (0xFFFF != _mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)))
+							return false;
+					}
+					if (i < n)
+					{
+						const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + n - 16));
+						const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + n - 16));
+						return 0xFFFF == _mm_movemask_epi8(_mm_cmpeq_epi8(va, vb));
+					}
+					return true;
+				}
+#endif
+				if (8 <= n)
+				{
+					size_t i = 0;
+					for (; i + 8 <= n; i += 8)
+					{
+						if (Read64(a + i) != Read64(b + i))
+							return false;
+					}
+					return (i == n) || (Read64(a + n - 8) == Read64(b + n - 8));
+				}
+				if (4 <= n)
+					return (Read32(a) == Read32(b)) && (Read32(a + n - 4) == Read32(b + n - 4));
+				for (size_t i = 0; i < n; ++i)
+				{
+					if (a[i] != b[i])
+						return false;
+				}
+				return true;
+			}
+		}
+
+		// 文字列のハッシュ. 定数式でも実行時でも同じ値を返す.
+		constexpr uint64_t TextHashSimd(const char* p, size_t n)
+		{
+			if (NGL_TEXT_IS_CONSTANT_EVALUATED())
+				return text_hash_detail::HashConstexpr(p, n);
+			return text_hash_detail::HashRuntime(p, n);
+		}
+		// 長さnの文字列の一致判定.
+		constexpr bool TextEqualSimd(const char* a, const char* b, size_t n)
+		{
+			if (NGL_TEXT_IS_CONSTANT_EVALUATED())
+				return text_hash_detail::EqualConstexpr(a, b, n);
+			return text_hash_detail::EqualRuntime(a, b, n);
+		}
+	}
+}
+
+#endif // _NGL_TEXT_TEXT_HASH_SIMD_
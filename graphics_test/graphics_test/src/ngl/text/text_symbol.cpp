@@ -0,0 +1,242 @@
+﻿
+#include "text_symbol.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <cstring>
+#include <assert.h>
+
+#include "ngl/util/singleton.h"
+
+namespace ngl
+{
+namespace text
+{
+	namespace
+	{
+		/*
+			シンボルの文字列プール.
+				登録順の識別子で参照するエントリ配列と, ハッシュから識別子を引くオープンアドレス法のテーブルを持つ.
+				エントリ配列はチャンク単位で確保して移動しないため, 識別子からの参照はロック無しで行える.
+				テーブルは拡張時に新しいテーブルを作成して差し替え, 古いテーブルは参照中のスレッドのためにプール破棄まで保持する.
+		*/
+		class TextSymbolPool : public Singleton<TextSymbolPool>
+		{
+		public:
+			TextSymbolPool()
+			{
+				for (auto& e : entry_chunk_)
+					e.store(nullptr, std::memory_order_relaxed);
+
+				// 識別子0は空文字列.
+				Entry* chunk = new Entry[k_entry_chunk_size];
+				chunk[0] = { "", 0, TextHashSimd("", 0) };
+				entry_chunk_[0].store(chunk, std::memory_order_relaxed);
+				entry_count_ = 1;
+
+				Table* table = NewTable(k_initial_table_size);
+				table_.store(table, std::memory_order_release);
+				table_array_.push_back(table);
+			}
+			~TextSymbolPool()
+			{
+				for (auto& e : entry_chunk_)
+					delete[] e.load(std::memory_order_relaxed);
+				for (auto* e : table_array_)
+					DeleteTable(e);
+				for (auto* e : string_chunk_array_)
+					delete[] e;
+			}
+
+			u32 Find(const char* str, u32 length, u64 hash) const
+			{
+				const Table* table = table_.load(std::memory_order_acquire);
+				for (u32 i = static_cast<u32>(hash) & table->mask; ; i = (i + 1) & table->mask)
+				{
+					const u32 id = table->slot[i].load(std::memory_order_acquire);
+					if (0 == id)
+						return 0;
+					const Entry& e = GetEntry(id);
+					if (e.hash == hash && e.length == length && 0 == std::memcmp(e.str, str, length))
+						return id;
+				}
+			}
+
+			u32 Intern(const char* str, u32 length, u64 hash)
+			{
+				if (0 == length)
+					return 0;
+				if (const u32 id = Find(str, length, hash))
+					return id;
+
+				std::lock_guard<std::mutex> lock(mutex_);
+				// ロック待ちの間に他スレッドが登録した可能性がある.
+				if (const u32 id = Find(str, length, hash))
+					return id;
+
+				const u32 id = entry_count_;
+				const u32 chunk_index = id / k_entry_chunk_size;
+				assert(k_entry_chunk_count > chunk_index);
+				Entry* chunk = entry_chunk_[chunk_index].load(std::memory_order_relaxed);
+				if (!chunk)
+				{
+					chunk = new Entry[k_entry_chunk_size];
+					entry_chunk_[chunk_index].store(chunk, std::memory_order_release);
+				}
+				chunk[id % k_entry_chunk_size] = { AllocateString(str, length), length, hash };
+				++entry_count_;
+
+				// 負荷率1/2を超える場合はテーブルを拡張.
+				Table* table = table_.load(std::memory_order_relaxed);
+				if (table->mask + 1 < entry_count_ * 2)
+				{
+					table = NewTable((table->mask + 1) * 2);
+					for (u32 i = 1; i < id; ++i)
+						InsertTable(table, i, GetEntry(i).hash);
+					table_array_.push_back(table);
+					table_.store(table, std::memory_order_release);
+				}
+				InsertTable(table, id, hash);
+				return id;
+			}
+
+			const char* GetString(u32 id) const
+			{
+				return GetEntry(id).str;
+			}
+			u32 GetLength(u32 id) const
+			{
+				return GetEntry(id).length;
+			}
+			u32 GetCount()
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				return entry_count_ - 1;
+			}
+
+		private:
+			struct Entry
+			{
+				const char*	str;
+				u32			length;
+				u64			hash;
+			};
+			struct Table
+			{
+				u32					mask;
+				std::atomic<u32>*	slot;
+			};
+
+			static constexpr u32 k_entry_chunk_size = 1024;
+			static constexpr u32 k_entry_chunk_count = 1024;
+			static constexpr u32 k_initial_table_size = 1024;
+			static constexpr u32 k_string_chunk_size = 64 * 1024;
+
+			const Entry& GetEntry(u32 id) const
+			{
+				return entry_chunk_[id / k_entry_chunk_size].load(std::memory_order_acquire)[id % k_entry_chunk_size];
+			}
+
+			static Table* NewTable(u32 size)
+			{
+				Table* table = new Table();
+				table->mask = size - 1;
+				table->slot = new std::atomic<u32>[size];
+				for (u32 i = 0; i < size; ++i)
+					table->slot[i].store(0, std::memory_order_relaxed);
+				return table;
+			}
+			static void DeleteTable(Table* table)
+			{
+				delete[] table->slot;
+				delete table;
+			}
+			static void InsertTable(Table* table, u32 id, u64 hash)
+			{
+				u32 i = static_cast<u32>(hash) & table->mask;
+				while (0 != table->slot[i].load(std::memory_order_relaxed))
+					i = (i + 1) & table->mask;
+				table->slot[i].store(id, std::memory_order_release);
+			}
+
+			// 終端文字込みで文字列を複製する. ロック中に呼ぶ.
+			const char* AllocateString(const char* str, u32 length)
+			{
+				const u32 size = length + 1;
+				if (k_string_chunk_size < size)
+				{
+					// 大きな文字列は個別に確保.
+					char* p = new char[size];
+					string_chunk_array_.push_back(p);
+					std::memcpy(p, str, length);
+					p[length] = 0;
+					return p;
+				}
+				if (string_chunk_remain_ < size)
+				{
+					string_chunk_ = new char[k_string_chunk_size];
+					string_chunk_array_.push_back(string_chunk_);
+					string_chunk_remain_ = k_string_chunk_size;
+				}
+				char* p = string_chunk_ + (k_string_chunk_size - string_chunk_remain_);
+				string_chunk_remain_ -= size;
+				std::memcpy(p, str, length);
+				p[length] = 0;
+				return p;
+			}
+
+		private:
+			std::atomic<Entry*>		entry_chunk_[k_entry_chunk_count];
+			std::atomic<Table*>		table_ = nullptr;
+
+			// 以下は登録時のみロック中に更新.
+			std::mutex				mutex_;
+			u32						entry_count_ = 0;
+			std::vector<Table*>		table_array_;
+			std::vector<char*>		string_chunk_array_;
+			char*					string_chunk_ = nullptr;
+			u32						string_chunk_remain_ = 0;
+		};
+	}
+
+	TextSymbol::TextSymbol(const char* str)
+		: TextSymbol(str, static_cast<u32>(std::strlen(str)))
+	{
+	}
+	TextSymbol::TextSymbol(const char* str, u32 length)
+		: TextSymbol(TextSymbolKey(str, length))
+	{
+	}
+	TextSymbol::TextSymbol(const TextSymbolKey& key)
+	{
+		id_ = TextSymbolPool::Instance().Intern(key.Get(), key.Length(), key.Hash());
+	}
+
+	TextSymbol TextSymbol::Find(const char* str)
+	{
+		return Find(TextSymbolKey(str, static_cast<u32>(std::strlen(str))));
+	}
+	TextSymbol TextSymbol::Find(const TextSymbolKey& key)
+	{
+		TextSymbol symbol;
+		if (0 < key.Length())
+			symbol.id_ = TextSymbolPool::Instance().Find(key.Get(), key.Length(), key.Hash());
+		return symbol;
+	}
+
+	const char* TextSymbol::GetString() const
+	{
+		return TextSymbolPool::Instance().GetString(id_);
+	}
+	u32 TextSymbol::GetLength() const
+	{
+		return TextSymbolPool::Instance().GetLength(id_);
+	}
+
+	u32 GetTextSymbolCount()
+	{
+		return TextSymbolPool::Instance().GetCount();
+	}
+}
+}
@@ -0,0 +1,132 @@
+﻿#pragma once
+
+#ifndef _NGL_TEXT_TEXT_SYMBOL_
+#define _NGL_TEXT_TEXT_SYMBOL_
+
+#include <functional>
+
+#include "ngl/util/types.h"
+#include "ngl/text/hash_text.h"
+
+/*
+	文字列を32bitの識別子に変換して保持するシンボル.
+		同じ文字列は全スレッドで同じ識別子になるため, 比較とハッシュは整数で行える.
+		文字列はグローバルなプールに登録され, プログラム終了まで保持される. GetString()で取得したポインタは常に有効.
+		プールの検索はロックフリー. 新規登録のみロックを取る.
+		識別子0は無効なシンボル(空文字列)を表す.
+
+	// 実行時の文字列から登録.
+	ngl::text::TextSymbol symbol("tex_basecolor");
+	// 登録済みの場合のみ取得. 未登録の場合は無効なシンボル.
+	ngl::text::TextSymbol found = ngl::text::TextSymbol::Find("tex_basecolor");
+
+	// リテラルはハッシュを定数式で計算し, 呼び出し箇所毎に一度だけ登録する.
+	pso->SetView(&desc_set, NGL_TEXT_SYMBOL("tex_basecolor"), p_view);
+*/
+
+namespace ngl
+{
+	namespace text
+	{
+		// 文字列とハッシュ. リテラルから定数式で構築できる.
+		class TextSymbolKey
+		{
+		public:
+			template<size_t N>
+			constexpr TextSymbolKey(const char(&str)[N])
+				: str_(str)
+				, length_(StrLenConstexpr(str, N - 1))
+				, hash_(TextHashSimd(str, StrLenConstexpr(str, N - 1)))
+			{
+			}
+			// 実行時の文字列.
+			TextSymbolKey(const char* str, u32 length)
+				: str_(str)
+				, length_(length)
+				, hash_(TextHashSimd(str, length))
+			{
+			}
+			// 計算済みのハッシュ. TextHashSimdで計算した値であること.
+			constexpr TextSymbolKey(const char* str, u32 length, u64 hash)
+				: str_(str)
+				, length_(length)
+				, hash_(hash)
+			{
+			}
+
+			constexpr const char* Get() const { return str_; }
+			constexpr u32 Length() const { return length_; }
+			constexpr u64 Hash() const { return hash_; }
+
+		private:
+			static constexpr u32 StrLenConstexpr(const char* str, size_t max_length)
+			{
+				u32 l = 0;
+				for (; l < max_length && 0 != str[l]; ++l)
+				{
+				}
+				return l;
+			}
+
+			const char*	str_;
+			u32			length_;
+			u64			hash_;
+		};
+
+		class TextSymbol
+		{
+		public:
+			constexpr TextSymbol()
+			{
+			}
+			// 文字列を登録してシンボルを取得する.
+			TextSymbol(const char* str);
+			TextSymbol(const TextSymbolKey& key);
+			// SIMD版ハッシュのHashTextはハッシュを再計算しない.
+			template<int LEN, TextHashType HASH_TYPE>
+			TextSymbol(const HashText<LEN, HASH_TYPE>& text)
+				: TextSymbol((TextHashType::Simd == HASH_TYPE) ? TextSymbolKey(text.Get(), static_cast<u32>(text.Length()), text.Hash())
+					: TextSymbolKey(text.Get(), static_cast<u32>(text.Length())))
+			{
+			}
+			TextSymbol(const char* str, u32 length);
+
+			// 登録済みの場合のみシンボルを取得する. 未登録の場合は無効なシンボル.
+			static TextSymbol Find(const char* str);
+			static TextSymbol Find(const TextSymbolKey& key);
+
+			constexpr u32 GetId() const { return id_; }
+			constexpr bool IsValid() const { return 0 != id_; }
+
+			// 登録された文字列. 無効なシンボルは空文字列.
+			const char* GetString() const;
+			u32 GetLength() const;
+
+			constexpr bool operator==(const TextSymbol& v) const { return id_ == v.id_; }
+			constexpr bool operator!=(const TextSymbol& v) const { return id_ != v.id_; }
+
+		private:
+			u32	id_ = 0;
+		};
+
+		// 登録済みシンボル数. デバッグ用.
+		u32 GetTextSymbolCount();
+	}
+}
+
+namespace std
+{
+	template <>
+	struct hash<ngl::text::TextSymbol>
+	{
+		size_t operator()(const ngl::text::TextSymbol& v) const
+		{
+			return v.GetId();
+		}
+	};
+}
+
+// リテラル文字列のシンボル. ハッシュは定数式で計算し, 登録は呼び出し箇所毎に初回のみ行う.
+#define NGL_TEXT_SYMBOL(str) ([]() -> const ngl::text::TextSymbol& { static constexpr ngl::text::TextSymbolKey k_key(str); static const ngl::text::TextSymbol s_symbol(k_key); return s_symbol; }())
+
+#endif // _NGL_TEXT_TEXT_SYMBOL_
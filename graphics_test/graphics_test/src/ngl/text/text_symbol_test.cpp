@@ -0,0 +1,184 @@
+﻿
+#include "text_symbol_test.h"
+
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <cstring>
+
+#include <assert.h>
+
+namespace ngl
+{
+namespace text
+{
+namespace test
+{
+	namespace
+	{
+		using Clock = std::chrono::steady_clock;
+
+		constexpr int k_thread_count = 8;
+		constexpr int k_intern_count = 20000;
+		constexpr int k_lookup_loop = 200000;
+
+		// シェーダリソース名を模した検索キー.
+		const char* k_slot_name[] =
+		{
+			"ngl_cb_sceneview",
+			"ngl_cb_shadowview",
+			"ngl_cb_instance",
+			"samp_default",
+			"tex_basecolor",
+			"tex_normal",
+			"tex_occlusion",
+			"tex_roughness",
+			"tex_metalness",
+			"tex_depth",
+			"tex_gbuffer0",
+			"tex_gbuffer1",
+			"tex_gbuffer2",
+			"tex_gbuffer3",
+			"tex_lit",
+			"uav_result",
+		};
+		constexpr int k_slot_name_count = static_cast<int>(sizeof(k_slot_name) / sizeof(k_slot_name[0]));
+
+		double ToMillisec(Clock::duration d)
+		{
+			return std::chrono::duration<double, std::milli>(d).count();
+		}
+	}
+
+	void TextSymbolTest()
+	{
+		int fail_count = 0;
+
+		// 基本動作.
+		{
+			const TextSymbol a("text_symbol_test_a");
+			const TextSymbol b(std::string("text_symbol_test_a").c_str());
+			const TextSymbol c("text_symbol_test_c");
+			if (!a.IsValid() || a != b || a == c)
+				++fail_count;
+			if (0 != std::strcmp(a.GetString(), "text_symbol_test_a") || 18 != a.GetLength())
+				++fail_count;
+
+			// リテラルのシンボルは実行時の文字列から登録したものと一致する.
+			if (NGL_TEXT_SYMBOL("text_symbol_test_a") != a)
+				++fail_count;
+			// HashTextからの変換.
+			if (TextSymbol(HashText<32>("text_symbol_test_c")) != c)
+				++fail_count;
+
+			// 未登録の文字列は登録されない.
+			const u32 count = GetTextSymbolCount();
+			if (TextSymbol::Find("text_symbol_test_not_registered").IsValid())
+				++fail_count;
+			if (count != GetTextSymbolCount())
+				++fail_count;
+			if (TextSymbol::Find("text_symbol_test_c") != c)
+				++fail_count;
+
+			// 空文字列は無効なシンボル.
+			if (TextSymbol("").IsValid() || TextSymbol().IsValid() || 0 != std::strcmp(TextSymbol().GetString(), ""))
+				++fail_count;
+		}
+
+		// 複数スレッドから同じ文字列群を別順序で登録し, 全スレッドで同じ識別子になるか.
+		// テーブル拡張中の検索も含む.
+		{
+			std::vector<std::string> name_array(k_intern_count);
+			for (int i = 0; i < k_intern_count; ++i)
+				name_array[i] = "text_symbol_test_mt_" + std::to_string(i);
+
+			std::vector<std::vector<u32>> result(k_thread_count, std::vector<u32>(k_intern_count));
+			std::vector<std::thread> thread_array;
+			for (int t = 0; t < k_thread_count; ++t)
+			{
+				thread_array.emplace_back([&, t]()
+					{
+						for (int j = 0; j < k_intern_count; ++j)
+						{
+							const int i = (t & 1) ? (k_intern_count - 1 - j) : j;
+							result[t][i] = TextSymbol(name_array[i].c_str()).GetId();
+						}
+					});
+			}
+			for (auto& e : thread_array)
+				e.join();
+
+			for (int i = 0; i < k_intern_count; ++i)
+			{
+				const TextSymbol found = TextSymbol::Find(name_array[i].c_str());
+				if (!found.IsValid() || 0 != std::strcmp(found.GetString(), name_array[i].c_str()))
+					++fail_count;
+				for (int t = 0; t < k_thread_count; ++t)
+				{
+					if (result[t][i] != found.GetId())
+						++fail_count;
+				}
+			}
+		}
+
+		// 検索速度. PipelineResourceViewLayoutDepのslot_mapを模擬.
+		Clock::duration hash_text_time{}, symbol_find_time{}, symbol_time{};
+		{
+			std::unordered_map<HashText<32>, int> hash_text_map;
+			std::unordered_map<TextSymbol, int> symbol_map;
+			std::vector<TextSymbol> symbol_array;
+			for (int i = 0; i < k_slot_name_count; ++i)
+			{
+				hash_text_map[k_slot_name[i]] = i;
+				symbol_map[TextSymbol(k_slot_name[i])] = i;
+				symbol_array.push_back(TextSymbol(k_slot_name[i]));
+			}
+
+			// 文字列からHashTextを構築して検索. 従来のSetView(const char*).
+			s64 sum0 = 0;
+			auto t0 = Clock::now();
+			for (int l = 0; l < k_lookup_loop; ++l)
+			{
+				const auto it = hash_text_map.find(k_slot_name[l % k_slot_name_count]);
+				sum0 += it->second;
+			}
+			auto t1 = Clock::now();
+			// 文字列からシンボルを検索してから検索.
+			s64 sum1 = 0;
+			for (int l = 0; l < k_lookup_loop; ++l)
+			{
+				const auto it = symbol_map.find(TextSymbol::Find(k_slot_name[l % k_slot_name_count]));
+				sum1 += it->second;
+			}
+			auto t2 = Clock::now();
+			// 事前に取得したシンボルで検索.
+			s64 sum2 = 0;
+			for (int l = 0; l < k_lookup_loop; ++l)
+			{
+				const auto it = symbol_map.find(symbol_array[l % k_slot_name_count]);
+				sum2 += it->second;
+			}
+			auto t3 = Clock::now();
+
+			if (sum0 != sum1 || sum0 != sum2)
+				++fail_count;
+
+			hash_text_time = t1 - t0;
+			symbol_find_time = t2 - t1;
+			symbol_time = t3 - t2;
+		}
+
+		const double scale = 1000000.0 / k_lookup_loop;
+		std::cout << "[TextSymbolTest] thread " << k_thread_count << ", intern " << k_intern_count << ", symbol count " << GetTextSymbolCount() << std::endl;
+		std::cout << "  lookup HashText<32> map          : " << ToMillisec(hash_text_time) * scale << " ns" << std::endl;
+		std::cout << "  lookup TextSymbol::Find + map    : " << ToMillisec(symbol_find_time) * scale << " ns" << std::endl;
+		std::cout << "  lookup TextSymbol map            : " << ToMillisec(symbol_time) * scale << " ns (" << (ToMillisec(hash_text_time) / ToMillisec(symbol_time)) << "x)" << std::endl;
+		std::cout << "  fail " << fail_count << std::endl;
+		assert(0 == fail_count);
+	}
+}
+}
+}
@@ -0,0 +1,18 @@
+﻿#pragma once
+
+#include "text_symbol.h"
+
+
+namespace ngl
+{
+namespace text
+{
+namespace test
+{
+	// TextSymbolのテスト.
+	// 同一文字列の識別子一致, 未登録文字列のFind, 複数スレッドからの同時登録での識別子の一貫性を検証し,
+	// HashTextをキーとしたmapの検索とTextSymbolをキーとしたmapの検索の速度を標準出力に出力する.
+	void TextSymbolTest();
+}
+}
+}
@@ -0,0 +1,273 @@
+﻿#pragma once
+
+#include <atomic>
+#include <new>
+#include <utility>
+
+#include "ngl/util/types.h"
+
+/*
+	固定容量のロックフリーリングキュー.
+		Producer/Consumerのスレッド数に応じた実装をテンプレート引数で選択する.
+			MPMC : 複数Producer, 複数Consumer. 要素毎のシーケンス番号で確保と公開を行う.
+			MPSC : 複数Producer, 単一Consumer. Consumer側はCASを使わない.
+			SPSC : 単一Producer, 単一Consumer. 相手側のインデックスをキャッシュしてアトミックな読み込みを減らす.
+		Producer側とConsumer側のインデックスはキャッシュラインを分けて配置する.
+		満杯でのTryPush, 空でのTryPopは待機せずにfalseを返す.
+
+	ngl::thread::BoundedRingQueue<Message, 10, ngl::thread::RingQueueType::MPSC> queue;// 容量 1<<10.
+	// 任意のスレッド.
+	queue.TryPush(msg);
+	// 受信スレッドのみ.
+	Message out;
+	while(queue.TryPop(out)) {...}
+*/
+
+namespace ngl
+{
+namespace thread
+{
+	enum class RingQueueType
+	{
+		MPMC,
+		MPSC,
+		SPSC,
+	};
+
+	namespace ring_queue_detail
+	{
+		constexpr u32 k_cache_line_size = 64;
+
+		// 要素の格納領域. 構築と破棄はキュー側で行う.
+		template<typename T>
+		struct Storage
+		{
+			alignas(T) u8	data[sizeof(T)];
+
+			T* Get() { return reinterpret_cast<T*>(data); }
+		};
+
+		// シーケンス番号付きの要素. MPMC, MPSC用.
+		template<typename T>
+		struct SequencedCell
+		{
+			std::atomic<u64>	sequence;
+			Storage<T>			storage;
+		};
+
+		// MPMC, MPSC共通のProducer側.
+		//	sequenceが位置と一致する要素が空. 確保したProducerが構築後に位置+1を書き込んで公開する.
+		//	Consumerは取り出し後に位置+容量を書き込んで次の周回に空として返す.
+		template<typename T, u32 CAPACITY_EXP>
+		class SequencedRingBase
+		{
+		public:
+			static constexpr u64 k_capacity = u64(1) << CAPACITY_EXP;
+			static constexpr u64 k_mask = k_capacity - 1;
+
+			SequencedRingBase()
+			{
+				for (u64 i = 0; i < k_capacity; ++i)
+					cell_[i].sequence.store(i, std::memory_order_relaxed);
+			}
+
+			template<typename U>
+			bool TryPush(U&& v)
+			{
+				u64 pos = tail_.load(std::memory_order_relaxed);
+				SequencedCell<T>* cell;
+				while (true)
+				{
+					cell = &cell_[pos & k_mask];
+					const u64 seq = cell->sequence.load(std::memory_order_acquire);
+					const s64 diff = static_cast<s64>(seq - pos);
+					if (0 == diff)
+					{
+						if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+							break;
+					}
+					else if (0 > diff)
+					{
+						// 前の周回の要素がまだ取り出されていない.
+						return false;
+					}
+					else
+					{
+						// 他のProducerが先に確保した.
+						pos = tail_.load(std::memory_order_relaxed);
+					}
+				}
+				new(cell->storage.Get()) T(std::forward<U>(v));
+				cell->sequence.store(pos + 1, std::memory_order_release);
+				return true;
+			}
+
+			u64 GetSizeApprox() const
+			{
+				const u64 tail = tail_.load(std::memory_order_relaxed);
+				const u64 head = head_.load(std::memory_order_relaxed);
+				return (tail > head) ? (tail - head) : 0;
+			}
+			static constexpr u64 GetCapacity() { return k_capacity; }
+
+		protected:
+			// posの要素を取り出して空に戻す.
+			void PopCell(SequencedCell<T>* cell, u64 pos, T& out)
+			{
+				T* p = cell->storage.Get();
+				out = std::move(*p);
+				p->~T();
+				cell->sequence.store(pos + k_capacity, std::memory_order_release);
+			}
+			// 残っている要素を破棄する. 他スレッドがアクセスしていない状態で呼ぶ.
+			void DestroyRemaining()
+			{
+				const u64 tail = tail_.load(std::memory_order_relaxed);
+				for (u64 pos = head_.load(std::memory_order_relaxed); pos < tail; ++pos)
+				{
+					cell_[pos & k_mask].storage.Get()->~T();
+				}
+			}
+
+			alignas(k_cache_line_size) std::atomic<u64>	tail_ = 0;
+			alignas(k_cache_line_size) std::atomic<u64>	head_ = 0;
+			alignas(k_cache_line_size) SequencedCell<T>	cell_[k_capacity];
+		};
+	}
+
+	// 複数Producer, 複数Consumer.
+	template<typename T, u32 CAPACITY_EXP, RingQueueType TYPE = RingQueueType::MPMC>
+	class BoundedRingQueue : public ring_queue_detail::SequencedRingBase<T, CAPACITY_EXP>
+	{
+		using Base = ring_queue_detail::SequencedRingBase<T, CAPACITY_EXP>;
+	public:
+		~BoundedRingQueue()
+		{
+			Base::DestroyRemaining();
+		}
+
+		bool TryPop(T& out)
+		{
+			u64 pos = Base::head_.load(std::memory_order_relaxed);
+			ring_queue_detail::SequencedCell<T>* cell;
+			while (true)
+			{
+				cell = &Base::cell_[pos & Base::k_mask];
+				const u64 seq = cell->sequence.load(std::memory_order_acquire);
+				const s64 diff = static_cast<s64>(seq - (pos + 1));
+				if (0 == diff)
+				{
+					if (Base::head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if (0 > diff)
+				{
+					// 空.
+					return false;
+				}
+				else
+				{
+					// 他のConsumerが先に取り出した.
+					pos = Base::head_.load(std::memory_order_relaxed);
+				}
+			}
+			Base::PopCell(cell, pos, out);
+			return true;
+		}
+	};
+
+	// 複数Producer, 単一Consumer. TryPopは単一のスレッドからのみ呼ぶこと.
+	template<typename T, u32 CAPACITY_EXP>
+	class BoundedRingQueue<T, CAPACITY_EXP, RingQueueType::MPSC> : public ring_queue_detail::SequencedRingBase<T, CAPACITY_EXP>
+	{
+		using Base = ring_queue_detail::SequencedRingBase<T, CAPACITY_EXP>;
+	public:
+		~BoundedRingQueue()
+		{
+			Base::DestroyRemaining();
+		}
+
+		bool TryPop(T& out)
+		{
+			// head_はConsumerのみが更新するためCAS不要.
+			const u64 pos = Base::head_.load(std::memory_order_relaxed);
+			ring_queue_detail::SequencedCell<T>* cell = &Base::cell_[pos & Base::k_mask];
+			if (pos + 1 != cell->sequence.load(std::memory_order_acquire))
+				return false;
+
+			Base::head_.store(pos + 1, std::memory_order_relaxed);
+			Base::PopCell(cell, pos, out);
+			return true;
+		}
+	};
+
+	// 単一Producer, 単一Consumer. TryPushとTryPopはそれぞれ単一のスレッドからのみ呼ぶこと.
+	template<typename T, u32 CAPACITY_EXP>
+	class BoundedRingQueue<T, CAPACITY_EXP, RingQueueType::SPSC>
+	{
+	public:
+		static constexpr u64 k_capacity = u64(1) << CAPACITY_EXP;
+		static constexpr u64 k_mask = k_capacity - 1;
+
+		~BoundedRingQueue()
+		{
+			const u64 tail = tail_.load(std::memory_order_relaxed);
+			for (u64 pos = head_.load(std::memory_order_relaxed); pos < tail; ++pos)
+			{
+				storage_[pos & k_mask].Get()->~T();
+			}
+		}
+
+		template<typename U>
+		bool TryPush(U&& v)
+		{
+			const u64 pos = tail_.load(std::memory_order_relaxed);
+			if (pos - head_cache_ >= k_capacity)
+			{
+				// キャッシュでは満杯の場合のみ最新の値を読む.
+				head_cache_ = head_.load(std::memory_order_acquire);
+				if (pos - head_cache_ >= k_capacity)
+					return false;
+			}
+			new(storage_[pos & k_mask].Get()) T(std::forward<U>(v));
+			tail_.store(pos + 1, std::memory_order_release);
+			return true;
+		}
+
+		bool TryPop(T& out)
+		{
+			const u64 pos = head_.load(std::memory_order_relaxed);
+			if (pos == tail_cache_)
+			{
+				// キャッシュでは空の場合のみ最新の値を読む.
+				tail_cache_ = tail_.load(std::memory_order_acquire);
+				if (pos == tail_cache_)
+					return false;
+			}
+			T* p = storage_[pos & k_mask].Get();
+			out = std::move(*p);
+			p->~T();
+			head_.store(pos + 1, std::memory_order_release);
+			return true;
+		}
+
+		u64 GetSizeApprox() const
+		{
+			const u64 tail = tail_.load(std::memory_order_relaxed);
+			const u64 head = head_.load(std::memory_order_relaxed);
+			return (tail > head) ? (tail - head) : 0;
+		}
+		static constexpr u64 GetCapacity() { return k_capacity; }
+
+	private:
+		// Producer側.
+		alignas(ring_queue_detail::k_cache_line_size) std::atomic<u64>	tail_ = 0;
+		u64		head_cache_ = 0;
+		// Consumer側.
+		alignas(ring_queue_detail::k_cache_line_size) std::atomic<u64>	head_ = 0;
+		u64		tail_cache_ = 0;
+
+		alignas(ring_queue_detail::k_cache_line_size) ring_queue_detail::Storage<T>	storage_[k_capacity];
+	};
+}
+}
@@ -0,0 +1,208 @@
+﻿
+#include "bounded_ring_queue_test.h"
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <iostream>
+
+#include <assert.h>
+
+namespace ngl
+{
+namespace thread
+{
+namespace test
+{
+	namespace
+	{
+		using Clock = std::chrono::steady_clock;
+
+		constexpr u64 k_total_item_count = 1 << 20;
+		constexpr u32 k_queue_capacity_exp = 12;
+
+		// 比較用.
+		class MutexDequeQueue
+		{
+		public:
+			bool TryPush(u64 v)
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				if ((u64(1) << k_queue_capacity_exp) <= queue_.size())
+					return false;
+				queue_.push_back(v);
+				return true;
+			}
+			bool TryPop(u64& out)
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				if (queue_.empty())
+					return false;
+				out = queue_.front();
+				queue_.pop_front();
+				return true;
+			}
+		private:
+			std::mutex			mutex_;
+			std::deque<u64>		queue_;
+		};
+
+		struct RunResult
+		{
+			double	ops_per_sec = 0.0;
+			bool	valid = false;
+		};
+
+		// 各Producerは連番を積み, Consumerは取り出した値の合計と個数を集計する.
+		template<typename QUEUE>
+		RunResult Run(int producer_count, int consumer_count)
+		{
+			std::unique_ptr<QUEUE> queue(new QUEUE());
+			const u64 per_producer = k_total_item_count / producer_count;
+			const u64 total = per_producer * producer_count;
+
+			std::atomic<u64> pop_count = 0;
+			std::atomic<u64> pop_sum = 0;
+			std::atomic<bool> start = false;
+
+			std::vector<std::thread> thread_array;
+			for (int p = 0; p < producer_count; ++p)
+			{
+				thread_array.emplace_back([&, p]()
+					{
+						while (!start.load())
+							std::this_thread::yield();
+						const u64 base = p * per_producer;
+						for (u64 i = 0; i < per_producer; ++i)
+						{
+							while (!queue->TryPush(base + i))
+								std::this_thread::yield();
+						}
+					});
+			}
+			for (int c = 0; c < consumer_count; ++c)
+			{
+				thread_array.emplace_back([&]()
+					{
+						while (!start.load())
+							std::this_thread::yield();
+						u64 local_count = 0;
+						u64 local_sum = 0;
+						u64 v = 0;
+						while (pop_count.load(std::memory_order_relaxed) + local_count < total)
+						{
+							if (queue->TryPop(v))
+							{
+								++local_count;
+								local_sum += v;
+								// 他のConsumerが終了判定できるように適度に反映する.
+								if (0 == (local_count & 255))
+								{
+									pop_count.fetch_add(local_count);
+									pop_sum.fetch_add(local_sum);
+									local_count = 0;
+									local_sum = 0;
+								}
+							}
+							else
+							{
+								// 空の間は集計を反映しておく. 他のConsumerの終了判定が未反映の分で止まらないように.
+								if (0 < local_count)
+								{
+									pop_count.fetch_add(local_count);
+									pop_sum.fetch_add(local_sum);
+									local_count = 0;
+									local_sum = 0;
+								}
+								std::this_thread::yield();
+							}
+						}
+						pop_count.fetch_add(local_count);
+						pop_sum.fetch_add(local_sum);
+					});
+			}
+
+			const auto begin = Clock::now();
+			start = true;
+			for (auto& e : thread_array)
+				e.join();
+			const double sec = std::chrono::duration<double>(Clock::now() - begin).count();
+
+			RunResult result;
+			result.ops_per_sec = total / sec;
+			result.valid = (total == pop_count.load()) && ((total - 1) * total / 2 == pop_sum.load());
+			return result;
+		}
+
+		void Report(const char* label, const RunResult& result, const RunResult& baseline, int& fail_count)
+		{
+			std::cout << "    " << label << result.ops_per_sec << " ops/sec (" << (result.ops_per_sec / baseline.ops_per_sec) << "x)"
+				<< (result.valid ? "" : " invalid") << std::endl;
+			if (!result.valid)
+				++fail_count;
+		}
+	}
+
+	void BoundedRingQueueBenchmark()
+	{
+		int fail_count = 0;
+		std::cout << "[BoundedRingQueueBenchmark] item " << k_total_item_count << ", capacity " << (u64(1) << k_queue_capacity_exp) << std::endl;
+
+		const int producer_count_array[] = { 1, 4, 16 };
+		for (int producer_count : producer_count_array)
+		{
+			std::cout << "  producer " << producer_count << std::endl;
+
+			// 単一Consumer.
+			{
+				const RunResult baseline = Run<MutexDequeQueue>(producer_count, 1);
+				std::cout << "   consumer 1" << std::endl;
+				std::cout << "    mutex + deque : " << baseline.ops_per_sec << " ops/sec" << std::endl;
+				if (!baseline.valid)
+					++fail_count;
+				Report("MPMC          : ", Run<BoundedRingQueue<u64, k_queue_capacity_exp, RingQueueType::MPMC>>(producer_count, 1), baseline, fail_count);
+				Report("MPSC          : ", Run<BoundedRingQueue<u64, k_queue_capacity_exp, RingQueueType::MPSC>>(producer_count, 1), baseline, fail_count);
+				if (1 == producer_count)
+					Report("SPSC          : ", Run<BoundedRingQueue<u64, k_queue_capacity_exp, RingQueueType::SPSC>>(producer_count, 1), baseline, fail_count);
+			}
+			// 複数Consumer.
+			{
+				const RunResult baseline = Run<MutexDequeQueue>(producer_count, 4);
+				std::cout << "   consumer 4" << std::endl;
+				std::cout << "    mutex + deque : " << baseline.ops_per_sec << " ops/sec" << std::endl;
+				if (!baseline.valid)
+					++fail_count;
+				Report("MPMC          : ", Run<BoundedRingQueue<u64, k_queue_capacity_exp, RingQueueType::MPMC>>(producer_count, 4), baseline, fail_count);
+			}
+		}
+
+		// 非トリビアルな型の構築と破棄.
+		{
+			auto counter = std::make_shared<int>(0);
+			{
+				std::unique_ptr<BoundedRingQueue<std::shared_ptr<int>, 4, RingQueueType::MPMC>> queue(new BoundedRingQueue<std::shared_ptr<int>, 4, RingQueueType::MPMC>());
+				for (int i = 0; i < 20; ++i)
+				{
+					if (!queue->TryPush(counter))
+						break;
+				}
+				std::shared_ptr<int> out;
+				queue->TryPop(out);
+				out.reset();
+				if (16 - 1 != counter.use_count() - 1)
+					++fail_count;
+			}
+			// キューの破棄で残りの要素も破棄される.
+			if (1 != counter.use_count())
+				++fail_count;
+		}
+
+		std::cout << "  fail " << fail_count << std::endl;
+		assert(0 == fail_count);
+	}
+}
+}
+}
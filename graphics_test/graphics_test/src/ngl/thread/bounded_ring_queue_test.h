@@ -0,0 +1,17 @@
+﻿#pragma once
+
+#include "bounded_ring_queue.h"
+
+
+namespace ngl
+{
+namespace thread
+{
+namespace test
+{
+	// BoundedRingQueueのテスト.
+	// Producer数 1, 4, 16 でのスループットをmutex + std::dequeと比較して標準出力に出力し, 全要素が一度ずつ取り出されたかを検証する.
+	void BoundedRingQueueBenchmark();
+}
+}
+}
@@ -0,0 +1,131 @@
+﻿#pragma once
+
+#include <new>
+#include <utility>
+#include <type_traits>
+
+#include "ngl/util/types.h"
+
+namespace ngl
+{
+namespace thread
+{
+	// Job用の呼び出し可能オブジェクト.
+	//	std::functionと異なりムーブのみで, k_inline_size以下の関数オブジェクトはヒープを使わずに内部に保持する.
+	//	サイズを超えるもの, アライメントが大きいもの, noexceptでムーブできないものはヒープに確保する.
+	class JobFunction
+	{
+	public:
+		static constexpr size_t k_inline_size = 64;
+		static constexpr size_t k_inline_alignment = 16;
+
+		JobFunction() = default;
+		JobFunction(std::nullptr_t) {}
+
+		template<typename FUNC, typename = std::enable_if_t<!std::is_same<std::decay_t<FUNC>, JobFunction>::value && !std::is_same<std::decay_t<FUNC>, std::nullptr_t>::value>>
+		JobFunction(FUNC&& func)
+		{
+			using F = std::decay_t<FUNC>;
+			if constexpr (IsInline<F>())
+			{
+				new(storage_) F(std::forward<FUNC>(func));
+				ops_ = &k_inline_ops<F>;
+			}
+			else
+			{
+				*reinterpret_cast<F**>(storage_) = new F(std::forward<FUNC>(func));
+				ops_ = &k_heap_ops<F>;
+			}
+		}
+
+		~JobFunction()
+		{
+			Reset();
+		}
+
+		JobFunction(JobFunction&& v) noexcept
+		{
+			MoveFrom(v);
+		}
+		JobFunction& operator=(JobFunction&& v) noexcept
+		{
+			if (this != &v)
+			{
+				Reset();
+				MoveFrom(v);
+			}
+			return *this;
+		}
+		JobFunction& operator=(std::nullptr_t)
+		{
+			Reset();
+			return *this;
+		}
+		JobFunction(const JobFunction&) = delete;
+		JobFunction& operator=(const JobFunction&) = delete;
+
+		void operator()()
+		{
+			ops_->invoke(storage_);
+		}
+		explicit operator bool() const
+		{
+			return nullptr != ops_;
+		}
+
+		// 保持している関数オブジェクトを破棄する.
+		void Reset()
+		{
+			if (ops_)
+			{
+				ops_->destroy(storage_);
+				ops_ = nullptr;
+			}
+		}
+
+		// 関数オブジェクトを内部に保持するか.
+		template<typename F>
+		static constexpr bool IsInline()
+		{
+			return (sizeof(F) <= k_inline_size) && (alignof(F) <= k_inline_alignment) && std::is_nothrow_move_constructible<F>::value;
+		}
+
+	private:
+		struct Ops
+		{
+			void (*invoke)(void* storage);
+			// srcからdstへムーブしてsrcを破棄する.
+			void (*move)(void* dst, void* src);
+			void (*destroy)(void* storage);
+		};
+
+		template<typename F>
+		static constexpr Ops k_inline_ops =
+		{
+			[](void* storage) { (*static_cast<F*>(storage))(); },
+			[](void* dst, void* src) { new(dst) F(std::move(*static_cast<F*>(src))); static_cast<F*>(src)->~F(); },
+			[](void* storage) { static_cast<F*>(storage)->~F(); },
+		};
+		template<typename F>
+		static constexpr Ops k_heap_ops =
+		{
+			[](void* storage) { (**static_cast<F**>(storage))(); },
+			[](void* dst, void* src) { *static_cast<F**>(dst) = *static_cast<F**>(src); },
+			[](void* storage) { delete *static_cast<F**>(storage); },
+		};
+
+		void MoveFrom(JobFunction& v) noexcept
+		{
+			if (v.ops_)
+			{
+				v.ops_->move(storage_, v.storage_);
+				ops_ = v.ops_;
+				v.ops_ = nullptr;
+			}
+		}
+
+		alignas(k_inline_alignment) u8	storage_[k_inline_size];
+		const Ops*	ops_ = nullptr;
+	};
+}
+}
@@ -1,122 +1,341 @@
 ﻿
 #include "job_thread.h"
+#include "work_stealing_deque.h"
+
+#include "ngl/util/time/profiler.h"
 
 #include <iostream>
+#include <cstdio>
 
 
 namespace ngl
 {
 namespace thread
 {
+    namespace
+    {
+        // 待機に入る前に再探索する回数.
+        constexpr int k_spin_count = 64;
+        // 共有キューからWorkerのDequeへ一度に取り込む最大数.
+        constexpr int k_global_queue_batch = 16;
+        // Jobレコードプールが一度に確保するレコード数.
+        constexpr int k_job_pool_chunk_size = 256;
+
+        // 呼び出しスレッドが所属するJobSystemとWorkerインデックス.
+        struct JobWorkerIdentity
+        {
+            const JobSystem*    system = nullptr;
+            int                 index = -1;
+        };
+        thread_local JobWorkerIdentity tls_job_worker = {};
+
+        u32 XorShift32(u32& state)
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return state;
+        }
+    }
+
+    // Jobレコード.
+    struct JobSystemJob
+    {
+        JobFunction         func;
+        JobCounter*         counter = nullptr;
+        JobSystem*          system = nullptr;
+
+        // 未完了の依存Job数 + 投入前の1. 0になった時点でキューに積む.
+        std::atomic<s32>    pending_count = 1;
+        // JobSystemとJobHandleからの参照数.
+        std::atomic<s32>    ref_count = 1;
+
+        // completedの設定と継続Jobの登録はcontinuation_lockで排他する.
+        std::atomic_flag    continuation_lock = ATOMIC_FLAG_INIT;
+        std::atomic<bool>   completed = false;
+        // 完了後もclearのみで容量を保持し, 再利用時の確保を避ける.
+        std::vector<JobSystemJob*>  continuation;
+
+        // 確保元のプールスロット.
+        s32                 pool_slot = 0;
+        // プール内の空きリスト.
+        JobSystemJob*       next_free = nullptr;
+    };
+
+    // Jobレコードプール.
+    //  スロット0はWorker以外のスレッド用でmutexで排他する. スロット1以降は各Worker専用.
+    //  所有者以外のスレッドが解放したレコードはremote_freeに積み, 所有者が空きが無くなった時にまとめて回収する.
+    //  remote_freeは取り出しが一括のみのためABA問題は起きない.
+    struct JobSystemJobPool
+    {
+        struct alignas(64) Slot
+        {
+            JobSystemJob*               local_free = nullptr;
+            std::atomic<JobSystemJob*>  remote_free = nullptr;
+        };
+
+        std::vector<Slot*>      slot{};
+        std::mutex              external_mutex;
+
+        std::mutex              chunk_mutex;
+        std::vector<JobSystemJob*>  chunk{};
+
+        JobSystemJobPool()
+        {
+            slot.push_back(new Slot());
+        }
+        ~JobSystemJobPool()
+        {
+            for(auto* e : slot)
+                delete e;
+            for(auto* e : chunk)
+                delete[] e;
+        }
+
+        JobSystemJob* Allocate(s32 slot_index)
+        {
+            Slot* s = slot[slot_index];
+            if(!s->local_free)
+            {
+                s->local_free = s->remote_free.exchange(nullptr, std::memory_order_acquire);
+            }
+            if(!s->local_free)
+            {
+                JobSystemJob* new_chunk = new JobSystemJob[k_job_pool_chunk_size];
+                {
+                    std::unique_lock<std::mutex> lock(chunk_mutex);
+                    chunk.push_back(new_chunk);
+                }
+                for(int i = 0; i < k_job_pool_chunk_size; ++i)
+                {
+                    new_chunk[i].pool_slot = slot_index;
+                    new_chunk[i].next_free = (i + 1 < k_job_pool_chunk_size) ? &new_chunk[i + 1] : nullptr;
+                }
+                s->local_free = new_chunk;
+            }
+
+            JobSystemJob* job = s->local_free;
+            s->local_free = job->next_free;
+            job->next_free = nullptr;
+            return job;
+        }
+        // slot_indexは呼び出しスレッドのスロット.
+        void Free(JobSystemJob* job, s32 slot_index)
+        {
+            Slot* s = slot[job->pool_slot];
+            if(job->pool_slot == slot_index)
+            {
+                job->next_free = s->local_free;
+                s->local_free = job;
+                return;
+            }
+
+            JobSystemJob* head = s->remote_free.load(std::memory_order_relaxed);
+            do
+            {
+                job->next_free = head;
+            } while(!s->remote_free.compare_exchange_weak(head, job, std::memory_order_release, std::memory_order_relaxed));
+        }
+    };
+
+    namespace
+    {
+        void LockContinuation(JobSystemJob* job)
+        {
+            while(job->continuation_lock.test_and_set(std::memory_order_acquire))
+            {
+                std::this_thread::yield();
+            }
+        }
+        void UnlockContinuation(JobSystemJob* job)
+        {
+            job->continuation_lock.clear(std::memory_order_release);
+        }
+
+        void AddRefJob(JobSystemJob* job)
+        {
+            job->ref_count.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+
+    JobHandle::JobHandle(JobSystemJob* job)
+        : job_(job)
+    {
+        if(job_)
+            AddRefJob(job_);
+    }
+    JobHandle::~JobHandle()
+    {
+        Reset();
+    }
+    JobHandle::JobHandle(const JobHandle& v)
+        : JobHandle(v.job_)
+    {
+    }
+    JobHandle::JobHandle(JobHandle&& v) noexcept
+        : job_(v.job_)
+    {
+        v.job_ = nullptr;
+    }
+    JobHandle& JobHandle::operator=(const JobHandle& v)
+    {
+        if(job_ != v.job_)
+        {
+            Reset();
+            job_ = v.job_;
+            if(job_)
+                AddRefJob(job_);
+        }
+        return *this;
+    }
+    JobHandle& JobHandle::operator=(JobHandle&& v) noexcept
+    {
+        if(this != &v)
+        {
+            Reset();
+            job_ = v.job_;
+            v.job_ = nullptr;
+        }
+        return *this;
+    }
+    bool JobHandle::IsCompleted() const
+    {
+        return (nullptr == job_) || job_->completed.load();
+    }
+    void JobHandle::Reset()
+    {
+        if(job_)
+        {
+            JobSystem::ReleaseJob(job_);
+            job_ = nullptr;
+        }
+    }
+
     class JobSystemWorker
     {
         friend JobSystem;
     public:
-        JobSystemWorker();
+        JobSystemWorker(JobSystem* p_system, int index);
         ~JobSystemWorker();
 
-        void Init(JobSystem* p_system);
+        // Thread開始. 全Workerの生成後に呼び出す.
+        void Start();
 
     private:
         // Job Thread 実行部.
         void Execute();
-        
-        void Wait();
 
-        JobSystem* p_system_{};
-        
+        JobSystem*  p_system_{};
+        int         index_ = -1;
+
         std::thread	thread_instance_;
 
-        bool			terminate_signal_ = false;
-        
-        bool            job_enable_ = false;
-        std::function< void(void) > func_;
+        WorkStealingDeque<JobSystemJob> deque_;
     };
 
-    JobSystemWorker::JobSystemWorker()
+    JobSystemWorker::JobSystemWorker(JobSystem* p_system, int index)
+        : p_system_(p_system), index_(index)
     {
-        thread_instance_ = std::thread([&](){Execute();});
     }
-    void JobSystemWorker::Init(JobSystem* p_system)
+    void JobSystemWorker::Start()
     {
-        p_system_ = p_system;
+        thread_instance_ = std::thread([&](){Execute();});
     }
     JobSystemWorker::~JobSystemWorker()
     {
-        // 実行部停止通知.
-        {
-            std::unique_lock<std::mutex> lock(p_system_->condition_mutex_);
-            terminate_signal_ = true;
-			
-            p_system_->condition_var_.notify_all();
-        }
-		
-        // thread完了待ち.
-        thread_instance_.join();
+        // thread完了待ち. 停止通知はJobSystem側.
+        if(thread_instance_.joinable())
+            thread_instance_.join();
 
         //std::cout << "~JobSystemWorker" << std::endl;
     }
-    // Job実行完了を待機する.
-    void JobSystemWorker::Wait()
-    {
-        std::unique_lock<std::mutex> lock(p_system_->condition_mutex_);
-        // Job割当されてなければ即リターン.
-        if(!job_enable_)
-            return;
-		
-        // Job完了までConditionで待機.
-        p_system_->condition_var_.wait(lock, [&]{return (!job_enable_ || terminate_signal_);});
-    }
     void JobSystemWorker::Execute()
     {
+        tls_job_worker.system = p_system_;
+        tls_job_worker.index = index_;
+        {
+            char thread_name[32];
+            snprintf(thread_name, sizeof(thread_name), "JobWorker %d", index_);
+            time::Profiler::Instance().SetThreadName(thread_name);
+        }
+
+        u32 rand_state = 0x9e3779b9u * static_cast<u32>(index_ + 1);
+        int spin = 0;
         while (true)
         {
-            // Job実行リクエストか終了通知が来るまで待機.
+            // Job実行.
+            if(JobSystemJob* job = p_system_->FindJob(index_, rand_state))
             {
-                std::unique_lock<std::mutex> lock(p_system_->condition_mutex_);
-                if(0 >= p_system_->job_queue_.size())
-                {
-                    // Jobが積まれていなければ積まれるまで待機.
-                    p_system_->condition_var_.wait(lock, [&]{return (0<p_system_->job_queue_.size() || terminate_signal_);});
-                }
-                
-                // Job取り出し.
-                if(0<p_system_->job_queue_.size())
-                {
-                    job_enable_ = true;
-                    
-                    func_ = p_system_->job_queue_.front();
-                    p_system_->job_queue_.pop_front();
-                }
+                p_system_->ExecuteJob(job);
+                spin = 0;
+                continue;
+            }
 
-                // terminate_signal_の待機側へ通知.
-                p_system_->condition_var_.notify_all();
+            // 見つからなくてもしばらくは再探索.
+            if(k_spin_count > ++spin)
+            {
+                std::this_thread::yield();
+                continue;
             }
-            
-            // Job実行.
-            if(job_enable_)
+            spin = 0;
+
+            // Jobが積まれるか終了通知が来るまで待機.
             {
-                func_();
-                
-                std::unique_lock<std::mutex> lock(p_system_->condition_mutex_);
-                job_enable_ = false;
-                
-                // job_enable_の待機側へ通知.
-                p_system_->condition_var_.notify_all();
+                std::unique_lock<std::mutex> lock(p_system_->sleep_mutex_);
+                p_system_->sleeping_count_.fetch_add(1);
+                p_system_->sleep_cv_.wait(lock, [&]{return (0 < p_system_->queued_job_count_.load() || p_system_->terminate_signal_);});
+                p_system_->sleeping_count_.fetch_sub(1);
+
+                // 終了.
+                if(p_system_->terminate_signal_)
+                    break;
             }
-            
-            // 終了.
-            if(terminate_signal_)
-                break;
         }
+
+        tls_job_worker = {};
     }
 
-    
+
     JobSystem::JobSystem()
     {
+        job_pool_ = new JobSystemJobPool();
     }
     JobSystem::~JobSystem()
     {
+        // 実行部停止通知.
+        {
+            std::unique_lock<std::mutex> lock(sleep_mutex_);
+            terminate_signal_ = true;
+            sleep_cv_.notify_all();
+        }
+
+        // 他のWorkerのDequeを参照するため, 全thread完了待ちしてから破棄.
+        for(auto* j : worker_thread_)
+        {
+            if(j && j->thread_instance_.joinable())
+                j->thread_instance_.join();
+        }
+        // 未実行のJobは実行せずに完了扱いにして破棄する. 継続Jobは共有キューに積まれるため, 空になるまで繰り返す.
+        for(auto* j : worker_thread_)
+        {
+            if(j)
+            {
+                while(JobSystemJob* job = j->deque_.Pop())
+                {
+                    global_queue_.push_back(job);
+                }
+            }
+        }
+        while(!global_queue_.empty())
+        {
+            Job* job = global_queue_.front();
+            global_queue_.pop_front();
+            job->func = nullptr;
+            FinishJob(job);
+        }
+        global_queue_count_ = 0;
+
         for(auto&& j : worker_thread_)
         {
             if(j)
@@ -126,47 +345,329 @@ namespace thread
             }
         }
         worker_thread_.clear();
+
+        // 参照の残っているJobHandleがあればJobSystemより先に破棄されていない.
+        delete job_pool_;
+        job_pool_ = nullptr;
     }
     void JobSystem::Init(int num_max_thread)
     {
+        // Worker用のJobレコードプールスロット.
+        for(int i = 0; i < num_max_thread; ++i)
+        {
+            job_pool_->slot.push_back(new JobSystemJobPool::Slot());
+        }
+
         worker_thread_.resize(num_max_thread);
-        for(auto&& j : worker_thread_)
+        for(int i = 0; i < num_max_thread; ++i)
+        {
+            worker_thread_[i] = new JobSystemWorker(this, i);
+        }
+        // Stealで他のWorkerを参照するため, 全Workerの生成後に開始.
+        for(auto* j : worker_thread_)
         {
-            j = new JobSystemWorker();
-            j->Init(this);
+            j->Start();
         }
     }
 
 
-    void JobSystem::Add(std::function< void(void) > func)
+    void JobSystem::Add(JobFunction func)
+    {
+        Submit(NewJob(std::move(func), nullptr), nullptr, 0);
+    }
+    void JobSystem::Add(JobFunction func, JobCounter* counter)
+    {
+        Submit(NewJob(std::move(func), counter), nullptr, 0);
+    }
+    JobHandle JobSystem::Add(JobFunction func, const JobHandle* dependency, int dependency_count, JobCounter* counter)
+    {
+        Job* job = NewJob(std::move(func), counter);
+        // Submit後は即座に完了して解放される可能性があるため, 先にハンドルで参照しておく.
+        JobHandle handle(job);
+        Submit(job, dependency, dependency_count);
+        return handle;
+    }
+    JobHandle JobSystem::Add(JobFunction func, std::initializer_list<JobHandle> dependency, JobCounter* counter)
+    {
+        return Add(std::move(func), dependency.begin(), static_cast<int>(dependency.size()), counter);
+    }
+    JobHandle JobSystem::AddContinuation(const JobHandle& prev, JobFunction func, JobCounter* counter)
+    {
+        return Add(std::move(func), &prev, 1, counter);
+    }
+
+    template<typename PRED>
+    void JobSystem::WaitWithExecute(PRED pred)
     {
-        std::unique_lock<std::mutex> lock(condition_mutex_);
-		
-        // Jobリストに追加.
-        job_queue_.push_back(func);
-		
-        condition_var_.notify_all();
+        const int worker_index = GetCurrentWorkerIndex();
+        u32 rand_state = 0x7f4a7c15u;
+        while(!pred())
+        {
+            // 待機中も実行可能なJobがあれば呼び出しスレッドで実行.
+            if(Job* job = FindJob(worker_index, rand_state))
+            {
+                ExecuteJob(job);
+                continue;
+            }
+
+            // 残りは他のWorkerで実行中か依存待ち. 完了まで待機.
+            // waiting_count_の加算とpredの参照, 完了側の逆順の操作はどちらもseq_cstのため, 通知漏れは起きない.
+            std::unique_lock<std::mutex> lock(wait_mutex_);
+            waiting_count_.fetch_add(1);
+            wait_cv_.wait(lock, pred);
+            waiting_count_.fetch_sub(1);
+        }
     }
-    
     void JobSystem::WaitAll()
     {
-        // この時点で処理待ちのjobがある場合は待機.
+        WaitWithExecute([this]{return (0 >= unfinished_job_count_.load());});
+    }
+    void JobSystem::Wait(const JobCounter& counter)
+    {
+        WaitWithExecute([&counter]{return (0 >= counter.count_.load());});
+    }
+    void JobSystem::Wait(const JobHandle& handle)
+    {
+        if(!handle.job_)
+            return;
+        const Job* job = handle.job_;
+        WaitWithExecute([job]{return job->completed.load();});
+    }
+
+    int JobSystem::GetCurrentWorkerIndex() const
+    {
+        return (this == tls_job_worker.system) ? tls_job_worker.index : -1;
+    }
+
+    JobSystem::Job* JobSystem::NewJob(JobFunction&& func, JobCounter* counter)
+    {
+        Job* job = AllocateJob();
+        job->func = std::move(func);
+        job->counter = counter;
+        job->system = this;
+        job->pending_count.store(1, std::memory_order_relaxed);
+        job->ref_count.store(1, std::memory_order_relaxed);
+        job->completed.store(false, std::memory_order_relaxed);
+
+        if(counter)
+            counter->count_.fetch_add(1);
+        unfinished_job_count_.fetch_add(1);
+        return job;
+    }
+
+    void JobSystem::Submit(Job* job, const JobHandle* dependency, int dependency_count)
+    {
+        // 未完了の依存Jobには継続として登録し, 依存Jobの完了時にpending_countを減算してもらう.
+        for(int i = 0; i < dependency_count; ++i)
         {
-            std::unique_lock<std::mutex> lock(condition_mutex_);
-            if(0<job_queue_.size())
+            Job* dep = dependency[i].job_;
+            if(!dep)
+                continue;
+
+            job->pending_count.fetch_add(1);
+            bool registered = false;
+            LockContinuation(dep);
+            if(!dep->completed.load(std::memory_order_relaxed))
             {
-                // job queue が空になるまで待機.
-                condition_var_.wait(lock, [&]{return (0>=job_queue_.size());});
+                dep->continuation.push_back(job);
+                registered = true;
             }
+            UnlockContinuation(dep);
+            if(!registered)
+                job->pending_count.fetch_sub(1);
         }
-        
-        // 各Workerの完了待機.
-        for(auto&& j : worker_thread_)
+
+        // 投入前の分を減算. 依存が全て完了済みであればキューに積む.
+        if(1 == job->pending_count.fetch_sub(1))
+        {
+            Enqueue(job);
+        }
+    }
+
+    void JobSystem::Enqueue(Job* job)
+    {
+        // WorkerスレッドからであればそのWorkerのDequeへ. 満杯なら共有キューへ.
+        const int worker_index = GetCurrentWorkerIndex();
+        if(0 > worker_index || !worker_thread_[worker_index]->deque_.Push(job))
+        {
+            std::unique_lock<std::mutex> lock(global_queue_mutex_);
+            global_queue_.push_back(job);
+            global_queue_count_.fetch_add(1);
+        }
+
+        // 待機中のWorkerがいれば一つだけ起床させる.
+        // queued_job_count_の加算とsleeping_count_の参照, Worker側の逆順の操作はどちらもseq_cstのため, 起床漏れは起きない.
+        queued_job_count_.fetch_add(1);
+        if(0 < sleeping_count_.load())
+        {
+            std::unique_lock<std::mutex> lock(sleep_mutex_);
+            sleep_cv_.notify_one();
+        }
+    }
+
+    JobSystem::Job* JobSystem::FindJob(int worker_index, u32& rand_state)
+    {
+        // 自身のDequeから.
+        if(0 <= worker_index)
+        {
+            if(Job* job = worker_thread_[worker_index]->deque_.Pop())
+            {
+                queued_job_count_.fetch_sub(1);
+                return job;
+            }
+        }
+
+        // 共有キューから.
+        if(0 < global_queue_count_.load(std::memory_order_relaxed))
         {
-            j->Wait();
+            if(Job* job = PopGlobalQueue(worker_index))
+            {
+                queued_job_count_.fetch_sub(1);
+                return job;
+            }
+        }
+
+        // 他のWorkerのDequeから盗む. 開始位置は乱数で分散させる.
+        const int worker_count = static_cast<int>(worker_thread_.size());
+        if(0 < worker_count)
+        {
+            const int start = static_cast<int>(XorShift32(rand_state) % static_cast<u32>(worker_count));
+            for(int i = 0; i < worker_count; ++i)
+            {
+                const int victim = (start + i) % worker_count;
+                if(victim == worker_index)
+                    continue;
+                if(Job* job = worker_thread_[victim]->deque_.Steal())
+                {
+                    queued_job_count_.fetch_sub(1);
+                    return job;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    JobSystem::Job* JobSystem::PopGlobalQueue(int worker_index)
+    {
+        std::unique_lock<std::mutex> lock(global_queue_mutex_);
+        if(global_queue_.empty())
+            return nullptr;
+
+        Job* job = global_queue_.front();
+        global_queue_.pop_front();
+        global_queue_count_.fetch_sub(1);
+
+        // Workerであれば続きもまとめて自身のDequeへ取り込み, 他のWorkerからはStealで分配する.
+        if(0 <= worker_index)
+        {
+            // Worker間で偏らないように取り込み数を制限する.
+            const int worker_count = static_cast<int>(worker_thread_.size());
+            int batch = static_cast<int>(global_queue_.size()) / worker_count;
+            batch = (k_global_queue_batch < batch) ? k_global_queue_batch : batch;
+            auto& deque = worker_thread_[worker_index]->deque_;
+            for(int i = 0; i < batch; ++i)
+            {
+                if(!deque.Push(global_queue_.front()))
+                    break;
+                global_queue_.pop_front();
+                global_queue_count_.fetch_sub(1);
+            }
+        }
+        return job;
+    }
+
+    void JobSystem::ExecuteJob(Job* job)
+    {
+        {
+#if NGL_JOB_PROFILE_ENABLE
+            NGL_PROFILE_SCOPE("Job");
+#endif
+            job->func();
+        }
+        // キャプチャした資源はハンドルの参照が残っていても即座に解放する.
+        job->func = nullptr;
+
+        FinishJob(job);
+    }
+
+    void JobSystem::FinishJob(Job* job)
+    {
+        // 完了を設定して以降の継続登録を止める. 以降はcontinuationを変更するスレッドは無い.
+        LockContinuation(job);
+        job->completed.store(true);
+        UnlockContinuation(job);
+
+        for(Job* c : job->continuation)
+        {
+            if(1 == c->pending_count.fetch_sub(1))
+            {
+                Enqueue(c);
+            }
+        }
+        job->continuation.clear();
+
+        // カウンタ, ハンドル, WaitAllのいずれかの待機が完了し得る場合は通知.
+        // counterは0になった時点で待機側が破棄し得るため, 以降は参照しない.
+        bool notify = (1 < job->ref_count.load());
+        if(job->counter && 1 == job->counter->count_.fetch_sub(1))
+            notify = true;
+        if(1 == unfinished_job_count_.fetch_sub(1))
+            notify = true;
+
+        ReleaseJob(job);
+
+        if(notify)
+            NotifyWaiter();
+    }
+
+    void JobSystem::ReleaseJob(Job* job)
+    {
+        if(1 == job->ref_count.fetch_sub(1, std::memory_order_acq_rel))
+        {
+            job->system->FreeJob(job);
+        }
+    }
+
+    JobSystem::Job* JobSystem::AllocateJob()
+    {
+        // Worker以外のスレッドはスロット0を共有する.
+        const int worker_index = GetCurrentWorkerIndex();
+        if(0 <= worker_index)
+        {
+            return job_pool_->Allocate(worker_index + 1);
         }
+        std::unique_lock<std::mutex> lock(job_pool_->external_mutex);
+        return job_pool_->Allocate(0);
     }
-    
+    void JobSystem::FreeJob(Job* job)
+    {
+        job->counter = nullptr;
+
+        const int worker_index = GetCurrentWorkerIndex();
+        if(0 <= worker_index)
+        {
+            job_pool_->Free(job, worker_index + 1);
+            return;
+        }
+        if(0 == job->pool_slot)
+        {
+            std::unique_lock<std::mutex> lock(job_pool_->external_mutex);
+            job_pool_->Free(job, 0);
+            return;
+        }
+        // 所有者以外のスロットへはremote_freeに積むためロック不要.
+        job_pool_->Free(job, -1);
+    }
+
+    void JobSystem::NotifyWaiter()
+    {
+        if(0 < waiting_count_.load())
+        {
+            std::unique_lock<std::mutex> lock(wait_mutex_);
+            wait_cv_.notify_all();
+        }
+    }
+
 }
 }
 
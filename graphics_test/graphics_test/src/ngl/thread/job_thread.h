@@ -1,10 +1,22 @@
 ﻿#pragma once
 
 #include <array>
+#include <vector>
+#include <deque>
+#include <atomic>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <functional>
+#include <initializer_list>
+
+#include "ngl/util/types.h"
+#include "job_function.h"
+
+// JobSystemの各Jobをプロファイルゾーン"Job"で計測する. 既定で有効. 細かいJobを大量に積む場合はプリプロセッサ定義で0を指定すると無効.
+#ifndef NGL_JOB_PROFILE_ENABLE
+    #define NGL_JOB_PROFILE_ENABLE 1
+#endif
 
 namespace ngl
 {
@@ -106,11 +118,69 @@ namespace thread
 
 
     class JobSystemWorker;
+    struct JobSystemJob;
+    struct JobSystemJobPool;
+    class JobSystem;
+
+    /*
+        JobCounter.
+            Jobの完了数を数えるカウンタ. Add時に指定したJobの追加で加算され, 完了で減算される.
+            JobSystem::Wait(counter) で指定したJobの集合のみの完了を待機できる.
+            待機が完了するまで破棄しないこと.
+    */
+    class JobCounter
+    {
+        friend JobSystem;
+    public:
+        JobCounter() = default;
+        JobCounter(const JobCounter&) = delete;
+        JobCounter& operator=(const JobCounter&) = delete;
+
+        // 未完了のJob数.
+        s32 GetCount() const { return count_.load(std::memory_order_acquire); }
+        bool IsCompleted() const { return 0 >= GetCount(); }
+
+    private:
+        std::atomic<s32>    count_ = 0;
+    };
+
+    /*
+        JobHandle.
+            Add時に返されるJobへの参照. 依存関係の指定と個別の完了待機に利用する.
+            参照中はJobの実体を保持するため, JobSystemより先に破棄すること.
+    */
+    class JobHandle
+    {
+        friend JobSystem;
+    public:
+        JobHandle() = default;
+        ~JobHandle();
+        JobHandle(const JobHandle& v);
+        JobHandle(JobHandle&& v) noexcept;
+        JobHandle& operator=(const JobHandle& v);
+        JobHandle& operator=(JobHandle&& v) noexcept;
+
+        bool IsValid() const { return nullptr != job_; }
+        // 無効なハンドルは完了済み扱い.
+        bool IsCompleted() const;
+        void Reset();
+
+    private:
+        explicit JobHandle(JobSystemJob* job);
+
+        JobSystemJob*   job_ = nullptr;
+    };
+
     /*
         JobSystem.
+            Worker毎のWork-Stealing Deque(Chase-Lev)によるスケジューラ.
+            WorkerスレッドからAddしたJobはそのWorkerのDequeに積まれ, 他のWorkerは空になると別のWorkerのDequeから盗んで実行する.
+            Worker以外のスレッドからAddしたJobは共有キューに積まれ, Workerがまとめて自身のDequeに取り込む.
+            Jobの関数オブジェクトはJobFunctionでJobレコード内に保持し, JobレコードはWorker毎のプールで再利用するため, 定常状態ではAddでヒープ確保しない.
+            待機中のWorkerはJob追加毎に一つだけ起床させる.
      
-        ngl::thread::JobSystem job_system(8);
-        ngl::time::Timer::Instance().StartTimer("job_system_test");
+        ngl::thread::JobSystem job_system;
+        job_system.Init(8);
         std::atomic_int job_system_test_cnt = 0;
         for(int i = 0; i < 100; ++i)
         {
@@ -122,10 +192,19 @@ namespace thread
             });
         }
         job_system.WaitAll();// 待機.
+
+        // 依存関係とカウンタ.
+        ngl::thread::JobCounter counter;
+        ngl::thread::JobHandle a = job_system.Add(func_a, nullptr, 0, &counter);
+        ngl::thread::JobHandle b = job_system.Add(func_b, nullptr, 0, &counter);
+        ngl::thread::JobHandle c = job_system.Add(func_c, {a, b}, &counter);// a,bの完了後に実行.
+        job_system.AddContinuation(c, func_d, &counter);// cの完了後に実行.
+        job_system.Wait(counter);// a,b,c,dの完了のみ待機.
     */
     class JobSystem
     {
         friend JobSystemWorker;
+        friend JobHandle;
         
     public:
         JobSystem();
@@ -133,17 +212,79 @@ namespace thread
 
         void Init(int num_max_thread);
         
-        void Add(std::function< void(void) > func);
+        // 任意のスレッドから呼び出し可能.
+        void Add(JobFunction func);
+        // counterを指定した場合は追加時に加算し, 完了時に減算する.
+        void Add(JobFunction func, JobCounter* counter);
+        // dependencyの全Jobの完了後に実行されるJobを追加する. 無効なハンドルは無視する.
+        JobHandle Add(JobFunction func, const JobHandle* dependency, int dependency_count, JobCounter* counter = nullptr);
+        JobHandle Add(JobFunction func, std::initializer_list<JobHandle> dependency, JobCounter* counter = nullptr);
+        // prevの完了後に実行される継続Jobを追加する.
+        JobHandle AddContinuation(const JobHandle& prev, JobFunction func, JobCounter* counter = nullptr);
 
+        // 追加済みの全Jobの完了を待機する. 待機中は呼び出しスレッドもJobを実行する.
+        // Jobの内部から呼び出さないこと.
         void WaitAll();
+        // counterの完了を待機する. 待機中は呼び出しスレッドもJobを実行する.
+        // Jobの内部から呼び出す場合は, 待機対象がそのJob自身の継続Jobを含まないこと.
+        void Wait(const JobCounter& counter);
+        // handleのJobの完了を待機する. 待機中は呼び出しスレッドもJobを実行する.
+        void Wait(const JobHandle& handle);
+
+        int GetWorkerCount() const { return static_cast<int>(worker_thread_.size()); }
 	
     private:
-        std::mutex				condition_mutex_;
-        std::condition_variable	condition_var_;
+        using Job = JobSystemJob;
+
+        // 呼び出しスレッドがこのJobSystemのWorkerであればそのインデックス. それ以外は負数.
+        int GetCurrentWorkerIndex() const;
 
-        std::list<std::function<void(void)>> job_queue_{};
+        Job* NewJob(JobFunction&& func, JobCounter* counter);
+        // Jobレコードの参照を解放する. 参照が無くなればプールに戻す.
+        static void ReleaseJob(Job* job);
+        // Jobレコードプール. 呼び出しスレッドの対応するスロットから確保し, 確保したスロットへ返却する.
+        Job* AllocateJob();
+        void FreeJob(Job* job);
+        // 依存Jobの登録を終えたJobを投入する. 依存が残っていれば依存Jobの完了時に投入される.
+        void Submit(Job* job, const JobHandle* dependency, int dependency_count);
+        // Jobをキューに積んで待機中のWorkerを起床させる.
+        void Enqueue(Job* job);
+        // 実行するJobを探す. 自身のDeque, 共有キュー, 他のWorkerのDequeの順.
+        Job* FindJob(int worker_index, u32& rand_state);
+        Job* PopGlobalQueue(int worker_index);
+        void ExecuteJob(Job* job);
+        // Job完了処理. 継続Jobの投入とカウンタの減算, 待機側への通知を行う.
+        void FinishJob(Job* job);
+        // predが成立するまで呼び出しスレッドでJobを実行しながら待機する.
+        template<typename PRED>
+        void WaitWithExecute(PRED pred);
+        void NotifyWaiter();
         
+    private:
         std::vector<JobSystemWorker*> worker_thread_{};
+
+        JobSystemJobPool*       job_pool_ = nullptr;
+
+        // Worker以外のスレッドから追加されたJob.
+        std::mutex              global_queue_mutex_;
+        std::deque<Job*>        global_queue_{};
+        std::atomic<s32>        global_queue_count_ = 0;
+
+        // キューに積まれていて未取得のJob数. 一時的に負になる場合がある.
+        std::atomic<s32>        queued_job_count_ = 0;
+        // 追加されて実行完了していないJob数.
+        std::atomic<s32>        unfinished_job_count_ = 0;
+
+        // Workerの待機.
+        std::mutex				sleep_mutex_;
+        std::condition_variable	sleep_cv_;
+        std::atomic<s32>        sleeping_count_ = 0;
+        bool                    terminate_signal_ = false;
+
+        // WaitAll, Waitの待機.
+        std::mutex				wait_mutex_;
+        std::condition_variable	wait_cv_;
+        std::atomic<s32>        waiting_count_ = 0;
     };
     
 }
@@ -0,0 +1,353 @@
+﻿
+#include "job_thread_test.h"
+
+#include <list>
+#include <chrono>
+#include <iostream>
+
+#include <assert.h>
+
+namespace ngl
+{
+namespace thread
+{
+namespace test
+{
+	namespace
+	{
+		using Clock = std::chrono::steady_clock;
+
+		constexpr int k_job_count = 10000;
+		constexpr int k_round_count = 20;
+		// 入れ子のケースで各Jobから追加する子Job数.
+		constexpr int k_child_job_count = 8;
+
+		// 比較用. 以前のJobSystemの実装(std::listの共有キューとnotify_allによる起床).
+		class LegacyJobSystem
+		{
+		public:
+			LegacyJobSystem(int num_thread)
+			{
+				worker_.resize(num_thread);
+				for (auto&& w : worker_)
+				{
+					w.reset(new Worker());
+					Worker* p = w.get();
+					p->thread_instance = std::thread([this, p]() {Execute(p); });
+				}
+			}
+			~LegacyJobSystem()
+			{
+				{
+					std::unique_lock<std::mutex> lock(condition_mutex_);
+					terminate_signal_ = true;
+					condition_var_.notify_all();
+				}
+				for (auto&& w : worker_)
+					w->thread_instance.join();
+			}
+
+			void Add(std::function< void(void) > func)
+			{
+				std::unique_lock<std::mutex> lock(condition_mutex_);
+				job_queue_.push_back(func);
+				condition_var_.notify_all();
+			}
+			void WaitAll()
+			{
+				std::unique_lock<std::mutex> lock(condition_mutex_);
+				// 入れ子で追加されるJobも含めて, キューが空かつ全Workerが実行中でなくなるまで待機.
+				condition_var_.wait(lock, [&]
+					{
+						if (0 < job_queue_.size())
+							return false;
+						for (auto&& w : worker_)
+						{
+							if (w->job_enable)
+								return false;
+						}
+						return true;
+					});
+			}
+
+		private:
+			struct Worker
+			{
+				std::thread	thread_instance;
+				bool		job_enable = false;
+				std::function< void(void) > func;
+			};
+
+			void Execute(Worker* w)
+			{
+				while (true)
+				{
+					bool terminate = false;
+					{
+						std::unique_lock<std::mutex> lock(condition_mutex_);
+						if (0 >= job_queue_.size())
+						{
+							condition_var_.wait(lock, [&] {return (0 < job_queue_.size() || terminate_signal_); });
+						}
+						if (0 < job_queue_.size())
+						{
+							w->job_enable = true;
+							w->func = job_queue_.front();
+							job_queue_.pop_front();
+						}
+						terminate = terminate_signal_;
+						condition_var_.notify_all();
+					}
+					if (w->job_enable)
+					{
+						w->func();
+
+						std::unique_lock<std::mutex> lock(condition_mutex_);
+						w->job_enable = false;
+						condition_var_.notify_all();
+					}
+					if (terminate)
+						break;
+				}
+			}
+
+			std::mutex				condition_mutex_;
+			std::condition_variable	condition_var_;
+			bool					terminate_signal_ = false;
+			std::list<std::function<void(void)>> job_queue_{};
+			std::vector<std::unique_ptr<Worker>> worker_{};
+		};
+
+		// 小さなJob. 最適化で消えないように結果をカウンタへ反映する.
+		void TinyWork(std::atomic<s64>* counter, int seed)
+		{
+			u32 v = static_cast<u32>(seed) * 2654435761u;
+			for (int i = 0; i < 16; ++i)
+				v = v * 1664525u + 1013904223u;
+			counter->fetch_add(1 + (v & 0));
+		}
+
+		// 呼び出しスレッドから全Jobを追加.
+		template<typename SYSTEM>
+		double RunFlat(SYSTEM& system, std::atomic<s64>& counter)
+		{
+			const auto begin = Clock::now();
+			for (int r = 0; r < k_round_count; ++r)
+			{
+				for (int i = 0; i < k_job_count; ++i)
+				{
+					system.Add([&counter, i] {TinyWork(&counter, i); });
+				}
+				system.WaitAll();
+			}
+			return std::chrono::duration<double>(Clock::now() - begin).count();
+		}
+		// Jobの内部から子Jobを追加.
+		template<typename SYSTEM>
+		double RunNested(SYSTEM& system, std::atomic<s64>& counter)
+		{
+			const auto begin = Clock::now();
+			for (int r = 0; r < k_round_count; ++r)
+			{
+				for (int i = 0; i < k_job_count / k_child_job_count; ++i)
+				{
+					system.Add([&system, &counter, i]
+						{
+							for (int c = 1; c < k_child_job_count; ++c)
+							{
+								system.Add([&counter, i, c] {TinyWork(&counter, i * k_child_job_count + c); });
+							}
+							TinyWork(&counter, i * k_child_job_count);
+						});
+				}
+				system.WaitAll();
+			}
+			return std::chrono::duration<double>(Clock::now() - begin).count();
+		}
+
+		void Report(const char* label, double legacy_sec, double current_sec, s64 legacy_count, s64 current_count, s64 expect_count)
+		{
+			const double job_total = static_cast<double>(expect_count);
+			std::cout << "  " << label << std::endl;
+			std::cout << "    legacy       : " << (job_total / legacy_sec) << " jobs/sec" << ((legacy_count == expect_count) ? "" : " (count mismatch)") << std::endl;
+			std::cout << "    work-stealing: " << (job_total / current_sec) << " jobs/sec" << ((current_count == expect_count) ? "" : " (count mismatch)") << std::endl;
+			std::cout << "    speedup      : " << (legacy_sec / current_sec) << "x" << std::endl;
+		}
+	}
+
+	void JobSystemDependencyTest()
+	{
+		int num_thread = static_cast<int>(std::thread::hardware_concurrency());
+		num_thread = (1 < num_thread) ? num_thread - 1 : 1;
+
+		JobSystem system;
+		system.Init(num_thread);
+
+		int fail_count = 0;
+		auto check = [&fail_count](bool result, const char* label)
+		{
+			if (!result)
+			{
+				++fail_count;
+				std::cout << "  failed : " << label << std::endl;
+			}
+		};
+
+		// a -> (b, c) -> d. 依存先が完了していることを記録した順序で検証する.
+		{
+			constexpr int k_diamond_count = 1000;
+			std::atomic<int> order_error = 0;
+			JobCounter counter;
+			for (int i = 0; i < k_diamond_count; ++i)
+			{
+				auto* stamp = new std::atomic<int>[4]{};
+				std::atomic<int>* sequence = new std::atomic<int>(0);
+				JobHandle a = system.Add([=] { stamp[0] = ++(*sequence); }, nullptr, 0, &counter);
+				JobHandle b = system.Add([=] { stamp[1] = ++(*sequence); }, { a }, &counter);
+				JobHandle c = system.Add([=] { stamp[2] = ++(*sequence); }, { a }, &counter);
+				system.Add([=, &order_error]
+					{
+						stamp[3] = ++(*sequence);
+						if (!(stamp[0] < stamp[1] && stamp[0] < stamp[2] && stamp[1] < stamp[3] && stamp[2] < stamp[3]))
+							order_error.fetch_add(1);
+						delete[] stamp;
+						delete sequence;
+					}, { b, c }, &counter);
+			}
+			system.Wait(counter);
+			check(0 == order_error.load(), "diamond order");
+			check(counter.IsCompleted(), "diamond counter");
+		}
+
+		// 継続Jobの連鎖. 直前のJobの完了後に実行されるため値は順に書き込まれる.
+		{
+			constexpr int k_chain_length = 1000;
+			std::vector<int> value;
+			value.reserve(k_chain_length);
+			JobHandle prev = system.Add([&value] { value.push_back(0); }, nullptr, 0);
+			for (int i = 1; i < k_chain_length; ++i)
+			{
+				prev = system.AddContinuation(prev, [&value, i] { value.push_back(i); });
+			}
+			system.Wait(prev);
+			bool ordered = (k_chain_length == static_cast<int>(value.size()));
+			for (int i = 0; ordered && i < k_chain_length; ++i)
+				ordered = (i == value[i]);
+			check(ordered, "continuation chain");
+		}
+
+		// 多数のJobの完了を待つJob.
+		{
+			constexpr int k_fan_in_count = 500;
+			std::atomic<int> done = 0;
+			bool join_ok = false;
+			std::vector<JobHandle> handle;
+			for (int i = 0; i < k_fan_in_count; ++i)
+			{
+				handle.push_back(system.Add([&done] { done.fetch_add(1); }, nullptr, 0));
+			}
+			JobHandle join = system.Add([&done, &join_ok] { join_ok = (k_fan_in_count == done.load()); }, handle.data(), static_cast<int>(handle.size()));
+			system.Wait(join);
+			check(join_ok, "fan-in");
+		}
+
+		// 内部に収まらない関数オブジェクトはヒープに確保して保持する.
+		{
+			struct LargeCapture
+			{
+				u32 value[64];
+			};
+			static_assert(!JobFunction::IsInline<LargeCapture>(), "");
+			LargeCapture large = {};
+			for (u32 i = 0; i < 64; ++i)
+				large.value[i] = i;
+			std::atomic<u32> sum = 0;
+			JobCounter counter;
+			for (int i = 0; i < 100; ++i)
+			{
+				system.Add([large, &sum]
+					{
+						u32 v = 0;
+						for (u32 e : large.value)
+							v += e;
+						sum.fetch_add(v);
+					}, &counter);
+			}
+			system.Wait(counter);
+			check(100 * (63 * 64 / 2) == sum.load(), "large capture");
+		}
+
+		// 部分的な待機. 完了していないJobがあってもカウンタの対象のみ待機できる.
+		{
+			std::atomic<bool> release = false;
+			std::atomic<bool> started = false;
+			JobCounter blocker_counter;
+			system.Add([&release, &started]
+				{
+					started = true;
+					while (!release.load())
+						std::this_thread::yield();
+				}, &blocker_counter);
+			// 呼び出しスレッドが待機中に実行しないように, Workerで開始されるまで待つ.
+			while (!started.load())
+				std::this_thread::yield();
+
+			JobCounter counter;
+			std::atomic<int> done = 0;
+			for (int i = 0; i < 100; ++i)
+			{
+				system.Add([&done] { done.fetch_add(1); }, &counter);
+			}
+			system.Wait(counter);
+			check(100 == done.load(), "partial wait");
+			check(!blocker_counter.IsCompleted(), "partial wait blocker");
+
+			release = true;
+			system.WaitAll();
+			check(blocker_counter.IsCompleted(), "wait all");
+		}
+
+		std::cout << "[JobSystemDependencyTest] fail " << fail_count << std::endl;
+		assert(0 == fail_count);
+	}
+
+	void JobSystemBenchmark()
+	{
+		int num_thread = static_cast<int>(std::thread::hardware_concurrency());
+		num_thread = (1 < num_thread) ? num_thread - 1 : 1;
+
+		const s64 expect_flat = s64(k_job_count) * k_round_count;
+		const s64 expect_nested = s64(k_job_count / k_child_job_count) * k_child_job_count * k_round_count;
+
+		std::cout << "[JobSystemBenchmark] worker " << num_thread << ", job " << k_job_count << " x " << k_round_count << std::endl;
+
+		std::atomic<s64> legacy_flat = 0;
+		std::atomic<s64> legacy_nested = 0;
+		double legacy_flat_sec = 0.0;
+		double legacy_nested_sec = 0.0;
+		{
+			LegacyJobSystem system(num_thread);
+			legacy_flat_sec = RunFlat(system, legacy_flat);
+			legacy_nested_sec = RunNested(system, legacy_nested);
+		}
+
+		std::atomic<s64> current_flat = 0;
+		std::atomic<s64> current_nested = 0;
+		double current_flat_sec = 0.0;
+		double current_nested_sec = 0.0;
+		{
+			JobSystem system;
+			system.Init(num_thread);
+			current_flat_sec = RunFlat(system, current_flat);
+			current_nested_sec = RunNested(system, current_nested);
+		}
+
+		Report("flat (add from caller)", legacy_flat_sec, current_flat_sec, legacy_flat.load(), current_flat.load(), expect_flat);
+		Report("nested (add from job)", legacy_nested_sec, current_nested_sec, legacy_nested.load(), current_nested.load(), expect_nested);
+
+		assert(expect_flat == current_flat.load());
+		assert(expect_nested == current_nested.load());
+	}
+}
+}
+}
@@ -0,0 +1,21 @@
+﻿#pragma once
+
+#include "job_thread.h"
+
+
+namespace ngl
+{
+namespace thread
+{
+namespace test
+{
+	// JobSystemのテスト.
+	// 小さなJobを大量に投入した場合のスループットを以前の実装(共有キュー + notify_all)と比較して標準出力に出力し, 全Jobが一度ずつ実行されたかを検証する.
+	void JobSystemBenchmark();
+
+	// JobSystemの依存関係のテスト.
+	// 依存Jobの完了後に実行されること, 継続Jobの実行順, JobCounterによる部分的な待機を検証して結果を標準出力に出力する.
+	void JobSystemDependencyTest();
+}
+}
+}
@@ -1,12 +1,18 @@
 ﻿#pragma once
 
 #include <atomic>
+#include <assert.h>
+
+#include "ngl/util/types.h"
 
 namespace ngl
 {
 namespace thread
 {
 	// Node継承クラスをStackする.
+	//	先頭ポインタの上位16bitに更新毎に加算するタグを持たせ, PopしたノードをそのままPushし直すような場合のABA問題を防ぐ.
+	//	x64のユーザー空間アドレスが下位48bitに収まることを前提とする.
+	//	Popは他スレッドが取り出したノードのnextを読む可能性があるため, Popと並行してノードのメモリを解放しないこと.
 	template<typename T>
 	class LockFreeStackIntrusive
 	{
@@ -17,20 +23,30 @@ namespace thread
 
 			virtual ~Node() {};
 
-			T& Get() 
-			{ 
-				return *static_cast<T*>(this); 
+			T& Get()
+			{
+				return *static_cast<T*>(this);
 			}
 			const T& Get() const
 			{
 				return *static_cast<T*>(this);
 			}
 
-			Node(const Node& o)
+			// PushList用の連結, PopAllで取り出したリストの走査用.
+			T* GetNext() const
+			{
+				return next.load(std::memory_order_relaxed);
+			}
+			void SetNext(T* p)
+			{
+				next.store(p, std::memory_order_relaxed);
+			}
+
+			Node(const Node&)
 			{
 				// Nothing. atomicはコピー禁止のためコピーコンストラクタ/代入演算子を明示定義しないと定義自体がdeleteされる.
 			}
-			Node& operator=(const Node & o)
+			Node& operator=(const Node&)
 			{
 				// Nothing. atomicはコピー禁止のためコピーコンストラクタ/代入演算子を明示定義しないと定義自体がdeleteされる.
 				return *this;
@@ -49,38 +65,73 @@ namespace thread
 		}
 		void Push(T* node)
 		{
+			PushList(node, node);
+		}
+		// SetNextでheadからtailまで連結済みのリストを一度にPushする.
+		void PushList(T* head, T* tail)
+		{
+			u64 old = top_.load(std::memory_order_relaxed);
 			while (true)
 			{
-				T* old = top_;
-				node->next = old;
-				if (top_.compare_exchange_weak(old, node))
+				tail->SetNext(GetPointer(old));
+				if (top_.compare_exchange_weak(old, Pack(head, GetTag(old) + 1), std::memory_order_release, std::memory_order_relaxed))
 				{
 					break;
 				}
 			}
 		}
-		// ABA問題への対策はしていないため, PopしたポインタをそのままPushし直すようなタスクでは問題が発生する可能性がある.
 		T* Pop()
 		{
-			T* old = nullptr;
+			u64 old = top_.load(std::memory_order_acquire);
 			while (true)
 			{
-				old = top_;
-				if (nullptr == old)
-					break;
+				T* p = GetPointer(old);
+				if (nullptr == p)
+					return nullptr;
 
-				T* next = old->next;
-				if (top_.compare_exchange_weak(old, next))
+				// 他スレッドが先にPopしてPushし直していてもタグが異なるためCASは失敗する.
+				T* next = p->GetNext();
+				if (top_.compare_exchange_weak(old, Pack(next, GetTag(old) + 1), std::memory_order_acquire, std::memory_order_acquire))
 				{
-					break;
+					return p;
 				}
 			}
+		}
+		// 全ノードを一度に取り出す. 戻り値からGetNextで辿れる.
+		T* PopAll()
+		{
+			// ポインタ部のみクリアしてタグは維持する. 以降のPushでタグは加算されるためABA問題は起きない.
+			const u64 old = top_.fetch_and(k_tag_mask, std::memory_order_acquire);
+			return GetPointer(old);
+		}
 
-			return old;
+		bool IsEmpty() const
+		{
+			return nullptr == GetPointer(top_.load(std::memory_order_relaxed));
 		}
+
 	private:
-		std::atomic<T*> top_ = nullptr;
+		static constexpr u64 k_pointer_bits = 48;
+		static constexpr u64 k_pointer_mask = (u64(1) << k_pointer_bits) - 1;
+		static constexpr u64 k_tag_mask = ~k_pointer_mask;
+		static_assert(sizeof(void*) == sizeof(u64), "LockFreeStackIntrusive requires 64bit pointer.");
+
+		static u64 Pack(T* p, u64 tag)
+		{
+			const u64 v = reinterpret_cast<u64>(p);
+			assert(0 == (v & k_tag_mask));
+			return v | (tag << k_pointer_bits);
+		}
+		static T* GetPointer(u64 v)
+		{
+			return reinterpret_cast<T*>(v & k_pointer_mask);
+		}
+		static u64 GetTag(u64 v)
+		{
+			return v >> k_pointer_bits;
+		}
+
+		std::atomic<u64> top_ = 0;
 	};
 }
 }
-
@@ -3,11 +3,12 @@
 
 #include <thread>
 #include <vector>
+#include <tuple>
+#include <chrono>
 #include <algorithm>
 #include <iostream>
 
 #include <assert.h>
-#include <Windows.h>
 
 namespace ngl
 {
@@ -79,7 +80,7 @@ namespace test
 
 		void operator()()
 		{
-			Sleep(1);
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
 			while (auto* n = src_->Pop())
 			{
 				//Sleep(1);
@@ -169,6 +170,231 @@ namespace test
 		std::cout << "Test End LockFreeStackIntrusive" << std::endl;
 
 	}
+
+	namespace
+	{
+		struct StressNode : public LockFreeStackIntrusive<StressNode>::Node
+		{
+			int					id = 0;
+			// Popしたスレッドのみが保持しているはずなので, 重複してPopされた場合に検出できる.
+			std::atomic<int>	owned = 0;
+		};
+		using StressStack = LockFreeStackIntrusive<StressNode>;
+
+		u32 XorShift32(u32& state)
+		{
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			return state;
+		}
+
+		bool Acquire(StressNode* n, std::atomic<int>* error_count)
+		{
+			if (0 != n->owned.exchange(1))
+			{
+				error_count->fetch_add(1);
+				return false;
+			}
+			return true;
+		}
+		void Release(StressNode* n)
+		{
+			n->owned.store(0);
+		}
+	}
+
+	void LockfreeStackIntrusiveStressTest()
+	{
+		// ABA問題の検証.
+		//	少数のノードを多数のスレッドでPop, Push, PushList, PopAllし続ける. PopしたノードをすぐにPushし直すためABAが起きやすい.
+		//	同じノードが重複してPopされたり, ノードが失われたりしないことを確認する.
+		{
+			constexpr int k_node_count = 64;
+			constexpr int k_thread_count = 16;
+			constexpr int k_iteration = 100000;
+
+			std::vector<StressNode> node(k_node_count);
+			StressStack stack;
+			for (int i = 0; i < k_node_count; ++i)
+			{
+				node[i].id = i;
+				stack.Push(&node[i]);
+			}
+
+			std::atomic<int> error_count = 0;
+			std::vector<std::thread> thread_array;
+			for (int t = 0; t < k_thread_count; ++t)
+			{
+				thread_array.emplace_back([&stack, &error_count, t]()
+					{
+						u32 rand_state = 0x9e3779b9u * (t + 1);
+						StressNode* local[8];
+						for (int i = 0; i < k_iteration; ++i)
+						{
+							const u32 op = XorShift32(rand_state) % 16;
+							if (0 == op)
+							{
+								// 全て取り出して戻す.
+								StressNode* head = stack.PopAll();
+								StressNode* tail = nullptr;
+								for (StressNode* n = head; n; n = n->GetNext())
+								{
+									Acquire(n, &error_count);
+									tail = n;
+								}
+								for (StressNode* n = head; n; n = n->GetNext())
+									Release(n);
+								if (head)
+									stack.PushList(head, tail);
+							}
+							else if (8 > op)
+							{
+								// 取り出してすぐに戻す.
+								if (StressNode* n = stack.Pop())
+								{
+									if (Acquire(n, &error_count))
+										Release(n);
+									stack.Push(n);
+								}
+							}
+							else
+							{
+								// 複数取り出して連結してから一度に戻す.
+								int count = 0;
+								for (; count < 8; ++count)
+								{
+									StressNode* n = stack.Pop();
+									if (!n)
+										break;
+									Acquire(n, &error_count);
+									local[count] = n;
+								}
+								if (0 < count)
+								{
+									for (int k = 0; k < count; ++k)
+									{
+										Release(local[k]);
+										local[k]->SetNext((k + 1 < count) ? local[k + 1] : nullptr);
+									}
+									stack.PushList(local[0], local[count - 1]);
+								}
+							}
+						}
+					});
+			}
+			for (auto& e : thread_array)
+				e.join();
+
+			// 全ノードが重複なく残っている.
+			std::vector<int> found(k_node_count, 0);
+			int total = 0;
+			for (StressNode* n = stack.PopAll(); n && total <= k_node_count; n = n->GetNext())
+			{
+				++found[n->id];
+				++total;
+			}
+			bool valid = (k_node_count == total);
+			for (int e : found)
+				valid = valid && (1 == e);
+
+			std::cout << "LockFreeStackIntrusive ABA stress : " << ((valid && 0 == error_count.load()) ? "ok" : "failed")
+				<< " (duplicate pop " << error_count.load() << ", node " << total << "/" << k_node_count << ")" << std::endl;
+			assert(valid && 0 == error_count.load());
+		}
+
+		// 多数のProducerとConsumer.
+		//	ProducerはPushとPushListで新規ノードを積み, ConsumerはPopとPopAllで取り出す. 全ノードが一度ずつ取り出されることを確認する.
+		{
+			constexpr int k_producer_count = 8;
+			constexpr int k_consumer_count = 8;
+			constexpr int k_per_producer_count = 20000;
+			constexpr int k_total = k_producer_count * k_per_producer_count;
+
+			std::vector<StressNode> node(k_total);
+			for (int i = 0; i < k_total; ++i)
+				node[i].id = i;
+
+			StressStack stack;
+			std::atomic<int> producer_done = 0;
+			std::vector<std::vector<int>> consumed(k_consumer_count);
+			std::vector<std::thread> thread_array;
+			for (int p = 0; p < k_producer_count; ++p)
+			{
+				thread_array.emplace_back([&, p]()
+					{
+						StressNode* base = &node[p * k_per_producer_count];
+						int i = 0;
+						while (i < k_per_producer_count)
+						{
+							// 4個ずつ連結してPushList, 残りは個別にPush.
+							if (i + 4 <= k_per_producer_count && 0 == (i & 4))
+							{
+								for (int k = 0; k < 3; ++k)
+									base[i + k].SetNext(&base[i + k + 1]);
+								stack.PushList(&base[i], &base[i + 3]);
+								i += 4;
+							}
+							else
+							{
+								stack.Push(&base[i]);
+								++i;
+							}
+						}
+						producer_done.fetch_add(1);
+					});
+			}
+			for (int c = 0; c < k_consumer_count; ++c)
+			{
+				thread_array.emplace_back([&, c]()
+					{
+						auto& out = consumed[c];
+						u32 rand_state = 0x7f4a7c15u * (c + 1);
+						while (true)
+						{
+							const bool finished = (k_producer_count == producer_done.load());
+							if (0 == XorShift32(rand_state) % 64)
+							{
+								for (StressNode* n = stack.PopAll(); n;)
+								{
+									StressNode* next = n->GetNext();
+									out.push_back(n->id);
+									n = next;
+								}
+							}
+							else if (StressNode* n = stack.Pop())
+							{
+								out.push_back(n->id);
+							}
+							else if (finished)
+							{
+								break;
+							}
+						}
+					});
+			}
+			for (auto& e : thread_array)
+				e.join();
+
+			std::vector<int> found(k_total, 0);
+			int total = 0;
+			for (auto& v : consumed)
+			{
+				for (int id : v)
+				{
+					++found[id];
+					++total;
+				}
+			}
+			bool valid = (k_total == total) && stack.IsEmpty();
+			for (int e : found)
+				valid = valid && (1 == e);
+
+			std::cout << "LockFreeStackIntrusive producer/consumer stress : " << (valid ? "ok" : "failed")
+				<< " (" << total << "/" << k_total << ")" << std::endl;
+			assert(valid);
+		}
+	}
+}
 }
 }
-}
\ No newline at end of file
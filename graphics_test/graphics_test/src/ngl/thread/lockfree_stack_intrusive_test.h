@@ -10,6 +10,8 @@ namespace thread
 namespace test
 {
 	void LockfreeStackIntrusiveTest();
+	// 多数のスレッドでのABA問題, PushList, PopAllの検証.
+	void LockfreeStackIntrusiveStressTest();
 }
 }
 }
\ No newline at end of file
@@ -0,0 +1,143 @@
+﻿#pragma once
+
+#include <vector>
+#include <utility>
+#include <type_traits>
+
+#include "ngl/util/types.h"
+#include "job_thread.h"
+
+/*
+	JobSystem上のデータ並列処理.
+		範囲を二分割しながら後半をJobとして積み, 前半は呼び出しスレッドで続けて分割する.
+		積まれたJobは大きな範囲から他のWorkerに盗まれるため, 粒度を細かくしても偏りにくい.
+		呼び出しスレッドも処理に参加し, 全範囲の完了を待ってから戻る.
+		job_systemがnullptrもしくはWorkerが無い場合は呼び出しスレッドで逐次実行する.
+
+	// 要素毎.
+	ngl::thread::ParallelFor(p_job_system, 0, count, 0, [&](s64 i)
+	{
+		array[i].Update();
+	});
+
+	// 範囲毎.
+	ngl::thread::ParallelForRange(p_job_system, 0, count, 256, [&](s64 begin, s64 end)
+	{
+		for(s64 i = begin; i < end; ++i)
+			array[i].Update();
+	});
+
+	// 集約. 範囲毎の結果は範囲の順に集約するため, 浮動小数の加算等でも結果は実行毎に変わらない.
+	float sum = ngl::thread::ParallelReduce(p_job_system, 0, count, 0, 0.0f,
+		[&](s64 begin, s64 end) { float v = 0.0f; for(s64 i = begin; i < end; ++i) v += array[i]; return v; },
+		[](float a, float b) { return a + b; });
+*/
+
+namespace ngl
+{
+namespace thread
+{
+	namespace parallel_for_detail
+	{
+		// grain自動決定時のスレッド毎の分割数.
+		constexpr s64 k_auto_chunk_per_thread = 4;
+
+		// grainが0以下の場合は参加スレッド数から自動で決定する.
+		inline s64 ResolveGrain(const JobSystem* job_system, s64 count, s64 grain)
+		{
+			if (0 < grain)
+				return grain;
+			const s64 thread_count = s64(job_system->GetWorkerCount()) + 1;
+			const s64 auto_grain = count / (thread_count * k_auto_chunk_per_thread);
+			return (1 < auto_grain) ? auto_grain : 1;
+		}
+
+		template<typename FUNC>
+		struct ParallelForContext
+		{
+			JobSystem*	job_system;
+			FUNC*		func;
+			s64			grain;
+			JobCounter	counter;
+		};
+
+		// [begin, end) を分割して後半をJobとして積み, 残りを実行する.
+		template<typename FUNC>
+		void SplitAndExecute(ParallelForContext<FUNC>* context, s64 begin, s64 end)
+		{
+			while (context->grain < end - begin)
+			{
+				const s64 mid = begin + (end - begin) / 2;
+				context->job_system->Add([context, mid, end]
+					{
+						SplitAndExecute(context, mid, end);
+					}, &context->counter);
+				end = mid;
+			}
+			(*context->func)(begin, end);
+		}
+	}
+
+	// [begin, end) をgrain以下の範囲に分割してfunc(range_begin, range_end)を並列実行する.
+	// grainが0以下の場合は自動で決定する.
+	template<typename FUNC>
+	void ParallelForRange(JobSystem* job_system, s64 begin, s64 end, s64 grain, FUNC&& func)
+	{
+		if (end <= begin)
+			return;
+		if (!job_system || 0 >= job_system->GetWorkerCount())
+		{
+			func(begin, end);
+			return;
+		}
+
+		using F = std::remove_reference_t<FUNC>;
+		parallel_for_detail::ParallelForContext<F> context;
+		context.job_system = job_system;
+		context.func = &func;
+		context.grain = parallel_for_detail::ResolveGrain(job_system, end - begin, grain);
+
+		parallel_for_detail::SplitAndExecute(&context, begin, end);
+		job_system->Wait(context.counter);
+	}
+
+	// [begin, end) の各要素についてfunc(i)を並列実行する.
+	template<typename FUNC>
+	void ParallelFor(JobSystem* job_system, s64 begin, s64 end, s64 grain, FUNC&& func)
+	{
+		ParallelForRange(job_system, begin, end, grain, [&func](s64 range_begin, s64 range_end)
+			{
+				for (s64 i = range_begin; i < range_end; ++i)
+					func(i);
+			});
+	}
+
+	// [begin, end) をgrain以下の範囲に分割してmap(range_begin, range_end)を並列実行し, 結果をreduce(a, b)で集約する.
+	// 集約は範囲の順に呼び出しスレッドで行う. 範囲が空の場合はidentityを返す.
+	template<typename T, typename MAP, typename REDUCE>
+	T ParallelReduce(JobSystem* job_system, s64 begin, s64 end, s64 grain, T identity, MAP&& map, REDUCE&& reduce)
+	{
+		if (end <= begin)
+			return identity;
+		if (!job_system || 0 >= job_system->GetWorkerCount())
+			return reduce(std::move(identity), map(begin, end));
+
+		const s64 count = end - begin;
+		grain = parallel_for_detail::ResolveGrain(job_system, count, grain);
+		const s64 chunk_count = (count + grain - 1) / grain;
+
+		std::vector<T> partial(static_cast<size_t>(chunk_count), identity);
+		ParallelFor(job_system, 0, chunk_count, 1, [&](s64 chunk)
+			{
+				const s64 chunk_begin = begin + chunk * grain;
+				const s64 chunk_end = (chunk_begin + grain < end) ? (chunk_begin + grain) : end;
+				partial[static_cast<size_t>(chunk)] = map(chunk_begin, chunk_end);
+			});
+
+		T result = std::move(identity);
+		for (auto& e : partial)
+			result = reduce(std::move(result), std::move(e));
+		return result;
+	}
+}
+}
@@ -0,0 +1,255 @@
+﻿
+#include "parallel_for_test.h"
+
+#include <cmath>
+#include <chrono>
+#include <atomic>
+#include <iostream>
+#include <cstring>
+
+#include <assert.h>
+
+namespace ngl
+{
+namespace thread
+{
+namespace test
+{
+	namespace
+	{
+		using Clock = std::chrono::steady_clock;
+
+		constexpr int k_instance_count = 100000;
+		constexpr int k_frame_count = 30;
+
+		// インスタンス毎の行列とAABBの更新を模擬したインスタンス.
+		struct MockMeshInstance
+		{
+			float	transform[3][4];
+			float	transform_prev[3][4];
+			float	local_aabb_min[3];
+			float	local_aabb_max[3];
+
+			// 更新結果.
+			float	world_aabb_min[3];
+			float	world_aabb_max[3];
+			// 定数バッファ相当. 行列と余因子行列.
+			float	cb_mtx[3][4];
+			float	cb_cofactor[3][3];
+			int		flip_index;
+		};
+
+		struct Aabb
+		{
+			float	min[3];
+			float	max[3];
+		};
+
+		void InitInstance(MockMeshInstance& e, int index)
+		{
+			e = {};
+			const float s = 1.0f + (index % 7) * 0.25f;
+			for (int r = 0; r < 3; ++r)
+				e.transform[r][r] = s;
+			e.transform[0][3] = float(index % 317) * 4.0f;
+			e.transform[1][3] = float((index / 317) % 31) * 4.0f;
+			e.transform[2][3] = float(index / (317 * 31)) * 4.0f;
+			for (int a = 0; a < 3; ++a)
+			{
+				e.local_aabb_min[a] = -1.0f - (index % 3);
+				e.local_aabb_max[a] = 1.0f + (index % 5);
+			}
+		}
+
+		// 移動と行列更新. インスタンス毎に独立した処理の負荷として使用する.
+		void UpdateInstance(MockMeshInstance& e, int index, float app_sec)
+		{
+			const float move_range = (index % 10) / 10.0f;
+			e.transform[2][3] += std::sin(app_sec * 2.0f * 3.14159265f * 0.1f * (move_range + 1.0f)) * 0.075f;
+
+			bool changed = false;
+			for (int r = 0; r < 3 && !changed; ++r)
+				for (int c = 0; c < 4 && !changed; ++c)
+					changed = (e.transform[r][c] != e.transform_prev[r][c]);
+			if (!changed)
+				return;
+
+			for (int r = 0; r < 3; ++r)
+				for (int c = 0; c < 4; ++c)
+					e.transform_prev[r][c] = e.transform[r][c];
+			e.flip_index = (e.flip_index + 1) % 2;
+
+			// 定数バッファ更新.
+			const auto& m = e.transform;
+			for (int r = 0; r < 3; ++r)
+				for (int c = 0; c < 4; ++c)
+					e.cb_mtx[r][c] = m[r][c];
+			e.cb_cofactor[0][0] = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+			e.cb_cofactor[0][1] = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+			e.cb_cofactor[0][2] = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+			e.cb_cofactor[1][0] = m[0][2] * m[2][1] - m[0][1] * m[2][2];
+			e.cb_cofactor[1][1] = m[0][0] * m[2][2] - m[0][2] * m[2][0];
+			e.cb_cofactor[1][2] = m[0][1] * m[2][0] - m[0][0] * m[2][1];
+			e.cb_cofactor[2][0] = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+			e.cb_cofactor[2][1] = m[0][2] * m[1][0] - m[0][0] * m[1][2];
+			e.cb_cofactor[2][2] = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+
+			// ワールドAABB. 中心と半径を変換する.
+			for (int r = 0; r < 3; ++r)
+			{
+				float center = m[r][3];
+				float extent = 0.0f;
+				for (int c = 0; c < 3; ++c)
+				{
+					const float local_center = (e.local_aabb_min[c] + e.local_aabb_max[c]) * 0.5f;
+					const float local_extent = (e.local_aabb_max[c] - e.local_aabb_min[c]) * 0.5f;
+					center += m[r][c] * local_center;
+					extent += std::fabs(m[r][c]) * local_extent;
+				}
+				e.world_aabb_min[r] = center - extent;
+				e.world_aabb_max[r] = center + extent;
+			}
+		}
+
+		Aabb EmptyAabb()
+		{
+			return { { 1e30f, 1e30f, 1e30f }, { -1e30f, -1e30f, -1e30f } };
+		}
+		Aabb MergeAabb(const Aabb& a, const Aabb& b)
+		{
+			Aabb r;
+			for (int i = 0; i < 3; ++i)
+			{
+				r.min[i] = (a.min[i] < b.min[i]) ? a.min[i] : b.min[i];
+				r.max[i] = (a.max[i] > b.max[i]) ? a.max[i] : b.max[i];
+			}
+			return r;
+		}
+		Aabb ComputeBounds(const std::vector<MockMeshInstance>& instance, s64 begin, s64 end)
+		{
+			Aabb r = EmptyAabb();
+			for (s64 i = begin; i < end; ++i)
+			{
+				const auto& e = instance[i];
+				for (int a = 0; a < 3; ++a)
+				{
+					r.min[a] = (r.min[a] < e.world_aabb_min[a]) ? r.min[a] : e.world_aabb_min[a];
+					r.max[a] = (r.max[a] > e.world_aabb_max[a]) ? r.max[a] : e.world_aabb_max[a];
+				}
+			}
+			return r;
+		}
+
+		bool IsSameInstance(const MockMeshInstance& a, const MockMeshInstance& b)
+		{
+			return 0 == memcmp(&a, &b, sizeof(MockMeshInstance));
+		}
+		bool IsSameAabb(const Aabb& a, const Aabb& b)
+		{
+			return 0 == memcmp(&a, &b, sizeof(Aabb));
+		}
+
+		double ToMillisec(Clock::duration d)
+		{
+			return std::chrono::duration<double, std::milli>(d).count();
+		}
+	}
+
+	void ParallelForBenchmark()
+	{
+		int num_thread = static_cast<int>(std::thread::hardware_concurrency());
+		num_thread = (1 < num_thread) ? num_thread - 1 : 1;
+
+		JobSystem job_system;
+		job_system.Init(num_thread);
+
+		std::vector<MockMeshInstance> serial_instance(k_instance_count);
+		std::vector<MockMeshInstance> parallel_instance(k_instance_count);
+		std::vector<MockMeshInstance> range_instance(k_instance_count);
+		for (int i = 0; i < k_instance_count; ++i)
+		{
+			InitInstance(serial_instance[i], i);
+			InitInstance(parallel_instance[i], i);
+			InitInstance(range_instance[i], i);
+		}
+
+		int fail_count = 0;
+		Clock::duration serial_time{}, parallel_time{}, range_time{};
+		Clock::duration serial_reduce_time{}, parallel_reduce_time{};
+		for (int frame = 0; frame < k_frame_count; ++frame)
+		{
+			const float app_sec = frame * (1.0f / 60.0f);
+
+			// 逐次.
+			auto t0 = Clock::now();
+			for (int i = 0; i < k_instance_count; ++i)
+				UpdateInstance(serial_instance[i], i, app_sec);
+			auto t1 = Clock::now();
+			const Aabb serial_bounds = ComputeBounds(serial_instance, 0, k_instance_count);
+			auto t2 = Clock::now();
+
+			// 要素毎, grain自動.
+			ParallelFor(&job_system, 0, k_instance_count, 0, [&](s64 i)
+				{
+					UpdateInstance(parallel_instance[i], static_cast<int>(i), app_sec);
+				});
+			auto t3 = Clock::now();
+			const Aabb parallel_bounds = ParallelReduce(&job_system, 0, k_instance_count, 0, EmptyAabb(),
+				[&](s64 begin, s64 end) { return ComputeBounds(parallel_instance, begin, end); },
+				[](const Aabb& a, const Aabb& b) { return MergeAabb(a, b); });
+			auto t4 = Clock::now();
+
+			// 範囲毎, grain指定.
+			ParallelForRange(&job_system, 0, k_instance_count, 512, [&](s64 begin, s64 end)
+				{
+					for (s64 i = begin; i < end; ++i)
+						UpdateInstance(range_instance[i], static_cast<int>(i), app_sec);
+				});
+			auto t5 = Clock::now();
+
+			serial_time += t1 - t0;
+			serial_reduce_time += t2 - t1;
+			parallel_time += t3 - t2;
+			parallel_reduce_time += t4 - t3;
+			range_time += t5 - t4;
+
+			if (!IsSameAabb(serial_bounds, parallel_bounds))
+				++fail_count;
+		}
+		for (int i = 0; i < k_instance_count; ++i)
+		{
+			if (!IsSameInstance(serial_instance[i], parallel_instance[i]) || !IsSameInstance(serial_instance[i], range_instance[i]))
+				++fail_count;
+		}
+
+		// 各要素がちょうど一度ずつ呼ばれるか.
+		{
+			std::vector<std::atomic<int>> visit(k_instance_count);
+			for (auto& e : visit)
+				e = 0;
+			ParallelFor(&job_system, 0, k_instance_count, 1, [&](s64 i) { visit[i].fetch_add(1); });
+			for (auto& e : visit)
+			{
+				if (1 != e.load())
+					++fail_count;
+			}
+			// 空範囲, 1要素.
+			ParallelFor(&job_system, 5, 5, 0, [&](s64) { ++fail_count; });
+			const s64 single = ParallelReduce(&job_system, 7, 8, 0, s64(0), [](s64 b, s64) { return b; }, [](s64 a, s64 b) { return a + b; });
+			if (7 != single)
+				++fail_count;
+		}
+
+		const double frame_scale = 1.0 / k_frame_count;
+		std::cout << "[ParallelForBenchmark] worker " << num_thread << ", instance " << k_instance_count << ", " << k_frame_count << " frames" << std::endl;
+		std::cout << "  update serial            : " << ToMillisec(serial_time) * frame_scale << " ms/frame" << std::endl;
+		std::cout << "  update ParallelFor       : " << ToMillisec(parallel_time) * frame_scale << " ms/frame (" << (ToMillisec(serial_time) / ToMillisec(parallel_time)) << "x)" << std::endl;
+		std::cout << "  update ParallelForRange  : " << ToMillisec(range_time) * frame_scale << " ms/frame (" << (ToMillisec(serial_time) / ToMillisec(range_time)) << "x)" << std::endl;
+		std::cout << "  bounds serial            : " << ToMillisec(serial_reduce_time) * frame_scale << " ms/frame" << std::endl;
+		std::cout << "  bounds ParallelReduce    : " << ToMillisec(parallel_reduce_time) * frame_scale << " ms/frame (" << (ToMillisec(serial_reduce_time) / ToMillisec(parallel_reduce_time)) << "x)" << std::endl;
+		std::cout << "  fail " << fail_count << std::endl;
+		assert(0 == fail_count);
+	}
+}
+}
+}
@@ -0,0 +1,17 @@
+﻿#pragma once
+
+#include "parallel_for.h"
+
+
+namespace ngl
+{
+namespace thread
+{
+namespace test
+{
+	// ParallelFor, ParallelReduceのテスト.
+	// 100k個の模擬メッシュインスタンスの更新とシーンAABBの集約を逐次実行と比較して標準出力に出力し, 結果が一致するかを検証する.
+	void ParallelForBenchmark();
+}
+}
+}
@@ -0,0 +1,97 @@
+﻿#pragma once
+
+#include <atomic>
+
+#include "ngl/util/types.h"
+
+namespace ngl
+{
+namespace thread
+{
+	// Chase-Lev Work-Stealing Deque.
+	//	所有スレッドのみがPush/Popで末尾(bottom)を操作し, 他スレッドはStealで先頭(top)から取り出す.
+	//	容量は固定. Pushが失敗した場合は呼び出し側で別のキューへ退避する.
+	//	参考 : Le et al. "Correct and Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013).
+	template<typename T, u32 CAPACITY_EXP = 12>
+	class WorkStealingDeque
+	{
+	public:
+		static constexpr s64 k_capacity = s64(1) << CAPACITY_EXP;
+
+		WorkStealingDeque()
+		{
+			for (auto& e : buffer_)
+				e.store(nullptr, std::memory_order_relaxed);
+		}
+
+		// 所有スレッドのみ. 満杯の場合はfalse.
+		bool Push(T* item)
+		{
+			const s64 b = bottom_.load(std::memory_order_relaxed);
+			const s64 t = top_.load(std::memory_order_acquire);
+			if (k_capacity <= b - t)
+				return false;
+
+			buffer_[b & (k_capacity - 1)].store(item, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			bottom_.store(b + 1, std::memory_order_relaxed);
+			return true;
+		}
+
+		// 所有スレッドのみ. 最後にPushしたものから取り出す. 空ならnullptr.
+		T* Pop()
+		{
+			const s64 b = bottom_.load(std::memory_order_relaxed) - 1;
+			bottom_.store(b, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			s64 t = top_.load(std::memory_order_relaxed);
+
+			if (t > b)
+			{
+				// 空.
+				bottom_.store(b + 1, std::memory_order_relaxed);
+				return nullptr;
+			}
+
+			T* item = buffer_[b & (k_capacity - 1)].load(std::memory_order_relaxed);
+			if (t == b)
+			{
+				// 最後の一つはStealと競合するためCASで確定する.
+				if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+					item = nullptr;
+				bottom_.store(b + 1, std::memory_order_relaxed);
+			}
+			return item;
+		}
+
+		// 任意のスレッド. 最初にPushしたものから取り出す. 空もしくは競合した場合はnullptr.
+		T* Steal()
+		{
+			s64 t = top_.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			const s64 b = bottom_.load(std::memory_order_acquire);
+			if (t >= b)
+				return nullptr;
+
+			T* item = buffer_[t & (k_capacity - 1)].load(std::memory_order_relaxed);
+			if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				return nullptr;
+			return item;
+		}
+
+		// 概算の要素数.
+		s64 GetSizeApprox() const
+		{
+			const s64 b = bottom_.load(std::memory_order_relaxed);
+			const s64 t = top_.load(std::memory_order_relaxed);
+			return (b > t) ? (b - t) : 0;
+		}
+
+	private:
+		// 所有スレッドとStealするスレッドで偽共有しないようにキャッシュラインを分ける.
+		alignas(64) std::atomic<s64>	top_ = 0;
+		alignas(64) std::atomic<s64>	bottom_ = 0;
+		alignas(64) std::atomic<T*>		buffer_[k_capacity];
+	};
+}
+}
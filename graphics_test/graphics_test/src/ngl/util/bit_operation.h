@@ -10,6 +10,16 @@
 
 #define NGL_LSB_MODE
 
+// ビットスキャン命令が利用可能な環境ではそちらを利用する.
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+	#include <intrin.h>
+	#pragma intrinsic(_BitScanReverse64)
+	#pragma intrinsic(_BitScanForward64)
+	#define NGL_BIT_SCAN_INTRINSIC_MSVC
+#elif defined(__GNUC__) || defined(__clang__)
+	#define NGL_BIT_SCAN_INTRINSIC_GCC
+#endif
+
 namespace ngl
 {
 	// ビットの値が1の個数 8bit
@@ -57,6 +67,36 @@ namespace ngl
 	u64 LeastSignificantBitOnly(const u64 arg);
 
 
+	// 最上位ビットの桁を返す. ビットスキャン命令版.
+	// 命令が利用できない環境では MostSignificantBit64 にフォールバックする.
+	// arg==0 の場合は -1
+	inline s32 MostSignificantBit64Fast(u64 v)
+	{
+#if defined(NGL_BIT_SCAN_INTRINSIC_MSVC)
+		unsigned long index;
+		return _BitScanReverse64(&index, v) ? static_cast<s32>(index) : -1;
+#elif defined(NGL_BIT_SCAN_INTRINSIC_GCC)
+		return (0 != v) ? (63 - __builtin_clzll(v)) : -1;
+#else
+		return MostSignificantBit64(v);
+#endif
+	}
+	// 最下位ビットの桁を返す. ビットスキャン命令版.
+	// 命令が利用できない環境では LeastSignificantBit64 にフォールバックする.
+	// arg==0 の場合は -1
+	inline s32 LeastSignificantBit64Fast(u64 v)
+	{
+#if defined(NGL_BIT_SCAN_INTRINSIC_MSVC)
+		unsigned long index;
+		return _BitScanForward64(&index, v) ? static_cast<s32>(index) : -1;
+#elif defined(NGL_BIT_SCAN_INTRINSIC_GCC)
+		return (0 != v) ? __builtin_ctzll(v) : -1;
+#else
+		return LeastSignificantBit64(v);
+#endif
+	}
+
+
 }
 
 
@@ -2,7 +2,9 @@
 #ifndef _NGL_UTIL_INSTANCE_HANDLE
 #define _NGL_UTIL_INSTANCE_HANDLE
 
+#include <atomic>
 #include <utility>
+#include <assert.h>
 
 #include "ngl/util/types.h"
 
@@ -10,7 +12,16 @@
 
 namespace ngl
 {
-	template<typename T, u16 NUM_INSTANCE>
+	// InstanceHandleFactoryのスレッド安全性.
+	enum class InstanceHandleThreadPolicy
+	{
+		// 参照カウントとフリーリストをアトミック操作で更新する. 任意のスレッドからハンドルのコピー, 生成, 解放が可能.
+		ThreadSafe,
+		// 単一スレッドからのみ利用する. アトミック命令を使わない.
+		SingleThread,
+	};
+
+	template<typename T, u16 NUM_INSTANCE, InstanceHandleThreadPolicy POLICY>
 	class InstanceHandleFactory;
 
 
@@ -22,21 +33,24 @@ namespace ngl
 	//
 	//		TestHandle handle0;  // 既定では無効なハンドルになっている
 	//
-	//		handle0.newHandle(); // これで新しく有効なハンドルを生成
+	//		handle0.NewHandle(); // これで新しく有効なハンドルを生成
 	//
 	//		TestHandle handle1 = handle0;  // のようにするとhandle1とhandle0が同じ実体を共有する
 	//
-	//		handle0.release(); で参照カウントを減算する
+	//		handle0.Release(); で参照カウントを減算する
 	//		
 	//		参照カウントがゼロになった実態はフリーになり、新しいハンドルに割り当て可能になる
 	//
 	//		実体のクラスはデフォルトコンストラクタを持っている必要があります
+	//		実体は再利用時に再構築されません
 	//
+	//		ハンドルは実体のインデックスと世代番号を持ち, 実体がフリーになると世代番号が進むため古いハンドルは無効になる.
+	//		既定ではスレッドセーフ. 単一スレッドでのみ利用する場合はInstanceHandleThreadPolicy::SingleThreadを指定する.
 	//
-	template<typename T, u16 NUM_INSTANCE>
+	template<typename T, u16 NUM_INSTANCE, InstanceHandleThreadPolicy POLICY = InstanceHandleThreadPolicy::ThreadSafe>
 	class InstanceHandle
 	{
-		typedef InstanceHandleFactory<T, NUM_INSTANCE> Factory;
+		typedef InstanceHandleFactory<T, NUM_INSTANCE, POLICY> Factory;
 
 	public:
 		friend Factory;
@@ -49,37 +63,39 @@ namespace ngl
 		// コピーコンストラクタ
 		InstanceHandle(const InstanceHandle& obj)
 		{
-			*this = obj;
+			// コピー元が参照を持っているため実体は解放されない
+			Factory::Instance().AddRef(obj);
+			handle_id_ = obj.handle_id_;
 		}
 		// 代入
 		InstanceHandle& operator=(const InstanceHandle& obj)
 		{
-			// 今までのハンドルのカウントを減算して
-			Release();
-			
-			// 新しいハンドルをコピーして
-			handle_id_ = obj.handle_id_;
-
-
-			// 新しい方でカウント加算
-			Factory::Instance().AddRef(*this);
+			if (this != &obj)
+			{
+				// 新しい方でカウント加算してから今までのハンドルのカウントを減算
+				Factory::Instance().AddRef(obj);
+				Release();
+				handle_id_ = obj.handle_id_;
+			}
 			return *this;
 		}
 
 		// move系
-		InstanceHandle(InstanceHandle&& obj)
+		InstanceHandle(InstanceHandle&& obj) noexcept
 		{
-			*this = std::move(obj);
+			handle_id_ = obj.handle_id_;
+			obj.handle_id_ = Factory::k_invalid_id;
 		}
 		InstanceHandle & operator=(InstanceHandle&& obj) noexcept
 		{
-			// 持っていたハンドルは無効にして
-			Release();
-			// ハンドルIDだけコピーして
-			handle_id_ = obj.handle_id_;
-			// ハンドルを委譲するためobj側のハンドルは直接無効化
-			obj.handle_id_ = NUM_INSTANCE;
-			
+			if (this != &obj)
+			{
+				// 持っていたハンドルは無効にして
+				Release();
+				// ハンドルを委譲するためobj側のハンドルは直接無効化
+				handle_id_ = obj.handle_id_;
+				obj.handle_id_ = Factory::k_invalid_id;
+			}
 			return *this;
 		}
 
@@ -93,14 +109,22 @@ namespace ngl
 		{
 			return Factory::Instance().GetObject(*this);
 		}
+		const T* operator->() const
+		{
+			return Factory::Instance().GetObject(*this);
+		}
 
 		// インスタンス取得
 		T* Get()
 		{
 			return Factory::Instance().GetObject(*this);
 		}
+		const T* Get() const
+		{
+			return Factory::Instance().GetObject(*this);
+		}
 
-		bool IsValidHandle()
+		bool IsValidHandle() const
 		{
 			return Factory::Instance().IsValidHandle(*this);
 		}
@@ -117,77 +141,179 @@ namespace ngl
 		void Release()
 		{
 			// 参照カウント減算して無効なハンドルにする
-			Factory::Instance().release(*this);
-			handle_id_ = NUM_INSTANCE;
+			if (Factory::k_invalid_id != handle_id_)
+			{
+				Factory::Instance().Release(*this);
+				handle_id_ = Factory::k_invalid_id;
+			}
 		}
 
 	private:
-		u16 handle_id_	= NUM_INSTANCE;
+		// 上位16bitが世代番号, 下位16bitがインデックス.
+		u32 handle_id_	= Factory::k_invalid_id;
 	};
 
-	template<typename T, u16 NUM_INSTANCE>
-	class InstanceHandleFactory : public Singleton<InstanceHandleFactory<T, NUM_INSTANCE>>
+	// InstanceHandleの実体と参照カウントの管理.
+	//	空き実体はインデックスの連結リストで管理し, NewHandleはO(1).
+	//	実体毎の状態は上位16bitが世代番号, 下位16bitが参照カウントの32bit値.
+	//	ThreadSafeではフリーリストの先頭に更新毎に加算するタグを持たせてABA問題を防ぐ.
+	template<typename T, u16 NUM_INSTANCE, InstanceHandleThreadPolicy POLICY = InstanceHandleThreadPolicy::ThreadSafe>
+	class InstanceHandleFactory : public Singleton<InstanceHandleFactory<T, NUM_INSTANCE, POLICY>>
 	{
-		typedef InstanceHandle<T, NUM_INSTANCE> HandleType;
+		typedef InstanceHandle<T, NUM_INSTANCE, POLICY> HandleType;
 
 	public:
+		static constexpr bool k_thread_safe = (InstanceHandleThreadPolicy::ThreadSafe == POLICY);
+		static constexpr u32 k_invalid_id = ~u32(0);
+
 		InstanceHandleFactory()
 		{
+			// インデックス順に割り当てられるように連結.
 			for (u32 i = 0; i < NUM_INSTANCE; ++i)
-				ref_count_[i] = 0;
+			{
+				state_[i].store(0, std::memory_order_relaxed);
+				next_free_[i].store(i + 1, std::memory_order_relaxed);
+			}
+			free_head_.store(0, std::memory_order_relaxed);
 		}
 
 		T* GetObject(const HandleType& handle)
 		{
 			if (IsValidHandle(handle))
-				return &instance_[handle.handle_id_];
-			return NULL;
+				return &instance_[GetIndex(handle.handle_id_)];
+			return nullptr;
 		}
 
 
 		void NewHandle(HandleType& handle)
 		{
-			handle.handle_id_ = NUM_INSTANCE;
-			for (u32 i = 0; i < NUM_INSTANCE; ++i)
-			{
-				if (0 == ref_count_[i])
-				{
-					// 参照1で開始
-					ref_count_[i] = 1;
-					handle.handle_id_ = i;
-					break;
-				}
-			}
+			handle.handle_id_ = k_invalid_id;
+
+			const u32 index = PopFree();
+			if (k_null_index == index)
+				return;
+
+			// 参照1で開始. フリーの実体は他から参照されないためstoreのみ.
+			const u32 generation = GetGeneration(state_[index].load(std::memory_order_relaxed));
+			state_[index].store(MakeState(generation, 1), std::memory_order_relaxed);
+			handle.handle_id_ = MakeId(generation, index);
 		}
-		bool IsValidHandle(const HandleType& handle)
+		bool IsValidHandle(const HandleType& handle) const
 		{
-			if (NUM_INSTANCE > handle.handle_id_ && 1 <= ref_count_[handle.handle_id_])
-				return true;
-			return false;
+			const u32 index = GetIndex(handle.handle_id_);
+			if (NUM_INSTANCE <= index)
+				return false;
+			const u32 state = state_[index].load(std::memory_order_relaxed);
+			return (GetGeneration(state) == GetGeneration(handle.handle_id_)) && (0 < GetRefCount(state));
 		}
 		// 参照カウント加算
 		void AddRef(const HandleType& handle)
 		{
 			if (IsValidHandle(handle))
 			{
-				++ref_count_[handle.handle_id_];
+				auto& state = state_[GetIndex(handle.handle_id_)];
+				if constexpr (k_thread_safe)
+				{
+					const u32 prev = state.fetch_add(1, std::memory_order_relaxed);
+					assert(k_ref_count_mask > GetRefCount(prev));
+				}
+				else
+				{
+					const u32 prev = state.load(std::memory_order_relaxed);
+					assert(k_ref_count_mask > GetRefCount(prev));
+					state.store(prev + 1, std::memory_order_relaxed);
+				}
 			}
 		}
 		// 参照カウント減算
-		void release(const HandleType& handle)
+		void Release(const HandleType& handle)
 		{
 			if (IsValidHandle(handle))
 			{
-				if (0 == --ref_count_[handle.handle_id_])
+				const u32 index = GetIndex(handle.handle_id_);
+				auto& state = state_[index];
+				u32 prev;
+				if constexpr (k_thread_safe)
+				{
+					prev = state.fetch_sub(1, std::memory_order_acq_rel);
+				}
+				else
+				{
+					prev = state.load(std::memory_order_relaxed);
+					state.store(prev - 1, std::memory_order_relaxed);
+				}
+
+				if (1 == GetRefCount(prev))
+				{
+					// 参照がゼロになった. 世代番号を進めてフリーリストに戻す.
+					state.store(MakeState(GetGeneration(prev) + 1, 0), std::memory_order_relaxed);
+					PushFree(index);
+				}
+			}
+		}
+
+	private:
+		static constexpr u32 k_index_bits = 16;
+		static constexpr u32 k_index_mask = (u32(1) << k_index_bits) - 1;
+		static constexpr u32 k_ref_count_mask = k_index_mask;
+		static constexpr u32 k_null_index = NUM_INSTANCE;
+
+		static u32 GetIndex(u32 id) { return id & k_index_mask; }
+		static u32 GetGeneration(u32 v) { return v >> k_index_bits; }
+		static u32 GetRefCount(u32 state) { return state & k_ref_count_mask; }
+		static u32 MakeId(u32 generation, u32 index) { return (generation << k_index_bits) | index; }
+		static u32 MakeState(u32 generation, u32 ref_count) { return (generation << k_index_bits) | ref_count; }
+
+		// フリーリスト先頭. 上位32bitがタグ, 下位32bitがインデックス.
+		u32 PopFree()
+		{
+			u64 old = free_head_.load(std::memory_order_acquire);
+			while (true)
+			{
+				const u32 index = static_cast<u32>(old);
+				if (k_null_index == index)
+					return k_null_index;
+
+				const u64 next = ((old >> 32) + 1) << 32 | next_free_[index].load(std::memory_order_relaxed);
+				if constexpr (k_thread_safe)
+				{
+					// 他スレッドが先にPopしてPushし直していてもタグが異なるためCASは失敗する.
+					if (free_head_.compare_exchange_weak(old, next, std::memory_order_acquire, std::memory_order_acquire))
+						return index;
+				}
+				else
+				{
+					free_head_.store(next, std::memory_order_relaxed);
+					return index;
+				}
+			}
+		}
+		void PushFree(u32 index)
+		{
+			u64 old = free_head_.load(std::memory_order_relaxed);
+			while (true)
+			{
+				next_free_[index].store(static_cast<u32>(old), std::memory_order_relaxed);
+				const u64 head = ((old >> 32) + 1) << 32 | index;
+				if constexpr (k_thread_safe)
+				{
+					if (free_head_.compare_exchange_weak(old, head, std::memory_order_release, std::memory_order_relaxed))
+						return;
+				}
+				else
 				{
-					// 参照がゼロになった
+					free_head_.store(head, std::memory_order_relaxed);
+					return;
 				}
 			}
 		}
 
 	private:
+		std::atomic<u64>	free_head_ = 0;
+		std::atomic<u32>	state_[NUM_INSTANCE];
+		std::atomic<u32>	next_free_[NUM_INSTANCE];
+
 		T	instance_[NUM_INSTANCE]		= {};
-		u16	ref_count_[NUM_INSTANCE]	= {};
 	};
 }
 
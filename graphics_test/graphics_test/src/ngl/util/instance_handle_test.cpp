@@ -0,0 +1,228 @@
+﻿
+#include "instance_handle_test.h"
+
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <iostream>
+
+#include <assert.h>
+
+namespace ngl
+{
+namespace test
+{
+	namespace
+	{
+		using Clock = std::chrono::steady_clock;
+
+		constexpr u16 k_num_instance = 4096;
+		constexpr int k_loop_count = 1000000;
+
+		// テスト用の実体. Factoryは型毎のシングルトンのため用途毎に型を分ける.
+		template<int ID>
+		struct TestObject
+		{
+			u32	owner = 0;
+			u32	value = 0;
+		};
+
+		// 旧実装の生成, 解放. 先頭から空きを線形探索する.
+		class LegacyInstanceFactory
+		{
+		public:
+			u32 NewHandle()
+			{
+				for (u32 i = 0; i < k_num_instance; ++i)
+				{
+					if (0 == ref_count_[i])
+					{
+						ref_count_[i] = 1;
+						return i;
+					}
+				}
+				return k_num_instance;
+			}
+			void Release(u32 id)
+			{
+				if (k_num_instance > id && 0 < ref_count_[id])
+					--ref_count_[id];
+			}
+
+		private:
+			u16	ref_count_[k_num_instance] = {};
+		};
+
+		double ToNanoSecPerOp(Clock::duration d, int op_count)
+		{
+			return std::chrono::duration<double, std::nano>(d).count() / op_count;
+		}
+
+		template<typename HANDLE>
+		int TestFunction()
+		{
+			int fail_count = 0;
+
+			HANDLE h0;
+			if (h0.IsValidHandle())
+				++fail_count;
+			if (!h0.NewHandle())
+				++fail_count;
+			h0->value = 123;
+
+			// コピーは同じ実体を共有する.
+			HANDLE h1 = h0;
+			h1 = h1;
+			if (!h1.IsValidHandle() || h0.Get() != h1.Get() || 123 != h1->value)
+				++fail_count;
+
+			// ムーブ元は無効になる.
+			HANDLE h2 = std::move(h1);
+			if (h1.IsValidHandle() || h2.Get() != h0.Get())
+				++fail_count;
+
+			// 全参照の解放で実体はフリーになる.
+			h0.Release();
+			if (!h2.IsValidHandle())
+				++fail_count;
+			h2.Release();
+			if (h2.IsValidHandle() || nullptr != h2.Get())
+				++fail_count;
+
+			// 枯渇時は無効なハンドル.
+			{
+				std::vector<HANDLE> handle_array(k_num_instance);
+				for (auto& e : handle_array)
+				{
+					if (!e.NewHandle())
+						++fail_count;
+				}
+				HANDLE over;
+				if (over.NewHandle())
+					++fail_count;
+
+				handle_array[k_num_instance / 2].Release();
+				if (!over.NewHandle())
+					++fail_count;
+			}
+			return fail_count;
+		}
+
+		// 半数の実体を保持した状態で生成と解放を繰り返す.
+		template<typename HANDLE>
+		double BenchmarkSingleThread()
+		{
+			std::vector<HANDLE> keep(k_num_instance / 2);
+			for (auto& e : keep)
+				e.NewHandle();
+
+			HANDLE h;
+			const auto t0 = Clock::now();
+			for (int i = 0; i < k_loop_count; ++i)
+			{
+				h.NewHandle();
+				HANDLE copy = h;
+				h.Release();
+			}
+			return ToNanoSecPerOp(Clock::now() - t0, k_loop_count);
+		}
+		double BenchmarkLegacy()
+		{
+			static LegacyInstanceFactory factory;
+			for (u32 i = 0; i < k_num_instance / 2; ++i)
+				factory.NewHandle();
+
+			const auto t0 = Clock::now();
+			for (int i = 0; i < k_loop_count; ++i)
+			{
+				const u32 id = factory.NewHandle();
+				factory.Release(id);
+			}
+			return ToNanoSecPerOp(Clock::now() - t0, k_loop_count);
+		}
+
+		// 複数スレッドから生成, コピー, 解放を繰り返し, 実体が重複して割り当てられないことを検証する.
+		int BenchmarkMultiThread(int num_thread, double& out_ns_per_op)
+		{
+			using Handle = InstanceHandle<TestObject<2>, k_num_instance>;
+			constexpr int k_handle_per_thread = 64;
+			const int loop_per_thread = k_loop_count / num_thread / k_handle_per_thread;
+
+			std::atomic<int> fail_count = 0;
+			std::vector<std::thread> threads;
+			const auto t0 = Clock::now();
+			for (int t = 0; t < num_thread; ++t)
+			{
+				threads.emplace_back([&, t]
+					{
+						std::vector<Handle> handle_array(k_handle_per_thread);
+						std::vector<Handle> copy_array(k_handle_per_thread);
+						for (int loop = 0; loop < loop_per_thread; ++loop)
+						{
+							for (int i = 0; i < k_handle_per_thread; ++i)
+							{
+								if (!handle_array[i].NewHandle())
+								{
+									++fail_count;
+									continue;
+								}
+								handle_array[i]->owner = t;
+								handle_array[i]->value = i;
+								copy_array[i] = handle_array[i];
+							}
+							for (int i = 0; i < k_handle_per_thread; ++i)
+							{
+								// 他スレッドに割り当てられていれば書き換わる.
+								if (copy_array[i].Get() && (copy_array[i]->owner != static_cast<u32>(t) || copy_array[i]->value != static_cast<u32>(i)))
+									++fail_count;
+								handle_array[i].Release();
+							}
+							for (auto& e : copy_array)
+								e.Release();
+						}
+					});
+			}
+			for (auto& e : threads)
+				e.join();
+			const auto t1 = Clock::now();
+			out_ns_per_op = ToNanoSecPerOp(t1 - t0, loop_per_thread * k_handle_per_thread * num_thread);
+
+			// 全て解放されていれば全実体を生成できる.
+			{
+				std::vector<Handle> handle_array(k_num_instance);
+				for (auto& e : handle_array)
+				{
+					if (!e.NewHandle())
+						++fail_count;
+				}
+			}
+			return fail_count.load();
+		}
+	}
+
+	void InstanceHandleBenchmark()
+	{
+		int fail_count = 0;
+		fail_count += TestFunction<InstanceHandle<TestObject<0>, k_num_instance>>();
+		fail_count += TestFunction<InstanceHandle<TestObject<0>, k_num_instance, InstanceHandleThreadPolicy::SingleThread>>();
+
+		const double legacy_ns = BenchmarkLegacy();
+		const double single_ns = BenchmarkSingleThread<InstanceHandle<TestObject<1>, k_num_instance, InstanceHandleThreadPolicy::SingleThread>>();
+		const double thread_safe_ns = BenchmarkSingleThread<InstanceHandle<TestObject<1>, k_num_instance, InstanceHandleThreadPolicy::ThreadSafe>>();
+		std::cout << "[InstanceHandleBenchmark] new/release with " << (k_num_instance / 2) << " live handles" << std::endl;
+		std::cout << "	legacy linear search : " << legacy_ns << " ns/op" << std::endl;
+		std::cout << "	SingleThread         : " << single_ns << " ns/op" << std::endl;
+		std::cout << "	ThreadSafe           : " << thread_safe_ns << " ns/op" << std::endl;
+
+		for (int num_thread : { 1, 2, 4, 8 })
+		{
+			double ns_per_op = 0.0;
+			fail_count += BenchmarkMultiThread(num_thread, ns_per_op);
+			std::cout << "	ThreadSafe " << num_thread << " threads : " << ns_per_op << " ns/op" << std::endl;
+		}
+
+		std::cout << "	fail " << fail_count << std::endl;
+		assert(0 == fail_count);
+	}
+}
+}
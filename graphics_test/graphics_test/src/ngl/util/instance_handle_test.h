@@ -0,0 +1,14 @@
+﻿#pragma once
+
+#include "instance_handle.h"
+
+
+namespace ngl
+{
+namespace test
+{
+	// InstanceHandleのテスト.
+	// 生成, コピー, ムーブ, 枯渇時の挙動を検証し, 旧実装の線形探索と比較した生成解放の速度と, 複数スレッドからの生成解放の速度を標準出力に出力する.
+	void InstanceHandleBenchmark();
+}
+}
@@ -5,14 +5,52 @@
 
 //
 //	参照カウンタ
-//		既定のnew/deleteを使用しているがそのうちAllocator指定したい
+//		カウンタ実体はアロケータを指定して確保できる. 未指定の場合は既定のnew/deleteを使用する.
+//		アロケータは void* Allocate(u64 size) と Deallocate(void* p) を持つ型で, TlsfAllocatorCoreやTlsfConcurrentAllocatorがそのまま利用できる.
+//		確保されるメモリのアライメントは16以上を前提とする.
+//		カウンタ実体は最後の参照を解放したスレッドでアロケータに返却されるため, アロケータのスレッド安全性は利用側で保証すること.
 //
 
+#include <cstddef>
+#include <new>
+#include <atomic>
+#include <utility>
+
 #include "types.h"
 
 namespace ngl
 {
+	// 参照カウントの更新方式.
+	enum class RefCountPolicy
+	{
+		// アトミック操作で更新する. 任意のスレッドから参照のコピーと破棄が可能.
+		Atomic,
+		// 単一スレッドからのみ利用する. アトミック命令を使わない.
+		NonAtomic,
+	};
+
+	// アロケータ未指定時のカウンタ実体確保用.
+	class RefCountDefaultAllocator
+	{
+	public:
+		void* Allocate(u64 size)
+		{
+			return ::operator new(static_cast<size_t>(size));
+		}
+		void Deallocate(void* p)
+		{
+			::operator delete(p);
+		}
+
+		static RefCountDefaultAllocator* Instance()
+		{
+			static RefCountDefaultAllocator instance;
+			return &instance;
+		}
+	};
+
 	// 参照カウンタ基底
+	template<RefCountPolicy POLICY = RefCountPolicy::Atomic>
 	class RefCountCoreBase
 	{
 	public:
@@ -27,35 +65,59 @@ namespace ngl
 		// 参照カウント加算
 		void AddRef()
 		{
-			++count_;
+			if constexpr (RefCountPolicy::Atomic == POLICY)
+			{
+				count_.fetch_add(1, std::memory_order_relaxed);
+			}
+			else
+			{
+				count_.store(count_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			}
 		}
 		void release()
 		{
-			if (--count_ == 0)
+			s32 prev;
+			if constexpr (RefCountPolicy::Atomic == POLICY)
+			{
+				prev = count_.fetch_sub(1, std::memory_order_acq_rel);
+			}
+			else
+			{
+				prev = count_.load(std::memory_order_relaxed);
+				count_.store(prev - 1, std::memory_order_relaxed);
+			}
+
+			if (1 == prev)
 			{
 				// 管理ポインタの実削除処理
 				Dispose();
 				// 参照カウンタの削除
-				delete this;
+				Destroy();
 			}
 		}
+		s32 GetCount() const
+		{
+			return count_.load(std::memory_order_relaxed);
+		}
 		// 実削除処理
 		virtual void Dispose() = 0;
+		// カウンタ自身の削除処理
+		virtual void Destroy() = 0;
 
 		virtual void* Get() = 0;
 
 	private:
-		s32 count_;
+		std::atomic<s32> count_;
 	};
 
-	// 参照カウンタ実装
-	template<typename T, typename DeleterT>
+	// 参照カウンタ実装. 管理ポインタをDeleterで削除する.
+	template<typename T, typename DeleterT, typename ALLOCATOR, RefCountPolicy POLICY>
 	class RefCountCoreImplDel
-		: public RefCountCoreBase
+		: public RefCountCoreBase<POLICY>
 	{
 	public:
-		RefCountCoreImplDel(T* ptr, DeleterT deleter)
-			: ptr_(ptr), deleter_(deleter)
+		RefCountCoreImplDel(T* ptr, DeleterT deleter, ALLOCATOR* allocator)
+			: ptr_(ptr), deleter_(deleter), allocator_(allocator)
 		{
 		}
 		void Dispose() override
@@ -63,6 +125,12 @@ namespace ngl
 			// Deleterで削除
 			deleter_(ptr_);
 		}
+		void Destroy() override
+		{
+			ALLOCATOR* allocator = allocator_;
+			this->~RefCountCoreImplDel();
+			allocator->Deallocate(this);
+		}
 		void* Get() override
 		{
 			return ptr_;
@@ -70,10 +138,47 @@ namespace ngl
 	private:
 		T* ptr_;
 		DeleterT deleter_;
+		ALLOCATOR* allocator_;
+	};
+
+	// 参照カウンタ実装. 管理オブジェクトをカウンタと同じメモリに配置する. MakeShared用.
+	template<typename T, typename ALLOCATOR, RefCountPolicy POLICY>
+	class RefCountCoreImplInplace
+		: public RefCountCoreBase<POLICY>
+	{
+	public:
+		template<typename... ARGS>
+		RefCountCoreImplInplace(ALLOCATOR* allocator, ARGS&&... args)
+			: allocator_(allocator)
+		{
+			new(storage_) T(std::forward<ARGS>(args)...);
+		}
+		void Dispose() override
+		{
+			GetObject()->~T();
+		}
+		void Destroy() override
+		{
+			ALLOCATOR* allocator = allocator_;
+			this->~RefCountCoreImplInplace();
+			allocator->Deallocate(this);
+		}
+		void* Get() override
+		{
+			return GetObject();
+		}
+		T* GetObject()
+		{
+			return reinterpret_cast<T*>(storage_);
+		}
+	private:
+		ALLOCATOR* allocator_;
+		alignas(T) u8 storage_[sizeof(T)];
 	};
 
 
 	// 参照カウンタ
+	template<RefCountPolicy POLICY = RefCountPolicy::Atomic>
 	class SharedCount
 	{
 	public:
@@ -85,7 +190,29 @@ namespace ngl
 		// デリータ有り
 		template<typename T, typename DeleterT>
 		SharedCount(T* ptr, DeleterT deleter)
-			: count_(new RefCountCoreImplDel<T, DeleterT>(ptr, deleter))
+			: SharedCount(ptr, deleter, RefCountDefaultAllocator::Instance())
+		{
+		}
+		// デリータ, カウンタ確保用アロケータ有り
+		template<typename T, typename DeleterT, typename ALLOCATOR>
+		SharedCount(T* ptr, DeleterT deleter, ALLOCATOR* allocator)
+			: count_(nullptr)
+		{
+			using Impl = RefCountCoreImplDel<T, DeleterT, ALLOCATOR, POLICY>;
+			void* mem = allocator->Allocate(sizeof(Impl));
+			if (mem)
+			{
+				count_ = new(mem) Impl(ptr, deleter, allocator);
+			}
+			else
+			{
+				// カウンタを確保できなければ管理ポインタは即時削除
+				deleter(ptr);
+			}
+		}
+		// 確保済みのカウンタ実体を引き取る
+		explicit SharedCount(RefCountCoreBase<POLICY>* count)
+			: count_(count)
 		{
 		}
 
@@ -102,6 +229,11 @@ namespace ngl
 			if (count_)
 				count_->AddRef();
 		}
+		SharedCount(SharedCount&& sc) noexcept
+			: count_(sc.count_)
+		{
+			sc.count_ = nullptr;
+		}
 
 		// 既存をデクリメント、ソース側をインクリメント
 		SharedCount& operator=(SharedCount const& sc)
@@ -116,6 +248,17 @@ namespace ngl
 			}
 			return *this;
 		}
+		SharedCount& operator=(SharedCount&& sc) noexcept
+		{
+			if (this != &sc)
+			{
+				if (count_)
+					count_->release();
+				count_ = sc.count_;
+				sc.count_ = nullptr;
+			}
+			return *this;
+		}
 
 		// 参照取得
 		template<typename T>
@@ -126,10 +269,19 @@ namespace ngl
 			else
 				return NULL;
 		}
+		// 参照数
+		s32 GetCount() const
+		{
+			return (count_) ? count_->GetCount() : 0;
+		}
+		bool IsValid() const
+		{
+			return nullptr != count_;
+		}
 
 	private:
 		// カウンタ実部
-		RefCountCoreBase* count_;
+		RefCountCoreBase<POLICY>* count_;
 	};
 
 }
@@ -1,6 +1,13 @@
 ﻿#pragma once
 
-//		既定のnew/deleteを使用しているがそのうちAllocator指定したい
+//	共有ポインタ
+//		カウンタ実体は既定ではnew/deleteで確保する. アロケータを指定した場合はそのアロケータから確保する(shared_count.h参照).
+//		MakeShared, AllocateSharedはオブジェクトとカウンタを一つのメモリに配置するため確保は一回.
+//		RefCountPolicy::NonAtomicを指定すると参照カウントをアトミック命令無しで更新する. 単一スレッドでのみ利用すること.
+//
+//		ngl::SharedPtr<Foo> p0 = ngl::MakeShared<Foo>(arg0, arg1);
+//		ngl::SharedPtr<Foo> p1 = ngl::AllocateShared<Foo>(&tlsf_allocator_core, arg0, arg1);
+//		ngl::SharedPtr<Foo, ngl::RefCountPolicy::NonAtomic> p2 = ngl::MakeShared<Foo, ngl::RefCountPolicy::NonAtomic>();
 
 #include "shared_count.h"
 
@@ -12,12 +19,21 @@ namespace ngl
 	{
 	public:
 		typedef T* TypePtr;
+		typedef T& TypeRef;
 	};
 	template<typename T>
 	class SharedPtrTypeDef<T[]>
 	{
 	public:
 		typedef T* TypePtr;
+		typedef T& TypeRef;
+	};
+	template<>
+	class SharedPtrTypeDef<void>
+	{
+	public:
+		typedef void* TypePtr;
+		typedef void TypeRef;
 	};
 
 	// デフォルトデリータ
@@ -42,18 +58,28 @@ namespace ngl
 		}
 	};
 
+	template<typename T, RefCountPolicy POLICY>
+	class SharedPtr;
+
+	template<typename T, RefCountPolicy POLICY = RefCountPolicy::Atomic, typename ALLOCATOR, typename... ARGS>
+	SharedPtr<T, POLICY> AllocateShared(ALLOCATOR* allocator, ARGS&&... args);
+
 	// 共有ポインタ
-	template<typename T>
+	template<typename T, RefCountPolicy POLICY = RefCountPolicy::Atomic>
 	class SharedPtr
 	{
 	public:
-		typename typedef SharedPtrTypeDef<T>::TypePtr TypePtr;
-		typename typedef SharedPtrDeleter<T> DefaultDeleterT;
+		typedef typename SharedPtrTypeDef<T>::TypePtr TypePtr;
+		typedef typename SharedPtrTypeDef<T>::TypeRef TypeRef;
+		typedef SharedPtrDeleter<T> DefaultDeleterT;
 
 		// 任意の型のSharedPtrにメンバ公開
-		template<typename U>
+		template<typename U, RefCountPolicy P>
 		friend class SharedPtr;
 
+		template<typename U, RefCountPolicy P, typename ALLOCATOR, typename... ARGS>
+		friend SharedPtr<U, P> AllocateShared(ALLOCATOR* allocator, ARGS&&... args);
+
 	public:
 
 		SharedPtr()
@@ -63,29 +89,78 @@ namespace ngl
 		template<typename U>
 		SharedPtr(U* ptr)
 			: count_(ptr, DefaultDeleterT())
-			, ptr_(ptr)
+			, ptr_(count_.IsValid() ? ptr : nullptr)
 		{
 		}
 		template<typename U, typename DeleterT>
 		SharedPtr(U* ptr, DeleterT deleter)
 			: count_(ptr, deleter)
-			, ptr_(ptr)
+			, ptr_(count_.IsValid() ? ptr : nullptr)
+		{
+		}
+		// カウンタをallocatorから確保する
+		template<typename U, typename DeleterT, typename ALLOCATOR>
+		SharedPtr(U* ptr, DeleterT deleter, ALLOCATOR* allocator)
+			: count_(ptr, deleter, allocator)
+			, ptr_(count_.IsValid() ? ptr : nullptr)
 		{
 		}
 
 		// コピーコンストラクタ
+		SharedPtr(SharedPtr const& sp)
+			: count_(sp.count_)
+			, ptr_(sp.ptr_)
+		{
+		}
 		template<typename U>
-		SharedPtr(SharedPtr<U> const& sp)
+		SharedPtr(SharedPtr<U, POLICY> const& sp)
 			: count_(sp.count_)
 			, ptr_(sp.ptr_)
 		{
 		}
+		// ムーブ. 参照カウントは変化しない
+		SharedPtr(SharedPtr&& sp) noexcept
+			: count_(std::move(sp.count_))
+			, ptr_(sp.ptr_)
+		{
+			sp.ptr_ = nullptr;
+		}
+		template<typename U>
+		SharedPtr(SharedPtr<U, POLICY>&& sp) noexcept
+			: count_(std::move(sp.count_))
+			, ptr_(sp.ptr_)
+		{
+			sp.ptr_ = nullptr;
+		}
 
+		SharedPtr& operator=(SharedPtr const& sp)
+		{
+			count_ = sp.count_;
+			ptr_ = sp.ptr_;
+			return *this;
+		}
+		SharedPtr& operator=(SharedPtr&& sp) noexcept
+		{
+			if (this != &sp)
+			{
+				count_ = std::move(sp.count_);
+				ptr_ = sp.ptr_;
+				sp.ptr_ = nullptr;
+			}
+			return *this;
+		}
+
+		template<typename U, typename DeleterT, typename ALLOCATOR>
+		void Reset(U* ptr, DeleterT deleter, ALLOCATOR* allocator)
+		{
+			count_ = SharedCount<POLICY>(ptr, deleter, allocator);
+			ptr_ = count_.IsValid() ? ptr : nullptr;
+		}
 		template<typename U, typename DeleterT>
 		void Reset(U* ptr, DeleterT deleter)
 		{
-			count_ = SharedCount( ptr, deleter );
-			ptr_ = ptr;
+			count_ = SharedCount<POLICY>( ptr, deleter );
+			ptr_ = count_.IsValid() ? ptr : nullptr;
 		}
 		template<typename U>
 		void Reset(U* ptr)
@@ -94,23 +169,68 @@ namespace ngl
 		}
 		void Reset()
 		{
-			Reset(nullptr, DefaultDeleterT());
+			count_ = SharedCount<POLICY>();
+			ptr_ = nullptr;
 		}
 
 		TypePtr operator->() const
 		{
 			return ptr_;
 		}
+		TypeRef operator*() const
+		{
+			return *ptr_;
+		}
 
 		TypePtr get() const
 		{
 			return ptr_;
 		}
 
+		explicit operator bool() const
+		{
+			return nullptr != ptr_;
+		}
+
+		// 参照数
+		s32 UseCount() const
+		{
+			return count_.GetCount();
+		}
+
+	private:
+		SharedPtr(SharedCount<POLICY>&& count, TypePtr ptr)
+			: count_(std::move(count))
+			, ptr_(ptr)
+		{
+		}
+
 	private:
-		SharedCount count_		= {};
+		SharedCount<POLICY> count_		= {};
 
 		// 外部アクセス用
 		TypePtr			ptr_	= nullptr;
 	};
+
+
+	// オブジェクトとカウンタをallocatorから一度に確保して構築する. 確保に失敗した場合は空を返す.
+	template<typename T, RefCountPolicy POLICY, typename ALLOCATOR, typename... ARGS>
+	SharedPtr<T, POLICY> AllocateShared(ALLOCATOR* allocator, ARGS&&... args)
+	{
+		using Impl = RefCountCoreImplInplace<T, ALLOCATOR, POLICY>;
+		static_assert(alignof(Impl) <= 16, "AllocateShared supports alignment up to 16.");
+
+		void* mem = allocator->Allocate(sizeof(Impl));
+		if (!mem)
+			return SharedPtr<T, POLICY>();
+		Impl* impl = new(mem) Impl(allocator, std::forward<ARGS>(args)...);
+		return SharedPtr<T, POLICY>(SharedCount<POLICY>(impl), impl->GetObject());
+	}
+
+	// オブジェクトとカウンタを既定のnew/deleteで一度に確保して構築する.
+	template<typename T, RefCountPolicy POLICY = RefCountPolicy::Atomic, typename... ARGS>
+	SharedPtr<T, POLICY> MakeShared(ARGS&&... args)
+	{
+		return AllocateShared<T, POLICY>(RefCountDefaultAllocator::Instance(), std::forward<ARGS>(args)...);
+	}
 }
@@ -0,0 +1,192 @@
+﻿
+#include "shared_ptr_test.h"
+
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <iostream>
+
+#include <assert.h>
+
+#include "ngl/memory/tlsf_allocator_core.h"
+
+namespace ngl
+{
+namespace test
+{
+	namespace
+	{
+		using Clock = std::chrono::steady_clock;
+
+		constexpr int k_object_count = 100000;
+		constexpr int k_copy_count = 8;
+
+		int s_live_count = 0;
+
+		struct TestBase
+		{
+			TestBase(int v) : value(v) { ++s_live_count; }
+			virtual ~TestBase() { --s_live_count; }
+
+			int	value = 0;
+		};
+		struct TestDerived : public TestBase
+		{
+			TestDerived(int v, float f) : TestBase(v), value_f(f) {}
+
+			float	value_f = 0.0f;
+		};
+
+		// 確保数を数えるTLSFアロケータ.
+		class CountingTlsfAllocator
+		{
+		public:
+			CountingTlsfAllocator(u64 size)
+				: memory_(new u8[size])
+			{
+				core_.Initialize(memory_, size);
+			}
+			~CountingTlsfAllocator()
+			{
+				core_.Destroy();
+				delete[] memory_;
+			}
+
+			void* Allocate(u64 size)
+			{
+				++allocate_count_;
+				return core_.Allocate(size);
+			}
+			void Deallocate(void* p)
+			{
+				++deallocate_count_;
+				core_.Deallocate(p);
+			}
+
+			memory::TlsfAllocatorCore	core_;
+			u8*		memory_ = nullptr;
+			int		allocate_count_ = 0;
+			int		deallocate_count_ = 0;
+		};
+
+		double ToMillisec(Clock::duration d)
+		{
+			return std::chrono::duration<double, std::milli>(d).count();
+		}
+
+		int TestFunction()
+		{
+			int fail_count = 0;
+			{
+				SharedPtr<TestBase> p0 = MakeShared<TestDerived>(1, 2.0f);
+				SharedPtr<TestBase> p1 = p0;
+				SharedPtr<TestBase> p2 = std::move(p1);
+				p0 = p0;
+				if (p1 || !p0 || p0.get() != p2.get() || 2 != p0.UseCount() || 1 != p0->value || 1 != s_live_count)
+					++fail_count;
+
+				p0.Reset();
+				p2.Reset(new TestBase(3));
+				if (1 != s_live_count || 3 != (*p2).value)
+					++fail_count;
+			}
+			if (0 != s_live_count)
+				++fail_count;
+
+			// デリータ, 配列.
+			{
+				int delete_count = 0;
+				{
+					SharedPtr<TestBase> p(new TestBase(0), [&delete_count](TestBase* p) { ++delete_count; delete p; });
+					SharedPtr<TestBase> copy = p;
+					SharedPtr<int[]> array(new int[16]);
+					array.get()[15] = 1;
+				}
+				if (1 != delete_count || 0 != s_live_count)
+					++fail_count;
+			}
+
+			// アロケータ指定. MakeSharedはオブジェクトとカウンタで確保一回.
+			{
+				CountingTlsfAllocator allocator(1024 * 1024);
+				{
+					SharedPtr<TestBase> p0 = AllocateShared<TestDerived>(&allocator, 1, 2.0f);
+					SharedPtr<TestBase> p1(new TestBase(2), SharedPtrDeleter<TestBase>(), &allocator);
+					SharedPtr<TestBase, RefCountPolicy::NonAtomic> p2 = AllocateShared<TestBase, RefCountPolicy::NonAtomic>(&allocator, 3);
+					SharedPtr<TestBase, RefCountPolicy::NonAtomic> p3 = p2;
+					if (3 != allocator.allocate_count_ || 3 != s_live_count || 2 != p3.UseCount())
+						++fail_count;
+				}
+				if (3 != allocator.deallocate_count_ || 0 != s_live_count)
+					++fail_count;
+			}
+			return fail_count;
+		}
+
+		struct BenchmarkResult
+		{
+			double	create_ms = 0.0;
+			double	copy_ms = 0.0;
+			double	destroy_ms = 0.0;
+		};
+
+		// 生成, 参照のコピー, 全参照の破棄の時間.
+		template<typename PTR, typename CREATE>
+		BenchmarkResult Benchmark(CREATE create)
+		{
+			BenchmarkResult result;
+
+			std::vector<PTR> ptr_array;
+			ptr_array.reserve(k_object_count);
+			std::vector<PTR> copy_array;
+			copy_array.reserve(k_object_count * k_copy_count);
+
+			const auto t0 = Clock::now();
+			for (int i = 0; i < k_object_count; ++i)
+				ptr_array.push_back(create(i));
+			const auto t1 = Clock::now();
+			for (int c = 0; c < k_copy_count; ++c)
+				for (auto& e : ptr_array)
+					copy_array.push_back(e);
+			const auto t2 = Clock::now();
+			copy_array.clear();
+			ptr_array.clear();
+			const auto t3 = Clock::now();
+
+			result.create_ms = ToMillisec(t1 - t0);
+			result.copy_ms = ToMillisec(t2 - t1);
+			result.destroy_ms = ToMillisec(t3 - t2);
+			return result;
+		}
+
+		void PrintResult(const char* name, const BenchmarkResult& r)
+		{
+			std::cout << "	" << name << " : create " << r.create_ms << " ms, copy " << r.copy_ms << " ms, destroy " << r.destroy_ms << " ms" << std::endl;
+		}
+	}
+
+	void SharedPtrBenchmark()
+	{
+		int fail_count = TestFunction();
+
+		CountingTlsfAllocator allocator(64 * 1024 * 1024);
+
+		const auto new_result = Benchmark<SharedPtr<TestBase>>([](int i) { return SharedPtr<TestBase>(new TestBase(i)); });
+		const auto make_result = Benchmark<SharedPtr<TestBase>>([](int i) { return MakeShared<TestBase>(i); });
+		const auto tlsf_result = Benchmark<SharedPtr<TestBase>>([&allocator](int i) { return AllocateShared<TestBase>(&allocator, i); });
+		const auto non_atomic_result = Benchmark<SharedPtr<TestBase, RefCountPolicy::NonAtomic>>([&allocator](int i) { return AllocateShared<TestBase, RefCountPolicy::NonAtomic>(&allocator, i); });
+		const auto std_result = Benchmark<std::shared_ptr<TestBase>>([](int i) { return std::make_shared<TestBase>(i); });
+		if (0 != s_live_count || allocator.allocate_count_ != allocator.deallocate_count_ || 2 * k_object_count != allocator.allocate_count_)
+			++fail_count;
+
+		std::cout << "[SharedPtrBenchmark] " << k_object_count << " objects, " << k_copy_count << " copies each" << std::endl;
+		PrintResult("SharedPtr(new)               ", new_result);
+		PrintResult("MakeShared                   ", make_result);
+		PrintResult("AllocateShared TLSF          ", tlsf_result);
+		PrintResult("AllocateShared TLSF NonAtomic", non_atomic_result);
+		PrintResult("std::make_shared             ", std_result);
+		std::cout << "	fail " << fail_count << std::endl;
+		assert(0 == fail_count);
+	}
+}
+}
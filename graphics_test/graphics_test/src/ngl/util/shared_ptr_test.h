@@ -0,0 +1,15 @@
+﻿#pragma once
+
+#include "shared_ptr.h"
+
+
+namespace ngl
+{
+namespace test
+{
+	// SharedPtrのテスト.
+	// 参照管理, 派生型からの変換, デリータ, アロケータ指定とMakeSharedの確保回数を検証し,
+	// new/delete, MakeShared, TLSFからのAllocateShared, std::make_sharedの生成破棄とコピーの速度を標準出力に出力する.
+	void SharedPtrBenchmark();
+}
+}
@@ -0,0 +1,346 @@
+﻿
+#include "profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+namespace ngl
+{
+namespace time
+{
+	thread_local ProfileThreadBuffer* Profiler::tls_buffer_ = nullptr;
+
+	// スレッド終了時に記録バッファを返却する.
+	struct ProfileThreadBufferHolder
+	{
+		~ProfileThreadBufferHolder()
+		{
+			if (buffer)
+				Profiler::Instance().ReleaseThreadBuffer(buffer);
+		}
+		ProfileThreadBuffer* buffer = nullptr;
+	};
+
+	namespace
+	{
+		thread_local ProfileThreadBufferHolder tls_buffer_holder;
+
+		s64 SteadyClockNanosec()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		// 集計の検索キー. 親ノードはスレッド毎のため, スレッドはルートのみキーに含める.
+		u64 MakeStatKey(u32 thread_index, s32 parent, u32 symbol_id)
+		{
+			if (0 <= parent)
+				return (static_cast<u64>(parent) << 32) | symbol_id;
+			return (u64(1) << 63) | (static_cast<u64>(thread_index & 0x7FFFFFFF) << 32) | symbol_id;
+		}
+
+		// JSON文字列としてエスケープして出力.
+		void WriteJsonString(std::ofstream& ofs, const char* str)
+		{
+			ofs << '"';
+			for (const char* p = str; *p; ++p)
+			{
+				const char c = *p;
+				if ('"' == c || '\\' == c)
+					ofs << '\\' << c;
+				else if (0x20 > static_cast<unsigned char>(c))
+					ofs << ' ';
+				else
+					ofs << c;
+			}
+			ofs << '"';
+		}
+	}
+
+	Profiler::Profiler()
+	{
+		// 初期の較正. 以降はEndFrame毎に計測開始からの経過で更新する.
+		calibration_tick_ = ProfileTick();
+		calibration_ns_ = SteadyClockNanosec();
+#if NGL_PROFILE_USE_RDTSC
+		while (SteadyClockNanosec() - calibration_ns_ < 1000000)
+		{
+		}
+		UpdateCalibration();
+#else
+		sec_per_tick_.store(static_cast<double>(std::chrono::steady_clock::period::num) / std::chrono::steady_clock::period::den);
+#endif
+	}
+	Profiler::~Profiler()
+	{
+		std::lock_guard<std::mutex> lock(buffer_mutex_);
+		for (auto* e : buffer_array_)
+			delete e;
+		buffer_array_.clear();
+	}
+
+	ProfileThreadBuffer* Profiler::RegisterCurrentThread()
+	{
+		Profiler& profiler = Instance();
+		std::lock_guard<std::mutex> lock(profiler.buffer_mutex_);
+
+		// 終了したスレッドのバッファを再利用する. 回収済みでない記録を別スレッドのものとして扱わないよう空の場合のみ.
+		ProfileThreadBuffer* buffer = nullptr;
+		for (auto* e : profiler.buffer_array_)
+		{
+			if (e->released_ && 0 == e->queue_.GetSizeApprox())
+			{
+				buffer = e;
+				break;
+			}
+		}
+		if (!buffer)
+		{
+			buffer = new ProfileThreadBuffer();
+			profiler.buffer_array_.push_back(buffer);
+		}
+		buffer->released_ = false;
+		buffer->depth = 0;
+		buffer->thread_index_ = static_cast<u32>(profiler.thread_name_array_.size());
+		buffer->thread_name_.clear();
+		profiler.thread_name_array_.push_back({});
+
+		tls_buffer_ = buffer;
+		tls_buffer_holder.buffer = buffer;
+		return buffer;
+	}
+	void Profiler::ReleaseThreadBuffer(ProfileThreadBuffer* p)
+	{
+		std::lock_guard<std::mutex> lock(buffer_mutex_);
+		p->released_ = true;
+		tls_buffer_ = nullptr;
+	}
+
+	void Profiler::SetThreadName(const char* name)
+	{
+		ProfileThreadBuffer* buffer = GetThreadBuffer();
+		std::lock_guard<std::mutex> lock(buffer_mutex_);
+		buffer->thread_name_ = name;
+		thread_name_array_[buffer->thread_index_] = name;
+	}
+	const char* Profiler::GetThreadName(u32 thread_index) const
+	{
+		std::lock_guard<std::mutex> lock(buffer_mutex_);
+		return (thread_index < thread_name_array_.size()) ? thread_name_array_[thread_index].c_str() : "";
+	}
+
+	void Profiler::UpdateCalibration()
+	{
+#if NGL_PROFILE_USE_RDTSC
+		const u64 tick = ProfileTick();
+		const s64 ns = SteadyClockNanosec();
+		if (tick > calibration_tick_ && ns > calibration_ns_)
+			sec_per_tick_.store(static_cast<double>(ns - calibration_ns_) * 1e-9 / static_cast<double>(tick - calibration_tick_), std::memory_order_relaxed);
+#endif
+	}
+
+	text::TextSymbol Profiler::GetNameSymbol(const char* name)
+	{
+		auto it = name_symbol_cache_.find(name);
+		if (name_symbol_cache_.end() != it)
+			return it->second;
+		const text::TextSymbol symbol(name);
+		name_symbol_cache_.insert(std::make_pair(name, symbol));
+		return symbol;
+	}
+
+	void Profiler::EndFrame()
+	{
+		UpdateCalibration();
+		const double sec_per_tick = GetSecPerTick();
+
+		{
+			// thread_index_はバッファ再利用時にロック中で書き換わるため, 同じロック中に読む.
+			std::lock_guard<std::mutex> lock(buffer_mutex_);
+			work_buffer_array_.clear();
+			for (auto* e : buffer_array_)
+				work_buffer_array_.push_back({ e, e->thread_index_ });
+		}
+
+		work_stat_node_.clear();
+		work_thread_root_.clear();
+		work_stat_map_.clear();
+		for (const auto& [buffer, thread_index] : work_buffer_array_)
+		{
+			work_record_.clear();
+			ProfileZoneRecord record;
+			while (buffer->queue_.TryPop(record))
+				work_record_.push_back(record);
+			if (work_record_.empty())
+				continue;
+
+			if (0 < capture_remain_frame_)
+			{
+				for (const auto& e : work_record_)
+					capture_record_.push_back({ e, thread_index });
+			}
+			BuildThreadStat(thread_index, work_record_);
+		}
+
+		// 親の直後に子が並ぶ順で出力.
+		last_frame_stat_.clear();
+		std::vector<std::pair<s32, s32>> stack;// node, 出力先の親インデックス.
+		for (s32 root : work_thread_root_)
+		{
+			stack.push_back({ root, -1 });
+			while (!stack.empty())
+			{
+				const auto [node_index, parent_out] = stack.back();
+				stack.pop_back();
+				const StatNode& node = work_stat_node_[node_index];
+				const s32 out_index = static_cast<s32>(last_frame_stat_.size());
+				last_frame_stat_.push_back(node.stat);
+				last_frame_stat_.back().parent = parent_out;
+				last_frame_stat_.back().total_sec *= sec_per_tick;
+				last_frame_stat_.back().max_sec *= sec_per_tick;
+
+				// 兄弟の順序を保つため逆順に積む.
+				const size_t child_begin = stack.size();
+				for (s32 c = node.first_child; 0 <= c; c = work_stat_node_[c].next_sibling)
+					stack.push_back({ c, out_index });
+				std::reverse(stack.begin() + child_begin, stack.end());
+			}
+		}
+
+		if (0 < capture_remain_frame_)
+			--capture_remain_frame_;
+	}
+
+	void Profiler::BuildThreadStat(u32 thread_index, std::vector<ProfileZoneRecord>& record)
+	{
+		// 終了順に積まれているため開始順に並べ替える. 同時刻は浅いものが先.
+		std::sort(record.begin(), record.end(), [](const ProfileZoneRecord& a, const ProfileZoneRecord& b)
+			{
+				return (a.begin_tick != b.begin_tick) ? (a.begin_tick < b.begin_tick) : (a.depth < b.depth);
+			});
+
+		// 開いているゾーンの記録と集計ノード.
+		std::vector<std::pair<const ProfileZoneRecord*, s32>> open_stack;
+		for (const auto& e : record)
+		{
+			// 親は開始済みで浅く, 終了していないゾーン. 親がまだ終了していない(未回収)場合はルートとして扱う.
+			while (!open_stack.empty() && (open_stack.back().first->depth >= e.depth || open_stack.back().first->end_tick < e.begin_tick))
+				open_stack.pop_back();
+			const s32 parent = open_stack.empty() ? -1 : open_stack.back().second;
+
+			const text::TextSymbol symbol = GetNameSymbol(e.name);
+			const u64 key = MakeStatKey(thread_index, parent, symbol.GetId());
+			s32 node_index;
+			auto it = work_stat_map_.find(key);
+			if (work_stat_map_.end() != it)
+			{
+				node_index = it->second;
+			}
+			else
+			{
+				node_index = static_cast<s32>(work_stat_node_.size());
+				work_stat_map_.insert(std::make_pair(key, node_index));
+
+				StatNode node;
+				node.stat.name = e.name;
+				node.stat.thread_index = thread_index;
+				node.stat.depth = parent < 0 ? 0 : work_stat_node_[parent].stat.depth + 1;
+				work_stat_node_.push_back(node);
+				if (0 > parent)
+				{
+					work_thread_root_.push_back(node_index);
+				}
+				else
+				{
+					StatNode& parent_node = work_stat_node_[parent];
+					if (0 > parent_node.last_child)
+						parent_node.first_child = node_index;
+					else
+						work_stat_node_[parent_node.last_child].next_sibling = node_index;
+					parent_node.last_child = node_index;
+				}
+			}
+
+			// 集計はtick単位で行い, 出力時に秒へ変換する.
+			StatNode& node = work_stat_node_[node_index];
+			const double duration = static_cast<double>(e.end_tick - e.begin_tick);
+			++node.stat.count;
+			node.stat.total_sec += duration;
+			node.stat.max_sec = std::max(node.stat.max_sec, duration);
+
+			open_stack.push_back({ &e, node_index });
+		}
+	}
+
+	double Profiler::GetLastFrameZoneSec(const char* name) const
+	{
+		const text::TextSymbol symbol = text::TextSymbol::Find(name);
+		if (!symbol.IsValid())
+			return 0.0;
+		double sec = 0.0;
+		for (const auto& e : last_frame_stat_)
+		{
+			if (e.name == name || text::TextSymbol::Find(e.name) == symbol)
+				sec += e.total_sec;
+		}
+		return sec;
+	}
+
+	void Profiler::BeginCapture(u32 frame_count)
+	{
+		capture_record_.clear();
+		capture_remain_frame_ = frame_count;
+	}
+
+	bool Profiler::ExportChromeTrace(const char* file_path) const
+	{
+		std::ofstream ofs(file_path);
+		if (!ofs.is_open())
+			return false;
+
+		u64 base_tick = ~u64(0);
+		for (const auto& e : capture_record_)
+			base_tick = std::min(base_tick, e.record.begin_tick);
+		const double usec_per_tick = GetSecPerTick() * 1e6;
+
+		ofs << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		bool first = true;
+		// スレッド名.
+		{
+			std::lock_guard<std::mutex> lock(buffer_mutex_);
+			for (size_t i = 0; i < thread_name_array_.size(); ++i)
+			{
+				if (thread_name_array_[i].empty())
+					continue;
+				ofs << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << i << ",\"args\":{\"name\":";
+				WriteJsonString(ofs, thread_name_array_[i].c_str());
+				ofs << "}}";
+				first = false;
+			}
+		}
+		// ゾーン. 完了イベントとして出力する.
+		ofs.setf(std::ios::fixed);
+		ofs.precision(3);
+		for (const auto& e : capture_record_)
+		{
+			ofs << (first ? "" : ",\n") << "{\"name\":";
+			WriteJsonString(ofs, e.record.name);
+			ofs << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << e.thread_index
+				<< ",\"ts\":" << static_cast<double>(e.record.begin_tick - base_tick) * usec_per_tick
+				<< ",\"dur\":" << static_cast<double>(e.record.end_tick - e.record.begin_tick) * usec_per_tick << "}";
+			first = false;
+		}
+		ofs << "\n]}\n";
+		return ofs.good();
+	}
+
+	u64 Profiler::GetDroppedCount() const
+	{
+		std::lock_guard<std::mutex> lock(buffer_mutex_);
+		u64 count = 0;
+		for (const auto* e : buffer_array_)
+			count += e->dropped_count_.load(std::memory_order_relaxed);
+		return count;
+	}
+}
+}
@@ -0,0 +1,237 @@
+﻿#pragma once
+
+#ifndef _NGL_UTIL_PROFILER_
+#define _NGL_UTIL_PROFILER_
+
+/*
+	CPUプロファイラ.
+
+	スコープ単位のゾーン計測. ゾーンの開始と終了の時刻をスレッド毎のSPSCリングバッファに積み, EndFrameでまとめて回収する.
+		計測側はロックもハッシュ検索も行わない. 時刻はx64ではrdtsc, それ以外はsteady_clock.
+		ゾーン名は文字列リテラル等の寿命が無限の文字列を渡すこと. 計測時はポインタのみ保持する.
+		ゾーンの入れ子はスレッド毎に開始時刻の順で復元し, フレーム毎にスレッド, 親ゾーン, 名前で集計する.
+		リングバッファが満杯の場合は記録を破棄してGetDroppedCountで数える.
+
+	BeginCaptureで指定フレーム数の全記録を保持し, ExportChromeTraceでChrome Trace形式(chrome://tracing, Perfetto)のJSONを出力する.
+
+	void Func()
+	{
+		NGL_PROFILE_SCOPE("Func");
+		{
+			NGL_PROFILE_SCOPE("Inner");
+		}
+	}
+	// メインループ.
+	ngl::time::Profiler::Instance().EndFrame();
+	for (const auto& e : ngl::time::Profiler::Instance().GetLastFrameStat()) {...}
+*/
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__x86_64__)
+	#define NGL_PROFILE_USE_RDTSC 1
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+	#else
+		#include <x86intrin.h>
+	#endif
+#else
+	#define NGL_PROFILE_USE_RDTSC 0
+	#include <chrono>
+#endif
+
+#include "ngl/util/types.h"
+#include "ngl/util/singleton.h"
+#include "ngl/thread/bounded_ring_queue.h"
+#include "ngl/text/text_symbol.h"
+
+namespace ngl
+{
+	namespace time
+	{
+		// プロファイラの時刻. 単位はProfiler::GetSecPerTick.
+		inline u64 ProfileTick()
+		{
+#if NGL_PROFILE_USE_RDTSC
+			return __rdtsc();
+#else
+			return static_cast<u64>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+		}
+
+		// ゾーン1回分の記録.
+		struct ProfileZoneRecord
+		{
+			const char*	name = nullptr;
+			u64			begin_tick = 0;
+			u64			end_tick = 0;
+			u32			depth = 0;
+		};
+
+		// スレッド毎の記録バッファ. Producerは所属スレッド, ConsumerはEndFrameを呼ぶスレッド.
+		class ProfileThreadBuffer
+		{
+			friend class Profiler;
+		public:
+			static constexpr u32 k_capacity_exp = 14;
+
+			void Push(const ProfileZoneRecord& record)
+			{
+				if (!queue_.TryPush(record))
+					dropped_count_.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			u32		depth = 0;
+
+		private:
+			thread::BoundedRingQueue<ProfileZoneRecord, k_capacity_exp, thread::RingQueueType::SPSC> queue_;
+			std::atomic<u64>	dropped_count_ = 0;
+			// 以下はProfilerのロック中に更新.
+			u32					thread_index_ = 0;
+			std::string			thread_name_;
+			bool				released_ = false;
+		};
+
+		// フレーム毎のゾーン集計.
+		struct ProfileZoneStat
+		{
+			const char*	name = nullptr;
+			u32			thread_index = 0;
+			s32			parent = -1;// GetLastFrameStat内の親のインデックス. スレッドのルートは-1.
+			u32			depth = 0;
+			u32			count = 0;
+			double		total_sec = 0.0;
+			double		max_sec = 0.0;
+		};
+
+		class Profiler : public Singleton<Profiler>
+		{
+		public:
+			Profiler();
+			~Profiler();
+
+			// 呼び出しスレッドの記録バッファ. 初回のみ登録処理.
+			static ProfileThreadBuffer* GetThreadBuffer()
+			{
+				ProfileThreadBuffer* p = tls_buffer_;
+				return (p) ? p : RegisterCurrentThread();
+			}
+
+			// 呼び出しスレッドの名前. Trace出力と集計の表示用.
+			void SetThreadName(const char* name);
+
+			// 全スレッドの記録を回収して集計する. 1フレームに1回, 単一のスレッドから呼び出す.
+			void EndFrame();
+
+			// 直前のEndFrameの集計. スレッド毎に親ゾーンの直後に子ゾーンが並ぶ.
+			const std::vector<ProfileZoneStat>& GetLastFrameStat() const { return last_frame_stat_; }
+			// 直前のEndFrameで指定名のゾーンの合計時間[秒].
+			double GetLastFrameZoneSec(const char* name) const;
+			// スレッド名. 無ければ空文字列.
+			const char* GetThreadName(u32 thread_index) const;
+
+			// frame_count回のEndFrameで回収した全記録を保持する.
+			void BeginCapture(u32 frame_count);
+			bool IsCapturing() const { return 0 < capture_remain_frame_; }
+			// キャプチャした記録をChrome Trace形式で出力する.
+			bool ExportChromeTrace(const char* file_path) const;
+
+			// リングバッファ満杯で破棄した記録数.
+			u64 GetDroppedCount() const;
+			double GetSecPerTick() const { return sec_per_tick_.load(std::memory_order_relaxed); }
+
+		private:
+			static ProfileThreadBuffer* RegisterCurrentThread();
+			friend struct ProfileThreadBufferHolder;
+			void ReleaseThreadBuffer(ProfileThreadBuffer* p);
+
+			void UpdateCalibration();
+			// 1スレッド分の記録から集計を構築する.
+			void BuildThreadStat(u32 thread_index, std::vector<ProfileZoneRecord>& record);
+			text::TextSymbol GetNameSymbol(const char* name);
+
+			struct CaptureRecord
+			{
+				ProfileZoneRecord	record;
+				u32					thread_index;
+			};
+			struct StatNode
+			{
+				ProfileZoneStat	stat;
+				s32				first_child = -1;
+				s32				last_child = -1;
+				s32				next_sibling = -1;
+			};
+
+		private:
+			static thread_local ProfileThreadBuffer* tls_buffer_;
+
+			mutable std::mutex					buffer_mutex_;
+			std::vector<ProfileThreadBuffer*>	buffer_array_;
+			std::vector<std::string>			thread_name_array_;
+
+			// tick -> 秒の較正. 計測開始からの経過で随時更新する.
+			u64		calibration_tick_ = 0;
+			s64		calibration_ns_ = 0;
+			std::atomic<double>	sec_per_tick_ = 0.0;
+
+			// EndFrameの作業領域と結果. EndFrameを呼ぶスレッドのみアクセス.
+			std::vector<std::pair<ProfileThreadBuffer*, u32>>	work_buffer_array_;// バッファとロック中に読んだthread_index_.
+			std::vector<ProfileZoneRecord>			work_record_;
+			std::vector<StatNode>					work_stat_node_;
+			std::vector<s32>						work_thread_root_;
+			std::unordered_map<u64, s32>			work_stat_map_;
+			std::unordered_map<const char*, text::TextSymbol>	name_symbol_cache_;
+			std::vector<ProfileZoneStat>			last_frame_stat_;
+
+			u32							capture_remain_frame_ = 0;
+			std::vector<CaptureRecord>	capture_record_;
+		};
+
+		// スコープの開始から終了までを記録する.
+		class ScopedProfileZone
+		{
+		public:
+			explicit ScopedProfileZone(const char* name)
+				: name_(name)
+				, buffer_(Profiler::GetThreadBuffer())
+			{
+				depth_ = buffer_->depth++;
+				begin_tick_ = ProfileTick();
+			}
+			~ScopedProfileZone()
+			{
+				const u64 end_tick = ProfileTick();
+				--buffer_->depth;
+				buffer_->Push({ name_, begin_tick_, end_tick, depth_ });
+			}
+			ScopedProfileZone(const ScopedProfileZone&) = delete;
+			ScopedProfileZone& operator=(const ScopedProfileZone&) = delete;
+
+			// 開始からの経過時間[秒].
+			double GetElapsedSec() const
+			{
+				return static_cast<double>(ProfileTick() - begin_tick_) * Profiler::Instance().GetSecPerTick();
+			}
+
+		private:
+			const char*				name_;
+			ProfileThreadBuffer*	buffer_;
+			u64						begin_tick_ = 0;
+			u32						depth_ = 0;
+		};
+	}
+}
+
+#define JOIN_AGAIN_NGL_PROFILE_SCOPE(a,b) a ## b
+#define JOIN_NGL_PROFILE_SCOPE(a,b) JOIN_AGAIN_NGL_PROFILE_SCOPE(a, b)
+// スコープのプロファイルゾーン. nameは文字列リテラル等の寿命が無限の文字列.
+//	ex. NGL_PROFILE_SCOPE("RtgCompile");
+#define NGL_PROFILE_SCOPE(name) const ngl::time::ScopedProfileZone JOIN_NGL_PROFILE_SCOPE(scoped_profile_zone_ , __LINE__) (name);
+
+#endif // _NGL_UTIL_PROFILER_
@@ -0,0 +1,178 @@
+﻿
+#include "profiler_test.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <assert.h>
+
+#include "ngl/thread/job_thread.h"
+
+namespace ngl
+{
+namespace time
+{
+namespace test
+{
+	namespace
+	{
+		using Clock = std::chrono::steady_clock;
+
+		constexpr int k_zone_loop = 1000000;
+		// リングバッファが溢れないように回収する間隔.
+		constexpr int k_zone_per_frame = 8 * 1024;
+		constexpr int k_job_count = 256;
+
+		const ProfileZoneStat* FindStat(const std::vector<ProfileZoneStat>& stat, const char* name)
+		{
+			for (const auto& e : stat)
+			{
+				if (0 == std::strcmp(e.name, name))
+					return &e;
+			}
+			return nullptr;
+		}
+	}
+
+	void ProfilerBenchmark()
+	{
+		int fail_count = 0;
+		Profiler& profiler = Profiler::Instance();
+		profiler.SetThreadName("ProfilerTest");
+		// 以前の記録を破棄.
+		profiler.EndFrame();
+
+		// 入れ子ゾーンの集計.
+		{
+			for (int i = 0; i < 2; ++i)
+			{
+				NGL_PROFILE_SCOPE("ProfilerTestOuter");
+				for (int j = 0; j < 3; ++j)
+				{
+					NGL_PROFILE_SCOPE("ProfilerTestInner");
+				}
+			}
+			profiler.EndFrame();
+
+			const auto& stat = profiler.GetLastFrameStat();
+			const ProfileZoneStat* outer = FindStat(stat, "ProfilerTestOuter");
+			const ProfileZoneStat* inner = FindStat(stat, "ProfilerTestInner");
+			if (!outer || !inner)
+			{
+				++fail_count;
+			}
+			else
+			{
+				if (2 != outer->count || 0 <= outer->parent || 0 != outer->depth)
+					++fail_count;
+				if (6 != inner->count || 1 != inner->depth || 0 > inner->parent || &stat[inner->parent] != outer)
+					++fail_count;
+				if (outer->total_sec < inner->total_sec || outer->max_sec > outer->total_sec)
+					++fail_count;
+				if (0 != std::strcmp(profiler.GetThreadName(outer->thread_index), "ProfilerTest"))
+					++fail_count;
+			}
+			if (0.0 >= profiler.GetLastFrameZoneSec("ProfilerTestOuter"))
+				++fail_count;
+		}
+
+		// Workerスレッドからの記録.
+		{
+			thread::JobSystem job_system;
+			job_system.Init(4);
+			for (int i = 0; i < k_job_count; ++i)
+			{
+				job_system.Add([]()
+					{
+						NGL_PROFILE_SCOPE("ProfilerTestJob");
+					});
+			}
+			job_system.WaitAll();
+			profiler.EndFrame();
+
+			// NGL_JOB_PROFILE_ENABLEではJobの実行はExecuteJobのゾーン内.
+			u32 job_count = 0;
+			for (const auto& e : profiler.GetLastFrameStat())
+			{
+				if (0 == std::strcmp(e.name, "ProfilerTestJob"))
+				{
+					job_count += e.count;
+#if NGL_JOB_PROFILE_ENABLE
+					if (0 > e.parent || 0 != std::strcmp(profiler.GetLastFrameStat()[e.parent].name, "Job"))
+						++fail_count;
+#else
+					if (0 <= e.parent)
+						++fail_count;
+#endif
+				}
+			}
+			if (k_job_count != job_count)
+				++fail_count;
+		}
+
+		// Chrome Trace出力.
+		{
+			profiler.BeginCapture(2);
+			for (int f = 0; f < 2; ++f)
+			{
+				NGL_PROFILE_SCOPE("ProfilerTestCapture");
+				{
+					NGL_PROFILE_SCOPE("ProfilerTestCapture\"Quote");
+				}
+			}
+			profiler.EndFrame();
+			if (!profiler.IsCapturing())
+				++fail_count;
+			profiler.EndFrame();
+			if (profiler.IsCapturing())
+				++fail_count;
+
+			const char* k_trace_path = "./profiler_test_trace.json";
+			if (!profiler.ExportChromeTrace(k_trace_path))
+				++fail_count;
+			std::ifstream ifs(k_trace_path);
+			std::stringstream ss;
+			ss << ifs.rdbuf();
+			ifs.close();
+			std::remove(k_trace_path);
+
+			const std::string json = ss.str();
+			if (std::string::npos == json.find("\"traceEvents\"")
+				|| std::string::npos == json.find("\"ProfilerTest\"")
+				|| std::string::npos == json.find("\"ProfilerTestCapture\\\"Quote\""))
+				++fail_count;
+		}
+
+		// 計測コスト.
+		double zone_nanosec = 0.0;
+		{
+			Clock::duration total{};
+			for (int l = 0; l < k_zone_loop; l += k_zone_per_frame)
+			{
+				const auto t0 = Clock::now();
+				for (int i = 0; i < k_zone_per_frame; ++i)
+				{
+					NGL_PROFILE_SCOPE("ProfilerTestCost");
+				}
+				total += Clock::now() - t0;
+				profiler.EndFrame();
+			}
+			const int loop = (k_zone_loop + k_zone_per_frame - 1) / k_zone_per_frame * k_zone_per_frame;
+			zone_nanosec = std::chrono::duration<double, std::nano>(total).count() / loop;
+		}
+		if (0 != profiler.GetDroppedCount())
+			++fail_count;
+
+		std::cout << "[ProfilerBenchmark] sec per tick " << profiler.GetSecPerTick() << std::endl;
+		std::cout << "  zone cost : " << zone_nanosec << " ns" << std::endl;
+		std::cout << "  fail " << fail_count << std::endl;
+		assert(0 == fail_count);
+	}
+}
+}
+}
@@ -0,0 +1,18 @@
+﻿#pragma once
+
+#include "profiler.h"
+
+
+namespace ngl
+{
+namespace time
+{
+namespace test
+{
+	// Profilerのテスト.
+	// 入れ子ゾーンの集計, JobSystemのWorkerスレッドからの記録, Chrome Trace出力を検証し,
+	// ゾーン1回あたりの計測コストを標準出力に出力する.
+	void ProfilerBenchmark();
+}
+}
+}
@@ -17,13 +17,21 @@ namespace time
 		timers_.clear();
 	}
 
+	Timer::TimerMapType::iterator Timer::FindTimer(const char* name)
+	{
+		const TimerName key = TimerName::Find(name);
+		if (!key.IsValid())
+			return timers_.end();
+		return timers_.find(key);
+	}
+
 	void	Timer::StartTimer(const char* name)
 	{
-		TimerMapType::iterator it = timers_.find(name);
+		const TimerName key(name);
+		TimerMapType::iterator it = timers_.find(key);
 		if (timers_.end() == it)
 		{
-			timers_.insert(std::pair<TimerName, Timer::TimerEntity >(name, Timer::TimerEntity()));
-			it = timers_.find(name);
+			it = timers_.insert(std::pair<TimerName, Timer::TimerEntity >(key, Timer::TimerEntity())).first;
 		}
 		QueryPerformanceCounter(&it->second.time_begin_);
 		
@@ -37,7 +45,7 @@ namespace time
 	// 経過時間をパフォーマンスカウンタのまま取得
 	ngl::s64 Timer::GetPerformanceCounter(const char* name)
 	{
-		TimerMapType::iterator it = timers_.find(name);
+		TimerMapType::iterator it = FindTimer(name);
 		if (timers_.end() == it)
 		{
 			return 0;
@@ -47,7 +55,7 @@ namespace time
 	}
 	void	Timer::RemoveTimer(const char* name)
 	{
-		TimerMapType::iterator it = timers_.find(name);
+		TimerMapType::iterator it = FindTimer(name);
 		if (timers_.end() == it)
 		{
 			return;
@@ -58,7 +66,7 @@ namespace time
 	// タイマーを一時停止
 	void	Timer::SuspendTimer(const char* name)
 	{
-		TimerMapType::iterator it = timers_.find(name);
+		TimerMapType::iterator it = FindTimer(name);
 		if (timers_.end() == it)
 			return;
 		if (0 <= it->second.time_stop_start_.QuadPart)
@@ -68,7 +76,7 @@ namespace time
 	// タイマーを再開
 	void	Timer::ResumeTimer(const char* name)
 	{
-		TimerMapType::iterator it = timers_.find(name);
+		TimerMapType::iterator it = FindTimer(name);
 		if (timers_.end() == it)
 			return;
 		if (0 > it->second.time_stop_start_.QuadPart)
@@ -81,7 +89,7 @@ namespace time
 	// 
 	ngl::s64 Timer::GetSuspendTotalPerformanceCounter(const char* name)
 	{
-		TimerMapType::iterator it = timers_.find(name);
+		TimerMapType::iterator it = FindTimer(name);
 		if (timers_.end() == it)
 			return 0;
 		LARGE_INTEGER time;
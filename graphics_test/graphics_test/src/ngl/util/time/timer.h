@@ -12,7 +12,8 @@
 
 	名前を指定しないとデフォルトタイマーを使います
 
-	map をstd::stringからhashTextに変更したいかも
+	タイマー名はTextSymbolで保持し, mapの検索は識別子の比較で行う.
+	StartTimer以外は未登録の名前をシンボルプールに登録しない.
 
 */
 
@@ -26,14 +27,14 @@
 
 #include "ngl/util/types.h"
 #include "ngl/util/singleton.h"
-#include "ngl/text/hash_text.h"
+#include "ngl/text/text_symbol.h"
 
 namespace ngl
 {
 	namespace time
 	{
 		//typedef ngl::text::HashText<64>	TimerName;
-		using TimerName = ngl::text::HashText<64>;
+		using TimerName = ngl::text::TextSymbol;
 
 
 		class Timer : public Singleton< Timer >
@@ -91,6 +92,9 @@ namespace ngl
 			//using TimerMapType = std::map<TimerName, Timer::TimerEntity>;
 			using TimerMapType = std::unordered_map<TimerName, TimerEntity>;
 
+			// 登録済みのタイマーを検索. 未登録の名前はシンボルプールに登録せずend()を返す.
+			TimerMapType::iterator FindTimer(const char* name);
+
 			TimerMapType timers_ = {};
 		};
 	}
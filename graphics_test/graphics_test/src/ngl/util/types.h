@@ -3,10 +3,15 @@
 #ifndef _NGL_UTIL_TYPES_
 #define _NGL_UTIL_TYPES_
 
+#if !defined(_MSC_VER)
+#include <cstdint>
+#endif
+
 namespace ngl
 {
 	namespace types
 	{
+#if defined(_MSC_VER)
 		typedef __int8			  s8;
 		typedef __int16			 s16;
 		typedef __int32			 s32;
@@ -15,6 +20,17 @@ namespace ngl
 		typedef unsigned __int16	u16;
 		typedef unsigned __int32	u32;
 		typedef unsigned __int64	u64;
+#else
+		// MSVC以外(Linuxでのベンチマーク等).
+		typedef int8_t			  s8;
+		typedef int16_t			 s16;
+		typedef int32_t			 s32;
+		typedef int64_t			 s64;
+		typedef uint8_t			 u8;
+		typedef uint16_t			u16;
+		typedef uint32_t			u32;
+		typedef uint64_t			u64;
+#endif
 
 		typedef float			   f32;
 		typedef double			  f64;
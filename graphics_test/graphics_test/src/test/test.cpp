@@ -26,6 +26,22 @@
 
 #include "ngl/thread/lockfree_stack_intrusive.h"
 #include "ngl/thread/lockfree_stack_intrusive_test.h"
+#include "ngl/thread/job_thread_test.h"
+#include "ngl/thread/parallel_for_test.h"
+#include "ngl/thread/bounded_ring_queue_test.h"
+#include "ngl/memory/tlsf_allocator_core_test.h"
+#include "ngl/memory/tlsf_concurrent_allocator_test.h"
+#include "ngl/memory/tlsf_growable_heap_test.h"
+#include "ngl/memory/frame_arena_allocator_test.h"
+#include "ngl/rhi/rhi_object_garbage_collect_test.h"
+#include "ngl/rhi/rhi_ref_test.h"
+#include "ngl/util/instance_handle_test.h"
+#include "ngl/util/shared_ptr_test.h"
+#include "ngl/text/text_symbol_test.h"
+#include "ngl/text/hash_text_test.h"
+#include "ngl/util/time/profiler_test.h"
+#include "ngl/math/math_simd_test.h"
+#include "ngl/math/math_bvh_test.h"
 
 
 
@@ -467,6 +483,90 @@ namespace ngl_test
 		{
 			ngl::thread::test::LockfreeStackIntrusiveTest();
 		}
+		if (false)
+		{
+			ngl::thread::test::LockfreeStackIntrusiveStressTest();
+		}
+		if (false)
+		{
+			ngl::memory::test::TlsfAllocatorCoreBenchmark();
+		}
+		if (false)
+		{
+			ngl::memory::test::TlsfConcurrentAllocatorTest();
+		}
+		if (false)
+		{
+			ngl::memory::test::TlsfGrowableHeapTest();
+		}
+		if (false)
+		{
+			ngl::memory::test::FrameArenaAllocatorTest();
+		}
+		if (false)
+		{
+			ngl::thread::test::JobSystemBenchmark();
+		}
+		if (false)
+		{
+			ngl::thread::test::JobSystemDependencyTest();
+		}
+		if (false)
+		{
+			ngl::thread::test::ParallelForBenchmark();
+		}
+		if (false)
+		{
+			ngl::thread::test::BoundedRingQueueBenchmark();
+		}
+		if (false)
+		{
+			ngl::rhi::test::GabageCollectorTest();
+		}
+		if (false)
+		{
+			ngl::test::InstanceHandleBenchmark();
+		}
+		if (false)
+		{
+			ngl::rhi::test::RhiRefBenchmark();
+		}
+		if (false)
+		{
+			ngl::test::SharedPtrBenchmark();
+		}
+		if (false)
+		{
+			ngl::text::test::TextSymbolTest();
+		}
+		if (false)
+		{
+			ngl::text::test::HashTextBenchmark();
+		}
+		if (false)
+		{
+			ngl::time::test::ProfilerBenchmark();
+		}
+		if (false)
+		{
+			ngl::math::test::MathSimdBenchmark();
+		}
+		if (false)
+		{
+			ngl::math::test::MathTransformBatchBenchmark();
+		}
+		if (false)
+		{
+			ngl::math::test::MathFrustumCullingBenchmark();
+		}
+		if (false)
+		{
+			ngl::math::test::MathShadowCascadeCullingBenchmark();
+		}
+		if (false)
+		{
+			ngl::math::test::MathBvhBenchmark();
+		}
 
 
 		constexpr auto ce_str = ConstexprString("abc");